@@ -0,0 +1,180 @@
+#include "asset_loader.h"
+#include "clock.h"
+#include <chrono>
+
+const char *AssetLoader::LOG_SRC = "AssetLoader";
+const char *StartupLog::LOG_SRC = "Startup";
+
+double asset_loader_now(void)
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+AssetLoader::~AssetLoader(void)
+{
+    Stop();
+}
+
+void AssetLoader::Start(size_t workerCount)
+{
+    DLB_ASSERT(workerCount);
+    Stop();
+    stop = false;
+    queued = 0;
+    timings.clear();
+    startedAt = asset_loader_now();
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this] {
+            Run();
+        });
+    }
+}
+
+void AssetLoader::Stop(void)
+{
+    if (workers.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    loaded.clear();
+}
+
+void AssetLoader::Queue(const char *name, LoadFn load, FinishFn finish)
+{
+    DLB_ASSERT(!workers.empty());
+    DLB_ASSERT(load);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job &job = jobs.emplace_back();
+        job.name = name;
+        job.load = load;
+        job.finish = finish;
+    }
+    queued++;
+    wake.notify_one();
+}
+
+size_t AssetLoader::Poll(void)
+{
+    std::vector<Job> finished{};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(loaded);
+    }
+
+    for (Job &job : finished) {
+        const double finishStart = asset_loader_now();
+        if (job.finish) {
+            job.finish();
+        }
+        const double finishEnd = asset_loader_now();
+
+        Timing &timing = timings.emplace_back();
+        timing.name = job.name;
+        timing.err = job.err;
+        timing.loadSecs = job.loadSecs;
+        timing.finishSecs = finishEnd - finishStart;
+        timing.doneAt = finishEnd - startedAt;
+        if (job.err != ErrorType::Success) {
+            E_WARN("Failed to load %s (%d)", job.name, (int)job.err);
+        }
+    }
+    return finished.size();
+}
+
+void AssetLoader::Wait(std::function<void(void)> onProgress)
+{
+    while (!Done()) {
+        if (!Poll()) {
+            if (onProgress) {
+                onProgress();
+            } else {
+                std::unique_lock<std::mutex> lock(mutex);
+                loadDone.wait(lock, [this] { return !loaded.empty(); });
+            }
+        }
+    }
+    if (onProgress) {
+        onProgress();
+    }
+}
+
+size_t AssetLoader::JobsFailed(void) const
+{
+    size_t failed = 0;
+    for (const Timing &timing : timings) {
+        failed += timing.err != ErrorType::Success;
+    }
+    return failed;
+}
+
+void AssetLoader::LogTimings(void) const
+{
+    double loadSecs = 0;
+    double finishSecs = 0;
+    for (const Timing &timing : timings) {
+        E_DEBUG("%-24s load %7.2f ms, finish %7.2f ms, done at %7.2f ms", timing.name,
+            timing.loadSecs * 1000.0, timing.finishSecs * 1000.0, timing.doneAt * 1000.0);
+        loadSecs += timing.loadSecs;
+        finishSecs += timing.finishSecs;
+    }
+    const double wallSecs = timings.size() ? timings.back().doneAt : 0;
+    E_INFO("Loaded %zu assets (%zu failed) in %.2f ms on %zu workers: %.2f ms loading, %.2f ms finishing",
+        timings.size(), JobsFailed(), wallSecs * 1000.0, workers.size(), loadSecs * 1000.0, finishSecs * 1000.0);
+}
+
+void AssetLoader::Run(void)
+{
+    Job job{};
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stop || !jobs.empty(); });
+            if (stop) {
+                break;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        const double loadStart = asset_loader_now();
+        job.err = job.load();
+        job.loadSecs = asset_loader_now() - loadStart;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                break;
+            }
+            loaded.push_back(job);
+        }
+        loadDone.notify_one();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void StartupLog::Start(void)
+{
+    stages.clear();
+    startedAt = asset_loader_now();
+}
+
+double StartupLog::Mark(const char *stage)
+{
+    const double at = asset_loader_now() - startedAt;
+    stages.push_back({ stage, at });
+    E_INFO("%-24s %8.2f ms", stage, at * 1000.0);
+    return at;
+}
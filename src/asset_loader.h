@@ -0,0 +1,88 @@
+#pragma once
+#include "error.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Loads startup assets on a small pool of worker threads. Each job does its file I/O and decoding in Load (on a
+// worker), then Finish runs on whichever thread calls Poll (i.e. the render thread) for anything that has to touch the
+// GPU or the audio device. The catalogs are thread_local, so jobs must capture pointers to the render thread's
+// instances rather than naming the globals from Load.
+struct AssetLoader {
+    typedef std::function<ErrorType(void)> LoadFn;
+    typedef std::function<void(void)>      FinishFn;
+
+    struct Timing {
+        const char *name       {};
+        ErrorType   err        {};
+        double      loadSecs   {};  // time spent in Load on a worker
+        double      finishSecs {};  // time spent in Finish on the render thread
+        double      doneAt     {};  // secs since Start when Finish returned
+    };
+
+    ~AssetLoader(void);
+
+    void   Start         (size_t workerCount);
+    void   Stop          (void);
+    // Finish is called even if Load fails, so that the job can fall back to a placeholder
+    void   Queue         (const char *name, LoadFn load, FinishFn finish);
+    // Finish every job that's done loading, returns number of jobs finished
+    size_t Poll          (void);
+    // Poll until every queued job has finished, calling onProgress (if any) between polls
+    void   Wait          (std::function<void(void)> onProgress = 0);
+    size_t JobsQueued    (void) const { return queued; }
+    size_t JobsFinished  (void) const { return timings.size(); }
+    size_t JobsFailed    (void) const;
+    float  Progress      (void) const { return queued ? (float)timings.size() / queued : 1.0f; }
+    bool   Done          (void) const { return timings.size() == queued; }
+    void   LogTimings    (void) const;
+
+    std::vector<Timing> timings {};  // in the order jobs finished
+
+private:
+    static const char *LOG_SRC;
+
+    struct Job {
+        const char *name     {};
+        LoadFn      load     {};
+        FinishFn    finish   {};
+        ErrorType   err      {};
+        double      loadSecs {};
+    };
+
+    std::vector<std::thread> workers   {};
+    std::mutex               mutex     {};
+    std::condition_variable  wake      {};  // workers wait for jobs
+    std::condition_variable  loadDone  {};  // Wait waits for loaded jobs
+    bool                     stop      {};
+    std::deque<Job>          jobs      {};  // waiting for a worker
+    std::vector<Job>         loaded    {};  // waiting for Poll
+    size_t                   queued    {};
+    double                   startedAt {};
+
+    void Run(void);
+};
+
+// Wall clock timestamps of startup stages, measured from the same clock as AssetLoader so that time-to-first-frame can
+// be logged (and tested) without a window
+struct StartupLog {
+    struct Stage {
+        const char *name {};
+        double      at   {};  // secs since Start
+    };
+
+    void   Start (void);
+    double Mark  (const char *stage);  // logs and returns secs since Start
+
+    std::vector<Stage> stages {};
+
+private:
+    static const char *LOG_SRC;
+
+    double startedAt {};
+};
+
+double asset_loader_now(void);
@@ -0,0 +1,281 @@
+#include "asset_pack.h"
+#include "clock.h"
+#include "helpers.h"
+#include "dlb_murmur3.h"
+#include "raylib/raylib.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const char *AssetPack::LOG_SRC = "AssetPack";
+const char *AssetPackWriter::LOG_SRC = "AssetPackWriter";
+
+static const AssetPack *g_asset_pack;  // shared by every thread on purpose, see asset_pack_install
+
+static size_t asset_pack_align(size_t offset)
+{
+    return (offset + ASSET_PACK_ALIGN - 1) & ~(size_t)(ASSET_PACK_ALIGN - 1);
+}
+
+AssetPack::~AssetPack(void)
+{
+    Close();
+}
+
+ErrorType AssetPack::Open(const char *filename)
+{
+    Close();
+    if (!MapFile(filename, mappedFile)) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "Failed to map asset pack %s", filename);
+    }
+
+    ErrorType err = OpenMemory(mappedFile.data, mappedFile.size);
+    if (err != ErrorType::Success) {
+        UnmapFile(mappedFile);
+        E_ERROR_RETURN(err, "Failed to open asset pack %s", filename);
+    }
+    E_INFO("Opened %s, %zu assets (%zu bytes)", filename, entryCount, size);
+    return ErrorType::Success;
+}
+
+ErrorType AssetPack::OpenMemory(const unsigned char *packData, size_t packSize)
+{
+    DLB_ASSERT(packData);
+    if (mappedFile.data != packData) {
+        Close();
+    }
+
+    AssetPackHeader header{};
+    if (packSize < sizeof(header)) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack too small for header (%zu bytes)", packSize);
+    }
+    memcpy(&header, packData, sizeof(header));
+    if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "Not an asset pack, or wrong version (%u)", header.version);
+    }
+
+    const size_t tocSize = (size_t)header.entryCount * sizeof(AssetPackEntry);
+    if (header.tocOffset % alignof(AssetPackEntry) || header.tocOffset > packSize || tocSize > packSize - header.tocOffset) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack table of contents out of bounds", 0);
+    }
+    if (dlb_murmur3(packData + header.tocOffset, tocSize) != header.tocHash) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack table of contents is corrupt", 0);
+    }
+
+    const AssetPackEntry *entries = (const AssetPackEntry *)(packData + header.tocOffset);
+    for (size_t i = 0; i < header.entryCount; i++) {
+        const AssetPackEntry &entry = entries[i];
+        if (entry.offset > header.tocOffset || entry.size > header.tocOffset - entry.offset) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack entry %zu out of bounds", i);
+        }
+        if (i && entry.id <= entries[i - 1].id) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack table of contents isn't sorted", 0);
+        }
+    }
+
+    data = packData;
+    size = packSize;
+    toc = entries;
+    entryCount = header.entryCount;
+    return ErrorType::Success;
+}
+
+void AssetPack::Close(void)
+{
+    if (mappedFile.data) {
+        UnmapFile(mappedFile);
+    }
+    data = 0;
+    size = 0;
+    toc = 0;
+    entryCount = 0;
+}
+
+const AssetPackEntry *AssetPack::Find(uint32_t id) const
+{
+    const AssetPackEntry *end = toc + entryCount;
+    const AssetPackEntry *entry = std::lower_bound(toc, end, id,
+        [](const AssetPackEntry &entry, uint32_t id) { return entry.id < id; }
+    );
+    if (entry == end || entry->id != id) {
+        return 0;
+    }
+    return entry;
+}
+
+const unsigned char *AssetPack::Read(const AssetPackEntry &entry) const
+{
+    DLB_ASSERT(&entry >= toc && &entry < toc + entryCount);
+    const unsigned char *assetData = data + entry.offset;
+    if (dlb_murmur3(assetData, entry.size) != entry.dataHash) {
+        E_WARN("Asset %08x is corrupt, hash doesn't match", entry.id);
+        return 0;
+    }
+    return assetData;
+}
+
+unsigned char *AssetPack::LoadFile(const char *filename, unsigned int *bytesRead, bool text) const
+{
+    const AssetPackEntry *entry = Find(PathID(filename));
+    const unsigned char *packed = entry ? Read(*entry) : 0;
+
+    // User data in the pack is only a default, whatever's been saved to disk since wins
+    if (!packed || (entry->flags & AssetPackFlag_Default)) {
+        FILE *file = fopen(filename, text ? "rt" : "rb");
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            const long fileSize = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            unsigned char *fileData = fileSize >= 0 ? (unsigned char *)malloc((size_t)fileSize + 1) : 0;
+            const size_t read = fileData ? fread(fileData, 1, (size_t)fileSize, file) : 0;
+            fclose(file);
+            if (fileData) {
+                fileData[read] = 0;
+                if (bytesRead) *bytesRead = (unsigned int)read;
+                return fileData;
+            }
+        }
+    }
+
+    if (!packed) {
+        if (bytesRead) *bytesRead = 0;
+        return 0;
+    }
+
+    unsigned char *fileData = (unsigned char *)malloc(entry->size + 1);
+    if (!fileData) {
+        if (bytesRead) *bytesRead = 0;
+        return 0;
+    }
+    memcpy(fileData, packed, entry->size);
+    fileData[entry->size] = 0;
+    if (bytesRead) *bytesRead = (unsigned int)entry->size;
+    return fileData;
+}
+
+ErrorType AssetPack::Verify(void) const
+{
+    for (size_t i = 0; i < entryCount; i++) {
+        if (!Read(toc[i])) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "Asset pack failed verification", 0);
+        }
+    }
+    return ErrorType::Success;
+}
+
+uint32_t AssetPack::PathID(const char *path)
+{
+    return dlb_murmur3(path, strlen(path));
+}
+
+//-----------------------------------------------------------------------------
+
+ErrorType AssetPackWriter::Add(const char *path, const void *assetData, size_t assetSize, uint32_t flags)
+{
+    const uint32_t id = AssetPack::PathID(path);
+    for (const Asset &asset : assets) {
+        if (asset.entry.id == id) {
+            E_ERROR_RETURN(ErrorType::AllocFailed_Duplicate, "%s has the same ID as another asset (%08x)", path, id);
+        }
+    }
+
+    Asset &asset = assets.emplace_back();
+    asset.entry.id = id;
+    asset.entry.dataHash = dlb_murmur3(assetData, assetSize);
+    asset.entry.flags = flags;
+    asset.entry.size = assetSize;
+    asset.data.assign((const unsigned char *)assetData, (const unsigned char *)assetData + assetSize);
+    return ErrorType::Success;
+}
+
+void AssetPackWriter::Build(std::vector<unsigned char> &pack) const
+{
+    // Data goes in the order it was added, only the table of contents is sorted
+    std::vector<AssetPackEntry> entries{};
+    entries.reserve(assets.size());
+    size_t offset = asset_pack_align(sizeof(AssetPackHeader));
+    for (const Asset &asset : assets) {
+        AssetPackEntry &entry = entries.emplace_back(asset.entry);
+        entry.offset = offset;
+        offset = asset_pack_align(offset + asset.data.size());
+    }
+
+    const size_t tocOffset = offset;
+    const size_t tocSize = entries.size() * sizeof(AssetPackEntry);
+    pack.assign(tocOffset + tocSize, 0);
+    for (size_t i = 0; i < assets.size(); i++) {
+        if (assets[i].data.size()) {
+            memcpy(pack.data() + entries[i].offset, assets[i].data.data(), assets[i].data.size());
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+        [](const AssetPackEntry &a, const AssetPackEntry &b) { return a.id < b.id; }
+    );
+    if (tocSize) {
+        memcpy(pack.data() + tocOffset, entries.data(), tocSize);
+    }
+
+    AssetPackHeader header{};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)entries.size();
+    header.tocHash = dlb_murmur3(pack.data() + tocOffset, tocSize);
+    header.tocOffset = tocOffset;
+    memcpy(pack.data(), &header, sizeof(header));
+}
+
+ErrorType AssetPackWriter::Save(const char *filename) const
+{
+    std::vector<unsigned char> pack{};
+    Build(pack);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        E_ERROR_RETURN(ErrorType::FileWriteFailed, "Failed to open %s for writing", filename);
+    }
+    const size_t written = fwrite(pack.data(), 1, pack.size(), file);
+    fclose(file);
+    if (written != pack.size()) {
+        E_ERROR_RETURN(ErrorType::FileWriteFailed, "Failed to write %s", filename);
+    }
+    E_INFO("Wrote %s, %zu assets (%zu bytes)", filename, assets.size(), pack.size());
+    return ErrorType::Success;
+}
+
+//-----------------------------------------------------------------------------
+
+static unsigned char *asset_pack_load_file_data(const char *fileName, unsigned int *bytesRead)
+{
+    return g_asset_pack->LoadFile(fileName, bytesRead, false);
+}
+
+static char *asset_pack_load_file_text(const char *fileName)
+{
+    return (char *)g_asset_pack->LoadFile(fileName, 0, true);
+}
+
+void asset_pack_install(const AssetPack *pack)
+{
+    DLB_ASSERT(pack);
+    DLB_ASSERT(pack->IsOpen());
+    g_asset_pack = pack;
+    SetLoadFileDataCallback(asset_pack_load_file_data);
+    SetLoadFileTextCallback(asset_pack_load_file_text);
+}
+
+void asset_pack_uninstall(void)
+{
+    SetLoadFileDataCallback(0);
+    SetLoadFileTextCallback(0);
+    g_asset_pack = 0;
+}
+
+bool asset_pack_file_exists(const char *filename)
+{
+    if (g_asset_pack && g_asset_pack->Find(AssetPack::PathID(filename))) {
+        return true;
+    }
+    return FileExists(filename);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "error.h"
+#include "jail_win32_mmap.h"
+#include <cstdint>
+#include <vector>
+
+#define ASSET_PACK_MAGIC   0x4B504C53  // "SLPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGN   16          // every asset's data starts on a multiple of this many bytes
+#define ASSET_PACK_FILE    "data.pak"
+
+enum AssetPackFlags : uint32_t {
+    AssetPackFlag_Default = 1 << 0,  // user data (e.g. db/), a loose file on disk overrides the packed copy
+};
+
+// Layout: header, every asset's data, then the table of contents sorted by ID. Built by tools/asset_packer.cpp.
+struct AssetPackHeader {
+    uint32_t magic      {};
+    uint32_t version    {};
+    uint32_t entryCount {};
+    uint32_t tocHash    {};  // murmur3 of the table of contents
+    uint64_t tocOffset  {};
+};
+
+struct AssetPackEntry {
+    uint32_t id       {};  // murmur3 of the path the game loads it by, e.g. "data/audio/sound/gold1.ogg"
+    uint32_t dataHash {};  // murmur3 of the data, checked every time the asset is read
+    uint32_t flags    {};  // AssetPackFlags
+    uint32_t reserved {};
+    uint64_t offset   {};  // from start of pack
+    uint64_t size     {};
+};
+
+// Every asset the game loads from data/ and db/ in one memory-mapped file, so startup is one open instead of an
+// open/read/close per asset (and the pages are shared between the client and the local server). Read-only once open,
+// safe to read from any thread.
+struct AssetPack {
+    ~AssetPack(void);
+
+    ErrorType Open       (const char *filename);
+    ErrorType OpenMemory (const unsigned char *data, size_t size);  // data must outlive the pack
+    void      Close      (void);
+    bool      IsOpen     (void) const { return data != 0; }
+    size_t    EntryCount (void) const { return entryCount; }
+
+    const AssetPackEntry *Find(uint32_t id) const;
+    // The asset's bytes inside the pack (don't free them), or 0 if it's not in the pack or fails its hash check
+    const unsigned char *Read(const AssetPackEntry &entry) const;
+    // Copy of a file as if it was read by raylib's LoadFileData (free with UnloadFileData), from the pack when it's in
+    // there or from disk when it's not. text = true adds a nul terminator like LoadFileText.
+    unsigned char *LoadFile(const char *filename, unsigned int *bytesRead, bool text) const;
+    ErrorType Verify(void) const;  // check every asset's hash
+
+    static uint32_t PathID(const char *path);
+
+private:
+    static const char *LOG_SRC;
+
+    const unsigned char  *data       {};
+    size_t                size       {};
+    const AssetPackEntry *toc        {};
+    size_t                entryCount {};
+    MappedFile            mappedFile {};
+};
+
+struct AssetPackWriter {
+    ErrorType Add   (const char *path, const void *data, size_t size, uint32_t flags = 0);
+    void      Build (std::vector<unsigned char> &pack) const;
+    ErrorType Save  (const char *filename) const;
+
+private:
+    static const char *LOG_SRC;
+
+    struct Asset {
+        AssetPackEntry             entry {};
+        std::vector<unsigned char> data  {};
+    };
+    std::vector<Asset> assets {};
+};
+
+// Route raylib's LoadFileData and LoadFileText (and every loader built on them) through pack. Not thread_local like the
+// catalogs, the pack is shared by every thread and must stay open until asset_pack_uninstall.
+void asset_pack_install     (const AssetPack *pack);
+void asset_pack_uninstall   (void);
+// FileExists that also sees files in the installed pack
+bool asset_pack_file_exists (const char *filename);
@@ -1,6 +1,7 @@
 #include "bit_stream.h"
 #include "helpers.h"
 #include <cassert>
+#include <cstring>
 
 BitStream::BitStream(Mode mode, void *buffer, size_t bufferSize) : mode(mode), buffer(buffer), bufferBits(bufferSize * 8)
 {
@@ -14,12 +15,12 @@ void BitStream::Align()
 {
     const uint8_t remainderBits = bitsProcessed % 8;
     if (remainderBits) {
-        // NOTE: If assert fails in Reader mode, alignment padding corruption was detected; expected zero padding
+        // NOTE: Non-zero padding in Reader mode means the packet is corrupt, flags an error
         uint32_t value = 0;
         Process(value, 8 - remainderBits, 0, 0);
     }
-    assert(scratchBits % 8 == 0);
-    assert(bitsProcessed % 8 == 0);
+    assert(error || scratchBits % 8 == 0);
+    assert(error || bitsProcessed % 8 == 0);
 }
 
 // Return # of bytes read/written
@@ -39,12 +40,20 @@ void BitStream::ProcessInternal(uint32_t &word, uint8_t bits)
 
     switch (mode) {
         case Mode::Reader: {
-            // TODO: Handle malformed incoming packets in a way that doesn't crash the server
-            assert(bitsProcessed + bits <= bufferBits);
+            if (error || bitsProcessed + bits > bufferBits) {
+                // Ran off the end of a truncated/malformed packet
+                error = true;
+                word = 0;
+                return;
+            }
 
             // Read next word into scratch if scratch needs more bits to service the read
+            // NOTE: memcpy because messages in a bundle aren't word-aligned, and the last word may be partial
             if (bits > scratchBits) {
-                scratch |= (uint64_t)((uint32_t *)buffer)[wordIndex] << scratchBits;
+                uint32_t next = 0;
+                const size_t byteIndex = wordIndex * sizeof(next);
+                memcpy(&next, (uint8_t *)buffer + byteIndex, MIN(sizeof(next), bufferBits / 8 - byteIndex));
+                scratch |= (uint64_t)next << scratchBits;
                 wordIndex++;
                 scratchBits += 32;
             }
@@ -78,63 +87,39 @@ void BitStream::Process(bool &value)
 void BitStream::Process(uint8_t &value, uint8_t bits, uint8_t min, uint8_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = (uint32_t)value;
     ProcessInternal(word, bits);
     value = (uint8_t)word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(uint16_t &value, uint8_t bits, uint16_t min, uint16_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = (uint32_t)value;
     ProcessInternal(word, bits);
     value = (uint16_t)word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(uint32_t &value, uint8_t bits, uint32_t min, uint32_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     ProcessInternal(value, bits);
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(uint64_t &value, uint8_t bits, uint64_t min, uint64_t max)
 {
     //assert(bits <= sizeof(value) * 8);
     assert(bits == 64);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     assert(sizeof(uint32_t) * 2 == sizeof(uint64_t));
     uint32_t word0 = ((uint32_t *)&value)[0];
@@ -143,94 +128,59 @@ void BitStream::Process(uint64_t &value, uint8_t bits, uint64_t min, uint64_t ma
     ProcessInternal(word1, 32);
     ((uint32_t *)&value)[0] = word0;
     ((uint32_t *)&value)[1] = word1;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 
 void BitStream::Process(int8_t &value, uint8_t bits, int8_t min, int8_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = (uint8_t)value;
     ProcessInternal(word, bits);
     value = word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(int16_t &value, uint8_t bits, int16_t min, int16_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = (uint16_t)value;
     ProcessInternal(word, bits);
     value = word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(int32_t &value, uint8_t bits, int32_t min, int32_t max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = value;
     ProcessInternal(word, bits);
     value = word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(float &value, uint8_t bits, float min, float max)
 {
     assert(bits <= sizeof(value) * 8);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     uint32_t word = *(uint32_t *)&value;
     ProcessInternal(word, bits);
     value = *(float *)&word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::Process(double &value, uint8_t bits, double min, double max)
 {
     //assert(bits <= sizeof(value) * 8);
     assert(bits == 64);
-    if (mode == Mode::Writer) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckWrite(value, min, max);
 
     assert(sizeof(uint32_t) * 2 == sizeof(double));
     uint32_t word0 = ((uint32_t *)&value)[0];
@@ -239,36 +189,33 @@ void BitStream::Process(double &value, uint8_t bits, double min, double max)
     ProcessInternal(word1, 32);
     ((uint32_t *)&value)[0] = word0;
     ((uint32_t *)&value)[1] = word1;
-
-    if (mode == Mode::Reader) {
-        assert(value >= min);
-        assert(value <= max);
-    }
+    CheckRead(value, min, max);
 }
 
 void BitStream::ProcessChar(char &value)
 {
-    if (mode == Mode::Writer) {
-        assert(value >= STRING_ASCII_MIN);
-        assert(value <= STRING_ASCII_MAX);
-    }
+    CheckWrite(value, (char)STRING_ASCII_MIN, (char)STRING_ASCII_MAX);
 
     uint32_t word = (uint32_t)value;
     ProcessInternal(word, 8);
     value = (char)word;
-
-    if (mode == Mode::Reader) {
-        assert(value >= STRING_ASCII_MIN);
-        assert(value <= STRING_ASCII_MAX);
-    }
+    CheckRead(value, (char)STRING_ASCII_MIN, (char)STRING_ASCII_MAX);
 }
 
 // Flush word from scratch to buffer
 void BitStream::Flush()
 {
     if (mode == Mode::Writer && scratchBits) {
-        assert((wordIndex + 1) * 32 < bufferBits);
-        ((uint32_t *)buffer)[wordIndex] = scratch & 0xFFFFFFFF;
+        if ((wordIndex + 1) * 32 > bufferBits) {
+            // Message doesn't fit in the buffer
+            assert(!"BitStream buffer overflow");
+            error = true;
+            scratch = 0;
+            scratchBits = 0;
+            return;
+        }
+        const uint32_t word = scratch & 0xFFFFFFFF;
+        memcpy((uint8_t *)buffer + wordIndex * sizeof(word), &word, sizeof(word));
 
 #if _DEBUG && 0
         if (debugPrint) {
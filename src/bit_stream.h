@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <cfloat>
+#include <cassert>
 
 // https://gafferongames.com/post/reading_and_writing_packets/
 // https://gafferongames.com/post/serialization_strategies/
@@ -22,6 +23,13 @@ struct BitStream {
     // Return # of bytes read/written
     size_t BytesProcessed() const;
 
+    // True once the stream has run past the end of the buffer, or read a value outside of its valid range. Sticky;
+    // everything read after an error is zero (or min, for ranged values), so a malformed packet can't index past
+    // the end of an array, but the whole message should be thrown away.
+    bool Error() const { return error; }
+    // Flag a value that was read successfully but doesn't make sense, e.g. a delta that underflows
+    void SetError() { error = true; }
+
     // Read bits from scratch into word / Write bits form word to scratch
     void Process (bool     &value);
     void Process (uint8_t  &value, uint8_t bits =  8, uint8_t  min = 0        , uint8_t  max = UINT8_MAX );
@@ -51,6 +59,25 @@ private:
     void     *buffer        {};  // buffer we're writing to / reading from
     size_t    bufferBits    {};  // size of packet in bytes * 8
     size_t    bitsProcessed {};  // number of bits we've read/written so far
+    bool      error         {};  // see Error()
 
     void ProcessInternal(uint32_t &word, uint8_t bits);
+
+    // Writer: values outside of [min, max] are a bug
+    template <typename T>
+    void CheckWrite(const T &value, T min, T max) const {
+        if (mode == Mode::Writer) {
+            assert(value >= min);
+            assert(value <= max);
+        }
+    }
+
+    // Reader: values outside of [min, max] mean the packet is malformed, flag it and clamp to min
+    template <typename T>
+    void CheckRead(T &value, T min, T max) {
+        if (mode == Mode::Reader && !(value >= min && value <= max)) {  // NOTE: Also catches NaN
+            error = true;
+            value = min;
+        }
+    }
 };
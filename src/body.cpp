@@ -7,6 +7,78 @@
 
 #define IDLE_THRESHOLD_SECONDS 60.0
 
+const Vector3Snapshot &PositionHistory::Last(void) const
+{
+    DLB_ASSERT(count);
+    return slots[newestTick % CL_WORLD_HISTORY].entry;
+}
+
+Vector3Snapshot &PositionHistory::Push(uint32_t tick)
+{
+    const uint32_t N = CL_WORLD_HISTORY;
+    if (count && tick <= newestTick) {
+        // Snapshots arrive in order on their channel, so the server must have restarted
+        Clear();
+    }
+
+    Vector3Snapshot prev{};
+    if (count) {
+        // Copy, the slot might get reused below
+        prev = Last();
+        // Ticks in between didn't have an entry, i.e. they're still at prev until this tick
+        const uint32_t gapStart = MAX(newestTick, tick >= N ? tick - N + 1 : 0);
+        for (uint32_t gapTick = gapStart; gapTick < tick; gapTick++) {
+            Slot &gap = slots[gapTick % N];
+            gap.entry = prev;
+            gap.tick = gapTick;
+            gap.nextTick = tick;
+        }
+    } else {
+        firstTick = tick;
+    }
+
+    Slot &slot = slots[tick % N];
+    slot.entry = prev;
+    slot.entry.tick = tick;
+    slot.tick = tick;
+    slot.nextTick = 0;
+    newestTick = tick;
+    count = MIN(count + 1, (size_t)N);
+    return slot.entry;
+}
+
+void PositionHistory::Clear(void)
+{
+    firstTick = 0;
+    newestTick = 0;
+    count = 0;
+}
+
+bool PositionHistory::Find(uint32_t tick, const Vector3Snapshot **a, const Vector3Snapshot **b) const
+{
+    const uint32_t N = CL_WORLD_HISTORY;
+    DLB_ASSERT(a);
+    DLB_ASSERT(b);
+    if (!count || tick < firstTick || (uint64_t)tick + N <= newestTick) {
+        return false;
+    }
+
+    if (tick >= newestTick) {
+        *a = &Last();
+        *b = 0;
+        return true;
+    }
+
+    const Slot &slot = slots[tick % N];
+    DLB_ASSERT(slot.tick == tick);
+    DLB_ASSERT(slot.nextTick > tick && slot.nextTick <= newestTick);
+    const Slot &next = slots[slot.nextTick % N];
+    DLB_ASSERT(next.tick == slot.nextTick);
+    *a = &slot.entry;
+    *b = &next.entry;
+    return true;
+}
+
 Body3D::Body3D(void)
 {
     gravityScale = 1.0f;
@@ -254,42 +326,24 @@ void Body3D::Update(double dt)
     //lastUpdated = g_clock.now;
 }
 
-void Body3D::CL_Interpolate(double renderAt, Direction &direction)
+void Body3D::CL_Interpolate(const InterpolationCursor &cursor, Direction &direction)
 {
     Vector3 startPos = WorldPosition();
-    const size_t historyLen = positionHistory.Count();
+    const double renderAt = cursor.renderAt;
 
-    // If no history, nothing to interpolate yet
-    if (historyLen == 0) {
-        //printf("No snapshot history to interpolate from\n");
+    // renderAt is before any snapshots (or there's no history at all yet). Don't render things before we have at
+    // least two snapshots to interpolate between.
+    const Vector3Snapshot *a = 0;
+    const Vector3Snapshot *b = 0;
+    if (!cursor.valid || !positionHistory.Find(cursor.tick, &a, &b)) {
         return;
     }
 
-    // Find first snapshot after renderAt time
-    size_t right = 0;
-    while (right < historyLen && positionHistory.At(right).serverTime <= renderAt) {
-        right++;
-    }
-
-    if (right == 0) {
-        // renderAt is before any snapshots, show entity at oldest snapshot
-
-        // Don't render things before we have at least two snapshots to interpolate between
-        return;
-
-        const Vector3Snapshot &oldest = positionHistory.At(0);
-        DLB_ASSERT(renderAt < oldest.serverTime);
-        #if CL_DEBUG_SNAPSHOT_INTERPOLATION
-            E_DEBUG("[%.2f, %.2f, %.2f] @ %.2f before oldest %.2f", oldest.v.x, oldest.v.y, oldest.v.z, renderAt, oldest.serverTime);
-        #endif
-
-        Teleport(oldest.v);
-        direction = oldest.direction;
-    } else if (right == historyLen) {
+    if (!b) {
         // renderAt is after all snapshots, show entity at newest snapshot
 
         // TODO: Extrapolate beyond latest snapshot if/when this happens? Should be mostly avoidable..
-        const Vector3Snapshot &newest = positionHistory.At(historyLen - 1);
+        const Vector3Snapshot &newest = *a;
         DLB_ASSERT(renderAt >= newest.serverTime);
         #if CL_DEBUG_SNAPSHOT_INTERPOLATION
             E_DEBUG("[%.2f, %.2f, %.2f] @ %.2f after newest %.2f", newest.v.x, newest.v.y, newest.v.z, renderAt, newest.serverTime);
@@ -306,27 +360,18 @@ void Body3D::CL_Interpolate(double renderAt, Direction &direction)
         direction = newest.direction;
     } else {
         // renderAt is between two snapshots
-
-        DLB_ASSERT(right > 0);
-        DLB_ASSERT(right < historyLen);
-        const Vector3Snapshot &a = positionHistory.At(right - 1);
-        const Vector3Snapshot &b = positionHistory.At(right);
-
-        if (renderAt < a.serverTime) {
-            DLB_ASSERT(renderAt);
-        }
-        DLB_ASSERT(renderAt >= a.serverTime);
-        DLB_ASSERT(renderAt < b.serverTime);
+        DLB_ASSERT(renderAt >= a->serverTime);
+        DLB_ASSERT(renderAt < b->serverTime);
 
         // Linear interpolation: x = x0 + (x1 - x0) * alpha;
-        double alpha = (renderAt - a.serverTime) / (b.serverTime - a.serverTime);
-        const Vector3 lerp = v3_add(a.v, v3_scale(v3_sub(b.v, a.v), (float)alpha));
+        double alpha = (renderAt - a->serverTime) / (b->serverTime - a->serverTime);
+        const Vector3 lerp = v3_add(a->v, v3_scale(v3_sub(b->v, a->v), (float)alpha));
 
         #if CL_DEBUG_SNAPSHOT_INTERPOLATION
-            E_DEBUG("[%.2f, %.2f, %.2f] @ %.2f between %.2f - %.2f", lerp.x, lerp.y, lerp.z, renderAt, a.serverTime, b.serverTime);
+            E_DEBUG("[%.2f, %.2f, %.2f] @ %.2f between %.2f - %.2f", lerp.x, lerp.y, lerp.z, renderAt, a->serverTime, b->serverTime);
         #endif
         Teleport(lerp);
-        direction = b.direction;
+        direction = b->direction;
     }
 
     Vector3 endPos = WorldPosition();
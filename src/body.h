@@ -5,13 +5,48 @@
 #include "raylib/raylib.h"
 
 struct Vector3Snapshot {
+    uint32_t  tick       {};  // server tick of the snapshot this came from
     double    serverTime {};  // approx. server time when we received this snapshot
     Vector3   v          {};  // position
     Direction direction  {};  // facing direction
 };
 
+// What the client is rendering this frame. The snapshot that renderAt falls after is found once per frame, then every
+// body looks up its own state as of that snapshot's tick.
+struct InterpolationCursor {
+    double   renderAt {};  // server time being rendered
+    uint32_t tick     {};  // newest received snapshot at or before renderAt
+    bool     valid    {};  // false if renderAt is before every snapshot we still have
+};
+
+// Snapshot history indexed by server tick. Bodies only get an entry in snapshots they were sent in, so every tick
+// between two entries holds a copy of the older entry and the tick of the newer one. Finding the entries around any
+// tick is then O(1) instead of a scan. Covers the last CL_WORLD_HISTORY ticks.
+struct PositionHistory {
+    bool   Empty (void) const { return !count; }
+    size_t Count (void) const { return count; }  // entries received, up to CL_WORLD_HISTORY
+    const Vector3Snapshot &Last(void) const;
+    // New entry for tick, starts out as a copy of the previous entry. Ticks must be increasing.
+    Vector3Snapshot &Push(uint32_t tick);
+    void Clear(void);
+    // Newest entry at or before tick in *a, the entry after that in *b (null if there isn't one yet). Returns false
+    // if there's no entry at or before tick.
+    bool Find(uint32_t tick, const Vector3Snapshot **a, const Vector3Snapshot **b) const;
+
+private:
+    struct Slot {
+        Vector3Snapshot entry    {};  // newest entry at or before tick
+        uint32_t        tick     {};  // tick this slot is for
+        uint32_t        nextTick {};  // tick of the entry after this one, 0 if there isn't one yet
+    };
+    Slot     slots      [CL_WORLD_HISTORY]{};
+    uint32_t firstTick  {};  // tick of the first entry since Clear
+    uint32_t newestTick {};
+    size_t   count      {};
+};
+
 struct Body3D {
-    RingBuffer<Vector3Snapshot, CL_WORLD_HISTORY> positionHistory {};
+    PositionHistory positionHistory {};
 
     float   speed        {};  // move speed, in meters
     Vector3 velocity     {};
@@ -41,7 +76,7 @@ struct Body3D {
     double TimeSinceLastMove(void) const;
     void ApplyForce(Vector3 force);
     void Update(double dt);
-    void CL_Interpolate(double renderAt, Direction &direction);
+    void CL_Interpolate(const InterpolationCursor &cursor, Direction &direction);
 
 private:
     const char *LOG_SRC = "Body";
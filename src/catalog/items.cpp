@@ -1,11 +1,26 @@
+#include "../asset_loader.h"
 #include "csv.h"
 #include "items.h"
 #include <stdlib.h>
 
 #define CSV_DEBUG_PRINT 0
 
-void ItemCatalog::LoadTextures(void) {
-    tex = LoadTexture("data/texture/item/joecreates.png");
+// Decode on a worker, upload on this thread
+void ItemCatalog::LoadTextures(AssetLoader &loader)
+{
+    const char *path = "data/texture/item/joecreates.png";
+    Image *image = new Image{};
+    loader.Queue(path,
+        [image, path] {
+            *image = LoadImage(path);
+            return image->data ? ErrorType::Success : ErrorType::FileReadFailed;
+        },
+        [this, image] {
+            tex = LoadTextureFromImage(*image);
+            UnloadImage(*image);
+            delete image;
+        }
+    );
 }
 
 void ItemCatalog::LoadData(void)
@@ -49,7 +64,7 @@ void ItemCatalog::LoadData(void)
         ItemType itemType = vId.toUint();
         DLB_ASSERT(itemType < ItemType_Count);
 
-        ItemProto &proto = g_item_catalog.protos[itemType];
+        ItemProto &proto = protos[itemType];
         proto.itemType = itemType;
         proto.itemClass = ItemClassFromString((char *)vCategory.data, vCategory.length);
         DLB_ASSERT(proto.itemClass < ItemClass_Count);
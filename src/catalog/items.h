@@ -8,9 +8,13 @@
 #include <array>
 #include <unordered_map>
 
+struct AssetLoader;
+
 #define ITEM_AFFIX_MAX_COUNT 16
 #define ITEM_NAME_MAX_LENGTH 64
 #define ITEMCLASS_COUNT      256
+#define ITEM_DB_INDEX_BITS   20  // ItemUID = generation << ITEM_DB_INDEX_BITS | index, see ItemDatabase
+#define ITEM_DB_MAX_ITEMS    (1u << ITEM_DB_INDEX_BITS)
 
 // slot:       chest, weapon, shield, feet, head, neck, magicOrb1, magicOrb2, potion
 // class:      weapon, armor, necklace, ring, consumable, scroll, misc
@@ -505,7 +509,7 @@ struct ItemProto {
 };
 
 struct ItemCatalog {
-    void LoadTextures(void);
+    void LoadTextures(AssetLoader &loader);
     void LoadData(void);
 
     ItemProto &FindProto(ItemType type) {
@@ -595,10 +599,17 @@ private:
     //char name[64]{};
 };
 
+// Every item instance the server has rolled (or, client-side, has been told about). Items are refcounted by whatever
+// holds them (world items and inventory slots); one that nothing holds any more is reclaimed by the next Reclaim() and
+// its slot reused. Server-side uids are the slot index plus a generation that's bumped on reclaim, so a stale uid never
+// finds the item that replaced it. Releasing the last reference doesn't free anything until Reclaim(), so a uid that's
+// just been rolled or is being moved between holders stays valid until the end of the tick.
 struct ItemDatabase {
     ItemDatabase(void) {
-        // Reserve static default items for each item type
+        // Reserve static default items for each item type, these are never reclaimed
         items.resize(ItemType_Count);
+        refCounts.resize(ItemType_Count);
+        generations.resize(ItemType_Count);
         for (ItemType itemType = 0; itemType < ItemType_Count; itemType++) {
             Item &item = items[itemType];
             item.uid = itemType;
@@ -608,14 +619,10 @@ struct ItemDatabase {
         }
     }
 
+    // Returns 0 if the database is full. The new item has no holders yet, see Reclaim().
     ItemUID SV_Spawn(ItemType type) {
         DLB_ASSERT(g_clock.server);
 
-        if (!nextUid && g_clock.server) {
-            nextUid = 9999;
-        }
-        nextUid = MAX(ItemType_Count, nextUid + 1); // Prevent reserved IDs from being used on overflow
-
         const ItemProto &proto = g_item_catalog.FindProto(type);
         if (proto.IsScalar()) {
             //printf("Reusing memoized scalar item for type: %d\n", type);
@@ -624,9 +631,14 @@ struct ItemDatabase {
             return type;
         } else {
             //printf("Rolling new item for type: %d\n", type);
-            uint64_t seed = Item::GenSeed();
-            const Item &item = items.emplace_back(nextUid, type, seed);
-            byUid[item.uid] = (uint32_t)items.size() - 1;
+            const uint32_t index = Alloc();
+            if (!index) {
+                return 0;
+            }
+            const ItemUID uid = ((ItemUID)generations[index] << ITEM_DB_INDEX_BITS) | index;
+            Item &item = items[index];
+            item = Item(uid, type, Item::GenSeed());
+            byUid[item.uid] = index;
             return item.uid;
         }
     }
@@ -634,25 +646,107 @@ struct ItemDatabase {
     const Item& Find(ItemUID uid) {
         const auto &iter = byUid.find(uid);
         if (iter != byUid.end()) {
+            DLB_ASSERT(items[iter->second].uid == uid);
             return items[iter->second];
         }
         return items[0];
     }
 
+    // Client-side, uid is the server's. Returns a scratch item (that nothing will find) if the database is full.
     Item &FindOrCreate(ItemUID uid) {
         const auto &iter = byUid.find(uid);
         if (iter != byUid.end()) {
             return items[iter->second];
         }
-        Item &newItem = items.emplace_back();
+        const uint32_t index = Alloc();
+        if (!index) {
+            overflow = {};
+            overflow.uid = uid;
+            return overflow;
+        }
+        Item &newItem = items[index];
         newItem.uid = uid;
-        byUid[newItem.uid] = (uint32_t)items.size() - 1;
+        byUid[newItem.uid] = index;
         return newItem;
     }
+
+    void AddRef(ItemUID uid) {
+        const uint32_t index = Index(uid);
+        if (index >= ItemType_Count) {
+            refCounts[index]++;
+        }
+    }
+
+    void Release(ItemUID uid) {
+        const uint32_t index = Index(uid);
+        if (index >= ItemType_Count) {
+            DLB_ASSERT(refCounts[index]);
+            refCounts[index]--;
+            if (!refCounts[index]) {
+                unheld.push_back(index);
+            }
+        }
+    }
+
+    // Free every item that has had no holders since it was created or last released, returns how many were freed.
+    // Called once per tick (server) or frame (client), after anything that might pick up a fresh uid has run.
+    size_t Reclaim(void) {
+        size_t reclaimed = 0;
+        for (uint32_t index : unheld) {
+            Item &item = items[index];
+            if (refCounts[index] || !item.uid) {
+                continue;  // picked up again, or already reclaimed
+            }
+            byUid.erase(item.uid);
+            item = {};
+            generations[index] = (generations[index] + 1) & (UINT32_MAX >> ITEM_DB_INDEX_BITS);
+            freeList.push_back(index);
+            reclaimed++;
+        }
+        unheld.clear();
+        return reclaimed;
+    }
+
+    uint32_t RefCount (ItemUID uid) const { const uint32_t index = Index(uid); return index ? refCounts[index] : 0; }
+    size_t   Count    (void) const { return byUid.size(); }   // items that exist right now, including the reserved ones
+    size_t   Capacity (void) const { return items.size(); }   // high water mark
+
 private:
-    uint32_t nextUid = 0;
-    std::vector<Item> items{};
+    const char *LOG_SRC = "ItemDatabase";
+
+    std::vector<Item>     items       {};
+    std::vector<uint32_t> refCounts   {};  // number of holders of items[i]
+    std::vector<uint32_t> generations {};  // bumped every time items[i] is reclaimed
+    std::vector<uint32_t> freeList    {};  // reclaimed items[] indices
+    std::vector<uint32_t> unheld      {};  // items[] indices to check on next Reclaim(), may contain duplicates
+    Item                  overflow    {};
     std::unordered_map<ItemUID, uint32_t> byUid{};  // map of item.uid -> items[] index
+
+    // items[] index, or 0 if uid isn't in the database
+    uint32_t Index(ItemUID uid) const {
+        const auto &iter = byUid.find(uid);
+        return iter != byUid.end() ? iter->second : 0;
+    }
+
+    // Returns 0 if full
+    uint32_t Alloc(void) {
+        uint32_t index = 0;
+        if (freeList.size()) {
+            index = freeList.back();
+            freeList.pop_back();
+        } else if (items.size() < ITEM_DB_MAX_ITEMS) {
+            index = (uint32_t)items.size();
+            items.emplace_back();
+            refCounts.emplace_back();
+            generations.emplace_back();
+        } else {
+            E_WARN("Item database is full (%u items)", ITEM_DB_MAX_ITEMS);
+            return 0;
+        }
+        DLB_ASSERT(!refCounts[index]);
+        unheld.push_back(index);
+        return index;
+    }
 };
 
 thread_local static ItemDatabase g_item_db{};
@@ -1,21 +1,138 @@
 #include "catalog/particle_fx.h"
-#include "fx/fx.h"
+#include "helpers.h"
 
 namespace Catalog {
     void ParticleFX::Load(void)
     {
-        byId[(size_t)ParticleEffectID::Blood      ] = { FX::blood_init,        FX::blood_update        };
-        byId[(size_t)ParticleEffectID::Copper     ] = { FX::copper_init,       FX::copper_update       };
-        byId[(size_t)ParticleEffectID::Gem        ] = { FX::gem_init,          FX::gem_update          };
-        byId[(size_t)ParticleEffectID::GoldenChest] = { FX::golden_chest_init, FX::golden_chest_update };
-        byId[(size_t)ParticleEffectID::Goo        ] = { FX::goo_init,          FX::goo_update          };
-        byId[(size_t)ParticleEffectID::Number     ] = { FX::number_init,       FX::number_update       };
-        byId[(size_t)ParticleEffectID::Poison_Nova] = { FX::poison_nova_init,  FX::poison_nova_update  };
-        byId[(size_t)ParticleEffectID::Rainbow    ] = { FX::rainbow_init,      FX::rainbow_update      };
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Blood];
+            def.timing       = ParticleTiming::Params;
+            def.launch       = ParticleLaunch::Params;
+            def.scale        = ParticleScale::SpawnOrder;
+            def.palette[0]   = { 255, 0, 0, 255 };
+            def.paletteCount = 1;
+            def.colorLerp    = true;
+            def.fade         = ParticleFade::Lerp;
+            def.fadeColor    = { 0, 0, 0, 25 };
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Copper];
+            def.timing        = ParticleTiming::Duration;
+            def.spawnVariance = 0.05f;
+            def.dieVariance   = 0.15f;
+            def.launch        = ParticleLaunch::Box;
+            def.velocityMin   = { -1.0f, -1.0f, 0.0f };
+            def.velocityMax   = { 1.0f, 1.0f, 4.0f };
+            def.restitution   = 0.8f;
+            def.friction      = 0.5f;
+            def.scale         = ParticleScale::Fixed;
+            def.scaleA        = 1.0f;
+            def.palette[0]    = WHITE;
+            def.paletteCount  = 1;
+            def.spritesheet   = SpritesheetID::Item_Coins;
+            def.sprite        = sprite_id("coin_copper");
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Gem];
+            def.timing        = ParticleTiming::Duration;
+            def.spawnDelay    = 0.75f;
+            def.spawnVariance = 0.05f;
+            def.dieVariance   = 0.15f;
+            def.launch        = ParticleLaunch::Box;
+            def.velocityMin   = { -1.0f, -1.0f, 3.0f };
+            def.velocityMax   = { 1.0f, 1.0f, 6.0f };
+            def.restitution   = 0.9f;
+            def.friction      = 0.4f;
+            def.scale         = ParticleScale::Fixed;
+            def.scaleA        = 1.0f;
+            def.palette[0]    = WHITE;
+            def.paletteCount  = 1;
+            def.bounceSound   = SoundID::GemBounce;
+            def.bouncePitch   = 1.5f;
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::GoldenChest];
+            def.timing        = ParticleTiming::Duration;
+            def.spawnVariance = 0.05f;
+            def.dieVariance   = 0.15f;
+            def.launch        = ParticleLaunch::Box;
+            def.offsetMin     = { 0.0f, 0.0f, 1.0f };
+            def.offsetMax     = { 0.0f, 0.0f, 1.0f };
+            def.restitution   = 0.2f;
+            def.friction      = 0.1f;
+            def.scale         = ParticleScale::Fixed;
+            def.scaleA        = 2.0f;
+            def.palette[0]    = WHITE;
+            def.paletteCount  = 1;
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Goo];
+            def.timing        = ParticleTiming::Duration;
+            def.spawnVariance = 0.25f;
+            def.dieVariance   = 0.15f;
+            def.launch        = ParticleLaunch::Box;
+            def.velocityMin   = { -1.0f, -1.0f, 0.0f };
+            def.velocityMax   = { 1.0f, 1.0f, 2.0f };
+            def.friction      = 0.5f;
+            def.scale         = ParticleScale::Lerp;
+            def.scaleA        = 10.0f;
+            def.scaleB        = 2.0f;
+            def.palette[0]    = { 154, 219, 63, 178 };  // Slime lime
+            def.paletteCount  = 1;
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Number];
+            def.timing        = ParticleTiming::Duration;
+            def.spawnVariance = 0.05f;
+            def.dieVariance   = 0.15f;
+            def.launch        = ParticleLaunch::Box;
+            def.offsetMin     = { -0.5f, -0.5f, 0.0f };
+            def.offsetMax     = { 0.5f, 0.5f, 0.0f };
+            def.velocityMin   = { 0.0f, 0.0f, 4.0f };
+            def.velocityMax   = { 0.0f, 0.0f, 5.0f };
+            def.restitution   = 0.5f;
+            def.friction      = 0.5f;
+            def.scale         = ParticleScale::Fixed;
+            def.scaleA        = 2.0f;
+            def.palette[0]    = WHITE;
+            def.paletteCount  = 1;
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Poison_Nova];
+            def.timing       = ParticleTiming::Params;
+            def.launch       = ParticleLaunch::Ring;
+            def.scale        = ParticleScale::ParamsLerp;
+            def.palette[0]   = { 64, 0, 255, 255 };
+            def.paletteCount = 1;
+            def.colorLerp    = true;
+            def.fade         = ParticleFade::Pulse;
+            def.fadeColor    = { 255, 0, 255, 255 };
+        }
+        {
+            ParticleEffectDef &def = byId[(size_t)ParticleEffectID::Rainbow];
+            def.timing       = ParticleTiming::Sweep;
+            def.launch       = ParticleLaunch::Arc;
+            def.velocityMin  = { 0.0f, 0.0f, 0.2f };
+            def.velocityMax  = { 0.0f, 0.0f, 0.4f };
+            def.arcRadius    = 3.0f;
+            def.arcBandWidth = 0.16f;
+            def.scale        = ParticleScale::Lerp;
+            def.scaleA       = 7.0f;
+            def.scaleB       = 0.0f;
+            def.palette[0]   = RED;
+            def.palette[1]   = ORANGE;
+            def.palette[2]   = GOLD;
+            def.palette[3]   = DARKGREEN;
+            def.palette[4]   = DARKBLUE;
+            def.palette[5]   = DARKPURPLE;
+            def.paletteCount = 6;
+            def.fade         = ParticleFade::Lerp;
+            def.fadeColor    = { 0, 0, 0, 153 };
+        }
     }
 
     const ParticleEffectDef &ParticleFX::FindById(ParticleEffectID id) const
     {
         return byId[(size_t)id];
     }
-}
\ No newline at end of file
+}
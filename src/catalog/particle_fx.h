@@ -1,7 +1,7 @@
 #pragma once
-
-struct Particle;
-struct ParticleEffect;
+#include "catalog/sounds.h"
+#include "catalog/spritesheets.h"
+#include "raylib/raylib.h"
 
 namespace Catalog {
     enum class ParticleEffectID {
@@ -17,12 +17,68 @@ namespace Catalog {
         Count
     };
 
-    typedef void (*ParticleEffect_FnInit)(Particle &particle);
-    typedef void (*ParticleEffect_FnUpdate)(Particle &particle, float alpha);
+    // When each particle spawns and dies, relative to the start of its effect
+    enum class ParticleTiming {
+        Params,    // spawn after params.spawnDelay, live for params.lifespan
+        Duration,  // spawn within spawnVariance of the start (after spawnDelay), die within dieVariance of the end
+        Sweep,     // spawn one after another along the arc over the first half of the effect, live for 40% of it
+    };
+
+    // Where each particle starts (relative to the effect origin) and how fast it's going
+    enum class ParticleLaunch {
+        Params,    // velocity from the params ranges, one axis at a time
+        Box,       // velocity from the def ranges, one axis at a time
+        Ring,      // random direction on the ground, speed from the params x velocity range
+        Arc,       // on a half circle above the origin, one band per palette color, drifting up
+    };
+
+    // How size changes over a particle's life
+    enum class ParticleScale {
+        Fixed,       // scaleA
+        SpawnOrder,  // params.spawnScaleFirst for the first particle to spawn -> params.spawnScaleLast for the last one
+        Lerp,        // scaleA -> scaleB
+        ParamsLerp,  // params.scaleA -> params.scaleB
+    };
+
+    // How opacity changes over a particle's life
+    enum class ParticleFade {
+        None,   // spawn color's alpha
+        Lerp,   // spawn color's alpha -> fadeColor's alpha
+        Pulse,  // fades in quickly, holds, then fades out
+    };
 
+    // Everything needed to spawn and animate one kind of particle effect. Only as much randomness and as many curves as
+    // the effects need, so that ParticleSystem can update whole effects in tight loops.
     struct ParticleEffectDef {
-        ParticleEffect_FnInit   init   {};
-        ParticleEffect_FnUpdate update {};
+        ParticleTiming timing        {};
+        float          spawnDelay    {};  // secs (Duration)
+        float          spawnVariance {};  // fraction of duration (Duration)
+        float          dieVariance   {};  // fraction of duration (Duration)
+
+        ParticleLaunch launch        {};
+        Vector3        offsetMin     {};  // meters from origin
+        Vector3        offsetMax     {};
+        Vector3        velocityMin   {};  // meters per sec (Box, z is the upward drift for Arc)
+        Vector3        velocityMax   {};
+        float          arcRadius     {};  // meters to the innermost band (Arc)
+        float          arcBandWidth  {};  // meters between bands (Arc)
+        float          restitution   {};  // 0 = no bounce    1 = 100% bounce
+        float          friction      {};  // 0 = no friction  1 = 100% friction, Params and Ring use params.friction
+
+        ParticleScale  scale         {};
+        float          scaleA        {};
+        float          scaleB        {};
+
+        Color          palette[6]    {};  // each particle picks a random spawn color
+        int            paletteCount  {};
+        bool           colorLerp     {};  // blend rgb from spawn color -> fadeColor over life
+        ParticleFade   fade          {};
+        Color          fadeColor     {};
+
+        SpritesheetID  spritesheet   {};  // draw particles with this sprite instead of a colored square
+        SpriteID       sprite        {};
+        SoundID        bounceSound   {};  // played when a particle bounces off the ground
+        float          bouncePitch   {};  // +/- 0.1
     };
 
     struct ParticleFX {
@@ -34,4 +90,4 @@ namespace Catalog {
     };
 
     thread_local static ParticleFX g_particleFx{};
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "catalog/sounds.h"
+#include "asset_loader.h"
 #include "helpers.h"
 #include "raylib/raylib.h"
 
@@ -21,26 +22,47 @@ namespace Catalog {
         return 0;
     }
 
-    void Sounds::Load(void)
+    void Sounds::Load(AssetLoader &loader)
     {
-        byId[(size_t)SoundID::Empty          ] = MissingOggSound();
-        byId[(size_t)SoundID::Footstep       ] = LoadSound("data/audio/sound/footstep1.ogg");
-        byId[(size_t)SoundID::Gold           ] = LoadSound("data/audio/sound/gold1.ogg");
-        byId[(size_t)SoundID::Slime_Stab1    ] = LoadSound("data/audio/sound/slime_stab1.ogg");
-        byId[(size_t)SoundID::Squeak         ] = LoadSound("data/audio/sound/squeak1.ogg");
-        byId[(size_t)SoundID::Squish1        ] = LoadSound("data/audio/sound/squish1.ogg");
-        byId[(size_t)SoundID::Squish2        ] = LoadSound("data/audio/sound/squish2.ogg");
-        byId[(size_t)SoundID::Whoosh         ] = LoadSound("data/audio/sound/whoosh1.ogg");
-        byId[(size_t)SoundID::GemBounce      ] = LoadSound("data/audio/sound/gem_bounce.wav");
-        byId[(size_t)SoundID::Eughh          ] = LoadSound("data/audio/sound/eughh.ogg");
-        byId[(size_t)SoundID::RainbowSparkles] = LoadSound("data/audio/sound/rainbow_sparkles.ogg");
-        byId[(size_t)SoundID::Click1         ] = LoadSound("data/audio/sound/click1.ogg");
+        byId[(size_t)SoundID::Empty] = MissingOggSound();
+        QueueSound(loader, SoundID::Footstep,        "data/audio/sound/footstep1.ogg");
+        QueueSound(loader, SoundID::Gold,            "data/audio/sound/gold1.ogg");
+        QueueSound(loader, SoundID::Slime_Stab1,     "data/audio/sound/slime_stab1.ogg");
+        QueueSound(loader, SoundID::Squeak,          "data/audio/sound/squeak1.ogg");
+        QueueSound(loader, SoundID::Squish1,         "data/audio/sound/squish1.ogg");
+        QueueSound(loader, SoundID::Squish2,         "data/audio/sound/squish2.ogg");
+        QueueSound(loader, SoundID::Whoosh,          "data/audio/sound/whoosh1.ogg");
+        QueueSound(loader, SoundID::GemBounce,       "data/audio/sound/gem_bounce.wav");
+        QueueSound(loader, SoundID::Eughh,           "data/audio/sound/eughh.ogg");
+        QueueSound(loader, SoundID::RainbowSparkles, "data/audio/sound/rainbow_sparkles.ogg");
+        QueueSound(loader, SoundID::Click1,          "data/audio/sound/click1.ogg");
 
         for (size_t i = 0; i < (size_t)SoundID::Count; i++) {
             mixer.volumeLimit[i] = 1.0f;
         }
     }
 
+    // Decode on a worker, only creating the audio buffer has to happen on this thread
+    void Sounds::QueueSound(AssetLoader &loader, SoundID id, const char *path)
+    {
+        Sound *sound = &byId[(size_t)id];
+        Wave *wave = new Wave{};
+        loader.Queue(path,
+            [wave, path] {
+                *wave = LoadWave(path);
+                return wave->frameCount ? ErrorType::Success : ErrorType::FileReadFailed;
+            },
+            [wave, sound] {
+                // Failed sounds are left empty, FindById falls back to the missing sound
+                if (wave->frameCount) {
+                    *sound = LoadSoundFromWave(*wave);
+                    UnloadWave(*wave);
+                }
+                delete wave;
+            }
+        );
+    }
+
     void Sounds::Unload(void)
     {
         StopSoundMulti();
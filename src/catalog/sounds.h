@@ -1,6 +1,8 @@
 #pragma once
 #include "raylib/raylib.h"
 
+struct AssetLoader;
+
 namespace Catalog {
     struct MasterMixer {
         float masterVolume = 1.0f;
@@ -31,7 +33,7 @@ namespace Catalog {
     };
 
     struct Sounds {
-        void Load(void);
+        void Load(AssetLoader &loader);  // call after InitAudioDevice
         void Unload(void);
         Sound FindById(SoundID id);
         void Play(SoundID id, float pitch = 1.0f, bool multi = false);
@@ -44,6 +46,7 @@ namespace Catalog {
         Sound byId            [(size_t)SoundID::Count]{};
 
         Sound MissingOggSound(void);
+        void QueueSound(AssetLoader &loader, SoundID id, const char *path);
     };
 
     thread_local static MasterMixer g_mixer{};
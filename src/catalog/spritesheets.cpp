@@ -1,15 +1,48 @@
 #include "catalog/spritesheets.h"
+#include "asset_loader.h"
+#include "asset_pack.h"
 #include "spritesheet.h"
+#include <string>
 
 namespace Catalog {
-    void Spritesheets::Load(void)
+    void Spritesheets::Load(AssetLoader &loader)
     {
         // TODO: Load spritesheets from file
-        byId[(size_t)SpritesheetID::Character_Charlie ].LoadFromFile("data/entity/character/charlie.txt");
-        byId[(size_t)SpritesheetID::Environment_Forest].LoadFromFile("data/entity/environment/forest.txt");
-        byId[(size_t)SpritesheetID::Item_Coins        ].LoadFromFile("data/entity/item/coins.txt");
-        byId[(size_t)SpritesheetID::Monster_Slime     ].LoadFromFile("data/entity/monster/slime.txt");
-        //byId[(size_t)SpritesheetID::Items      ].LoadFromFile("data/entity/item/items.txt");
+        QueueSpritesheet(loader, SpritesheetID::Character_Charlie , "data/entity/character/charlie.txt");
+        QueueSpritesheet(loader, SpritesheetID::Environment_Forest, "data/entity/environment/forest.txt");
+        QueueSpritesheet(loader, SpritesheetID::Item_Coins        , "data/entity/item/coins.txt");
+        QueueSpritesheet(loader, SpritesheetID::Monster_Slime     , "data/entity/monster/slime.txt");
+        //QueueSpritesheet(loader, SpritesheetID::Items      , "data/entity/item/items.txt");
+    }
+
+    // Load the compiled spritesheet next to the .txt when there is one (see tools/spritesheet_compiler.cpp), unless the
+    // .txt has been edited since it was compiled
+    static std::string spritesheet_compiled_path(const char *path)
+    {
+        const char *LOG_SRC = "Spritesheets";
+        std::string compiledPath = path;
+        const size_t ext = compiledPath.rfind('.');
+        compiledPath.replace(ext == std::string::npos ? compiledPath.size() : ext, std::string::npos, SPRITESHEET_BIN_EXT);
+        if (!asset_pack_file_exists(compiledPath.c_str())) {
+            return path;
+        }
+        // A sheet that only lives in data.pak has no mod time to go by, so it's used as-is
+        if (FileExists(path) && FileExists(compiledPath.c_str()) &&
+            GetFileModTime(path) > GetFileModTime(compiledPath.c_str())) {
+            E_WARN("%s is out of date, compiling %s instead", compiledPath.c_str(), path);
+            return path;
+        }
+        return compiledPath;
+    }
+
+    // Parse and decode the texture on a worker, upload it on this thread
+    void Spritesheets::QueueSpritesheet(AssetLoader &loader, SpritesheetID id, const char *path)
+    {
+        Spritesheet *spritesheet = &byId[(size_t)id];
+        loader.Queue(path,
+            [spritesheet, path = spritesheet_compiled_path(path)] { return spritesheet->LoadFromFile(path.c_str()); },
+            [spritesheet] { spritesheet->UploadTexture(); }
+        );
     }
 
     const Spritesheet &Spritesheets::FindById(SpritesheetID id) const
@@ -1,6 +1,8 @@
 #pragma once
 #include "spritesheet.h"
 
+struct AssetLoader;
+
 namespace Catalog {
     enum class SpritesheetID {
         Empty,
@@ -12,11 +14,13 @@ namespace Catalog {
     };
 
     struct Spritesheets {
-        void Load(void);
+        void Load(AssetLoader &loader);
         const Spritesheet &FindById(SpritesheetID id) const;
 
     private:
         Spritesheet byId[(size_t)SpritesheetID::Count];
+
+        void QueueSpritesheet(AssetLoader &loader, SpritesheetID id, const char *path);
     };
 
     thread_local static Spritesheets g_spritesheets{};
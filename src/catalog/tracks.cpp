@@ -1,3 +1,4 @@
+#include "asset_loader.h"
 #include "catalog/sounds.h"
 #include "catalog/tracks.h"
 #include "raylib/raylib.h"
@@ -13,24 +14,45 @@ namespace Catalog {
         return 0;
     }
 
-    void Tracks::Load(void)
+    void Tracks::Load(AssetLoader &loader)
     {
-        byId[(size_t)TrackID::CopyrightBG] = LoadMusicStream("data/audio/music/fluquor_copyright.ogg");
-        byId[(size_t)TrackID::Whistle    ] = LoadMusicStream("data/audio/music/whistle.ogg");
+        byId[(size_t)TrackID::Empty] = MissingOggTrack();
+        byId[(size_t)TrackID::Empty].looping = true;
+        QueueTrack(loader, TrackID::CopyrightBG, "data/audio/music/fluquor_copyright.ogg");
+        QueueTrack(loader, TrackID::Whistle,     "data/audio/music/whistle.ogg");
 
         for (size_t i = 0; i < (size_t)TrackID::Count; i++) {
-            if (!byId[i].frameCount) {
-                byId[i] = MissingOggTrack();
-            }
             mixer.volumeLimit [i] = 1.0f;
             mixer.volume      [i] = 1.0f;
             mixer.volumeSpeed [i] = 1.0f;
             mixer.volumeTarget[i] = 1.0f;
-            byId[i].looping = true;  // TODO: Handle this case-by-case via some config?
         }
         mixer.bgMusicDuckTo = 0.1f;
+    }
 
-        PlayMusicStream(byId[(size_t)TrackID::CopyrightBG]);
+    // Read the file on a worker and stream from memory, opening the stream has to happen on this thread. The file data
+    // has to stay around for as long as the stream does.
+    void Tracks::QueueTrack(AssetLoader &loader, TrackID id, const char *path)
+    {
+        Music *music = &byId[(size_t)id];
+        unsigned char **data = &fileData[(size_t)id];
+        unsigned int *dataSize = new unsigned int{};
+        loader.Queue(path,
+            [data, dataSize, path] {
+                *data = LoadFileData(path, dataSize);
+                return *data ? ErrorType::Success : ErrorType::FileReadFailed;
+            },
+            [this, music, data, dataSize] {
+                if (*data) {
+                    *music = LoadMusicStreamFromMemory(".ogg", *data, (int)*dataSize);
+                }
+                if (!music->frameCount) {
+                    *music = MissingOggTrack();
+                }
+                music->looping = true;  // TODO: Handle this case-by-case via some config?
+                delete dataSize;
+            }
+        );
     }
 
     void Tracks::Unload(void)
@@ -40,6 +62,8 @@ namespace Catalog {
                 StopMusicStream(byId[i]);
                 UnloadMusicStream(byId[i]);
             }
+            UnloadFileData(fileData[i]);
+            fileData[i] = 0;
         }
     }
 
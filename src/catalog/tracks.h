@@ -1,5 +1,7 @@
 #pragma once
 
+struct AssetLoader;
+
 namespace Catalog {
     enum class TrackID {
         Empty,
@@ -26,7 +28,7 @@ namespace Catalog {
     };
 
     struct Tracks {
-        void Load(void);
+        void Load(AssetLoader &loader);  // call after InitAudioDevice
         void Unload(void);
         Music &FindById(TrackID id);
         void Play(TrackID id, float pitch) const;
@@ -35,8 +37,11 @@ namespace Catalog {
 
         TrackMixer mixer{};
     private:
-        Music byId[(size_t)TrackID::Count]{};
+        Music          byId     [(size_t)TrackID::Count]{};
+        unsigned char *fileData [(size_t)TrackID::Count]{};  // streamed from memory, free with UnloadFileData()
+
         Music MissingOggTrack(void);
+        void QueueTrack(AssetLoader &loader, TrackID id, const char *path);
     };
 
     thread_local static Tracks g_tracks{};
@@ -0,0 +1,85 @@
+#include "chunk_generator.h"
+
+ChunkGenerator::~ChunkGenerator(void)
+{
+    Stop();
+}
+
+void ChunkGenerator::Start(uint64_t seed)
+{
+    Stop();
+    stop = false;
+    thread = new std::thread([this, seed] {
+        Run(seed);
+    });
+}
+
+void ChunkGenerator::Stop(void)
+{
+    if (!thread) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        jobs.clear();
+    }
+    wake.notify_one();
+    thread->join();
+    delete thread;
+    thread = 0;
+    done.clear();
+}
+
+void ChunkGenerator::Queue(const ChunkDiff &diff)
+{
+    DLB_ASSERT(thread);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(diff);
+    }
+    wake.notify_one();
+}
+
+size_t ChunkGenerator::Poll(std::vector<Result> &results)
+{
+    results.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    results.swap(done);
+    return results.size();
+}
+
+void ChunkGenerator::Run(uint64_t seed)
+{
+    // g_noise is thread_local, this thread needs its own copy seeded the same as the server's
+    g_noise.Seed(seed);
+
+    ChunkDiff diff{};
+    Result result{};
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stop || !jobs.empty(); });
+            if (stop) {
+                break;
+            }
+            diff = jobs.front();
+            jobs.pop_front();
+        }
+
+        result = {};
+        result.chunk.x = diff.chunkX;
+        result.chunk.y = diff.chunkY;
+        Tilemap::GenerateChunk(result.chunk, 0);
+        result.chunk.ApplyDiff(diff);
+        result.valid = result.chunk.CalcHash() == diff.hash;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stop) {
+            done.push_back(result);
+        }
+    }
+
+    g_noise.Free();
+}
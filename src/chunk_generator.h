@@ -0,0 +1,35 @@
+#pragma once
+#include "tilemap.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Client-side worker that generates chunks from the world seed and applies the server's diff on top, so we only
+// have to download the tiles that players (or structures) have changed.
+struct ChunkGenerator {
+    struct Result {
+        Chunk chunk {};
+        bool  valid {};  // false if the hash didn't match the server's, chunk needs to be downloaded instead
+    };
+
+    ~ChunkGenerator(void);
+
+    void Start   (uint64_t seed);
+    void Stop    (void);
+    bool Running (void) const { return thread != 0; }
+    void Queue   (const ChunkDiff &diff);
+    // Move finished chunks into results, returns number of results
+    size_t Poll  (std::vector<Result> &results);
+
+private:
+    std::thread             *thread  {};
+    std::mutex               mutex   {};
+    std::condition_variable  wake    {};
+    bool                     stop    {};
+    std::deque<ChunkDiff>    jobs    {};
+    std::vector<Result>      done    {};
+
+    void Run(uint64_t seed);
+};
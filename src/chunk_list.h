@@ -0,0 +1,69 @@
+#pragma once
+#include "helpers.h"
+#include "dlb_types.h"
+
+// Intrusive links for tracking which chunk an entity is currently inside of. The list head lives in the Chunk,
+// the links live in the entity (T::chunkNode). Entities must not move in memory while linked, unless the owner
+// calls ChunkList::Relocate after moving them (e.g. ItemSystem's swap-remove).
+template <typename T>
+struct ChunkListNode {
+    T         *prev   {};
+    T         *next   {};
+    ChunkHash  chunk  {};  // chunk the entity is linked into, only valid when linked == true
+    bool       linked {};
+};
+
+template <typename T>
+struct ChunkList {
+    T        *head  {};
+    uint32_t  count {};
+
+    void Insert(T &entity, ChunkHash chunk)
+    {
+        ChunkListNode<T> &node = entity.chunkNode;
+        DLB_ASSERT(!node.linked);
+        node.prev = 0;
+        node.next = head;
+        node.chunk = chunk;
+        node.linked = true;
+        if (head) {
+            head->chunkNode.prev = &entity;
+        }
+        head = &entity;
+        count++;
+    }
+
+    void Remove(T &entity)
+    {
+        ChunkListNode<T> &node = entity.chunkNode;
+        DLB_ASSERT(node.linked);
+        DLB_ASSERT(count);
+        if (node.prev) {
+            node.prev->chunkNode.next = node.next;
+        } else {
+            DLB_ASSERT(head == &entity);
+            head = node.next;
+        }
+        if (node.next) {
+            node.next->chunkNode.prev = node.prev;
+        }
+        node = {};
+        count--;
+    }
+
+    // Entity was copied from `from` to `to`, point the neighbors at the new address
+    void Relocate(T &from, T &to)
+    {
+        ChunkListNode<T> &node = to.chunkNode;
+        DLB_ASSERT(node.linked);
+        if (node.prev) {
+            node.prev->chunkNode.next = &to;
+        } else {
+            DLB_ASSERT(head == &from);
+            head = &to;
+        }
+        if (node.next) {
+            node.next->chunkNode.prev = &to;
+        }
+    }
+};
@@ -0,0 +1,94 @@
+#include "chunk_mesh.h"
+#include "raylib/rlgl.h"
+
+static void chunk_mesh_push_quad(std::vector<ChunkMeshVertex> &verts, const Tileset &tileset, size_t rectIdx, float x, float y)
+{
+    DLB_ASSERT(rectIdx < ARRAY_SIZE(tileset.textureRects));
+    DLB_ASSERT(tileset.texture.width);
+    DLB_ASSERT(tileset.texture.height);
+
+    const Rectangle &rect = tileset.textureRects[rectIdx];
+    const float texW = (float)tileset.texture.width;
+    const float texH = (float)tileset.texture.height;
+    const float u0 = rect.x / texW;
+    const float v0 = rect.y / texH;
+    const float u1 = (rect.x + rect.width) / texW;
+    const float v1 = (rect.y + rect.height) / texH;
+
+    verts.push_back({ x             , y              , u0, v0 });
+    verts.push_back({ x             , y + rect.height, u0, v1 });
+    verts.push_back({ x + rect.width, y + rect.height, u1, v1 });
+    verts.push_back({ x + rect.width, y              , u1, v0 });
+}
+
+void ChunkMesh::Build(const Chunk &chunk, const Tileset &groundTileset, const Tileset &objectTileset)
+{
+    ground.clear();
+    objects.clear();
+    objectTiles.clear();
+    sprites.clear();
+    ground.reserve(ARRAY_SIZE(chunk.tiles) * 4);
+
+    const float chunkX = (float)chunk.x * CHUNK_W * TILE_W;
+    const float chunkY = (float)chunk.y * CHUNK_H * TILE_W;
+    for (size_t tileIdx = 0; tileIdx < ARRAY_SIZE(chunk.tiles); tileIdx++) {
+        const Tile &tile = chunk.tiles[tileIdx];
+        const float x = chunkX + (float)(tileIdx % CHUNK_W) * TILE_W;
+        const float y = chunkY + (float)(tileIdx / CHUNK_W) * TILE_W;
+        chunk_mesh_push_quad(ground, groundTileset, tile.type, x, y);
+
+        if (tile.object.type) {
+            const ObjectType effectiveType = tile.object.EffectiveType();
+            if (effectiveType < ObjectType_SpritesheetCount) {
+                chunk_mesh_push_quad(objects, objectTileset, effectiveType, x, y);
+                objectTiles.push_back((uint16_t)tileIdx);
+            } else {
+                sprites.push_back((uint16_t)tileIdx);
+            }
+        }
+    }
+    stale = false;
+}
+
+void ChunkMesh::Draw(const Texture &texture, const std::vector<ChunkMeshVertex> &verts, size_t first, size_t count)
+{
+    DLB_ASSERT((first + count) * 4 <= verts.size());
+    if (!count) {
+        return;
+    }
+
+    rlSetTexture(texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(255, 255, 255, 255);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    const ChunkMeshVertex *vert = &verts[first * 4];
+    const ChunkMeshVertex *end = vert + count * 4;
+    for (; vert != end; vert++) {
+        rlTexCoord2f(vert->u, vert->v);
+        rlVertex2f(vert->x, vert->y);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+const ChunkMesh &ChunkMeshCache::Fetch(const Chunk &chunk, const Tileset &groundTileset, const Tileset &objectTileset)
+{
+    auto iter = meshes.find(chunk.Hash());
+    if (iter == meshes.end()) {
+        iter = meshes.emplace(chunk.Hash(), ChunkMesh{ {}, {}, {}, {}, true }).first;
+    }
+    ChunkMesh &mesh = iter->second;
+    if (mesh.stale) {
+        mesh.Build(chunk, groundTileset, objectTileset);
+        builds++;
+    }
+    return mesh;
+}
+
+void ChunkMeshCache::Invalidate(ChunkHash chunk)
+{
+    auto iter = meshes.find(chunk);
+    if (iter != meshes.end()) {
+        iter->second.stale = true;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "tilemap.h"
+#include "tileset.h"
+#include <unordered_map>
+#include <vector>
+
+// CPU-side quads for drawing a chunk's tiles, built once when the chunk arrives or changes instead of looking up and
+// drawing every visible tile individually each frame. Quads are in world space, 4 vertices each, in the same order as
+// raylib's textured quads (TL, BL, BR, TR). Ground quads are row-major, so any visible sub-rectangle of the chunk is
+// one run of quads per row.
+struct ChunkMeshVertex {
+    float x {};  // world position
+    float y {};
+    float u {};  // normalized texture coords
+    float v {};
+};
+
+struct ChunkMesh {
+    std::vector<ChunkMeshVertex> ground      {};  // one quad per tile, from the map's tileset
+    std::vector<ChunkMeshVertex> objects     {};  // one quad per tile object that's drawn straight from the objects tileset
+    std::vector<uint16_t>        objectTiles {};  // tile index of each quad in objects
+    std::vector<uint16_t>        sprites     {};  // tile index of each object drawn as a depth-sorted sprite (e.g. trees)
+    bool                         stale       {};  // chunk tiles changed since this was built
+
+    void Build(const Chunk &chunk, const Tileset &groundTileset, const Tileset &objectTileset);
+    // Submit quads [first, first + count) of verts to the GPU batch in one go, needs a GL context
+    static void Draw(const Texture &texture, const std::vector<ChunkMeshVertex> &verts, size_t first, size_t count);
+};
+
+struct ChunkMeshCache {
+    std::unordered_map<ChunkHash, ChunkMesh> meshes {};
+    size_t                                   builds {};  // total number of (re)builds, for stats/tests
+
+    // Mesh for chunk, (re)built first if it's new or stale
+    const ChunkMesh &Fetch(const Chunk &chunk, const Tileset &groundTileset, const Tileset &objectTileset);
+    // Must be called whenever a chunk's tiles change, e.g. a WorldChunk or TileDelta arrives
+    void Invalidate(ChunkHash chunk);
+};
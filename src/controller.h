@@ -1,6 +1,7 @@
 #pragma once
 #include "helpers.h"
 #include "dlb_types.h"
+#include <cmath>
 
 struct PlayerControllerState {
     // Global keys
@@ -76,6 +77,8 @@ struct InputSample {
             dt = g_inputMsecHax * (1.0f / 1000.0f);
         }
 #endif
+        // Quantize now rather than on send, so client prediction replays the exact dt the server simulates
+        dt         = DtQuantized() * CL_INPUT_DT_QUANTUM;
         walkNorth  = controllerState.walkNorth;
         walkEast   = controllerState.walkEast;
         walkSouth  = controllerState.walkSouth;
@@ -86,7 +89,14 @@ struct InputSample {
         skipFx     = false;
     }
 
-    bool Equals(InputSample &other) {
+    // dt in multiples of CL_INPUT_DT_QUANTUM, as sent over the wire
+    uint32_t DtQuantized(void) const
+    {
+        const float steps = roundf(dt / CL_INPUT_DT_QUANTUM);
+        return (uint32_t)CLAMP(steps, 0.0f, (float)((1u << CL_INPUT_DT_BITS) - 1));
+    }
+
+    bool Equals(const InputSample &other) const {
         return (
             ownerId    == other.ownerId    &&
             walkNorth  == other.walkNorth  &&
@@ -1,10 +1,8 @@
 #include "draw_command.h"
-#include "entities/entities.h"
-#include "particles.h"
-#include "player.h"
-#include "world_item.h"
-#include <cstdlib>
-#include <cstring>
+#include "error.h"
+#include "helpers.h"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 void DrawList::EnableCulling(const Rectangle &rect)
@@ -20,7 +18,17 @@ void DrawList::DisableCulling()
     cullEnabled = false;
 }
 
-void DrawList::Push(const Drawable &drawable, float depth, bool cull, Vector2 at)
+uint64_t DrawCommand::SortKey(DrawableType type, float depth)
+{
+    DLB_ASSERT(type < DrawableType::Count);
+    // Fixed point depth, biased so that negative depths sort below positive ones as unsigned ints. Clamped well
+    // inside int32 range, which is still ~100k km of world in either direction.
+    const float fixed = CLAMP(floorf(depth * CL_DRAW_DEPTH_SCALE), -1073741824.0f, 1073741824.0f);
+    const uint32_t depthBits = (uint32_t)(int32_t)fixed ^ 0x80000000u;
+    return ((uint64_t)depthBits << 8) | (uint8_t)type;
+}
+
+void DrawList::Push(const Drawable &drawable, DrawableType type, float depth, bool cull, Vector2 at)
 {
     // TODO: Check this before calling push
     //if (!drawable.sprite.spriteDef) {
@@ -33,29 +41,63 @@ void DrawList::Push(const Drawable &drawable, float depth, bool cull, Vector2 at
     }
 #endif
 
-    size_t size = sortedCommands.size();
-    sortedCommands.resize(size + 1);
-    int j;
-    // NOTE: j is signed because it terminates at -1
-    for (j = (int)size - 1; j >= 0; j--) {
-        if (depth > sortedCommands[j].depth) {
-            break;
+    // Sorted once in Flush, keeping these in push order makes Push O(1)
+    commands.emplace_back(&drawable, DrawCommand::SortKey(type, depth), cull, at);
+}
+
+// LSD radix sort on the 40 bit sort key, one byte per pass. Passes where every key has the same byte (e.g. the high
+// depth bytes, since everything on screen is within a few thousand pixels) are skipped. The sort is stable, and runs
+// on the commands in reverse, so drawables with the same key are drawn in reverse push order, the way Push used to
+// insert them. Drawables of different types within the same 1/4 pixel of depth are drawn in type order instead.
+void DrawList::Sort(void)
+{
+    const size_t SORT_KEY_BYTES = 5;
+    const size_t count = commands.size();
+    if (count < 2) {
+        return;
+    }
+    std::reverse(commands.begin(), commands.end());
+
+    size_t histograms[SORT_KEY_BYTES][256]{};
+    for (const DrawCommand &cmd : commands) {
+        for (size_t pass = 0; pass < SORT_KEY_BYTES; pass++) {
+            histograms[pass][(cmd.sortKey >> (pass * 8)) & 0xFF]++;
         }
-        sortedCommands[(size_t)j + 1] = sortedCommands[j];
     }
-    sortedCommands[(size_t)j + 1] = { &drawable, depth, cull, at };
+
+    scratch.resize(count);
+    for (size_t pass = 0; pass < SORT_KEY_BYTES; pass++) {
+        size_t *histogram = histograms[pass];
+        const size_t shift = pass * 8;
+        if (histogram[(commands[0].sortKey >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < 256; bucket++) {
+            const size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (const DrawCommand &cmd : commands) {
+            scratch[histogram[(cmd.sortKey >> shift) & 0xFF]++] = cmd;
+        }
+        commands.swap(scratch);
+    }
 }
 
 void DrawList::Flush(World &world)
 {
-    if (sortedCommands.empty()) {
+    if (commands.empty()) {
         return;
     }
 
-    for (const DrawCommand &cmd : sortedCommands) {
+    Sort();
+
+    for (const DrawCommand &cmd : commands) {
 #if !CL_CULL_ON_PUSH
         if (!cullEnabled || !cmd.cull) {
-            cmd.drawable->Draw();
+            cmd.drawable->Draw(world, cmd.at);
         }
 #else
         DLB_ASSERT(cmd.drawable);
@@ -63,5 +105,5 @@ void DrawList::Flush(World &world)
 #endif
     }
 
-    sortedCommands.clear();
-}
\ No newline at end of file
+    commands.clear();
+}
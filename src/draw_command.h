@@ -1,16 +1,19 @@
 #pragma once
 #include "raylib/raylib.h"
+#include <cstdint>
 #include <vector>
 
 struct World;
 
-//enum class DrawableType {
-//    Particle,
-//    Player,
-//    Enemy,
-//    WorldItem,
-//    Count,
-//};
+// Drawables at the same (quantized) depth are drawn grouped by type, so that consecutive draws share a texture and batch
+enum class DrawableType : uint8_t {
+    SpriteFrame,
+    WorldItem,
+    NPC,
+    Player,
+    Particle,
+    Count,
+};
 
 class Drawable {
 public:
@@ -19,25 +22,29 @@ public:
 
 struct DrawCommand {
     const Drawable *drawable {};
-    float    depth     {};
-    bool     cull      {};
-    Vector2  at        {};  // for things that don't know where they are by themselves (e.g. tile-based entities)
+    uint64_t        sortKey  {};  // quantized depth in the high bits, type in the low bits
+    Vector2         at       {};  // for things that don't know where they are by themselves (e.g. tile-based entities)
+    bool            cull     {};
 
     DrawCommand(void) {};
 
-    DrawCommand(const Drawable *drawable, float depth, bool cull = false, Vector2 at = { 0, 0 })
-        : drawable(drawable), at(at), depth(depth), cull(cull) {};
+    DrawCommand(const Drawable *drawable, uint64_t sortKey, bool cull = false, Vector2 at = { 0, 0 })
+        : drawable(drawable), sortKey(sortKey), at(at), cull(cull) {};
+
+    static uint64_t SortKey(DrawableType type, float depth);
 };
 
 struct DrawList {
     void EnableCulling(const Rectangle &rect);  // must be enabled before calling push()
     void DisableCulling();
-    void Push(const Drawable &drawable, float depth, bool cull = false, Vector2 at = { 0, 0 });
+    void Push(const Drawable &drawable, DrawableType type, float depth, bool cull = false, Vector2 at = { 0, 0 });
     void Flush(World &world);
 
     bool      cullEnabled {};
     Rectangle cullRect    {};
 private:
-    std::vector<DrawCommand> sortedCommands {};
-};
+    void Sort(void);
 
+    std::vector<DrawCommand> commands {};  // in push order until Sort
+    std::vector<DrawCommand> scratch  {};  // radix sort ping-pongs between this and commands
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "body.h"
+#include "chunk_list.h"
 #include "combat.h"
 #include "draw_command.h"
 #include "sprite.h"
@@ -33,6 +34,7 @@ public:
     Sprite      sprite       {};
     MoveState   moveState    {};
     ActionState actionState  {};
+    ChunkListNode<NPC> chunkNode {};  // server-side, links npc into Chunk::npcs
 
     union {
         struct {
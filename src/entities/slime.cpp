@@ -1,5 +1,6 @@
 #include "slime.h"
 #include "../catalog/spritesheets.h"
+#include <float.h>
 
 void Slime::Init(NPC &npc)
 {
@@ -126,15 +127,10 @@ bool Slime::Attack(NPC &npc, double dt)
 
 void Slime::Update(NPC &npc, World &world, double dt)
 {
-    // Find nearest player
-    Vector2 toNearestPlayer{};
-    Player *nearestPlayer = world.FindNearestPlayer(npc.body.GroundPosition(), SV_ENEMY_DESPAWN_RADIUS,
-        &toNearestPlayer);
-
     // TODO: Make this more general for all enemies that should go away when nobody is nearby
     // Alternatively, we could store enemies in the world chunk if we want some sort of
     // mob continuity when a player returns to a previously visited area? Seems less fun.
-    if (!nearestPlayer || nearestPlayer->combat.diedAt) {
+    if (!world.SV_IsNearPlayer(npc.body.GroundPosition())) {
         // No nearby players, insta-kill enemy w/ no loot
         E_DEBUG("No nearby players, mark slime for despawn %u", npc.id);
         //npc.combat.Despawn();
@@ -142,33 +138,49 @@ void Slime::Update(NPC &npc, World &world, double dt)
         return;
     }
 
+    // Find nearest player
+    Vector2 toNearestPlayer{};
+    Player *nearestPlayer = world.FindNearestPlayer(npc.body.GroundPosition(), SV_SLIME_ATTACK_TRACK,
+        &toNearestPlayer);
+    if (nearestPlayer && nearestPlayer->combat.diedAt) {
+        nearestPlayer = 0;
+    }
+
     // Allow enemy to move toward nearest player
-    const float distToNearestPlayer = v2_length(toNearestPlayer);
-    if (distToNearestPlayer <= (float)SV_SLIME_ATTACK_TRACK) {
+    const float distToNearestPlayer = nearestPlayer ? v2_length(toNearestPlayer) : FLT_MAX;
+    if (nearestPlayer && distToNearestPlayer <= (float)SV_SLIME_ATTACK_TRACK) {
         Vector2 slimeToPlayer = v2_sub(nearestPlayer->body.GroundPosition(), npc.body.GroundPosition());
         const float moveDist = MIN(distToNearestPlayer, METERS_TO_PIXELS(npc.body.speed) * npc.sprite.scale);
         // 5% -1.0, 95% +1.0f
         const float moveRandMult = 1.0f; //dlb_rand32i_range(1, 100) > 5 ? 1.0f : -1.0f;
         const Vector2 slimeMoveDir = v2_normalize(slimeToPlayer);
-        const Vector2 slimeMoveMag = v2_scale(slimeMoveDir, moveDist * moveRandMult);
+        // Slimes can't swim or jump over rocks/trees, landing spot is roughly where the jump force takes them
+        const Vector2 slimeMoveMag = world.map.SweepMove(npc.body.GroundPosition(),
+            v2_scale(slimeMoveDir, moveDist * moveRandMult), TileBlock_Solid | TileBlock_Water);
         const Vector3 slimePos = npc.body.WorldPosition();
         const Vector3 slimePosNew = v3_add(slimePos, { slimeMoveMag.x, slimeMoveMag.y, 0 });
 
-        int willCollide = 0;
-        for (size_t collideIdx = 0; collideIdx < ARRAY_SIZE(world.npcs.slimes); collideIdx++) {
-            NPC &other = world.npcs.slimes[collideIdx];
-            if (other.id <= npc.id || other.combat.diedAt) {
-                continue;
-            }
-            DLB_ASSERT(other.type == NPC::Type_Slime);
+        // Only slimes in nearby chunks can possibly collide. Pad by a tile since chunk lists are updated at the
+        // end of the tick, and other slimes may have moved a little since then.
+        const float radiusScaled = SV_SLIME_RADIUS * npc.sprite.scale;
+        Chunk *nearbyChunks[SV_NEARBY_CHUNKS_MAX]{};
+        size_t nearbyChunkCount = world.map.FindNearbyChunks(npc.body.GroundPosition(),
+            radiusScaled + v2_length(slimeMoveMag) + TILE_W, nearbyChunks, ARRAY_SIZE(nearbyChunks));
 
-            Vector3 otherSlimePos = other.body.WorldPosition();
-            const float radiusScaled = SV_SLIME_RADIUS * npc.sprite.scale;
-            if (v3_length_sq(v3_sub(slimePos, otherSlimePos)) < SQUARED(radiusScaled)) {
-                TryCombine(npc, other);
-            }
-            if (v3_length_sq(v3_sub(slimePosNew, otherSlimePos)) < SQUARED(radiusScaled)) {
-                willCollide = 1;
+        int willCollide = 0;
+        for (size_t chunkIdx = 0; chunkIdx < nearbyChunkCount; chunkIdx++) {
+            for (NPC *other = nearbyChunks[chunkIdx]->npcs.head; other; other = other->chunkNode.next) {
+                if (other->type != NPC::Type_Slime || other->id <= npc.id || other->combat.diedAt) {
+                    continue;
+                }
+
+                Vector3 otherSlimePos = other->body.WorldPosition();
+                if (v3_length_sq(v3_sub(slimePos, otherSlimePos)) < SQUARED(radiusScaled)) {
+                    TryCombine(npc, *other);
+                }
+                if (v3_length_sq(v3_sub(slimePosNew, otherSlimePos)) < SQUARED(radiusScaled)) {
+                    willCollide = 1;
+                }
             }
         }
 
@@ -182,7 +194,7 @@ void Slime::Update(NPC &npc, World &world, double dt)
     }
 
     // Allow slime to attack if on the ground and close enough to the player
-    if (distToNearestPlayer <= SV_SLIME_ATTACK_REACH) {
+    if (nearestPlayer && distToNearestPlayer <= SV_SLIME_ATTACK_REACH) {
         if (!world.peaceful && Attack(npc, dt)) {
             nearestPlayer->combat.TakeDamage(npc.combat.meleeDamage * npc.sprite.scale);
         }
@@ -1,3 +1,4 @@
+#include "asset_loader.h"
 #include "catalog/items.h"
 #include "catalog/sounds.h"
 #include "catalog/spritesheets.h"
@@ -5,7 +6,6 @@
 #include "clock.h"
 #include "draw_command.h"
 #include "catalog/fonts.h"
-#include "fx/fx.h"
 #include "game_client.h"
 #include "healthbar.h"
 #include "loot_table.h"
@@ -28,21 +28,7 @@
 
 const char *GameClient::LOG_SRC = "GameClient";
 
-// TODO: Move this somewhere less stupid (e.g. a library of particle updaters)
-inline void RainbowParticlesDamagePlayer(Particle &particle, void *userData)
-{
-    DLB_ASSERT(userData);
-
-    Player *player = (Player *)userData;
-    const Vector3 particleWorld = v3_add(particle.effect->origin, particle.body.WorldPosition());
-    const Vector3 gut = player->GetAttachPoint(Player::AttachPoint::Gut);
-    const float particleToGut = v3_length_sq(v3_sub(gut, particleWorld));
-    if (particleToGut < SQUARED(METERS_TO_PIXELS(0.2f))) {
-        player->combat.TakeDamage(0.1f);
-    }
-}
-
-void GameClient::LoadingScreen(const char *text)
+void GameClient::LoadingScreen(const char *text, float progress)
 {
     DLB_ASSERT(checkboardTexture.id);
     DLB_ASSERT(screenSize.x);
@@ -54,11 +40,50 @@ void GameClient::LoadingScreen(const char *text)
     Vector2 size = MeasureTextEx(g_fonts.fontBig, text, (float)g_fonts.fontBig.baseSize, 1.0f);
     Vector2 pos{ screenSize.x / 2.0f - screenSize.x / 3.0f, screenSize.y / 2.0f - size.y / 2.0f };
     DrawTextFont(g_fonts.fontBig, text, pos.x, pos.y, -2, -2, g_fonts.fontBig.baseSize, WHITE);
+    if (progress >= 0.0f) {
+        Rectangle bar{ pos.x, pos.y + size.y + 16.0f, screenSize.x * 2.0f / 3.0f, 16.0f };
+        DrawRectangleRec(bar, Fade(BLACK, 0.5f));
+        bar.width *= CLAMP(progress, 0.0f, 1.0f);
+        DrawRectangleRec(bar, WHITE);
+    }
     EndDrawing();
 }
 
+// Rasterizing the SDF glyphs is the slowest part of loading the fonts, do it on a worker and only upload the atlas here
+void GameClient::QueueSdfFont(AssetLoader &loader, Font &font, int fontSize, const char *fontName)
+{
+    Font *sdf = &font;
+    Image *atlas = new Image{};
+    sdf->baseSize = fontSize;
+    sdf->glyphCount = 95;
+    loader.Queue("SDF font",
+        [sdf, atlas, fontName] {
+            unsigned int fileSize = 0;
+            unsigned char *fileData = LoadFileData(fontName, &fileSize);
+            if (!fileData) {
+                return ErrorType::FileReadFailed;
+            }
+            // Parameters > font size: 16, no glyphs array provided (0), glyphs count: 0 (defaults to 95)
+            sdf->glyphs = LoadFontData(fileData, fileSize, sdf->baseSize, 0, 0, FONT_SDF);
+            // Parameters > glyphs count: 95, font size: 16, glyphs padding in image: 0 px, pack method: 1 (Skyline algorythm)
+            *atlas = GenImageFontAtlas(sdf->glyphs, &sdf->recs, 95, sdf->baseSize, 0, 1);
+            UnloadFileData(fileData);  // Free memory from loaded file
+            return ErrorType::Success;
+        },
+        [sdf, atlas] {
+            if (atlas->data) {
+                sdf->texture = LoadTextureFromImage(*atlas);
+                UnloadImage(*atlas);
+            }
+            delete atlas;
+        }
+    );
+}
+
 void GameClient::Init(void)
 {
+    startupLog.Start();
+
     // NOTE: There could be other, bigger monitors
     const int monitorWidth = GetMonitorWidth(0);
     const int monitorHeight = GetMonitorHeight(0);
@@ -93,6 +118,32 @@ void GameClient::Init(void)
     Image checkerboardImage = GenImageChecked((int)screenSize.x, (int)screenSize.y, 32, 32, LIGHTGRAY, GRAY);
     checkboardTexture = LoadTextureFromImage(checkerboardImage);
     UnloadImage(checkerboardImage);
+    startupLog.Mark("Window");
+
+    // Sounds and tracks need the audio device to finish loading, start it before queueing them
+    LoadingScreen("Loading Audio Devices...");
+    InitAudioDevice();
+    if (!IsAudioDeviceReady()) {
+        printf("ERROR: Failed to initialized audio device\n");
+    }
+
+    // Read and decode everything on workers while we set up the rest of the renderer, the GPU/audio half of each
+    // asset is done once we wait on the loader below
+    LoadingScreen("Loading Assets...");
+    AssetLoader loader{};
+    loader.Start(MAX(1, MIN(CL_ASSET_LOADER_WORKERS, (int)std::thread::hardware_concurrency() - 1)));
+    QueueSdfFont(loader, g_fonts.fontSdf24, 24, fontName);
+    QueueSdfFont(loader, g_fonts.fontSdf72, 72, fontName);
+    g_item_catalog.LoadTextures(loader);
+    ItemCatalog *itemCatalog = &g_item_catalog;
+    loader.Queue("data/entity/item/items.csv", [itemCatalog] {
+        itemCatalog->LoadData();
+        return ErrorType::Success;
+    }, 0);
+    Catalog::g_sounds.Load(loader);
+    Catalog::g_tracks.Load(loader);
+    Catalog::g_spritesheets.Load(loader);
+    tileset_init(loader);
 
     // Setup Dear ImGui context
     LoadingScreen("Loading UI...");
@@ -126,61 +177,24 @@ void GameClient::Init(void)
     g_fonts.imFontHack64 = io.Fonts->AddFontFromFileTTF(fontName, 64.0f);
     io.FontDefault = g_fonts.imFontHack16;
 
-    // SDF font generation from TTF font
-    {
-        unsigned int fileSize = 0;
-        unsigned char *fileData = 0;
-        Image atlas{};
-
-        g_fonts.fontSdf24.baseSize = 24;
-        g_fonts.fontSdf24.glyphCount = 95;
-        // Parameters > font size: 16, no glyphs array provided (0), glyphs count: 0 (defaults to 95)
-        // Loading file to memory
-        fileData = LoadFileData(fontName, &fileSize);
-        g_fonts.fontSdf24.glyphs = LoadFontData(fileData, fileSize, g_fonts.fontSdf24.baseSize, 0, 0, FONT_SDF);
-        // Parameters > glyphs count: 95, font size: 16, glyphs padding in image: 0 px, pack method: 1 (Skyline algorythm)
-        atlas = GenImageFontAtlas(g_fonts.fontSdf24.glyphs, &g_fonts.fontSdf24.recs, 95, g_fonts.fontSdf24.baseSize, 0, 1);
-        g_fonts.fontSdf24.texture = LoadTextureFromImage(atlas);
-        UnloadImage(atlas);
-        UnloadFileData(fileData);  // Free memory from loaded file
-
-        g_fonts.fontSdf72.baseSize = 72;
-        g_fonts.fontSdf72.glyphCount = 95;
-        // Parameters > font size: 16, no glyphs array provided (0), glyphs count: 0 (defaults to 95)
-        // Loading file to memory
-        fileData = LoadFileData(fontName, &fileSize);
-        g_fonts.fontSdf72.glyphs = LoadFontData(fileData, fileSize, g_fonts.fontSdf72.baseSize, 0, 0, FONT_SDF);
-        // Parameters > glyphs count: 95, font size: 16, glyphs padding in image: 0 px, pack method: 1 (Skyline algorythm)
-        atlas = GenImageFontAtlas(g_fonts.fontSdf72.glyphs, &g_fonts.fontSdf72.recs, 95, g_fonts.fontSdf72.baseSize, 0, 1);
-        g_fonts.fontSdf72.texture = LoadTextureFromImage(atlas);
-        UnloadImage(atlas);
-        UnloadFileData(fileData);  // Free memory from loaded file
-
-        // Load SDF required shader (we use default vertex shader)
-        g_sdfShader = LoadShader(0, "data/font/sdf.fs");
-        SetTextureFilter(g_fonts.fontSdf72.texture, TEXTURE_FILTER_BILINEAR);  // Required for SDF font
-    }
+    // Load SDF required shader (we use default vertex shader)
+    g_sdfShader = LoadShader(0, "data/font/sdf.fs");
 
     LoadingScreen("Loading Cameras...");
     g_spycam.Init({ screenSize.x * 0.5f, screenSize.y * 0.5f });
 
-    LoadingScreen("Loading Audio Devices...");
-    InitAudioDevice();
-    if (!IsAudioDeviceReady()) {
-        printf("ERROR: Failed to initialized audio device\n");
-    }
-
-    LoadingScreen("Loading Items...");
-    g_item_catalog.LoadTextures();
-    g_item_catalog.LoadData();
-
     LoadingScreen("Loading Particles...");
     Catalog::g_particleFx.Load();
 
-    LoadingScreen("Loading Sounds...");
-    Catalog::g_sounds.Load();
-    LoadingScreen("Loading Music...");
-    Catalog::g_tracks.Load();
+    loader.Wait([this, &loader] {
+        LoadingScreen("Loading Assets...", loader.Progress());
+    });
+    loader.LogTimings();
+    loader.Stop();
+    startupLog.Mark("Assets");
+
+    SetTextureFilter(g_fonts.fontSdf72.texture, TEXTURE_FILTER_BILINEAR);  // Required for SDF font
+    Catalog::g_tracks.Play(Catalog::TrackID::CopyrightBG, 1.0f);
     Catalog::g_mixer.masterVolume = 0.5f;
     Catalog::g_mixer.musicVolume = 0; //0.3f;
     Catalog::g_sounds.mixer.volumeLimit[(size_t)Catalog::SoundID::GemBounce] = 0.8f;
@@ -188,12 +202,9 @@ void GameClient::Init(void)
     Catalog::g_sounds.mixer.volumeLimit[(size_t)Catalog::SoundID::Footstep] = 0.8f;
     Catalog::g_sounds.mixer.volumeLimit[(size_t)Catalog::SoundID::Click1] = 0.85f;
 
-    LoadingScreen("Loading Spritesheets...");
-    Catalog::g_spritesheets.Load();
-    LoadingScreen("Loading Tilesets...");
-    tileset_init();
     LoadingScreen("Loading Network...");
     netClient.Load();
+    startupLog.Mark("Init");
 
 #if CL_DEMO_VIEW_RTREE
     const int RECT_COUNT = 100;
@@ -234,6 +245,9 @@ ErrorType GameClient::PlayMode_Network()
 {
     E_ERROR_RETURN(netClient.Receive(), "Failed to receive packets", 0);
 
+    // Items from snapshots that nothing here is holding (any more)
+    g_item_db.Reclaim();
+
     if (UI::DisconnectRequested(netClient.IsDisconnected())) {
         netClient.Disconnect();
     }
@@ -388,7 +402,7 @@ void GameClient::PlayMode_Update(double frameDt, PlayerControllerState &input)
         //renderAt = g_clock.now - (1.0 / (SNAPSHOT_SEND_RATE * 1.5));
         const double interpolationTime = 0.2;
         renderAt = g_clock.now - interpolationTime;
-        netClient.serverWorld->CL_Interpolate(renderAt);
+        netClient.serverWorld->CL_Interpolate(netClient.FindInterpolationCursor(renderAt));
         //netClient.serverWorld->CL_Extrapolate(g_clock.now - renderAt);
         netClient.serverWorld->CL_Animate(frameDt);
     }
@@ -649,6 +663,7 @@ ErrorType GameClient::Run(void)
 {
     error_init("game.log");
     Init();
+    bool firstFrame = true;
 
     while (!WindowShouldClose() && !UI::QuitRequested()) {
         // Time is of the essence
@@ -687,10 +702,17 @@ ErrorType GameClient::Run(void)
             UI::MainMenu(escape, *this);
         }
 
+        // Send everything queued this frame (input, chat, inventory clicks) in as few packets as possible
+        netClient.Flush();
+
         // Render flip
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         EndDrawing();
+        if (firstFrame) {
+            startupLog.Mark("First frame");
+            firstFrame = false;
+        }
     }
 
     // Cleanup
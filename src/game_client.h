@@ -1,5 +1,6 @@
 #pragma once
 #include "args.h"
+#include "asset_loader.h"
 #include "error.h"
 #include "net_client.h"
 #include "spycam.h"
@@ -33,10 +34,12 @@ private:
     Vector2 screenSize {};
 
     // Other random stuff
-    size_t tilesDrawn {};
-    double renderAt   {};
+    size_t     tilesDrawn {};
+    double     renderAt   {};
+    StartupLog startupLog {};
 
-    void LoadingScreen           (const char *text);
+    void LoadingScreen           (const char *text, float progress = -1.0f);
+    void QueueSdfFont            (AssetLoader &loader, Font &font, int fontSize, const char *fontName);
     void Init                    (void);
     void PlayMode_PollController (PlayerControllerState &input);
     ErrorType PlayMode_Network   (void);
@@ -32,9 +32,18 @@ ErrorType GameServer::Run(const Args *args)
     // This is per-thread now.. I don't think sharing it is a good idea?
     g_item_catalog.LoadData();
 #endif
+    Structure::LoadPrefabs();
 
     World *world = new World;
 
+    // Stamp a vault over the world spawn so players never spawn inside of a rock or tree. This gets queued and
+    // applied when the spawn chunks are generated below.
+    const Vector3 worldSpawn = world->GetWorldSpawn();
+    const Prefab &vault = Structure::FindPrefab(Structure_Vault);
+    Structure::Spawn(world->map, Structure_Vault,
+        worldSpawn.x - (vault.w / 2) * TILE_W,
+        worldSpawn.y - (vault.h / 2) * TILE_W);
+
     // Pre-generate spawn chunks
     for (short y = -2; y <= 2; y++) {
         for (short x = -2; x <= 2; x++) {
@@ -161,6 +170,9 @@ ErrorType GameServer::Run(const Args *args)
             world->SV_DespawnDeadEntities();
             world->SV_Simulate(SV_TICK_DT);
 
+            // Send chunks that were modified in bulk (e.g. structures) to clients that already have them
+            netServer.BroadcastTileDeltas();
+
             // Send players world updates
             for (size_t i = 0; i < SV_MAX_PLAYERS; i++) {
                 SV_Client &client = netServer.clients[i];
@@ -171,7 +183,9 @@ ErrorType GameServer::Run(const Args *args)
                 // Send nearby chunks to player if they haven't received them yet
                 netServer.SendNearbyChunks(client);
 
-                if (g_clock.now - client.lastSnapshotSentAt > SNAPSHOT_SEND_DT) {
+                // Slow down and shrink snapshots for clients whose connection can't keep up
+                client.congestion.Update(*client.peer, g_clock.now, SV_TICK_DT);
+                if (g_clock.now - client.lastSnapshotSentAt > client.congestion.snapshotInterval) {
     #if SV_DEBUG_INPUT_SAMPLES
                     E_DEBUG("Sending snapshot for tick %u / input seq #%u, to player %u\n", world->tick, client.lastInputAck, client.playerId);
     #endif
@@ -187,6 +201,12 @@ ErrorType GameServer::Run(const Args *args)
                 //E_ASSERT(netServer.SendNearbyEvents(client), "Failed to send nearby events. playerId: %u", client.playerId);
             }
         }
+
+        // Send everything queued this iteration, both replies to received messages and this tick's world updates
+        netServer.Flush();
+
+        // Items rolled or dropped since the last pass that didn't end up in a world item or inventory
+        g_item_db.Reclaim();
     }
 
     delete world;
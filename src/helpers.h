@@ -55,6 +55,7 @@
 #define SV_DEBUG_WORLD_NPCS              (0 && _DEBUG)
 #define SV_DEBUG_WORLD_ITEMS             (0 && _DEBUG)
 #define SV_DEBUG_WORLD_PLAYERS           (0 && _DEBUG)
+#define SV_DEBUG_SNAPSHOT_STATS          (0 && _DEBUG)
 
 #if _DEBUG
     #define SHOW_DEBUG_STATS 1
@@ -95,7 +96,8 @@
 #define SV_INPUT_HISTORY            SV_TICK_RATE
 #define SV_INPUT_HISTORY_DT_MAX     1.0  //(5.0 * SV_TICK_DT)  // discard buffered inputs that exceed a sane dt accumulation
 #define SV_WORLD_HISTORY            SV_TICK_RATE
-#define SV_TILE_UPDATE_DIST         METERS_TO_PIXELS(20.0f)
+#define SV_CHUNK_SEND_RADIUS        2                            // send chunks within this many chunks of the player
+#define SV_TILE_DELTA_MAX           (WORLD_CHUNK_TILES / 2)      // send whole chunk instead if more tiles than this changed in one tick
 // NOTE: max diagonal distance at 1080p is 1100 + radius units. 1200px allows for a ~50px wide entity
 #if SV_DEBUG_SPAWN_REALLY_CLOSE
 #define SV_PLAYER_NEARBY_THRESHOLD  300.0f                       // how close a player has to be to appear in your snapshot
@@ -110,6 +112,8 @@
 #define SV_ENEMY_DESPAWN_RADIUS     METERS_TO_PIXELS(40.0f)      // furthest enemies can be from a player before despawning
 #define SV_ITEM_NEARBY_THRESHOLD    METERS_TO_PIXELS(20.0f)      // how close an item has to be to receive a snapshot
 #endif
+#define SV_ENEMY_MAX_PER_CHUNK      4                            // don't spawn new enemies into chunks that already have this many npcs
+#define SV_NEARBY_CHUNKS_MAX        144                          // max # of chunks a nearby chunk query can return (must cover SV_ENEMY_DESPAWN_RADIUS)
 #define SV_ITEM_ATTRACT_DIST        METERS_TO_PIXELS(1.0f)       // how close player should be to item to attract it
 #define SV_ITEM_PICKUP_DIST         METERS_TO_PIXELS(0.3f)       // how close player should be to item to pick it up
 #define SV_ITEM_PICKUP_DELAY        1.0                          // how long after an item is spawned before it can be picked up by a player
@@ -134,23 +138,40 @@
 // NOTE: Due to how "enemy.moved" flag is calculated atm, this *MUST* match SV_TICK_RATE
 #define SNAPSHOT_SEND_RATE            30  //SV_TICK_RATE  //MIN(30, SV_TICK_RATE)
 #define SNAPSHOT_SEND_DT              (1.0 / SV_TICK_RATE)
-#define SNAPSHOT_MAX_PLAYERS          SV_MAX_PLAYERS
-#define SNAPSHOT_MAX_NPCS             MIN(64, SV_MAX_NPCS)
-#define SNAPSHOT_MAX_ITEMS            MIN(64, SV_MAX_ITEMS)
+#define SNAPSHOT_PLAYER_SIZE_MAX      1088  // most bytes one record can take in a snapshot (player w/ full inventory is ~1 KB)
+#define SNAPSHOT_NPC_SIZE_MAX         128   // npc w/ max length name is ~100 bytes
+#define SNAPSHOT_ITEM_SIZE_MAX        48
+#define SNAPSHOT_SEND_DT_MAX          0.1   // snapshot interval for the most congested clients (10 Hz)
+#define SNAPSHOT_BUDGET_MIN           (NET_BUNDLE_SIZE_MAX - NET_BUNDLE_PREFIX)  // most congested clients get snapshots that fit in one packet
+#define SNAPSHOT_BUDGET_MAX           PACKET_SIZE_MAX                            // healthy clients get as many records as fit
+
+#define SV_CONGESTION_LOSS_MAX        0.05f  // packet loss above this means the client's link is congested
+#define SV_CONGESTION_RTT_SLACK       100    // msec, RTT this far above the lowest recent RTT means packets are queueing up somewhere
+#define SV_CONGESTION_RTT_DRIFT       10.0f  // msec/sec, how fast the lowest recent RTT forgets, in case the route changed
+#define SV_CONGESTION_BACKOFF_DT      1.0    // while congested, halve snapshot quality at most this often
+#define SV_CONGESTION_RECOVERY_RATE   0.2f   // snapshot quality regained per second while healthy (5 sec from worst to best)
 
 #define CL_FRAME_DT_MAX               (2.0 * SV_TICK_DT)
 #define CL_INPUT_SEND_RATE_LIMIT      60 // max # of input packets to sender to server per second
 #define CL_INPUT_SEND_RATE_LIMIT_DT   (1.0 / CL_INPUT_SEND_RATE_LIMIT)
 #define CL_INPUT_HISTORY              (256) // how many samples to keep around client side
-#define CL_INPUT_SAMPLES_MAX          (CL_INPUT_HISTORY) // send up to 1 second of samples per packet
+#define CL_INPUT_SAMPLES_MAX          32 // resend at most this many unacked samples per packet (~0.5 sec at 60 fps)
+#define CL_INPUT_DT_QUANTUM           (1.0f / 2048.0f) // input dt is sent as a multiple of this many secs (~0.5 ms)
+#define CL_INPUT_DT_BITS              10 // max input dt of ~0.5 sec
+#define CL_INPUT_DT_DELTA_BITS        4  // frame-to-frame dt jitter within +/- 8 quanta is sent as a small delta
 #define CL_WORLD_HISTORY              (SV_TICK_RATE / 2 + 1)  // >= 500 ms of data
 #define CL_CHAT_HISTORY               256
 #define CL_INVENTORY_UPDATE_SLOTS_MAX 256
 #define CL_MAX_PLAYER_POS_DESYNC_DIST METERS_TO_PIXELS(0.01)  // less than 1 pixel delta allowed
 #define CL_DAY_NIGHT_CYCLE            0
+#define CL_DRAW_DEPTH_SCALE           4.0f  // draw order depth is quantized to 1/4 pixel, drawables closer than that are grouped by type
+#define CL_ASSET_LOADER_WORKERS       4     // max # of threads reading/decoding assets at startup
 
 //#define PACKET_SIZE_MAX         1024
 #define PACKET_SIZE_MAX         16384
+#define NET_BUNDLE_SIZE_MAX     1200  // messages are bundled into packets up to this size, leaves room for ENet/UDP headers in a 1400 byte MTU
+#define NET_BUNDLE_PREFIX       sizeof(uint16_t)  // length prefix in front of each message in a bundle
+#define NET_PACKET_BUFFER_SIZE  (NET_BUNDLE_SIZE_MAX + PACKET_SIZE_MAX + 16)  // fits a max size message serialized at the end of a full bundle
 // Min/max ASCII value for username/password/motd/message, etc.
 #define STRING_ASCII_MIN        32
 #define STRING_ASCII_MAX        126
@@ -171,6 +192,7 @@
 #define WORLD_CHUNK_MIN         INT16_MIN
 #define WORLD_CHUNK_MAX         INT16_MAX
 #define WORLD_CHUNK_TILES       256
+#define WORLD_GEN_VERSION       1   // bump whenever Tilemap::GenerateChunk output changes for a given seed
 #define ENTITY_POSITION_X_MIN   0
 #define ENTITY_POSITION_X_MAX   UINT32_MAX  // Actually a float, so we need to allow full range
 #define ENTITY_POSITION_Y_MIN   0
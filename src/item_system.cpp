@@ -1,4 +1,5 @@
 #include "item_system.h"
+#include "tilemap.h"
 #include "catalog/spritesheets.h"
 #include "raylib/raylib.h"
 #include "sprite.h"
@@ -14,6 +15,13 @@
 // Server sends InventoryUpdate event
 // Server broadcasts ItemPickup event
 
+ItemSystem::~ItemSystem(void)
+{
+    for (const WorldItem &item : worldItems) {
+        g_item_db.Release(item.stack.uid);
+    }
+}
+
 WorldItem *ItemSystem::SpawnItem(Vector3 pos, ItemUID itemUid, uint32_t count, EntityUID euid)
 {
     if (!count) {
@@ -73,7 +81,12 @@ WorldItem *ItemSystem::SpawnItem(Vector3 pos, ItemUID itemUid, uint32_t count, E
     worldItem.spawnedAt = g_clock.now;
 
     byEuid[worldItem.euid] = (uint32_t)worldItems.size();
-    return &worldItems.emplace_back(worldItem);
+    WorldItem &newItem = worldItems.emplace_back(worldItem);
+    g_item_db.AddRef(newItem.stack.uid);
+    if (g_clock.server && map) {
+        map->UpdateChunkLink(newItem);
+    }
+    return &newItem;
 }
 
 WorldItem *ItemSystem::Find(EntityUID euid)
@@ -106,11 +119,18 @@ ErrorType ItemSystem::Remove(EntityUID euid)
     uint32_t idx = elem->second;
     uint32_t len = (uint32_t)worldItems.size();
     if (idx < len) {
+        g_item_db.Release(worldItems[idx].stack.uid);
+        if (map) {
+            map->UnlinkChunk(worldItems[idx]);
+        }
         if (idx == len - 1) {
             worldItems.pop_back();
         } else {
             // Copy last item to empty slot to keep densely packed
             worldItems[idx] = worldItems.back();
+            if (map) {
+                map->RelocateChunkLink(worldItems.back(), worldItems[idx]);
+            }
             // Update hash table
             byEuid[worldItems[idx].euid] = idx;
             // Zero free slot
@@ -175,7 +195,7 @@ void ItemSystem::PushAll(DrawList &drawList)
     for (WorldItem &item : worldItems) {
         if (item.stack.count) {
             DLB_ASSERT(item.stack.uid);
-            drawList.Push(item, item.Depth(), item.Cull(drawList.cullRect));
+            drawList.Push(item, DrawableType::WorldItem, item.Depth(), item.Cull(drawList.cullRect));
         }
     }
 }
\ No newline at end of file
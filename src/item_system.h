@@ -4,10 +4,13 @@
 #include <unordered_map>
 #include <vector>
 
-// This manages items spawned into the world as physics bodies; see Catalog::ItemDatabase for the actual item data
+struct Tilemap;
+
+// This manages items spawned into the world as physics bodies; see ItemDatabase for the actual item data. Each world item
+// holds a reference to its item for as long as it's in worldItems.
 struct ItemSystem {
     ItemSystem  (void) { worldItems.reserve(SV_MAX_ITEMS); }
-    ~ItemSystem (void) {}
+    ~ItemSystem (void);
 
     WorldItem *SpawnItem           (Vector3 pos, ItemUID itemUid, uint32_t count, EntityUID euid = 0);
     WorldItem *Find                (EntityUID eid);
@@ -18,6 +21,7 @@ struct ItemSystem {
 
     std::vector<WorldItem> worldItems{};
     std::unordered_map<EntityUID, uint32_t> byEuid{};  // map of world item entity id -> items[] index
+    Tilemap *map {};  // server-side, used to keep Chunk::items up-to-date
 
 private:
     const char *LOG_SRC = "ItemSystem";
@@ -0,0 +1,56 @@
+#include "jail_win32_mmap.h"
+#include "jail_windows_h.h"
+#undef NOKERNEL    // need the file and memory mapping APIs
+#undef NOMEMMGR
+#undef NOOPENFILE
+#include <Windows.h>
+
+bool MapFile(const char *filename, MappedFile &mappedFile)
+{
+    UnmapFile(mappedFile);
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mappedFile.data = (const unsigned char *)view;
+    mappedFile.size = (size_t)size.QuadPart;
+    mappedFile.file = file;
+    mappedFile.mapping = mapping;
+    return true;
+}
+
+void UnmapFile(MappedFile &mappedFile)
+{
+    if (mappedFile.data) {
+        UnmapViewOfFile(mappedFile.data);
+    }
+    if (mappedFile.mapping) {
+        CloseHandle(mappedFile.mapping);
+    }
+    if (mappedFile.file) {
+        CloseHandle(mappedFile.file);
+    }
+    mappedFile = {};
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+
+// Read-only view of a whole file, the OS pages it in as it's touched
+struct MappedFile {
+    const unsigned char *data    {};
+    size_t               size    {};
+    void                *file    {};  // HANDLE
+    void                *mapping {};  // HANDLE
+};
+
+bool MapFile(const char *filename, MappedFile &mappedFile);
+void UnmapFile(MappedFile &mappedFile);
@@ -160,9 +160,8 @@ void LootSystem::SV_RollDrops(LootTableID lootTableId, std::function<void(ItemSt
                             break;
                         }
                     }
-                    DLB_ASSERT(dropStack.uid);
                     DLB_ASSERT(dropStack.count);
-                    if (dropStack.uid && dropStack.count) {
+                    if (dropStack.uid && dropStack.count) {  // uid is 0 if the item database is full
                         callback(dropStack);
                     }
                 }
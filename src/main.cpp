@@ -1,6 +1,7 @@
 ﻿#define _CRTDBG_MAP_ALLOC
 
 #include "args.h"
+#include "asset_pack.h"
 #include "error.h"
 #include "game_client.h"
 #include "game_server.h"
@@ -88,7 +89,13 @@ int main(int argc, char *argv[])
     args.Parse(argc, argv);
     //args.standalone = true;
 
-    int enet_code = enet_initialize();
+    // Read data/ and db/ out of the asset pack when there is one (see tools/asset_packer.cpp), loose files otherwise
+    static AssetPack assetPack{};
+    if (assetPack.Open(ASSET_PACK_FILE) == ErrorType::Success) {
+        asset_pack_install(&assetPack);
+    }
+
+    int enet_code = net_enet_initialize();
     if (enet_code < 0) {
         TraceLog(LOG_ERROR, "Failed to initialize network utilities (enet). Error code: %d\n", enet_code);
     }
@@ -124,6 +131,7 @@ int main(int argc, char *argv[])
     delete gameServer;
     CloseWindow();
     enet_deinitialize();
+    asset_pack_uninstall();
 
 #if 0
     if (_CrtDumpMemoryLeaks()) {
@@ -148,6 +156,8 @@ int main(int argc, char *argv[])
 #undef DLB_RAND_IMPLEMENTATION
 
 #include "args.cpp"
+#include "asset_loader.cpp"
+#include "asset_pack.cpp"
 #include "bit_stream.cpp"
 #include "body.cpp"
 #include "catalog/csv.cpp"
@@ -157,31 +167,27 @@ int main(int argc, char *argv[])
 #include "catalog/spritesheets.cpp"
 #include "catalog/tracks.cpp"
 #include "chat.cpp"
+#include "chunk_generator.cpp"
+#include "chunk_mesh.cpp"
 #include "controller.cpp"
 #include "draw_command.cpp"
 #include "entities/npc.cpp"
 #include "entities/slime.cpp"
 #include "error.cpp"
-#include "fx/blood.cpp"
-#include "fx/gem.cpp"
-#include "fx/gold.cpp"
-#include "fx/golden_chest.cpp"
-#include "fx/goo.cpp"
-#include "fx/number.cpp"
-#include "fx/poison_nova.cpp"
-#include "fx/rainbow.cpp"
 #include "game_client.cpp"
 #include "game_server.cpp"
 #include "healthbar.cpp"
 #include "helpers.cpp"
 #include "item_system.cpp"
 #include "loot_table.cpp"
+#include "net_bundle.cpp"
 #include "net_client.cpp"
 #include "net_message.cpp"
 #include "net_server.cpp"
 #include "net_stat.cpp"
 #include "object.cpp"
 #include "OpenSimplex2F.c"
+#include "packet_pool.cpp"
 #include "particles.cpp"
 #include "perlin.cpp"
 #include "player.cpp"
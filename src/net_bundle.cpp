@@ -0,0 +1,150 @@
+#include "net_bundle.h"
+
+static void net_bundle_write_prefix(uint8_t *dst, size_t size)
+{
+    DLB_ASSERT(size <= UINT16_MAX);
+    dst[0] = (uint8_t)(size & 0xff);
+    dst[1] = (uint8_t)(size >> 8);
+}
+
+ErrorType NetBundle::Append(ENetPeer *peer, NetMessage &message)
+{
+    const NetDelivery delivery = message.Delivery();
+    size_t capacity = 0;
+    uint8_t *tail = Tail(delivery, &capacity);
+    size_t size = message.Serialize(tail, capacity);
+    if (!size) {
+        E_ERROR_RETURN(ErrorType::Overflow, "Failed to serialize %s message", message.TypeString());
+    }
+    return Commit(peer, delivery, size);
+}
+
+ErrorType NetBundle::Append(ENetPeer *peer, const uint8_t *data, size_t size, NetDelivery delivery)
+{
+    DLB_ASSERT(data);
+    DLB_ASSERT(size <= PACKET_SIZE_MAX);
+    size_t capacity = 0;
+    uint8_t *tail = Tail(delivery, &capacity);
+    memcpy(tail, data, size);
+    return Commit(peer, delivery, size);
+}
+
+ErrorType NetBundle::Flush(ENetPeer *peer)
+{
+    ErrorType err_code = ErrorType::Success;
+    for (int channel = 0; channel < NetChannel_Count; channel++) {
+        ErrorType result = Send(peer, (NetChannel)channel);
+        if (result != ErrorType::Success) {
+            err_code = result;
+        }
+    }
+    return err_code;
+}
+
+void NetBundle::Clear(void)
+{
+    for (int channel = 0; channel < NetChannel_Count; channel++) {
+        Pending &bundle = pending[channel];
+        if (bundle.buffer) {
+            pool->Free(bundle.buffer);
+        }
+        bundle = {};
+    }
+}
+
+uint8_t *NetBundle::Tail(NetDelivery delivery, size_t *capacity)
+{
+    DLB_ASSERT(pool);
+    DLB_ASSERT(delivery.channel < NetChannel_Count);
+
+    Pending &bundle = pending[delivery.channel];
+    // Every message on a channel must use the same delivery flags, or the bundle would be sent with the wrong ones
+    DLB_ASSERT(!bundle.length || bundle.flags == delivery.flags);
+    if (!bundle.buffer) {
+        bundle.buffer = pool->Alloc();
+    }
+
+    // Bundles never grow past NET_BUNDLE_SIZE_MAX, so there's always room for a max size message after them
+    DLB_ASSERT(bundle.length <= NET_BUNDLE_SIZE_MAX);
+    const size_t offset = bundle.length + NET_BUNDLE_PREFIX;
+    *capacity = sizeof(bundle.buffer->data) - offset;
+    DLB_ASSERT(*capacity > PACKET_SIZE_MAX);
+    return bundle.buffer->data + offset;
+}
+
+ErrorType NetBundle::Commit(ENetPeer *peer, NetDelivery delivery, size_t size)
+{
+    DLB_ASSERT(peer);
+    DLB_ASSERT(size);
+    DLB_ASSERT(size <= PACKET_SIZE_MAX);
+
+    Pending &bundle = pending[delivery.channel];
+    DLB_ASSERT(bundle.buffer);
+
+    if (bundle.length && bundle.length + NET_BUNDLE_PREFIX + size > NET_BUNDLE_SIZE_MAX) {
+        // Doesn't fit. Move the message to the front of a fresh buffer and send the full bundle without it. This is
+        // the only copy, and only happens once per full bundle.
+        PacketPool::Buffer *next = pool->Alloc();
+        memcpy(next->data + NET_BUNDLE_PREFIX, bundle.buffer->data + bundle.length + NET_BUNDLE_PREFIX, size);
+        ErrorType err_code = Send(peer, delivery.channel);
+        bundle.buffer = next;
+        E_ERROR_RETURN(err_code, "Failed to send full bundle", 0);
+    }
+
+    net_bundle_write_prefix(bundle.buffer->data + bundle.length, size);
+    bundle.length += NET_BUNDLE_PREFIX + size;
+    bundle.flags = delivery.flags;
+
+    if (bundle.length > NET_BUNDLE_SIZE_MAX) {
+        // Oversized message on its own, send it now so it doesn't get reordered with anything after it
+        DLB_ASSERT(bundle.length == NET_BUNDLE_PREFIX + size);
+        E_ERROR_RETURN(Send(peer, delivery.channel), "Failed to send oversized message", 0);
+    }
+    return ErrorType::Success;
+}
+
+ErrorType NetBundle::Send(ENetPeer *peer, NetChannel channel)
+{
+    Pending &bundle = pending[channel];
+    if (!bundle.length) {
+        return ErrorType::Success;
+    }
+
+    ENetPacket *packet = pool->CreatePacket(bundle.buffer, bundle.length, bundle.flags);
+    bundle = {};
+    if (!packet) {
+        E_ERROR_RETURN(ErrorType::PacketCreateFailed, "Failed to create packet.", 0);
+    }
+    if (enet_peer_send(peer, channel, packet) < 0) {
+        enet_packet_destroy(packet);
+        E_ERROR_RETURN(ErrorType::PeerSendFailed, "Failed to send bundle.", 0);
+    }
+    return ErrorType::Success;
+}
+
+bool NetBundleReader::Next(const uint8_t **msg, size_t *msgLength)
+{
+    DLB_ASSERT(msg);
+    DLB_ASSERT(msgLength);
+
+    if (offset == length) {
+        return false;
+    }
+    if (length - offset < NET_BUNDLE_PREFIX) {
+        E_WARN("Truncated bundle, discarding %zu trailing bytes", length - offset);
+        offset = length;
+        return false;
+    }
+
+    const size_t size = (size_t)data[offset] | ((size_t)data[offset + 1] << 8);
+    if (!size || size > length - offset - NET_BUNDLE_PREFIX) {
+        E_WARN("Malformed bundle, message length %zu exceeds remaining %zu bytes", size, length - offset - NET_BUNDLE_PREFIX);
+        offset = length;
+        return false;
+    }
+
+    *msg = data + offset + NET_BUNDLE_PREFIX;
+    *msgLength = size;
+    offset += NET_BUNDLE_PREFIX + size;
+    return true;
+}
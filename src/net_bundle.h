@@ -0,0 +1,55 @@
+#pragma once
+#include "error.h"
+#include "helpers.h"
+#include "net_message.h"
+#include "packet_pool.h"
+#include "enet_zpl.h"
+
+// Outgoing messages for one peer. Serialized messages are concatenated per channel, each prefixed with its
+// uint16 length, and sent as a single ENet packet when the bundle is full or flushed (once per tick). Bundles live
+// in buffers from a PacketPool, so messages are serialized in place and handed to ENet without copying.
+struct NetBundle {
+    PacketPool *pool {};
+
+    NetBundle(PacketPool *pool = 0) : pool(pool) {}
+    ~NetBundle(void) { Clear(); }
+
+    // Serialize message directly into the bundle for its channel. Sends the channel's pending bundle first if the
+    // message doesn't fit. Messages bigger than NET_BUNDLE_SIZE_MAX are sent on their own (in order) and ENet
+    // fragments them.
+    ErrorType Append (ENetPeer *peer, NetMessage &message);
+    // Same as above, for data that's already been serialized
+    ErrorType Append (ENetPeer *peer, const uint8_t *data, size_t size, NetDelivery delivery);
+    ErrorType Flush  (ENetPeer *peer);
+    // Discard pending messages without sending them (e.g. on disconnect)
+    void      Clear  (void);
+
+private:
+    const char *LOG_SRC = "NetBundle";
+
+    struct Pending {
+        PacketPool::Buffer *buffer {};
+        size_t              length {};
+        uint32_t            flags  {};
+    } pending[NetChannel_Count]{};
+
+    // Where the next message on this channel should be written, and how many bytes it has to work with
+    uint8_t  *Tail   (NetDelivery delivery, size_t *capacity);
+    // Add the message written at Tail() to the bundle
+    ErrorType Commit (ENetPeer *peer, NetDelivery delivery, size_t size);
+    ErrorType Send   (ENetPeer *peer, NetChannel channel);
+};
+
+// Iterates the messages in a received bundle
+struct NetBundleReader {
+    NetBundleReader(const uint8_t *data, size_t length) : data(data), length(length) {}
+
+    // Returns false when there are no more messages, or the rest of the bundle is malformed
+    bool Next(const uint8_t **msg, size_t *msgLength);
+
+private:
+    const char *LOG_SRC = "NetBundle";
+    const uint8_t *data   {};
+    size_t         length {};
+    size_t         offset {};
+};
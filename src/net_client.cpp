@@ -12,7 +12,6 @@
 #include <ctime>
 #include <memory>
 
-uint8_t NetClient::rawPacket[PACKET_SIZE_MAX];
 
 ErrorType NetClient::SaveDefaultServerDB(const char *filename)
 {
@@ -33,16 +32,12 @@ ErrorType NetClient::Load(void)
         E_ERROR_RETURN(SaveDefaultServerDB("db/servers.dat"), "Failed to save default server DB", 0);
     };
 
-    //rawPacket.dataLength = PACKET_SIZE_MAX;
-    //rawPacket.data = calloc(rawPacket.dataLength, sizeof(uint8_t));
-
     return ErrorType::Success;
 }
 
 NetClient::~NetClient(void)
 {
     CloseSocket();
-    //free(rawPacket.data);
 }
 
 ErrorType NetClient::OpenSocket(void)
@@ -51,7 +46,7 @@ ErrorType NetClient::OpenSocket(void)
     while (!connectionToken) {
         connectionToken = dlb_rand32u();
     }
-    client = enet_host_create(nullptr, 1, 1, 0, 0);
+    client = enet_host_create(nullptr, 1, NetChannel_Count, 0, 0);
     if (!client) {
         E_ERROR_RETURN(ErrorType::HostCreateFailed, "Failed to create host.", 0);
     }
@@ -77,7 +72,7 @@ ErrorType NetClient::Connect(const char *serverHost, unsigned short serverPort,
 
     enet_address_set_host(&address, serverHost);
     address.port = serverPort;
-    server = enet_host_connect(client, &address, 1, 0);
+    server = enet_host_connect(client, &address, NetChannel_Count, 0);
     assert(server);
 
 #if _DEBUG && CL_DEBUG_REALLY_LONG_TIMEOUT
@@ -100,7 +95,7 @@ ErrorType NetClient::Connect(const char *serverHost, unsigned short serverPort,
 }
 #pragma warning(pop)
 
-ErrorType NetClient::SendRaw(const uint8_t *buf, size_t len)
+ErrorType NetClient::SendRaw(const uint8_t *buf, size_t len, NetDelivery delivery)
 {
     assert(buf);
     assert(len);
@@ -111,15 +106,16 @@ ErrorType NetClient::SendRaw(const uint8_t *buf, size_t len)
         return ErrorType::NotConnected;
     }
 
-    // TODO(dlb): Don't always use reliable flag.. figure out what actually needs to be reliable (e.g. chat)
-    ENetPacket *packet = enet_packet_create(buf, len, ENET_PACKET_FLAG_RELIABLE);
-    if (!packet) {
-        E_ERROR_RETURN(ErrorType::PacketCreateFailed, "Failed to create packet.", 0);
-    }
-    if (enet_peer_send(server, 0, packet) < 0) {
-        E_ERROR_RETURN(ErrorType::PeerSendFailed, "Failed to send connection request.", 0);
+    return bundle.Append(server, buf, len, delivery);
+}
+
+void NetClient::Flush(void)
+{
+    if (!server || server->state != ENET_PEER_STATE_CONNECTED) {
+        bundle.Clear();
+        return;
     }
-    return ErrorType::Success;
+    E_ERROR(bundle.Flush(server), "Failed to flush bundle", 0);
 }
 
 ErrorType NetClient::SendMsg(NetMessage &message)
@@ -130,10 +126,8 @@ ErrorType NetClient::SendMsg(NetMessage &message)
     }
 
     message.connectionToken = connectionToken;
-    memset(rawPacket, 0, sizeof(rawPacket));
-    size_t bytes = message.Serialize(CSTR0(rawPacket));
-    //E_INFO("[SEND][%21s][%5u b] %16s ", rawPacket.dataLength, netMsg.TypeString());
-    E_ERROR_RETURN(SendRaw(rawPacket, bytes), "Failed to send packet", 0);
+    //E_INFO("[SEND] %16s ", netMsg.TypeString());
+    E_ERROR_RETURN(bundle.Append(server, message), "Failed to send packet", 0);
     return ErrorType::Success;
 }
 
@@ -230,6 +224,16 @@ ErrorType NetClient::SendTileInteract(float worldX, float worldY)
     return result;
 }
 
+ErrorType NetClient::SendChunkRequest(int16_t chunkX, int16_t chunkY)
+{
+    memset(&tempMsg, 0, sizeof(tempMsg));
+    tempMsg.type = NetMessage::Type::ChunkRequest;
+    tempMsg.data.chunkRequest.chunkX = chunkX;
+    tempMsg.data.chunkRequest.chunkY = chunkY;
+    ErrorType result = SendMsg(tempMsg);
+    return result;
+}
+
 ErrorType NetClient::SendPlayerInput(void)
 {
     if (!worldHistory.Count() || !inputHistory.Count()) {
@@ -241,18 +245,27 @@ ErrorType NetClient::SendPlayerInput(void)
     memset(&tempMsg, 0, sizeof(tempMsg));
     tempMsg.type = NetMessage::Type::Input;
 
+    // Resend the newest unacked samples, up to CL_INPUT_SAMPLES_MAX. They must be a consecutive run from the same
+    // player, since the message only encodes the first seq and ownerId. If the server falls further behind than
+    // that, it will discard the missing samples and we'll reconcile.
+    const InputSample &newest = inputHistory.Last();
+    size_t first = inputHistory.Count() - 1;
+    while (first > 0 && inputHistory.Count() - first < CL_INPUT_SAMPLES_MAX) {
+        const InputSample &prev = inputHistory.At(first - 1);
+        if (prev.seq <= worldSnapshot.lastInputAck || prev.seq + 1 != inputHistory.At(first).seq || prev.ownerId != newest.ownerId) {
+            break;
+        }
+        first--;
+    }
+
     uint32_t sampleCount = 0;
-    for (size_t i = 0; i < inputHistory.Count() && sampleCount < CL_INPUT_SAMPLES_MAX; i++) {
-        const InputSample &inputSample = inputHistory.At(i);
-        if (inputSample.seq > worldSnapshot.lastInputAck) {
-            //if (sampleCount == 0) { printf("Sending input seq:"); }
-            //printf(" %u", inputSample.seq);
-            tempMsg.data.input.samples[sampleCount++] = inputSample;
+    if (newest.seq > worldSnapshot.lastInputAck) {
+        for (size_t i = first; i < inputHistory.Count(); i++) {
+            tempMsg.data.input.samples[sampleCount++] = inputHistory.At(i);
         }
     }
-    //putchar('\n');
-    //fflush(stdout);
     tempMsg.data.input.sampleCount = sampleCount;
+    tempMsg.data.input.lastSnapshotTick = worldSnapshot.tick;
     lastInputSentAt = g_clock.now;
     return SendMsg(tempMsg);
 }
@@ -280,55 +293,82 @@ void NetClient::ReconcilePlayer(void)
     }
 
     const WorldSnapshot &latestSnapshot = worldHistory.Last();
-    const PlayerSnapshot *playerSnapshot = 0;
-    for (size_t i = 0; i < latestSnapshot.playerCount; i++) {
-        if (latestSnapshot.players[i].id == serverWorld->playerId) {
-            playerSnapshot = &latestSnapshot.players[i];
-            break;
-        }
-    }
-    assert(playerSnapshot);
-    if (!playerSnapshot) {
+    assert(latestSnapshot.ownerFlags);
+    if (!latestSnapshot.ownerFlags) {
         // Server sent us a snapshot that doesn't contain our own player??
         E_WARN("Can't reconcile player; no snapshot", 0);
         return;
     }
 
     const Vector3 localPos = player->body.WorldPosition();
-    //const Vector3 serverPos = playerSnapshot->position;
-    // Client presumably hasn't moved; skip reconciliation
-    //if (v3_distance_sq(localPos, serverPos) < SQUARED(CL_MAX_PLAYER_POS_DESYNC_DIST)) {
-    //    return;
-    //}
 
-    // Roll back local player to server snapshot location
-    if (playerSnapshot->flags & PlayerSnapshot::Flags_Position) {
-        player->body.Teleport(playerSnapshot->position);
+    if (!g_cl_client_prediction) {
+        // Show the player wherever the server last saw them
+        if (latestSnapshot.ownerFlags & PlayerSnapshot::Flags_Position) {
+            player->body.Teleport(latestSnapshot.ownerPosition);
+        }
+        // Predictions made before prediction was turned off don't include any of the inputs sent since
+        lastPredictedSeq = 0;
+    } else {
+        // Pick up where the previous frame's prediction left off, unless the server disagrees with it. Each snapshot
+        // stays the latest one for a few frames, only check it the first time.
+        const uint32_t prevPredictedSeq = lastPredictedSeq;
+        const CL_PredictedState *prevPrediction = FindPredictedState(prevPredictedSeq);
+        bool replay = false;
+        if (latestSnapshot.ownerFlags & PlayerSnapshot::Flags_Position) {
+            if (latestSnapshot.tick != reconcileTick) {
+                reconcileTick = latestSnapshot.tick;
+                reconcileStats.snapshots++;
+                const CL_PredictedState *ackedPrediction = FindPredictedState(latestSnapshot.lastInputAck);
+                replay = !ackedPrediction || v3_distance_sq(ackedPrediction->position, latestSnapshot.ownerPosition) >
+                    SQUARED(CL_MAX_PLAYER_POS_DESYNC_DIST);
+            }
+            replay |= !prevPrediction;
+        } else if (!prevPrediction) {
+            // Nothing to predict from yet
+            return;
+        }
 
-        if (inputHistory.Count()) {
-            const InputSample &oldestInput = inputHistory.At(0);
-            if (latestSnapshot.lastInputAck + 1 < oldestInput.seq) {
-                E_WARN("inputHistory buffer too small. Server ack'd seq #%u on tick %u, but oldest input we still have is seq #%u",
-                    latestSnapshot.lastInputAck, latestSnapshot.tick, oldestInput.seq);
+        if (replay) {
+            // Roll back local player to server snapshot location, then replay every input the server hasn't handled
+            reconcileStats.replays++;
+            player->body.Teleport(latestSnapshot.ownerPosition);
+            SavePredictedState(latestSnapshot.lastInputAck, latestSnapshot.ownerPosition);
+            lastPredictedSeq = latestSnapshot.lastInputAck;
+
+            if (inputHistory.Count()) {
+                const InputSample &oldestInput = inputHistory.At(0);
+                if (latestSnapshot.lastInputAck + 1 < oldestInput.seq) {
+                    E_WARN("inputHistory buffer too small. Server ack'd seq #%u on tick %u, but oldest input we still have is seq #%u",
+                        latestSnapshot.lastInputAck, latestSnapshot.tick, oldestInput.seq);
+                }
             }
+        } else {
+            // Undo last frame's smoothing
+            player->body.Teleport(prevPrediction->position);
         }
 
-        if (g_cl_client_prediction) {
-            // Predict player for each input not yet handled by the server
-            for (size_t i = 0; i < inputHistory.Count(); i++) {
-                InputSample &input = inputHistory.At(i);
-                // NOTE: Old input's ownerId might not match if the player recently reconnected to a
-                // server and received a new playerId. Intentionally ignore those.
-                if (input.ownerId == player->id && input.seq > latestSnapshot.lastInputAck) {
-    #if CL_DEBUG_PLAYER_RECONCILIATION
-                    if (input.walkEast) putchar('>');
-                    else if (input.walkWest) putchar('<');
-                    else if (input.walkNorth) putchar('^');
-                    else if (input.walkSouth) putchar('v');
-                    else putchar('.');
-    #endif
-                    //E_DEBUG("CLI SQ: %u OS: %f S: %f", input.seq, origInput.dt, input.dt);
-                    player->Update(input, serverWorld->map);
+        // Predict player for each input not yet applied
+        for (size_t i = 0; i < inputHistory.Count(); i++) {
+            InputSample &input = inputHistory.At(i);
+            // NOTE: Old input's ownerId might not match if the player recently reconnected to a
+            // server and received a new playerId. Intentionally ignore those.
+            if (input.ownerId == player->id && input.seq > lastPredictedSeq) {
+#if CL_DEBUG_PLAYER_RECONCILIATION
+                if (input.walkEast) putchar('>');
+                else if (input.walkWest) putchar('<');
+                else if (input.walkNorth) putchar('^');
+                else if (input.walkSouth) putchar('v');
+                else putchar('.');
+#endif
+                //E_DEBUG("CLI SQ: %u OS: %f S: %f", input.seq, origInput.dt, input.dt);
+                player->Update(input, serverWorld->map);
+                SavePredictedState(input.seq, player->body.WorldPosition());
+                lastPredictedSeq = input.seq;
+                if (input.seq <= prevPredictedSeq) {
+                    reconcileStats.samplesReplayed++;
+                } else {
+                    reconcileStats.samplesPredicted++;
                 }
             }
         }
@@ -346,10 +386,496 @@ void NetClient::ReconcilePlayer(void)
     }
 }
 
+const CL_PredictedState *NetClient::FindPredictedState(uint32_t seq) const
+{
+    if (!seq) {
+        return 0;
+    }
+    const CL_PredictedState &state = predictedStates[seq % CL_INPUT_HISTORY];
+    return state.seq == seq ? &state : 0;
+}
+
+void NetClient::SavePredictedState(uint32_t seq, Vector3 position)
+{
+    if (!seq) {
+        return;
+    }
+    CL_PredictedState &state = predictedStates[seq % CL_INPUT_HISTORY];
+    state.seq = seq;
+    state.position = position;
+}
+
+void NetClient::ProcessGenChunks(void)
+{
+    if (!serverWorld || !chunkGenerator.Poll(chunkGenResults)) {
+        return;
+    }
+
+    Tilemap &map = serverWorld->map;
+    for (const ChunkGenerator::Result &result : chunkGenResults) {
+        const Chunk &chunk = result.chunk;
+        if (!result.valid) {
+            E_WARN("Generated chunk [%hd, %hd] doesn't match server, requesting full chunk", chunk.x, chunk.y);
+            SendChunkRequest(chunk.x, chunk.y);
+            continue;
+        }
+        // Full chunk may have arrived while this one was in the generator queue
+        const Chunk *existing = map.FindChunk(chunk.Hash());
+        if (existing && existing->version >= chunk.version) {
+            continue;
+        }
+        map.AddChunk(chunk);
+        serverWorld->chunkMeshes.Invalidate(chunk.Hash());
+    }
+
+    // TODO(perf): Only update if chunk is within visible region?
+    Player *player = serverWorld->FindPlayer(serverWorld->playerId);
+    if (player) {
+        map.GenerateMinimap(player->body.GroundPosition());
+    }
+}
+
+InterpolationCursor NetClient::FindInterpolationCursor(double renderAt) const
+{
+    InterpolationCursor cursor{};
+    cursor.renderAt = renderAt;
+    // renderAt trails the newest snapshot by a few snapshots, so searching back from the newest one is quick
+    for (size_t i = worldHistory.Count(); i > 0; i--) {
+        const WorldSnapshot &worldSnapshot = worldHistory.At(i - 1);
+        if (worldSnapshot.clock <= renderAt) {
+            cursor.tick = worldSnapshot.tick;
+            cursor.valid = true;
+            break;
+        }
+    }
+    return cursor;
+}
+
+void NetClient::OnHeader(const WorldSnapshot &header)
+{
+    snapshotHeader = header;
+    snapshotPlayers.clear();
+    snapshotNpcs.clear();
+    snapshotItems.clear();
+}
+
+void NetClient::OnPlayer(const PlayerSnapshot &playerSnapshot)
+{
+    snapshotPlayers.push_back(playerSnapshot);
+}
+
+void NetClient::OnNpc(const NpcSnapshot &npcSnapshot)
+{
+    snapshotNpcs.push_back(npcSnapshot);
+}
+
+void NetClient::OnItem(const ItemSnapshot &itemSnapshot)
+{
+    snapshotItems.push_back(itemSnapshot);
+}
+
+void NetClient::ApplySnapshot(void)
+{
+    ApplySnapshotHeader(snapshotHeader);
+    for (const PlayerSnapshot &playerSnapshot : snapshotPlayers) {
+        ApplySnapshotPlayer(playerSnapshot);
+    }
+    for (const NpcSnapshot &npcSnapshot : snapshotNpcs) {
+        ApplySnapshotNpc(npcSnapshot);
+    }
+    for (const ItemSnapshot &itemSnapshot : snapshotItems) {
+        ApplySnapshotItem(itemSnapshot);
+    }
+}
+
+// Item db entry a snapshot record came with, for an item that's about to be held by something on the client
+static void ApplySnapshotItemDb(ItemUID uid, ItemType type, const uint64_t *seed)
+{
+    Item &item = g_item_db.FindOrCreate(uid);
+    item.type = type;
+    if (seed) {
+        item.seed = *seed;
+        if (item.seed) {
+            item.Roll();
+        }
+    }
+}
+
+void NetClient::ApplySnapshotHeader(const WorldSnapshot &header)
+{
+    WorldSnapshot &worldSnapshot = worldHistory.Alloc();
+    worldSnapshot = header;
+    //worldSnapshot.recvAt = g_clock.now;
+    //worldSnapshot.rtt = rtt;
+
+    const double rtt = server->roundTripTime / 1000.0;
+    const double serverNow = worldSnapshot.clock + (rtt / 2.0);
+    const double clockDrift = g_clock.now - serverNow;
+    if (abs(clockDrift) > 1.0) {
+        // TODO: Smoothly move clock closer to server time?
+        E_WARN("Detected clock drift %f, skipping from %.2f to %.2f", clockDrift, g_clock.now, serverNow);
+        g_clock.now = serverNow;
+    }
+}
+
+void NetClient::ApplySnapshotPlayer(const PlayerSnapshot &playerSnapshot)
+{
+    WorldSnapshot &worldSnapshot = worldHistory.Last();
+    worldSnapshot.playerCount++;
+    if (playerSnapshot.id == serverWorld->playerId) {
+        worldSnapshot.ownerFlags = playerSnapshot.flags;
+        worldSnapshot.ownerPosition = playerSnapshot.position;
+    }
+
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_Despawn) {
+        serverWorld->RemovePlayer(playerSnapshot.id);
+        return;
+    }
+
+    bool spawned = false;
+    Player *player = serverWorld->FindPlayer(playerSnapshot.id);
+    if (!player) {
+        player = serverWorld->AddPlayer(playerSnapshot.id);
+        if (!player) {
+            return;
+        }
+        spawned = true;
+    }
+
+    if (playerSnapshot.flags != PlayerSnapshot::Flags_None) {
+        //E_DEBUG("Snapshot: player #%u", playerSnapshot.type);
+    }
+
+    const bool posChanged = playerSnapshot.flags & PlayerSnapshot::Flags_Position;
+    const bool dirChanged = playerSnapshot.flags & PlayerSnapshot::Flags_Direction;
+
+    if (posChanged || dirChanged) {
+        const bool hasPrevState = !player->body.positionHistory.Empty();
+
+        // Starts out as a copy of the previous state
+        Vector3Snapshot &state = player->body.positionHistory.Push(worldSnapshot.tick);
+        state.serverTime = worldSnapshot.clock;
+
+        if (posChanged) {
+            //E_DEBUG("Snapshot: pos %f %f %f",
+                //playerSnapshot.position.x,
+                //playerSnapshot.position.y,
+                //playerSnapshot.position.z);
+            state.v = playerSnapshot.position;
+        } else if (!hasPrevState) {
+            E_WARN("Received direction update but previous position is not known. playerId: %u", playerSnapshot.id);
+            state.v = player->body.WorldPosition();
+        }
+
+        if (dirChanged) {
+            state.direction = playerSnapshot.direction;
+            //E_DEBUG("Snapshot: dir %d", (char)state.direction);
+        } else if (!hasPrevState) {
+            E_WARN("Received position update but previous position is not available.", 0);
+            state.direction = player->sprite.direction;
+        }
+    }
+
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_Speed) {
+        player->body.speed = playerSnapshot.speed;
+    }
+    // TODO: Pos/dir are history based, but these are instantaneous.. hmm.. is that okay?
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_Health) {
+        //E_DEBUG("Snapshot: health %f", playerSnapshot.hitPoints);
+        const bool respawn = player->combat.diedAt && playerSnapshot.hitPoints;
+        float hpDelta = player->combat.hitPoints - playerSnapshot.hitPoints;
+        if (hpDelta > 0) {
+            player->combat.TakeDamage(hpDelta);
+            if (player->combat.diedAt) {
+                // Died
+                player->combat.diedAt = worldSnapshot.clock;
+                ParticleEffectParams bloodParams{};
+                bloodParams.particleCountMin = 128;
+                bloodParams.particleCountMax = bloodParams.particleCountMin;
+                bloodParams.durationMin = 4.0f;
+                bloodParams.durationMax = bloodParams.durationMin;
+                serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Blood, player->WorldCenter(), bloodParams);
+                Catalog::g_sounds.Play(Catalog::SoundID::Eughh, 1.0f + dlb_rand32f_variance(0.1f));
+            } else {
+                // Took damage
+                Vector3 playerGut = player->GetAttachPoint(Player::AttachPoint::Gut);
+                ParticleEffectParams bloodParams{};
+                bloodParams.particleCountMin = 32;
+                bloodParams.particleCountMax = bloodParams.particleCountMin;
+                bloodParams.durationMin = 1.0f;
+                bloodParams.durationMax = bloodParams.durationMin;
+                ParticleEffect *bloodParticles = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Blood, playerGut, bloodParams);
+                if (bloodParticles) {
+                    bloodParticles->effectCallbacks[(size_t)ParticleEffect_Event::BeforeUpdate] = {
+                        ParticlesFollowPlayerGut,
+                        player
+                    };
+                }
+            }
+        } else if (player->combat.diedAt && playerSnapshot.hitPoints) {
+            // Respawn
+            player->combat.hitPoints = playerSnapshot.hitPoints;
+            player->combat.diedAt = 0;
+        }
+    }
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_HealthMax) {
+        //E_DEBUG("Snapshot: healthMax %f", playerSnapshot.hitPointsMax);
+        player->combat.hitPointsMax = playerSnapshot.hitPointsMax;
+    }
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_Level) {
+        //E_DEBUG("Snapshot: level %u", enemySnapshot.level);
+        if (!spawned) {
+            if (playerSnapshot.level && playerSnapshot.level > player->combat.level) {
+                ParticleEffectParams rainbowParams{};
+                rainbowParams.durationMin = 3.0f;
+                rainbowParams.durationMax = rainbowParams.durationMin;
+                rainbowParams.particleCountMin = 256;
+                rainbowParams.particleCountMax = rainbowParams.particleCountMin;
+                ParticleEffect *rainbowFx = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Rainbow, player->body.WorldPosition(), rainbowParams);
+                if (rainbowFx) {
+                    Catalog::g_sounds.Play(Catalog::SoundID::RainbowSparkles, 1.0f);
+                }
+            }
+        }
+        player->combat.level = playerSnapshot.level;
+    }
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_XP) {
+        player->xp = playerSnapshot.xp;
+    }
+    if (playerSnapshot.flags & PlayerSnapshot::Flags_Inventory) {
+        for (size_t slot = 0; slot < ARRAY_SIZE(playerSnapshot.inventory.slots); slot++) {
+            const ItemStack &invStack = playerSnapshot.inventory.slots[slot].stack;
+            if (invStack.count) {
+                const ItemDbSnapshot &invItem = playerSnapshot.inventoryDb[slot];
+                ApplySnapshotItemDb(invStack.uid, invItem.type, &invItem.seed);
+            }
+        }
+        player->inventory.ReleaseItems();
+        player->inventory = playerSnapshot.inventory;
+        player->inventory.RetainItems();
+        //player->inventory.selectedSlot = playerSnapshot.inventory.selectedSlot;
+        //for (size_t i = 0; i < ARRAY_SIZE(playerSnapshot.inventory.slots); i++) {
+        //    player->inventory.slots[i] = playerSnapshot.inventory.slots[i];
+        //}
+    }
+}
+
+void NetClient::ApplySnapshotNpc(const NpcSnapshot &npcSnapshot)
+{
+    WorldSnapshot &worldSnapshot = worldHistory.Last();
+    worldSnapshot.npcCount++;
+
+    if (npcSnapshot.flags & NpcSnapshot::Flags_Despawn) {
+        serverWorld->RemoveNpc(npcSnapshot.id);
+        return;
+    }
+
+    bool spawned = false;
+    NPC *npc = serverWorld->FindNpc(npcSnapshot.id);
+    if (!npc) {
+        DLB_ASSERT(npcSnapshot.id);
+        DLB_ASSERT(npcSnapshot.type);
+        E_ERROR(serverWorld->SpawnNpc(npcSnapshot.id, npcSnapshot.type, npcSnapshot.position, &npc), "Failed to spawn replicated npc", 0);
+        if (!npc) {
+            return;
+        }
+        spawned = true;
+    }
+
+    if (npcSnapshot.flags & NpcSnapshot::Flags_Name && npcSnapshot.nameLength) {
+        npc->nameLength = MIN(npcSnapshot.nameLength, ENTITY_NAME_LENGTH_MAX);
+        strncpy(npc->name, npcSnapshot.name, npc->nameLength);
+    }
+
+    const bool posChanged = npcSnapshot.flags & NpcSnapshot::Flags_Position;
+    const bool dirChanged = npcSnapshot.flags & NpcSnapshot::Flags_Direction;
+
+    if (posChanged || dirChanged) {
+        const bool hasPrevState = !npc->body.positionHistory.Empty();
+
+        // Starts out as a copy of the previous state
+        Vector3Snapshot &state = npc->body.positionHistory.Push(worldSnapshot.tick);
+        state.serverTime = worldSnapshot.clock;
+
+        if (posChanged) {
+            //E_DEBUG("Snapshot: pos %f %f %f",
+            //    enemySnapshot.position.x,
+            //    enemySnapshot.position.y,
+            //    enemySnapshot.position.z);
+            state.v = npcSnapshot.position;
+        } else if (!hasPrevState) {
+            E_WARN("Received direction update but prevPosition is not known.", 0);
+            state.v = npc->body.WorldPosition();
+        }
+
+        if (dirChanged) {
+            state.direction = npcSnapshot.direction;
+            //E_DEBUG("Snapshot: dir %d", (char)state.direction);
+        } else if (!hasPrevState) {
+            E_WARN("Received position update but previous direction is not available.", 0);
+            state.direction = npc->sprite.direction;
+        }
+    }
+
+    // TODO: Pos/dir are history based, but these are instantaneous.. hmm.. is that okay?
+    if (npcSnapshot.flags & NpcSnapshot::Flags_Scale) {
+        //E_DEBUG("Snapshot: scale %f", (char)enemySnapshot.direction);
+        npc->sprite.scale = npcSnapshot.scale;
+    }
+    if (npcSnapshot.flags & NpcSnapshot::Flags_Health) {
+        //E_DEBUG("Snapshot: health %f", enemySnapshot.hitPoints);
+        float hpDelta = npc->combat.hitPoints - npcSnapshot.hitPoints;
+        if (hpDelta > 0) {
+            npc->combat.TakeDamage(hpDelta);
+            if (npc->combat.diedAt) {
+                // Died
+                ParticleEffectParams gooParams{};
+                gooParams.particleCountMin = 50 * (int)ceilf(CL_NPC_CORPSE_LIFETIME);
+                gooParams.particleCountMax = gooParams.particleCountMin;
+                gooParams.durationMin = CL_NPC_CORPSE_LIFETIME;
+                gooParams.durationMax = gooParams.durationMin;
+                serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Goo, npc->WorldCenter(), gooParams);
+                Catalog::g_sounds.Play(Catalog::SoundID::Squish2, 0.5f + dlb_rand32f_variance(0.1f), true);
+            } else {
+                // Took damage
+                ParticleEffectParams gooParams{};
+                gooParams.particleCountMin = 5;
+                gooParams.particleCountMax = gooParams.particleCountMin;
+                gooParams.durationMin = 0.5f;
+                gooParams.durationMax = gooParams.durationMin;
+                serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Goo, npc->WorldCenter(), gooParams);
+
+                ParticleEffectParams dmgParams{};
+                dmgParams.particleCountMin = (int)MAX(1, floorf(log10f(hpDelta)));
+                dmgParams.particleCountMax = dmgParams.particleCountMin;
+                dmgParams.durationMin = 3.0f;
+                dmgParams.durationMax = dmgParams.durationMin;
+                ParticleEffect *dmgFx = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Number, npc->WorldCenter(), dmgParams);
+                if (dmgFx) {
+                    char *text = (char *)calloc(1, 8);
+                    snprintf(text, 16, "%.f", hpDelta);
+                    dmgFx->particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Draw] = {
+                        ParticleDrawText,
+                        text
+                    };
+                    dmgFx->effectCallbacks[(size_t)ParticleEffect_Event::Dying] = {
+                        ParticleFreeText,
+                        text
+                    };
+                }
+
+                Catalog::g_sounds.Play(Catalog::SoundID::Slime_Stab1, 1.0f + dlb_rand32f_variance(0.4f));
+            }
+        } else if (npc->combat.diedAt && npcSnapshot.hitPoints) {
+            // Respawn
+            npc->combat.hitPoints = npcSnapshot.hitPoints;
+            npc->combat.diedAt = 0;
+        }
+    }
+    if (npcSnapshot.flags & NpcSnapshot::Flags_HealthMax) {
+        //E_DEBUG("Snapshot: healthMax %f", enemySnapshot.hitPointsMax);
+        npc->combat.hitPointsMax = npcSnapshot.hitPointsMax;
+    }
+    if (npcSnapshot.flags & NpcSnapshot::Flags_Level) {
+        //E_DEBUG("Snapshot: level %u", enemySnapshot.level);
+        npc->combat.level = npcSnapshot.level;
+    }
+}
+
+void NetClient::ApplySnapshotItem(const ItemSnapshot &itemSnapshot)
+{
+    WorldSnapshot &worldSnapshot = worldHistory.Last();
+    worldSnapshot.itemCount++;
+
+    if (itemSnapshot.flags & ItemSnapshot::Flags_Despawn) {
+        serverWorld->itemSystem.Remove(itemSnapshot.id);
+        return;
+    }
+
+    if (itemSnapshot.flags & ItemSnapshot::Flags_ItemUid) {
+        ApplySnapshotItemDb(itemSnapshot.itemUid, itemSnapshot.itemType, 0);
+    }
+
+    bool spawned = false;
+    WorldItem *item = serverWorld->itemSystem.Find(itemSnapshot.id);
+    if (!item) {
+#if CL_DEBUG_WORLD_ITEMS
+        E_DEBUG("Trying to spawn item: uid %u, count %u, id %u",
+            itemSnapshot.itemUid,
+            itemSnapshot.stackCount,
+            itemSnapshot.id
+        );
+#endif
+        item = serverWorld->itemSystem.SpawnItem(
+            itemSnapshot.position,
+            itemSnapshot.itemUid,
+            itemSnapshot.stackCount,
+            itemSnapshot.id
+        );
+        if (!item) {
+            return;
+        }
+        spawned = true;
+    }
+
+    const bool posChanged = itemSnapshot.flags & ItemSnapshot::Flags_Position;
+    if (posChanged) {
+        const bool hasPrevState = !item->body.positionHistory.Empty();
+
+        // Starts out as a copy of the previous state
+        Vector3Snapshot &state = item->body.positionHistory.Push(worldSnapshot.tick);
+        state.serverTime = worldSnapshot.clock;
+
+        if (posChanged) {
+            //E_DEBUG("Snapshot: pos %f %f %f",
+            //    itemSnapshot.position.x,
+            //    itemSnapshot.position.y,
+            //    itemSnapshot.position.z);
+            state.v = itemSnapshot.position;
+        } else if (!hasPrevState) {
+            E_WARN("Received direction update but prevPosition is not known.", 0);
+            state.v = item->body.WorldPosition();
+        }
+    }
+
+    //if (itemSnapshot.flags & ItemSnapshot::Flags_Position) {
+    //    item->body.Teleport(itemSnapshot.position);
+    //}
+    if (itemSnapshot.flags & ItemSnapshot::Flags_ItemUid && item->stack.uid != itemSnapshot.itemUid) {
+        g_item_db.AddRef(itemSnapshot.itemUid);
+        g_item_db.Release(item->stack.uid);
+        item->stack.uid = itemSnapshot.itemUid;
+    }
+    if (itemSnapshot.flags & ItemSnapshot::Flags_StackCount) {
+        DLB_ASSERT(itemSnapshot.stackCount);
+        item->stack.count = itemSnapshot.stackCount;
+        //if (!spawned) {
+        //    if (!item->stack.count && !item->pickedUpAt) {
+        //        item->pickedUpAt = worldSnapshot.recvAt;
+        //        Catalog::g_sounds.Play(Catalog::SoundID::Gold, 1.0f + dlb_rand32f_variance(0.2f), true);
+        //    }
+        //}
+    }
+}
+
 void NetClient::ProcessMsg(ENetPacket &packet)
+{
+    NetBundleReader reader(packet.data, packet.dataLength);
+    const uint8_t *data = 0;
+    size_t length = 0;
+    while (reader.Next(&data, &length)) {
+        ProcessMsg(data, length);
+    }
+}
+
+void NetClient::ProcessMsg(const uint8_t *data, size_t length)
 {
     memset(&tempMsg, 0, sizeof(tempMsg));
-    tempMsg.Deserialize(packet.data, packet.dataLength);
+    tempMsg.snapshotRecords = this;
+    if (!tempMsg.Deserialize(data, length)) {
+        E_WARN("Ignoring malformed %s message from server", tempMsg.TypeString());
+        return;
+    }
 
     if (connectionToken && tempMsg.connectionToken != connectionToken) {
         // Received a netMsg from a stale connection; discard it
@@ -371,6 +897,17 @@ void NetClient::ProcessMsg(ENetPacket &packet)
             //serverWorld->map->GenerateMinimap();
             serverWorld->playerId = welcomeMsg.playerId;
 
+            // Generate chunks locally if we're running the same generator as the server, otherwise we have to
+            // download each chunk in full.
+            if (welcomeMsg.worldGenVer == WORLD_GEN_VERSION) {
+                serverWorld->rtt_seed = welcomeMsg.worldSeed;
+                chunkGenerator.Start(welcomeMsg.worldSeed);
+            } else {
+                E_WARN("Server world gen v%u doesn't match client v%u, downloading all chunks",
+                    welcomeMsg.worldGenVer, WORLD_GEN_VERSION);
+                chunkGenerator.Stop();
+            }
+
             for (size_t i = 0; i < welcomeMsg.playerCount; i++) {
                 NetMessage_Welcome::NetMessage_Welcome_Player &netPlayerInfo = welcomeMsg.players[i];
                 PlayerInfo &playerInfo = serverWorld->playerInfos[i];
@@ -387,393 +924,49 @@ void NetClient::ProcessMsg(ENetPacket &packet)
             E_DEBUG("Received world chunk %hd %hd", worldChunk.chunk.x, worldChunk.chunk.y);
 #endif
             Tilemap &map = serverWorld->map;
-            auto chunkIter = map.chunksIndex.find(worldChunk.chunk.Hash());
-            if (chunkIter != map.chunksIndex.end()) {
-#if CL_DEBUG_WORLD_CHUNKS
-                E_DEBUG("  Updating existing chunk");
-#endif
-                size_t idx = chunkIter->second;
-                assert(idx < map.chunks.size());
-                map.chunks[chunkIter->second] = worldChunk.chunk;
-            } else {
-#if CL_DEBUG_WORLD_CHUNKS
-                E_DEBUG("  Adding new chunk to chunk list");
-#endif
-                map.chunks.emplace_back(worldChunk.chunk);
-                map.chunksIndex[worldChunk.chunk.Hash()] = map.chunks.size() - 1;
-            }
+            map.AddChunk(worldChunk.chunk);
+            serverWorld->chunkMeshes.Invalidate(worldChunk.chunk.Hash());
             // TODO(perf): Only update if chunk is within visible region?
             Player *player = serverWorld->FindPlayer(serverWorld->playerId);
             if (player) {
                 map.GenerateMinimap(player->body.GroundPosition());
             }
             break;
-        } case NetMessage::Type::TileUpdate: {
-            NetMessage_TileUpdate &tileUpdate = tempMsg.data.tileUpdate;
-
-            Tile *tile = serverWorld->map.TileAtWorld(tileUpdate.worldX, tileUpdate.worldY);
-            if (tile) {
-                tile->type = tileUpdate.tile.type;
-                tile->object.type = tileUpdate.tile.object.type;
-                tile->object.flags = tileUpdate.tile.object.flags;
+        } case NetMessage::Type::ChunkDiff: {
+            const ChunkDiff &diff = tempMsg.data.chunkDiff.diff;
+#if CL_DEBUG_WORLD_CHUNKS
+            E_DEBUG("Received chunk diff %hd %hd (%hu tiles)", diff.chunkX, diff.chunkY, diff.tileCount);
+#endif
+            if (chunkGenerator.Running()) {
+                chunkGenerator.Queue(diff);
+            } else {
+                SendChunkRequest(diff.chunkX, diff.chunkY);
             }
-
             break;
-        } case NetMessage::Type::WorldSnapshot: {
-            const WorldSnapshot &netSnapshot = tempMsg.data.worldSnapshot;
-            WorldSnapshot &worldSnapshot = worldHistory.Alloc();
-            worldSnapshot = netSnapshot;
-            //worldSnapshot.recvAt = g_clock.now;
-            //worldSnapshot.rtt = rtt;
-
-            const double rtt = server->roundTripTime / 1000.0;
-            const double serverNow = worldSnapshot.clock + (rtt / 2.0);
-            const double clockDrift = g_clock.now - serverNow;
-            if (abs(clockDrift) > 1.0) {
-                // TODO: Smoothly move clock closer to server time?
-                E_WARN("Detected clock drift %f, skipping from %.2f to %.2f", clockDrift, g_clock.now, serverNow);
-                g_clock.now = serverNow;
+        } case NetMessage::Type::TileDelta: {
+            NetMessage_TileDelta &tileDelta = tempMsg.data.tileDelta;
+
+            // Deltas only apply on top of the exact previous version, otherwise wait for the server to resend the
+            // whole chunk.
+            Chunk *chunk = serverWorld->map.FindChunk(Chunk::Hash(tileDelta.chunkX, tileDelta.chunkY));
+            if (!chunk || chunk->version + 1 != tileDelta.version) {
+                // e.g. the delta beat the chunk out of the generator. The server thinks we're up-to-date now, so
+                // we have to ask for the whole chunk.
+                E_WARN("Ignoring tile delta v%u for chunk [%hd, %hd], have v%u", tileDelta.version,
+                    tileDelta.chunkX, tileDelta.chunkY, chunk ? chunk->version : 0);
+                SendChunkRequest(tileDelta.chunkX, tileDelta.chunkY);
+                break;
             }
-
-            for (size_t i = 0; i < worldSnapshot.playerCount; i++) {
-                const PlayerSnapshot &playerSnapshot = worldSnapshot.players[i];
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_Despawn) {
-                    serverWorld->RemovePlayer(playerSnapshot.id);
-                    continue;
-                }
-
-                bool spawned = false;
-                Player *player = serverWorld->FindPlayer(playerSnapshot.id);
-                if (!player) {
-                    player = serverWorld->AddPlayer(playerSnapshot.id);
-                    if (!player) {
-                        continue;
-                    }
-                    spawned = true;
-                }
-
-                if (playerSnapshot.flags != PlayerSnapshot::Flags_None) {
-                    //E_DEBUG("Snapshot: player #%u", playerSnapshot.type);
-                }
-
-                const bool posChanged = playerSnapshot.flags & PlayerSnapshot::Flags_Position;
-                const bool dirChanged = playerSnapshot.flags & PlayerSnapshot::Flags_Direction;
-
-                if (posChanged || dirChanged) {
-                    const Vector3Snapshot *prevState{};
-                    if (player->body.positionHistory.Count()) {
-                        prevState = &player->body.positionHistory.Last();
-                    }
-
-                    Vector3Snapshot &state = player->body.positionHistory.Alloc();
-                    state.serverTime = worldSnapshot.clock;
-
-                    if (posChanged) {
-                        //E_DEBUG("Snapshot: pos %f %f %f",
-                            //playerSnapshot.position.x,
-                            //playerSnapshot.position.y,
-                            //playerSnapshot.position.z);
-                        state.v = playerSnapshot.position;
-                    } else {
-                        if (prevState) {
-                            state.v = prevState->v;
-                        } else {
-                            E_WARN("Received direction update but previous position is not known. playerId: %u", playerSnapshot.id);
-                            state.v = player->body.WorldPosition();
-                        }
-                    }
-
-                    if (dirChanged) {
-                        state.direction = playerSnapshot.direction;
-                        //E_DEBUG("Snapshot: dir %d", (char)state.direction);
-                    } else {
-                        if (prevState) {
-                            state.direction = prevState->direction;
-                            //E_DEBUG("Snapshot: dir %d (fallback prev)", (char)state.direction);
-                        } else {
-                            E_WARN("Received position update but previous position is not available.", 0);
-                            state.direction = player->sprite.direction;
-                        }
-                    }
-                }
-
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_Speed) {
-                    player->body.speed = playerSnapshot.speed;
-                }
-                // TODO: Pos/dir are history based, but these are instantaneous.. hmm.. is that okay?
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_Health) {
-                    //E_DEBUG("Snapshot: health %f", playerSnapshot.hitPoints);
-                    const bool respawn = player->combat.diedAt && playerSnapshot.hitPoints;
-                    float hpDelta = player->combat.hitPoints - playerSnapshot.hitPoints;
-                    if (hpDelta > 0) {
-                        player->combat.TakeDamage(hpDelta);
-                        if (player->combat.diedAt) {
-                            // Died
-                            player->combat.diedAt = worldSnapshot.clock;
-                            ParticleEffectParams bloodParams{};
-                            bloodParams.particleCountMin = 128;
-                            bloodParams.particleCountMax = bloodParams.particleCountMin;
-                            bloodParams.durationMin = 4.0f;
-                            bloodParams.durationMax = bloodParams.durationMin;
-                            serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Blood, player->WorldCenter(), bloodParams);
-                            Catalog::g_sounds.Play(Catalog::SoundID::Eughh, 1.0f + dlb_rand32f_variance(0.1f));
-                        } else {
-                            // Took damage
-                            Vector3 playerGut = player->GetAttachPoint(Player::AttachPoint::Gut);
-                            ParticleEffectParams bloodParams{};
-                            bloodParams.particleCountMin = 32;
-                            bloodParams.particleCountMax = bloodParams.particleCountMin;
-                            bloodParams.durationMin = 1.0f;
-                            bloodParams.durationMax = bloodParams.durationMin;
-                            ParticleEffect *bloodParticles = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Blood, playerGut, bloodParams);
-                            if (bloodParticles) {
-                                bloodParticles->effectCallbacks[(size_t)ParticleEffect_Event::BeforeUpdate] = {
-                                    ParticlesFollowPlayerGut,
-                                    player
-                                };
-                            }
-                        }
-                    } else if (player->combat.diedAt && playerSnapshot.hitPoints) {
-                        // Respawn
-                        player->combat.hitPoints = playerSnapshot.hitPoints;
-                        player->combat.diedAt = 0;
-                    }
-                }
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_HealthMax) {
-                    //E_DEBUG("Snapshot: healthMax %f", playerSnapshot.hitPointsMax);
-                    player->combat.hitPointsMax = playerSnapshot.hitPointsMax;
-                }
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_Level) {
-                    //E_DEBUG("Snapshot: level %u", enemySnapshot.level);
-                    if (!spawned) {
-                        if (playerSnapshot.level && playerSnapshot.level > player->combat.level) {
-                            ParticleEffectParams rainbowParams{};
-                            rainbowParams.durationMin = 3.0f;
-                            rainbowParams.durationMax = rainbowParams.durationMin;
-                            rainbowParams.particleCountMin = 256;
-                            rainbowParams.particleCountMax = rainbowParams.particleCountMin;
-                            ParticleEffect *rainbowFx = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Rainbow, player->body.WorldPosition(), rainbowParams);
-                            if (rainbowFx) {
-                                Catalog::g_sounds.Play(Catalog::SoundID::RainbowSparkles, 1.0f);
-                            }
-                        }
-                    }
-                    player->combat.level = playerSnapshot.level;
-                }
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_XP) {
-                    player->xp = playerSnapshot.xp;
-                }
-                if (playerSnapshot.flags & PlayerSnapshot::Flags_Inventory) {
-                    player->inventory = playerSnapshot.inventory;
-                    //player->inventory.selectedSlot = playerSnapshot.inventory.selectedSlot;
-                    //for (size_t i = 0; i < ARRAY_SIZE(playerSnapshot.inventory.slots); i++) {
-                    //    player->inventory.slots[i] = playerSnapshot.inventory.slots[i];
-                    //}
-                }
-            }
-
-            for (size_t i = 0; i < worldSnapshot.npcCount; i++) {
-                const NpcSnapshot &npcSnapshot = worldSnapshot.npcs[i];
-                if (npcSnapshot.flags & NpcSnapshot::Flags_Despawn) {
-                    serverWorld->RemoveNpc(npcSnapshot.id);
-                    continue;
-                }
-
-                bool spawned = false;
-                NPC *npc = serverWorld->FindNpc(npcSnapshot.id);
-                if (!npc) {
-                    DLB_ASSERT(npcSnapshot.id);
-                    DLB_ASSERT(npcSnapshot.type);
-                    E_ERROR(serverWorld->SpawnNpc(npcSnapshot.id, npcSnapshot.type, npcSnapshot.position, &npc), "Failed to spawn replicated npc", 0);
-                    if (!npc) {
-                        continue;
-                    }
-                    spawned = true;
-                }
-
-                if (npcSnapshot.flags & NpcSnapshot::Flags_Name && npcSnapshot.nameLength) {
-                    npc->nameLength = MIN(npcSnapshot.nameLength, ENTITY_NAME_LENGTH_MAX);
-                    strncpy(npc->name, npcSnapshot.name, npc->nameLength);
-                }
-
-                const bool posChanged = npcSnapshot.flags & NpcSnapshot::Flags_Position;
-                const bool dirChanged = npcSnapshot.flags & NpcSnapshot::Flags_Direction;
-
-                if (posChanged || dirChanged) {
-                    const Vector3Snapshot *prevState{};
-                    if (npc->body.positionHistory.Count()) {
-                        prevState = &npc->body.positionHistory.Last();
-                    }
-
-                    Vector3Snapshot &state = npc->body.positionHistory.Alloc();
-                    state.serverTime = worldSnapshot.clock;
-
-                    if (posChanged) {
-                        //E_DEBUG("Snapshot: pos %f %f %f",
-                        //    enemySnapshot.position.x,
-                        //    enemySnapshot.position.y,
-                        //    enemySnapshot.position.z);
-                        state.v = npcSnapshot.position;
-                    } else {
-                        if (prevState) {
-                            state.v = prevState->v;
-                        } else {
-                            E_WARN("Received direction update but prevPosition is not known.", 0);
-                            state.v = npc->body.WorldPosition();
-                        }
-                    }
-
-                    if (dirChanged) {
-                        state.direction = npcSnapshot.direction;
-                        //E_DEBUG("Snapshot: dir %d", (char)state.direction);
-                    } else {
-                        if (prevState) {
-                            state.direction = prevState->direction;
-                            //E_DEBUG("Snapshot: dir %d (fallback prev)", (char)state.direction);
-                        } else {
-                            E_WARN("Received position update but prevState.direction is not available.", 0);
-                            state.direction = npc->sprite.direction;
-                        }
-                    }
-                }
-
-                // TODO: Pos/dir are history based, but these are instantaneous.. hmm.. is that okay?
-                if (npcSnapshot.flags & NpcSnapshot::Flags_Scale) {
-                    //E_DEBUG("Snapshot: scale %f", (char)enemySnapshot.direction);
-                    npc->sprite.scale = npcSnapshot.scale;
-                }
-                if (npcSnapshot.flags & NpcSnapshot::Flags_Health) {
-                    //E_DEBUG("Snapshot: health %f", enemySnapshot.hitPoints);
-                    float hpDelta = npc->combat.hitPoints - npcSnapshot.hitPoints;
-                    if (hpDelta > 0) {
-                        npc->combat.TakeDamage(hpDelta);
-                        if (npc->combat.diedAt) {
-                            // Died
-                            ParticleEffectParams gooParams{};
-                            gooParams.particleCountMin = 50 * (int)ceilf(CL_NPC_CORPSE_LIFETIME);
-                            gooParams.particleCountMax = gooParams.particleCountMin;
-                            gooParams.durationMin = CL_NPC_CORPSE_LIFETIME;
-                            gooParams.durationMax = gooParams.durationMin;
-                            serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Goo, npc->WorldCenter(), gooParams);
-                            Catalog::g_sounds.Play(Catalog::SoundID::Squish2, 0.5f + dlb_rand32f_variance(0.1f), true);
-                        } else {
-                            // Took damage
-                            ParticleEffectParams gooParams{};
-                            gooParams.particleCountMin = 5;
-                            gooParams.particleCountMax = gooParams.particleCountMin;
-                            gooParams.durationMin = 0.5f;
-                            gooParams.durationMax = gooParams.durationMin;
-                            serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Goo, npc->WorldCenter(), gooParams);
-
-                            ParticleEffectParams dmgParams{};
-                            dmgParams.particleCountMin = (int)MAX(1, floorf(log10f(hpDelta)));
-                            dmgParams.particleCountMax = dmgParams.particleCountMin;
-                            dmgParams.durationMin = 3.0f;
-                            dmgParams.durationMax = dmgParams.durationMin;
-                            ParticleEffect *dmgFx = serverWorld->particleSystem.GenerateEffect(Catalog::ParticleEffectID::Number, npc->WorldCenter(), dmgParams);
-                            if (dmgFx) {
-                                char *text = (char *)calloc(1, 8);
-                                snprintf(text, 16, "%.f", hpDelta);
-                                dmgFx->particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Draw] = {
-                                    ParticleDrawText,
-                                    text
-                                };
-                                dmgFx->effectCallbacks[(size_t)ParticleEffect_Event::Dying] = {
-                                    ParticleFreeText,
-                                    text
-                                };
-                            }
-
-                            Catalog::g_sounds.Play(Catalog::SoundID::Slime_Stab1, 1.0f + dlb_rand32f_variance(0.4f));
-                        }
-                    } else if (npc->combat.diedAt && npcSnapshot.hitPoints) {
-                        // Respawn
-                        npc->combat.hitPoints = npcSnapshot.hitPoints;
-                        npc->combat.diedAt = 0;
-                    }
-                }
-                if (npcSnapshot.flags & NpcSnapshot::Flags_HealthMax) {
-                    //E_DEBUG("Snapshot: healthMax %f", enemySnapshot.hitPointsMax);
-                    npc->combat.hitPointsMax = npcSnapshot.hitPointsMax;
-                }
-                if (npcSnapshot.flags & NpcSnapshot::Flags_Level) {
-                    //E_DEBUG("Snapshot: level %u", enemySnapshot.level);
-                    npc->combat.level = npcSnapshot.level;
-                }
-            }
-
-            for (size_t i = 0; i < worldSnapshot.itemCount; i++) {
-                const ItemSnapshot &itemSnapshot = worldSnapshot.items[i];
-                if (itemSnapshot.flags & ItemSnapshot::Flags_Despawn) {
-                    serverWorld->itemSystem.Remove(itemSnapshot.id);
-                    continue;
-                }
-
-                bool spawned = false;
-                WorldItem *item = serverWorld->itemSystem.Find(itemSnapshot.id);
-                if (!item) {
-#if CL_DEBUG_WORLD_ITEMS
-                    E_DEBUG("Trying to spawn item: uid %u, count %u, id %u",
-                        itemSnapshot.itemUid,
-                        itemSnapshot.stackCount,
-                        itemSnapshot.id
-                    );
-#endif
-                    item = serverWorld->itemSystem.SpawnItem(
-                        itemSnapshot.position,
-                        itemSnapshot.itemUid,
-                        itemSnapshot.stackCount,
-                        itemSnapshot.id
-                    );
-                    if (!item) {
-                        continue;
-                    }
-                    spawned = true;
-                }
-
-                const bool posChanged = itemSnapshot.flags & ItemSnapshot::Flags_Position;
-                if (posChanged) {
-                    const Vector3Snapshot *prevState{};
-                    if (item->body.positionHistory.Count()) {
-                        prevState = &item->body.positionHistory.Last();
-                    }
-
-                    Vector3Snapshot &state = item->body.positionHistory.Alloc();
-                    state.serverTime = worldSnapshot.clock;
-
-                    if (posChanged) {
-                        //E_DEBUG("Snapshot: pos %f %f %f",
-                        //    itemSnapshot.position.x,
-                        //    itemSnapshot.position.y,
-                        //    itemSnapshot.position.z);
-                        state.v = itemSnapshot.position;
-                    } else {
-                        if (prevState) {
-                            state.v = prevState->v;
-                        } else {
-                            E_WARN("Received direction update but prevPosition is not known.", 0);
-                            state.v = item->body.WorldPosition();
-                        }
-                    }
-                }
-
-                //if (itemSnapshot.flags & ItemSnapshot::Flags_Position) {
-                //    item->body.Teleport(itemSnapshot.position);
-                //}
-                if (itemSnapshot.flags & ItemSnapshot::Flags_ItemUid) {
-                    item->stack.uid = itemSnapshot.itemUid;
-                }
-                if (itemSnapshot.flags & ItemSnapshot::Flags_StackCount) {
-                    DLB_ASSERT(itemSnapshot.stackCount);
-                    item->stack.count = itemSnapshot.stackCount;
-                    //if (!spawned) {
-                    //    if (!item->stack.count && !item->pickedUpAt) {
-                    //        item->pickedUpAt = worldSnapshot.recvAt;
-                    //        Catalog::g_sounds.Play(Catalog::SoundID::Gold, 1.0f + dlb_rand32f_variance(0.2f), true);
-                    //    }
-                    //}
-                }
+            for (size_t i = 0; i < tileDelta.tileCount; i++) {
+                const TileDelta &delta = tileDelta.tiles[i];
+                chunk->tiles[delta.index] = delta.tile;
+                chunk->UpdateMask(delta.index);
             }
+            chunk->version = tileDelta.version;
+            serverWorld->chunkMeshes.Invalidate(chunk->Hash());
+            break;
+        } case NetMessage::Type::WorldSnapshot: {
+            ApplySnapshot();
             break;
         } case NetMessage::Type::GlobalEvent: {
             const NetMessage_GlobalEvent &globalEvent = tempMsg.data.globalEvent;
@@ -906,6 +1099,7 @@ ErrorType NetClient::Receive(void)
         }
     } while (svc > 0);
 
+    ProcessGenChunks();
     return ErrorType::Success;
 }
 
@@ -954,9 +1148,15 @@ void NetClient::Disconnect(void)
         delete serverWorld;
         serverWorld = nullptr;
     }
+    chunkGenerator.Stop();
+    bundle.Clear();
     inputSeq = 0;
     inputHistory.Clear();
     worldHistory.Clear();
+    // seq #s start over on the next connection, don't let them match predictions from this one
+    memset(predictedStates, 0, sizeof(predictedStates));
+    lastPredictedSeq = 0;
+    reconcileTick = 0;
 }
 
 void NetClient::CloseSocket(void)
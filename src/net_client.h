@@ -1,13 +1,29 @@
 #pragma once
 #include "chat.h"
+#include "chunk_generator.h"
 #include "controller.h"
 #include "fbs.h"
+#include "net_bundle.h"
 #include "dlb_types.h"
 #include "servers_generated.h"
 
 struct World;
 
-struct NetClient {
+// Where client-side prediction put the local player after applying one input sample
+struct CL_PredictedState {
+    uint32_t seq      {};  // input sample this is the result of, 0 = empty slot
+    Vector3  position {};  // predicted position, before reconcile smoothing
+};
+
+// How often reconciliation had to throw away the prediction and replay input, for tuning prediction
+struct CL_ReconcileStats {
+    uint32_t snapshots        {};  // snapshots whose owner position was checked against the prediction
+    uint32_t replays          {};  // times the player was rolled back to the server's position
+    uint64_t samplesPredicted {};  // input samples applied for the first time
+    uint64_t samplesReplayed  {};  // input samples applied again by a replay
+};
+
+struct NetClient : private WorldSnapshotRecords {
     char     serverHost       [HOSTNAME_LENGTH_MAX]{};
     size_t   serverHostLength {};
     uint16_t serverPort       {};
@@ -26,6 +42,11 @@ struct NetClient {
     RingBuffer<InputSample,   CL_INPUT_HISTORY> inputHistory {};
     RingBuffer<WorldSnapshot, CL_WORLD_HISTORY> worldHistory {};
 
+    CL_PredictedState predictedStates[CL_INPUT_HISTORY]{};  // indexed by seq % CL_INPUT_HISTORY
+    uint32_t lastPredictedSeq {};  // seq # of newest input applied to the local player
+    uint32_t reconcileTick    {};  // tick of newest snapshot checked against the prediction
+    CL_ReconcileStats reconcileStats {};
+
     ErrorType Load                (void);
               ~NetClient          (void);
     ErrorType OpenSocket          (void);
@@ -35,9 +56,14 @@ struct NetClient {
     ErrorType SendSlotScroll      (SlotId slot, int scrollY);
     ErrorType SendSlotDrop        (SlotId slot, uint32_t count);
     ErrorType SendTileInteract    (float worldX, float worldY);
+    ErrorType SendChunkRequest    (int16_t chunkX, int16_t chunkY);
     ErrorType SendPlayerInput     (void);
+    // Send all bundled messages, call once per frame after everything has been queued
+    void      Flush               (void);
     void      PredictPlayer       (void);
     void      ReconcilePlayer     (void);
+    // Find the newest snapshot at or before renderAt, once per frame, for World::CL_Interpolate
+    InterpolationCursor FindInterpolationCursor(double renderAt) const;
     ErrorType Receive             (void);
     bool      IsConnecting        (void) const;
     bool      IsConnected         (void) const;
@@ -155,13 +181,37 @@ struct NetClient {
 
 private:
     const char *LOG_SRC = "NetClient";
-    static uint8_t rawPacket[PACKET_SIZE_MAX];
     NetMessage tempMsg {};
+    PacketPool packetPool {};  // buffers for outgoing packets, must outlive the ENet host
+    NetBundle bundle { &packetPool };
+    ChunkGenerator chunkGenerator {};
+    std::vector<ChunkGenerator::Result> chunkGenResults {};
 
     ErrorType   SaveDefaultServerDB (const char *filename);
-    ErrorType   SendRaw             (const uint8_t *buf, size_t len);
+    ErrorType   SendRaw             (const uint8_t *buf, size_t len, NetDelivery delivery);
     ErrorType   SendMsg             (NetMessage &message);
     ErrorType   Auth                (void);
+    const CL_PredictedState *FindPredictedState(uint32_t seq) const;
+    void        SavePredictedState  (uint32_t seq, Vector3 position);
+
+    // Snapshot records are staged as they're deserialized and only applied to serverWorld once the whole message has
+    // been read, so a malformed or stale snapshot is dropped instead of half applied. The vectors keep their capacity.
+    WorldSnapshot               snapshotHeader  {};
+    std::vector<PlayerSnapshot> snapshotPlayers {};
+    std::vector<NpcSnapshot>    snapshotNpcs    {};
+    std::vector<ItemSnapshot>   snapshotItems   {};
+    void        OnHeader            (const WorldSnapshot &header) override;
+    void        OnPlayer            (const PlayerSnapshot &playerSnapshot) override;
+    void        OnNpc               (const NpcSnapshot &npcSnapshot) override;
+    void        OnItem              (const ItemSnapshot &itemSnapshot) override;
+    void        ApplySnapshot       (void);
+    void        ApplySnapshotHeader (const WorldSnapshot &header);
+    void        ApplySnapshotPlayer (const PlayerSnapshot &playerSnapshot);
+    void        ApplySnapshotNpc    (const NpcSnapshot &npcSnapshot);
+    void        ApplySnapshotItem   (const ItemSnapshot &itemSnapshot);
+
     void        ProcessMsg          (ENetPacket &packet);
+    void        ProcessMsg          (const uint8_t *data, size_t length);
+    void        ProcessGenChunks    (void);
     const char *ServerStateString   (void);
 };
\ No newline at end of file
@@ -4,6 +4,159 @@
 #include "net_message.h"
 #include "tilemap.h"
 
+// Type (and seed) of the item with this uid. Only read into the record; the client applies it to the item db along with
+// the rest of the snapshot, so a malformed or rejected packet can't clobber an item the client already has.
+static void ProcessItem(BitStream &stream, ItemUID uid, ItemType &type, uint64_t *seed)
+{
+    if (stream.Writing()) {
+        const Item &item = g_item_db.Find(uid);
+        DLB_ASSERT(item.uid);
+        DLB_ASSERT(item.type);
+        type = item.type;
+        if (seed) {
+            *seed = item.seed;
+        }
+    }
+    stream.Process(type, 16, 0, ItemType_Count - 1);
+    if (seed) {
+        stream.Process(*seed);
+    }
+}
+
+static void ProcessPlayerSnapshot(BitStream &stream, PlayerSnapshot &playerSnap)
+{
+    stream.Process(playerSnap.id, 32, 1, UINT32_MAX);
+    stream.Process((uint32_t &)playerSnap.flags);
+    if (playerSnap.flags & PlayerSnapshot::Flags_Position) {
+        stream.Process(playerSnap.position.x);
+        stream.Process(playerSnap.position.y);
+        stream.Process(playerSnap.position.z);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_Direction) {
+        stream.Process((uint8_t &)playerSnap.direction, 3, (uint8_t)Direction::North, (uint8_t)Direction::NorthWest);
+        stream.Align();
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_Speed) {
+        stream.Process(playerSnap.speed);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_Health) {
+        stream.Process(playerSnap.hitPoints);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_HealthMax) {
+        stream.Process(playerSnap.hitPointsMax);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_Level) {
+        stream.Process(playerSnap.level);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_XP) {
+        stream.Process(playerSnap.xp);
+    }
+    if (playerSnap.flags & PlayerSnapshot::Flags_Inventory) {
+        //if (stream.Writing()) {
+        //    E_DEBUG("Sending player inventory update for player %u\n", playerSnap.id);
+        //}
+
+        stream.Process((uint8_t &)playerSnap.inventory.selectedSlot, 8, 0, PlayerInventory::SlotId_Count - 1);
+
+        const size_t slotCount = ARRAY_SIZE(playerSnap.inventory.slots);
+        bool slotMap[slotCount]{};
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            ItemStack &invStack = playerSnap.inventory.slots[slot].stack;
+            slotMap[slot] = invStack.count > 0;
+            stream.Process(slotMap[slot]);
+        }
+        stream.Align();
+
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            if (slotMap[slot]) {
+                ItemStack &invStack = playerSnap.inventory.slots[slot].stack;
+                stream.Process(invStack.uid, 32, 1, UINT32_MAX);  // ensure stack with count > 0 has valid item ID
+                stream.Process(invStack.count, 32, 1, UINT32_MAX);
+                ItemDbSnapshot &invItem = playerSnap.inventoryDb[slot];
+                ProcessItem(stream, invStack.uid, invItem.type, &invItem.seed);
+
+                // Default items have no rolled affixes that need to be sync'd
+                if (invStack.uid < ItemType_Count) {
+                    continue;
+                }
+
+                #if 0
+                Item &item = g_item_db.FindOrCreate(invStack.uid);
+                bool affixMap[ARRAY_SIZE(item.affixes)]{};
+                for (int affix = 0; affix < (int)ARRAY_SIZE(item.affixes); affix++) {
+                    affixMap[affix] = item.affixes[affix].type != ItemAffix_Empty;
+                    stream.Process(affixMap[affix]);
+                }
+                stream.Align();
+
+                for (int affix = 0; affix < (int)ARRAY_SIZE(item.affixes); affix++) {
+                    if (affixMap[affix]) {
+                        stream.Process(item.affixes[affix].type, 4, 0, ItemAffix_Count);
+                        stream.Process(item.affixes[affix].value.min);
+                        stream.Process(item.affixes[affix].value.max);
+                    } else {
+                        item.affixes[affix] = {};
+                    }
+                }
+                #endif
+            }
+        }
+    }
+}
+
+static void ProcessNpcSnapshot(BitStream &stream, NpcSnapshot &npcSnap)
+{
+    stream.Process(npcSnap.id, 32, 1, UINT32_MAX);
+    stream.Process((uint32_t &)npcSnap.flags);
+    stream.Process((uint32_t &)npcSnap.type, 4, NPC::Type_None + 1, NPC::Type_Count - 1);
+    if (npcSnap.flags & NpcSnapshot::Flags_Name) {
+        stream.Process(npcSnap.nameLength, 7, 0, ENTITY_NAME_LENGTH_MAX);
+        stream.Align();
+        for (size_t i = 0; i < npcSnap.nameLength; i++) {
+            stream.ProcessChar(npcSnap.name[i]);
+        }
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_Position) {
+        stream.Process(npcSnap.position.x);
+        stream.Process(npcSnap.position.y);
+        stream.Process(npcSnap.position.z);
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_Direction) {
+        stream.Process((uint8_t &)npcSnap.direction, 3, (uint8_t)Direction::North, (uint8_t)Direction::NorthWest);
+        stream.Align();
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_Scale) {
+        stream.Process(npcSnap.scale);
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_Health) {
+        stream.Process(npcSnap.hitPoints);
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_HealthMax) {
+        stream.Process(npcSnap.hitPointsMax);
+    }
+    if (npcSnap.flags & NpcSnapshot::Flags_Level) {
+        stream.Process(npcSnap.level);
+    }
+}
+
+static void ProcessItemSnapshot(BitStream &stream, ItemSnapshot &itemSnap)
+{
+    stream.Process(itemSnap.id, 32, 1, UINT32_MAX);
+    stream.Process((uint32_t &)itemSnap.flags);
+    if (itemSnap.flags & ItemSnapshot::Flags_Position) {
+        stream.Process(itemSnap.position.x);
+        stream.Process(itemSnap.position.y);
+        stream.Process(itemSnap.position.z);
+    }
+    if (itemSnap.flags & ItemSnapshot::Flags_ItemUid) {
+        stream.Process(itemSnap.itemUid, 32, 1, UINT32_MAX);
+        ProcessItem(stream, itemSnap.itemUid, itemSnap.itemType, 0);
+    }
+    if (itemSnap.flags & ItemSnapshot::Flags_StackCount) {
+        stream.Process(itemSnap.stackCount);
+    }
+}
+
 size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
 {
     DLB_ASSERT(buf);
@@ -51,6 +204,8 @@ size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
             }
 
             stream.Process(welcome.playerId, 32, 1, UINT32_MAX);
+            stream.Process(welcome.worldSeed);
+            stream.Process(welcome.worldGenVer);
             stream.Align();
 
             stream.Process(welcome.playerCount, 4, 0, SV_MAX_PLAYERS);
@@ -91,27 +246,74 @@ size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
         } case NetMessage::Type::Input: {
             NetMessage_Input &input = data.input;
 
-            stream.Process(input.sampleCount, 10, 0, CL_INPUT_SAMPLES_MAX);
+            stream.Process(input.lastSnapshotTick);
+            stream.Process(input.sampleCount, 6, 0, CL_INPUT_SAMPLES_MAX);
+            if (!input.sampleCount) {
+                stream.Align();
+                break;
+            }
+
+            // Samples are consecutive and all from the same player, so seq and ownerId are only sent once. Each
+            // sample after the first only sends dt and buttons when they differ from the previous sample.
+            InputSample &first = input.samples[0];
+            stream.Process(first.seq, 32, 0, UINT32_MAX);
+            stream.Process(first.ownerId, 32, 0, UINT32_MAX);
             for (size_t i = 0; i < input.sampleCount; i++) {
                 InputSample &sample = input.samples[i];
-                bool same = i && sample.Equals(input.samples[i - 1]) && (sample.seq == (input.samples[i - 1].seq + 1));
-                stream.Process(same);
-                if (same) {
+                InputSample *prev = i ? &input.samples[i - 1] : 0;
+                if (prev) {
                     if (mode == BitStream::Mode::Reader) {
-#pragma warning(push)
-#pragma warning(disable: 6385)
-                        // conversion from 'int' to 'float'
-                        sample = input.samples[i - 1];
-#pragma warning(pop)
-                        sample.seq = input.samples[i - 1].seq + 1;
+                        sample.seq = prev->seq + 1;
+                        sample.ownerId = prev->ownerId;
+                    }
+                    DLB_ASSERT(sample.seq == prev->seq + 1);
+                    DLB_ASSERT(sample.ownerId == prev->ownerId);
+                }
+
+                // dt is either the same as the previous sample, a small jitter away from it, or sent in full
+                uint32_t dtQuantized = sample.DtQuantized();
+                if (prev) {
+                    const uint32_t prevDt = prev->DtQuantized();
+                    const uint32_t deltaBias = 1u << (CL_INPUT_DT_DELTA_BITS - 1);
+                    uint32_t dtDelta = dtQuantized + deltaBias - prevDt;
+                    bool sameDt = dtQuantized == prevDt;
+                    bool smallDt = dtDelta < (1u << CL_INPUT_DT_DELTA_BITS);
+                    stream.Process(sameDt);
+                    if (sameDt) {
+                        dtQuantized = prevDt;
+                    } else {
+                        stream.Process(smallDt);
+                        if (smallDt) {
+                            stream.Process(dtDelta, CL_INPUT_DT_DELTA_BITS, 0, (1u << CL_INPUT_DT_DELTA_BITS) - 1);
+                            dtQuantized = prevDt + dtDelta - deltaBias;
+                            if (prevDt + dtDelta < deltaBias || dtQuantized >= (1u << CL_INPUT_DT_BITS)) {
+                                stream.SetError();
+                                dtQuantized = prevDt;
+                            }
+                        } else {
+                            stream.Process(dtQuantized, CL_INPUT_DT_BITS, 0, (1u << CL_INPUT_DT_BITS) - 1);
+                        }
+                    }
+                } else {
+                    stream.Process(dtQuantized, CL_INPUT_DT_BITS, 0, (1u << CL_INPUT_DT_BITS) - 1);
+                }
+                sample.dt = dtQuantized * CL_INPUT_DT_QUANTUM;
+
+                bool sameButtons = prev && sample.Equals(*prev);
+                if (prev) {
+                    stream.Process(sameButtons);
+                }
+                if (sameButtons) {
+                    if (mode == BitStream::Mode::Reader) {
+                        sample.walkNorth  = prev->walkNorth;
+                        sample.walkEast   = prev->walkEast;
+                        sample.walkSouth  = prev->walkSouth;
+                        sample.walkWest   = prev->walkWest;
+                        sample.run        = prev->run;
+                        sample.primary    = prev->primary;
+                        sample.selectSlot = prev->selectSlot;
                     }
-                    stream.Process(sample.dt);
                 } else {
-                    // TODO: Don't send every seq number, it's implicit based on the first seq number and count
-                    stream.Process(sample.seq, 32, 0, UINT32_MAX);
-                    // TODO: Don't send ownerId more than once.. move this up outside of the loop
-                    stream.Process(sample.ownerId, 32, 0, UINT32_MAX);
-                    stream.Process(sample.dt);
                     stream.Process(sample.walkNorth);
                     stream.Process(sample.walkEast);
                     stream.Process(sample.walkSouth);
@@ -131,6 +333,7 @@ size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
 
             stream.Process(worldChunk.chunk.x, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
             stream.Process(worldChunk.chunk.y, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(worldChunk.chunk.version);
 
             // TODO(perf): RLE compression
             // https://moddingwiki.shikadi.net/wiki/RLE_Compression#Code
@@ -142,177 +345,124 @@ size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
             stream.Align();
 
             break;
-        } case NetMessage::Type::TileUpdate: {
-            NetMessage_TileUpdate &tileUpdate = data.tileUpdate;
+        } case NetMessage::Type::ChunkDiff: {
+            ChunkDiff &diff = data.chunkDiff.diff;
+
+            stream.Process(diff.chunkX, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(diff.chunkY, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(diff.version);
+            stream.Process(diff.hash);
+            stream.Process(diff.tileCount, 9, 0, WORLD_CHUNK_TILES);
+
+            for (size_t i = 0; i < diff.tileCount; i++) {
+                TileDelta &delta = diff.tiles[i];
+                stream.Process(delta.index);
+                stream.Process(delta.tile.type, 5, 0, TileType_Count - 1);
+                stream.Process(delta.tile.object.type, 6, 0, ObjectType_Count - 1);
+                stream.Process(delta.tile.object.flags);
+            }
+            stream.Align();
 
-            stream.Process(tileUpdate.worldX);
-            stream.Process(tileUpdate.worldY);
+            break;
+        } case NetMessage::Type::ChunkRequest: {
+            NetMessage_ChunkRequest &chunkRequest = data.chunkRequest;
 
-            stream.Process(tileUpdate.tile.type, 4, 0, TileType_Count - 1);
-            stream.Process(tileUpdate.tile.object.type, 4, 0, ObjectType_Count - 1);
-            stream.Process(tileUpdate.tile.object.flags);
+            stream.Process(chunkRequest.chunkX, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(chunkRequest.chunkY, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+
+            break;
+        } case NetMessage::Type::TileDelta: {
+            NetMessage_TileDelta &tileDelta = data.tileDelta;
+
+            stream.Process(tileDelta.chunkX, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(tileDelta.chunkY, 16, WORLD_CHUNK_MIN, WORLD_CHUNK_MAX);
+            stream.Process(tileDelta.version);
+            stream.Process(tileDelta.tileCount, 9, 1, WORLD_CHUNK_TILES);
+
+            for (size_t i = 0; i < tileDelta.tileCount; i++) {
+                TileDelta &delta = tileDelta.tiles[i];
+                stream.Process(delta.index);
+                stream.Process(delta.tile.type, 5, 0, TileType_Count - 1);
+                stream.Process(delta.tile.object.type, 6, 0, ObjectType_Count - 1);
+                stream.Process(delta.tile.object.flags);
+            }
+            stream.Align();
 
             break;
         } case NetMessage::Type::WorldSnapshot: {
             WorldSnapshot &worldSnapshot = data.worldSnapshot;
+            WorldSnapshotRecords *records = snapshotRecords;
+            DLB_ASSERT(records);
 
             stream.Process(worldSnapshot.tick, 32, 1, UINT32_MAX);
             stream.Process(worldSnapshot.clock);
             stream.Process(worldSnapshot.lastInputAck);
             stream.Process(worldSnapshot.inputOverflow);
-            stream.Process(worldSnapshot.playerCount, 4, 0, SNAPSHOT_MAX_PLAYERS);
-            stream.Process(worldSnapshot.npcCount, 9, 0, SNAPSHOT_MAX_NPCS);
-            stream.Process(worldSnapshot.itemCount, 9, 0, SNAPSHOT_MAX_ITEMS);
-            stream.Align();
-
-            for (size_t i = 0; i < worldSnapshot.playerCount; i++) {
-                PlayerSnapshot &playerSnap = worldSnapshot.players[i];
-                stream.Process(playerSnap.id, 32, 1, UINT32_MAX);
-                stream.Process((uint32_t &)playerSnap.flags);
-                if (playerSnap.flags & PlayerSnapshot::Flags_Position) {
-                    stream.Process(playerSnap.position.x);
-                    stream.Process(playerSnap.position.y);
-                    stream.Process(playerSnap.position.z);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_Direction) {
-                    stream.Process((uint8_t &)playerSnap.direction, 3, (uint8_t)Direction::North, (uint8_t)Direction::NorthWest);
-                    stream.Align();
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_Speed) {
-                    stream.Process(playerSnap.speed);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_Health) {
-                    stream.Process(playerSnap.hitPoints);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_HealthMax) {
-                    stream.Process(playerSnap.hitPointsMax);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_Level) {
-                    stream.Process(playerSnap.level);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_XP) {
-                    stream.Process(playerSnap.xp);
-                }
-                if (playerSnap.flags & PlayerSnapshot::Flags_Inventory) {
-                    //if (stream.Writing()) {
-                    //    E_DEBUG("Sending player inventory update for player %u\n", playerSnap.id);
-                    //}
-
-                    stream.Process((uint8_t &)playerSnap.inventory.selectedSlot, 8, 0, PlayerInventory::SlotId_Count - 1);
-
-                    const size_t slotCount = ARRAY_SIZE(playerSnap.inventory.slots);
-                    bool slotMap[slotCount]{};
-                    for (size_t slot = 0; slot < slotCount; slot++) {
-                        ItemStack &invStack = playerSnap.inventory.slots[slot].stack;
-                        slotMap[slot] = invStack.count > 0;
-                        stream.Process(slotMap[slot]);
-                    }
-                    stream.Align();
-
-                    for (size_t slot = 0; slot < slotCount; slot++) {
-                        if (slotMap[slot]) {
-                            ItemStack &invStack = playerSnap.inventory.slots[slot].stack;
-                            stream.Process(invStack.uid);
-                            stream.Process(invStack.count);
-                            DLB_ASSERT(invStack.uid);  // ensure stack with count > 0 has valid item ID
-
-                            Item &item = g_item_db.FindOrCreate(invStack.uid);
-                            DLB_ASSERT(item.uid);
-                            if (stream.Writing()) {
-                                DLB_ASSERT(item.type);
-                            }
-                            stream.Process(item.type);
-                            stream.Process(item.seed);
-                            if (stream.Reading() && item.seed) {
-                                item.Roll();
-                            }
-
-                            // Default items have no rolled affixes that need to be sync'd
-                            if (item.uid < ItemType_Count) {
-                                continue;
-                            }
-
-                            #if 0
-                            bool affixMap[ARRAY_SIZE(item.affixes)]{};
-                            for (int affix = 0; affix < (int)ARRAY_SIZE(item.affixes); affix++) {
-                                affixMap[affix] = item.affixes[affix].type != ItemAffix_Empty;
-                                stream.Process(affixMap[affix]);
-                            }
-                            stream.Align();
-
-                            for (int affix = 0; affix < (int)ARRAY_SIZE(item.affixes); affix++) {
-                                if (affixMap[affix]) {
-                                    stream.Process(item.affixes[affix].type, 4, 0, ItemAffix_Count);
-                                    stream.Process(item.affixes[affix].value.min);
-                                    stream.Process(item.affixes[affix].value.max);
-                                } else {
-                                    item.affixes[affix] = {};
-                                }
-                            }
-                            #endif
-                        }
-                    }
-                }
+            if (stream.Reading() && !stream.Error()) {
+                records->OnHeader(worldSnapshot);
             }
 
-            for (size_t i = 0; i < worldSnapshot.npcCount; i++) {
-                NpcSnapshot &npcSnap = worldSnapshot.npcs[i];
-                stream.Process(npcSnap.id, 32, 1, UINT32_MAX);
-                stream.Process((uint32_t &)npcSnap.flags);
-                stream.Process((uint32_t &)npcSnap.type, 4, NPC::Type_None + 1, NPC::Type_Count - 1);
-                if (npcSnap.flags & NpcSnapshot::Flags_Name) {
-                    stream.Process(npcSnap.nameLength, 7, 0, ENTITY_NAME_LENGTH_MAX);
-                    stream.Align();
-                    for (size_t i = 0; i < npcSnap.nameLength; i++) {
-                        stream.ProcessChar(npcSnap.name[i]);
-                    }
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_Position) {
-                    stream.Process(npcSnap.position.x);
-                    stream.Process(npcSnap.position.y);
-                    stream.Process(npcSnap.position.z);
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_Direction) {
-                    stream.Process((uint8_t &)npcSnap.direction, 3, (uint8_t)Direction::North, (uint8_t)Direction::NorthWest);
-                    stream.Align();
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_Scale) {
-                    stream.Process(npcSnap.scale);
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_Health) {
-                    stream.Process(npcSnap.hitPoints);
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_HealthMax) {
-                    stream.Process(npcSnap.hitPointsMax);
-                }
-                if (npcSnap.flags & NpcSnapshot::Flags_Level) {
-                    stream.Process(npcSnap.level);
-                }
+            // Each record is preceded by its type, and the last one is followed by SnapshotRecordType::None. The
+            // writer tells Next how much room is left for a record once the end marker is accounted for, and stays
+            // under the budget and the buffer (minus the word Flush may pad the end out to). Entities it didn't get
+            // to keep their history and go out in the next snapshot.
+            size_t limit = len - sizeof(uint32_t);
+            if (records->budget) {
+                limit = MIN(limit, records->budget);
             }
-
-            for (size_t i = 0; i < worldSnapshot.itemCount; i++) {
-                ItemSnapshot &itemSnap = worldSnapshot.items[i];
-                stream.Process(itemSnap.id, 32, 1, UINT32_MAX);
-                stream.Process((uint32_t &)itemSnap.flags);
-                if (itemSnap.flags & ItemSnapshot::Flags_Position) {
-                    stream.Process(itemSnap.position.x);
-                    stream.Process(itemSnap.position.y);
-                    stream.Process(itemSnap.position.z);
+            PlayerSnapshot playerSnapRead{};
+            NpcSnapshot npcSnapRead{};
+            ItemSnapshot itemSnapRead{};
+            WorldSnapshotRecord record{};
+            do {
+                const size_t bytes = stream.BytesProcessed();
+                if (stream.Writing()) {
+                    const size_t used = bytes + WorldSnapshotRecord::SizeMax(SnapshotRecordType::None);
+                    const size_t room = used < limit ? limit - used : 0;
+                    record = records->Next(room);
+                    DLB_ASSERT(record.type == SnapshotRecordType::None || WorldSnapshotRecord::SizeMax(record.type) <= room);
+                } else {
+                    record = {};
                 }
-                if (itemSnap.flags & ItemSnapshot::Flags_ItemUid) {
-                    stream.Process(itemSnap.itemUid);
+                stream.Process((uint8_t &)record.type, 2, (uint8_t)SnapshotRecordType::None, (uint8_t)SnapshotRecordType::Count - 1);
 
-                    Item &item = g_item_db.FindOrCreate(itemSnap.itemUid);
-                    DLB_ASSERT(item.uid);
-                    if (stream.Writing()) {
-                        DLB_ASSERT(item.type);
+                switch (record.type) {
+                    case SnapshotRecordType::Player: {
+                        if (stream.Reading()) {
+                            playerSnapRead = {};
+                            record.player = &playerSnapRead;
+                        }
+                        ProcessPlayerSnapshot(stream, *record.player);
+                        if (stream.Reading() && !stream.Error()) {
+                            records->OnPlayer(*record.player);
+                        }
+                        break;
+                    } case SnapshotRecordType::Npc: {
+                        if (stream.Reading()) {
+                            npcSnapRead = {};
+                            record.npc = &npcSnapRead;
+                        }
+                        ProcessNpcSnapshot(stream, *record.npc);
+                        if (stream.Reading() && !stream.Error()) {
+                            records->OnNpc(*record.npc);
+                        }
+                        break;
+                    } case SnapshotRecordType::Item: {
+                        if (stream.Reading()) {
+                            itemSnapRead = {};
+                            record.item = &itemSnapRead;
+                        }
+                        ProcessItemSnapshot(stream, *record.item);
+                        if (stream.Reading() && !stream.Error()) {
+                            records->OnItem(*record.item);
+                        }
+                        break;
+                    } default: {
+                        break;
                     }
-                    stream.Process(item.type);
                 }
-                if (itemSnap.flags & ItemSnapshot::Flags_StackCount) {
-                    stream.Process(itemSnap.stackCount);
-                }
-            }
+                DLB_ASSERT(stream.Reading() || stream.BytesProcessed() - bytes <= WorldSnapshotRecord::SizeMax(record.type));
+            } while (record.type != SnapshotRecordType::None && !stream.Error());
 
             break;
         } case NetMessage::Type::GlobalEvent: {
@@ -468,6 +618,9 @@ size_t NetMessage::Process(BitStream::Mode mode, uint8_t *buf, size_t len)
     }
 
     stream.Flush();
+    if (stream.Error()) {
+        return 0;
+    }
     size_t bytesProcessed = stream.BytesProcessed();
 
 #if _DEBUG && 0
@@ -499,6 +652,15 @@ size_t NetMessage::Deserialize(const uint8_t *buf, size_t len)
     DLB_ASSERT(buf);
     DLB_ASSERT(len);
     size_t bytesProcessed = Process(BitStream::Mode::Reader, (uint8_t *)buf, len);
-    DLB_ASSERT(bytesProcessed);
     return bytesProcessed;
+}
+
+void NetMessage::PatchConnectionToken(uint8_t *buf, size_t len, uint32_t connectionToken)
+{
+    DLB_ASSERT(buf);
+    DLB_ASSERT(len >= sizeof(connectionToken));
+    // Token is the first thing Process writes, rewrite just that word the same way it was written
+    BitStream stream(BitStream::Mode::Writer, buf, sizeof(connectionToken));
+    stream.Process(connectionToken);
+    stream.Flush();
 }
\ No newline at end of file
@@ -19,6 +19,8 @@ struct NetMessage_Welcome {
     uint32_t motdLength  {};
     char     motd        [MOTD_LENGTH_MAX + 1]{};  // message of the day
     uint32_t playerId    {};                       // client's assigned playerId
+    uint64_t worldSeed   {};                       // seed for client-side chunk generation
+    uint32_t worldGenVer {};                       // server's WORLD_GEN_VERSION, client must match to use worldSeed
     uint32_t playerCount {};                       // players in game
     struct NetMessage_Welcome_Player {
         uint32_t  id           {};
@@ -46,18 +48,33 @@ struct NetMessage_ChatMessage {
 };
 
 struct NetMessage_Input {
-    uint32_t    sampleCount {};
-    InputSample samples     [CL_INPUT_SAMPLES_MAX]{};
+    uint32_t    lastSnapshotTick {};  // tick of newest snapshot client has received, acks snapshot deltas
+    uint32_t    sampleCount      {};
+    InputSample samples          [CL_INPUT_SAMPLES_MAX]{};
 };
 
 struct NetMessage_WorldChunk {
     Chunk chunk {};
 };
 
-struct NetMessage_TileUpdate {
-    float worldX;
-    float worldY;
-    Tile tile;
+// All tiles that changed in a chunk during one server tick. Only valid to apply on top of version - 1, if the
+// client is behind the server will resend the whole chunk instead.
+struct NetMessage_ChunkDiff {
+    ChunkDiff diff {};
+};
+
+// Client's locally generated chunk didn't match the server's hash, send the whole chunk instead
+struct NetMessage_ChunkRequest {
+    int16_t chunkX {};
+    int16_t chunkY {};
+};
+
+struct NetMessage_TileDelta {
+    int16_t   chunkX    {};
+    int16_t   chunkY    {};
+    uint32_t  version   {};  // chunk version after applying this delta
+    uint16_t  tileCount {};
+    TileDelta tiles     [WORLD_CHUNK_TILES]{};
 };
 
 struct NetMessage_GlobalEvent {
@@ -220,6 +237,19 @@ struct NetMessage_TileInteract {
     float tileY {};
 };
 
+// ENet channels. Each channel is sequenced independently, so a lost packet on one can't stall the others.
+enum NetChannel : uint8_t {
+    NetChannel_Realtime,  // unreliable sequenced, newer packets supersede lost ones (snapshots, input)
+    NetChannel_Reliable,  // reliable ordered (chat, events, inventory)
+    NetChannel_World,     // reliable ordered bulk world data, so big chunk transfers don't hold up chat
+    NetChannel_Count
+};
+
+struct NetDelivery {
+    NetChannel channel {};
+    uint32_t   flags   {};  // ENET_PACKET_FLAG_*
+};
+
 struct NetMessage {
     enum class Type : uint32_t {
         Unknown,
@@ -228,7 +258,9 @@ struct NetMessage {
         ChatMessage,
         Input,
         WorldChunk,
-        TileUpdate,
+        ChunkDiff,
+        ChunkRequest,
+        TileDelta,
         WorldSnapshot,
         GlobalEvent,
         NearbyEvent,
@@ -248,7 +280,9 @@ struct NetMessage {
             case Type::Welcome         : return "Welcome";
             case Type::Input           : return "Input";
             case Type::WorldChunk      : return "WorldChunk";
-            case Type::TileUpdate      : return "TileUpdate";
+            case Type::ChunkDiff       : return "ChunkDiff";
+            case Type::ChunkRequest    : return "ChunkRequest";
+            case Type::TileDelta       : return "TileDelta";
             case Type::WorldSnapshot   : return "WorldSnapshot";
             case Type::GlobalEvent     : return "GlobalEvent";
             case Type::NearbyEvent     : return "NearbyEvent";
@@ -265,8 +299,34 @@ struct NetMessage {
         return NetMessage::TypeString(type);
     }
 
+    // How each message type is sent, both client and server must agree on this
+    static NetDelivery Delivery(Type type)
+    {
+        const NetDelivery realtime { NetChannel_Realtime, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT };
+        const NetDelivery reliable { NetChannel_Reliable, ENET_PACKET_FLAG_RELIABLE };
+        const NetDelivery world    { NetChannel_World,    ENET_PACKET_FLAG_RELIABLE };
+
+        switch (type) {
+            case Type::Input           : return realtime;
+            case Type::WorldSnapshot   : return realtime;
+            // NOTE: Welcome and TileDelta share a channel with the chunk data so that they can't be overtaken by it
+            case Type::Welcome         : return world;
+            case Type::WorldChunk      : return world;
+            case Type::ChunkDiff       : return world;
+            case Type::ChunkRequest    : return world;
+            case Type::TileDelta       : return world;
+            default                    : return reliable;
+        }
+    }
+    NetDelivery Delivery()
+    {
+        return NetMessage::Delivery(type);
+    }
+
     uint32_t connectionToken {};
     Type type = Type::Unknown;
+    // Source (writer) or destination (reader) of a WorldSnapshot's entity records, must be set before serializing one
+    WorldSnapshotRecords *snapshotRecords {};
 
     union {
         NetMessage_Identify        identify;
@@ -274,7 +334,9 @@ struct NetMessage {
         NetMessage_Welcome         welcome;
         NetMessage_Input           input;
         NetMessage_WorldChunk      worldChunk;
-        NetMessage_TileUpdate      tileUpdate;
+        NetMessage_ChunkDiff       chunkDiff;
+        NetMessage_ChunkRequest    chunkRequest;
+        NetMessage_TileDelta       tileDelta;
         WorldSnapshot              worldSnapshot;
         NetMessage_GlobalEvent     globalEvent;
         NetMessage_NearbyEvent     nearbyEvent;
@@ -285,8 +347,13 @@ struct NetMessage {
         NetMessage_TileInteract    tileInteract;
     } data{};
 
+    // Both return # of bytes processed, or 0 on failure. Deserialize fails on malformed input (truncated, values out
+    // of range, etc.), the message must be discarded. For snapshots, records before the bad one were already applied.
     size_t Serialize(uint8_t *buf, size_t len);
     size_t Deserialize(const uint8_t *buf, size_t len);
+    // Overwrite the connection token at the front of an already serialized message, so a message with no other
+    // per-client data can be serialized once and copied to every client
+    static void PatchConnectionToken(uint8_t *buf, size_t len, uint32_t connectionToken);
 
 private:
     const char *LOG_SRC = "NetMessage";
@@ -5,8 +5,8 @@
 #include "users_generated.h"
 #include "raylib/raylib.h"
 #include "dlb_types.h"
+#include <algorithm>
 
-uint8_t NetServer::rawPacket[PACKET_SIZE_MAX];
 
 ErrorType NetServer::SaveUserDB(const char *filename)
 {
@@ -52,15 +52,15 @@ NetServer::NetServer(void)
     SaveUserDB("db/users.dat");
     LoadUserDB("db/users.dat");
 
-    //rawPacket.dataLength = PACKET_SIZE_MAX;
-    //rawPacket.data = calloc(rawPacket.dataLength, sizeof(uint8_t));
+    for (int i = 0; i < SV_MAX_PLAYERS; i++) {
+        bundles[i].pool = &packetPool;
+    }
 }
 
 NetServer::~NetServer(void)
 {
     E_DEBUG("Killing NetServer", 0);
     CloseSocket();
-    //free(rawPacket.data);
     UnloadFileData(fbs_users.data);
 }
 
@@ -72,7 +72,7 @@ ErrorType NetServer::OpenSocket(unsigned short socketPort)
     //address.host = enet_v4_localhost;
     address.port = socketPort;
 
-    server = enet_host_create(&address, SV_MAX_PLAYERS, 1, 0, 0);
+    server = enet_host_create(&address, SV_MAX_PLAYERS, NetChannel_Count, 0, 0);
     while ((!server || !server->socket)) {
         E_ERROR_RETURN(ErrorType::HostCreateFailed, "Failed to create host. Check if port(s) %hu already in use.", socketPort);
     }
@@ -81,7 +81,7 @@ ErrorType NetServer::OpenSocket(unsigned short socketPort)
     return ErrorType::Success;
 }
 
-ErrorType NetServer::SendRaw(const SV_Client &client, const void *data, size_t size)
+ErrorType NetServer::SendRaw(const SV_Client &client, const void *data, size_t size, NetDelivery delivery)
 {
     assert(data);
     assert(size <= PACKET_SIZE_MAX);
@@ -92,42 +92,22 @@ ErrorType NetServer::SendRaw(const SV_Client &client, const void *data, size_t s
 
     assert(client.peer->address.port);
 
-    // TODO(dlb): Don't always use reliable flag.. figure out what actually needs to be reliable (e.g. chat)
-    ENetPacket *packet = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
-    if (!packet) {
-        E_ERROR_RETURN(ErrorType::PacketCreateFailed, "Failed to create packet.", 0);
-    }
-    if (enet_peer_send(client.peer, 0, packet) < 0) {
-        E_ERROR_RETURN(ErrorType::PeerSendFailed, "Failed to send connection request.", 0);
-    }
-    return ErrorType::Success;
+    return Bundle(client).Append(client.peer, (const uint8_t *)data, size, delivery);
 }
 
-ErrorType NetServer::BroadcastRaw(const void *data, size_t size)
+ErrorType NetServer::BroadcastRaw(const void *data, size_t size, NetDelivery delivery)
 {
     assert(data);
     assert(size <= PACKET_SIZE_MAX);
 
     ErrorType err_code = ErrorType::Success;
 
-    // TODO(dlb): Don't always use reliable flag.. figure out what actually needs to be reliable (e.g. chat)
-    ENetPacket *packet = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
-    if (!packet) {
-        E_ERROR_RETURN(ErrorType::PacketCreateFailed, "Failed to create packet.", 0);
-    }
-
     // Broadcast netMsg to all connected clients
     for (int i = 0; i < SV_MAX_PLAYERS; i++) {
-        if (!clients[i].peer || clients[i].peer->state != ENET_PEER_STATE_CONNECTED) { // || !clients[i].playerId) {
-            continue;
-        }
-
-        SV_Client &client = clients[i];
-        assert(client.peer);
-        assert(client.peer->address.port);
-        if (enet_peer_send(client.peer, 0, packet) < 0) {
+        ErrorType result = SendRaw(clients[i], data, size, delivery);
+        if (result != ErrorType::Success) {
             TraceLog(LOG_ERROR, "[NetServer] BROADCAST %u bytes failed", size);
-            err_code = ErrorType::PeerSendFailed;
+            err_code = result;
         }
     }
 
@@ -141,10 +121,8 @@ ErrorType NetServer::SendMsg(const SV_Client &client, NetMessage &message)
     }
 
     message.connectionToken = client.connectionToken;
-    memset(rawPacket, 0, sizeof(rawPacket));
-    size_t bytes = message.Serialize(CSTR0(rawPacket));
 
-    //E_INFO("[SEND][%21s][%5u b] %16s ", SafeTextFormatIP(client.peer->address), rawPacket.dataLength, netMsg.TypeString());
+    //E_INFO("[SEND][%21s] %16s ", SafeTextFormatIP(client.peer->address), netMsg.TypeString());
     if (message.type != NetMessage::Type::WorldSnapshot) {
 #if 0
         const char *subType = "";
@@ -152,26 +130,36 @@ ErrorType NetServer::SendMsg(const SV_Client &client, NetMessage &message)
             case NetMessage::Type::GlobalEvent: subType = message.data.globalEvent.TypeString(); break;
             case NetMessage::Type::NearbyEvent: subType = message.data.nearbyEvent.TypeString(); break;
         }
-        E_DEBUG("[NetServer] Send %s %s (%zu b)", message.TypeString(), subType, bytes);
+        E_DEBUG("[NetServer] Send %s %s", message.TypeString(), subType);
 #endif
     }
 
-    E_ERROR_RETURN(SendRaw(client, rawPacket, bytes), "Failed to send packet", 0);
+    E_ERROR_RETURN(Bundle(client).Append(client.peer, message), "Failed to send packet", 0);
     return ErrorType::Success;
 }
 
-ErrorType NetServer::BroadcastMsg(NetMessage &message, std::function<bool(SV_Client &client)> clientFilter)
+ErrorType NetServer::BroadcastMsg(NetMessage &message, SV_ClientMask recipients)
 {
-    ErrorType err_code = ErrorType::Success;
+    DLB_ASSERT(message.type != NetMessage::Type::WorldSnapshot);
 
-    // Broadcast netMsg to all connected clients
+    message.connectionToken = 0;
+    const size_t size = message.Serialize(broadcastBuf, sizeof(broadcastBuf));
+    if (!size) {
+        E_ERROR_RETURN(ErrorType::Overflow, "Failed to serialize %s broadcast", message.TypeString());
+    }
+    const NetDelivery delivery = message.Delivery();
+
+    ErrorType err_code = ErrorType::Success;
     for (int i = 0; i < SV_MAX_PLAYERS; i++) {
-        SV_Client &client = clients[i];
-        if (!clientFilter || clientFilter(client)) {
-            ErrorType result = SendMsg(clients[i], message);
-            if (result != ErrorType::Success) {
-                err_code = result;
-            }
+        const SV_Client &client = clients[i];
+        if (!(recipients & (1u << i)) || !client.peer || client.peer->state != ENET_PEER_STATE_CONNECTED) {
+            continue;
+        }
+        NetMessage::PatchConnectionToken(broadcastBuf, size, client.connectionToken);
+        ErrorType result = bundles[i].Append(client.peer, broadcastBuf, size, delivery);
+        if (result != ErrorType::Success) {
+            TraceLog(LOG_ERROR, "[NetServer] BROADCAST %s to player %u failed", message.TypeString(), client.playerId);
+            err_code = result;
         }
     }
 
@@ -192,6 +180,8 @@ ErrorType NetServer::SendWelcomeBasket(SV_Client &client)
         welcome.motdLength = (uint32_t)(sizeof("Welcome to The Lonely Island") - 1);
         memcpy(welcome.motd, CSTR("Welcome to The Lonely Island"));
         welcome.playerId = client.playerId;
+        welcome.worldSeed = serverWorld->rtt_seed;
+        welcome.worldGenVer = WORLD_GEN_VERSION;
         welcome.playerCount = 0;
         for (size_t i = 0; i < SV_MAX_PLAYERS; i++) {
             if (!serverWorld->players[i].id)
@@ -296,329 +286,589 @@ ErrorType NetServer::SendWorldChunk(const SV_Client &client, const Chunk &chunk)
     return ErrorType::Success;
 }
 
+ErrorType NetServer::SendChunkDiff(const SV_Client &client, const Chunk &chunk)
+{
+#if SV_DEBUG_WORLD_CHUNKS
+    E_DEBUG("Sending chunk diff [%hd, %hd] to player #%u", chunk.x, chunk.y, client.playerId);
+#endif
+    memset(&netMsg, 0, sizeof(netMsg));
+    netMsg.type = NetMessage::Type::ChunkDiff;
+    ChunkDiff &diff = netMsg.data.chunkDiff.diff;
+    chunk.BuildDiff(diff);
+    if (diff.tileCount > SV_TILE_DELTA_MAX) {
+        // Heavily modified, cheaper to just send the whole thing
+        return SendWorldChunk(client, chunk);
+    }
+    E_ERROR_RETURN(SendMsg(client, netMsg), "Failed to send chunk diff", 0);
+    return ErrorType::Success;
+}
+
 void NetServer::SendNearbyChunks(SV_Client &client)
 {
-    // Send nearby chunks to player if they haven't received them yet
+    // Send nearby chunks to player if they haven't received them yet, or have missed tile deltas since
     const Player *player = serverWorld->FindPlayer(client.playerId);
     if (player) {
         Vector2 playerBC = player->body.GroundPosition();
         const int16_t chunkX = serverWorld->map.CalcChunk(playerBC.x);
         const int16_t chunkY = serverWorld->map.CalcChunk(playerBC.y);
 
-        for (int y = chunkY - 2; y <= chunkY + 2; y++) {
-            for (int x = chunkX - 2; x <= chunkX + 2; x++) {
-                const ChunkHash chunkHash = Chunk::Hash(x, y);
-                if (!client.chunkHistory.contains(chunkHash)) {
-                    const Chunk &chunk = serverWorld->map.FindOrGenChunk(*serverWorld, x, y);
-                    SendWorldChunk(client, chunk);
-                    client.chunkHistory.insert(chunk.Hash());
+        for (int y = chunkY - SV_CHUNK_SEND_RADIUS; y <= chunkY + SV_CHUNK_SEND_RADIUS; y++) {
+            for (int x = chunkX - SV_CHUNK_SEND_RADIUS; x <= chunkX + SV_CHUNK_SEND_RADIUS; x++) {
+                const Chunk &chunk = serverWorld->map.FindOrGenChunk(*serverWorld, x, y);
+                const auto history = client.chunkHistory.find(chunk.Hash());
+                if (history == client.chunkHistory.end() || history->second != chunk.version) {
+                    // Client generates the baseline from the world seed, we only send what's changed since
+                    SendChunkDiff(client, chunk);
+                    client.chunkHistory[chunk.Hash()] = chunk.version;
                 }
             }
         }
     }
 }
 
-ErrorType NetServer::BroadcastTileUpdate(float worldX, float worldY, const Tile &tile)
+void NetServer::BroadcastTileDeltas(void)
 {
-    memset(&netMsg, 0, sizeof(netMsg));
-    netMsg.type = NetMessage::Type::TileUpdate;
-    NetMessage_TileUpdate &tileUpdate = netMsg.data.tileUpdate;
-    tileUpdate.worldX = worldX;
-    tileUpdate.worldY = worldY;
-    tileUpdate.tile = tile;
-
-    // Broadcast to nearby players
-    E_ERROR_RETURN(BroadcastMsg(netMsg, [&](SV_Client &client) {
-        const Player *player = serverWorld->FindPlayer(client.playerId);
-        if (player) {
-            Vector3 playerPos = player->body.WorldPosition();
-            if (v3_distance_sq(playerPos, { worldX, worldY, 0 }) < SQUARED(SV_TILE_UPDATE_DIST)) {
-                E_INFO("Sending tile update to player %d", client.playerId);
-                return true;
+    Tilemap &map = serverWorld->map;
+    for (ChunkHash chunkHash : map.dirtyChunks) {
+        Chunk *chunk = map.FindChunk(chunkHash);
+        DLB_ASSERT(chunk);
+        chunk->version++;
+
+        // Only clients that are in range and exactly one version behind can apply this tick's changes. Anyone
+        // else who knows about the chunk is now stale, and SendNearbyChunks resends the whole thing when they
+        // come back in range.
+        SV_ClientMask recipients = 0;
+        for (int i = 0; i < SV_MAX_PLAYERS; i++) {
+            SV_Client &client = clients[i];
+            const auto history = client.chunkHistory.find(chunkHash);
+            if (history == client.chunkHistory.end() || history->second + 1 != chunk->version) {
+                continue;
+            }
+            const Player *player = serverWorld->FindPlayer(client.playerId);
+            if (!player) {
+                continue;
+            }
+            const Vector2 playerBC = player->body.GroundPosition();
+            if (abs(chunk->x - map.CalcChunk(playerBC.x)) <= SV_CHUNK_SEND_RADIUS &&
+                abs(chunk->y - map.CalcChunk(playerBC.y)) <= SV_CHUNK_SEND_RADIUS)
+            {
+                recipients |= 1u << i;
+                history->second = chunk->version;
             }
         }
-        return false;
-    }), "Failed to broadcast tile update", 0);
 
-    return ErrorType::Success;
+        memset(&netMsg, 0, sizeof(netMsg));
+        netMsg.type = NetMessage::Type::TileDelta;
+        NetMessage_TileDelta &tileDelta = netMsg.data.tileDelta;
+        tileDelta.chunkX = chunk->x;
+        tileDelta.chunkY = chunk->y;
+        tileDelta.version = chunk->version;
+        for (size_t tileIdx = 0; tileIdx < ARRAY_SIZE(chunk->tiles); tileIdx++) {
+            if (chunk->IsDirty(tileIdx)) {
+                TileDelta &delta = tileDelta.tiles[tileDelta.tileCount];
+                delta.index = (uint8_t)tileIdx;
+                delta.tile = chunk->tiles[tileIdx];
+                tileDelta.tileCount++;
+            }
+        }
+        memset(chunk->dirty, 0, sizeof(chunk->dirty));
+        DLB_ASSERT(tileDelta.tileCount);
+
+        if (!recipients) {
+            continue;
+        }
+        if (tileDelta.tileCount > SV_TILE_DELTA_MAX) {
+            // Cheaper to just send the whole chunk
+            memset(&netMsg, 0, sizeof(netMsg));
+            netMsg.type = NetMessage::Type::WorldChunk;
+            netMsg.data.worldChunk.chunk = *chunk;
+        }
+        E_ERROR(BroadcastMsg(netMsg, recipients), "Failed to broadcast chunk [%hd, %hd] changes", chunk->x, chunk->y);
+    }
+    map.dirtyChunks.clear();
 }
 
-ErrorType NetServer::SendWorldSnapshot(SV_Client &client)
+bool SV_Congestion::Congested(const ENetPeer &peer) const
 {
-    assert(client.playerId);
+    // NOTE: Only looks at RTT relative to what this link usually does. A long RTT on its own is just a long way away,
+    // and ENet starts every peer at 500 ms until it has measured a few round trips.
+    const float loss = (float)peer.packetLoss / ENET_PEER_PACKET_LOSS_SCALE;
+    return loss > SV_CONGESTION_LOSS_MAX || peer.roundTripTime > rttLow + SV_CONGESTION_RTT_SLACK;
+}
 
-    memset(&netMsg, 0, sizeof(netMsg));
-    netMsg.type = NetMessage::Type::WorldSnapshot;
-    WorldSnapshot &worldSnapshot = netMsg.data.worldSnapshot;
+void SV_Congestion::Update(const ENetPeer &peer, double now, double dt)
+{
+    const float rtt = (float)peer.roundTripTime;
+    rttLow = rttLow ? MIN(rttLow + SV_CONGESTION_RTT_DRIFT * (float)dt, rtt) : rtt;
+
+    if (Congested(peer)) {
+        // Give the last cut some time to show up in ENet's stats before cutting again
+        if (now - lastBackoffAt >= SV_CONGESTION_BACKOFF_DT) {
+            quality *= 0.5f;
+            lastBackoffAt = now;
+        }
+    } else {
+        quality = MIN(quality + SV_CONGESTION_RECOVERY_RATE * (float)dt, 1.0f);
+    }
 
-    Player *playerPtr = serverWorld->FindPlayer(client.playerId);
-    if (!playerPtr) {
-        TraceLog(LOG_ERROR, "Failed to find player to send world snapshot to");
-        return ErrorType::PlayerNotFound;
+    snapshotBudget = (size_t)LERP((float)SNAPSHOT_BUDGET_MIN, (float)SNAPSHOT_BUDGET_MAX, quality);
+    snapshotInterval = LERP(SNAPSHOT_SEND_DT_MAX, SNAPSHOT_SEND_DT, quality);
+}
+
+// Entities entering or leaving the client's vicinity go ahead of everything else. Everything else the client knows
+// about gains priority every snapshot it waits, faster the closer it is and the further it has moved since the client
+// last heard about it. It never gains nothing, so even far away entities in a crowd get their turn eventually.
+template <typename T>
+static float SV_AccumulatePriority(SV_EntityHistory<T> *history, float distSq, float nearbyThreshold, Vector3 position)
+{
+    const float SPAWN_PRIORITY = 1000000.0f;
+    const float proximity = 1.0f - MIN(sqrtf(distSq) / nearbyThreshold, 1.0f);
+    if (!history || (history->state.flags & T::Flags_Despawn) || distSq > SQUARED(nearbyThreshold)) {
+        return SPAWN_PRIORITY + proximity;
     }
-    Player &player = *playerPtr;
+    const float moved = v3_length(v3_sub(position, history->state.position)) / METERS_TO_PIXELS(1.0f);
+    history->priority += 0.1f + proximity + moved;
+    return history->priority;
+}
 
-    worldSnapshot.tick = serverWorld->tick;
-    worldSnapshot.clock = g_clock.now;
-    worldSnapshot.lastInputAck = client.lastInputAck;
-    worldSnapshot.inputOverflow = client.inputOverflow;
+void SV_SnapshotEncoder::Queue(const NPC &npc, float distSq)
+{
+    const auto history = client.npcHistory.find(npc.id);
+    SV_EntityHistory<NpcSnapshot> *lastSent = history != client.npcHistory.end() ? &history->second : 0;
+    if (lastSent) {
+        lastSent->queuedTick = tick;
+    }
+    if (lastSent || distSq <= SQUARED(SV_NPC_NEARBY_THRESHOLD)) {
+        const float priority = SV_AccumulatePriority(lastSent, distSq, SV_NPC_NEARBY_THRESHOLD, npc.body.WorldPosition());
+        queue.candidates.push_back({ npc, priority });
+    }
+}
+
+void SV_SnapshotEncoder::Queue(const WorldItem &item, float distSq)
+{
+    const auto history = client.itemHistory.find(item.euid);
+    SV_EntityHistory<ItemSnapshot> *lastSent = history != client.itemHistory.end() ? &history->second : 0;
+    if (lastSent) {
+        lastSent->queuedTick = tick;
+    }
+    if (lastSent || distSq <= SQUARED(SV_ITEM_NEARBY_THRESHOLD)) {
+        const float priority = SV_AccumulatePriority(lastSent, distSq, SV_ITEM_NEARBY_THRESHOLD, item.body.WorldPosition());
+        queue.candidates.push_back({ item, priority });
+    }
+}
 
-    // TODO: Find players/slimes/etc. that are actually near the player this snapshot is being generated for
-    worldSnapshot.playerCount = 0;
-    for (const Player &otherPlayer : serverWorld->players) {
+void SV_SnapshotEncoder::Prioritize(void)
+{
+    queue.candidates.clear();
+    skipped = 0;
+
+    // There are only a handful of players, check them all. Anything nearby, plus anything the client still has
+    // history for, which may need a despawn.
+    for (const Player &otherPlayer : world.players) {
         if (!otherPlayer.id) {
             continue;
         }
-        if (worldSnapshot.playerCount == ARRAY_SIZE(worldSnapshot.players)) {
-            TraceLog(LOG_ERROR, "Snapshot full, skipping player!");
-            break;
+        if (otherPlayer.id == player.id) {
+            queue.candidates.push_back({ otherPlayer, FLT_MAX });
+            continue;
         }
+        const float distSq = v2_length_sq(v2_sub(player.body.GroundPosition(), otherPlayer.body.GroundPosition()));
+        const auto history = client.playerHistory.find(otherPlayer.id);
+        SV_EntityHistory<PlayerSnapshot> *lastSent = history != client.playerHistory.end() ? &history->second : 0;
+        if (lastSent || distSq <= SQUARED(SV_PLAYER_NEARBY_THRESHOLD)) {
+            const float priority = SV_AccumulatePriority(lastSent, distSq, SV_PLAYER_NEARBY_THRESHOLD, otherPlayer.body.WorldPosition());
+            queue.candidates.push_back({ otherPlayer, priority });
+        }
+    }
 
-        uint32_t flags = PlayerSnapshot::Flags_None;
-        if (otherPlayer.id == player.id) {
-            // Always send player's entire state to to themselves
-            // This could be smarter, but if we don't do it, then ReconcilePlayer() can get
-            // desync'd from snapshot frequency and "miss" things like teleport events.
-            flags = PlayerSnapshot::Flags_Owner;
-            if (player.inventory.dirty) {
-                flags |= PlayerSnapshot::Flags_Inventory;
-                player.inventory.dirty = false;
-            }
-        } else {
-            // TODO: Make despawn threshold > spawn threshold to prevent spam on event horizon
-            const float distSq = v2_length_sq(v2_sub(player.body.GroundPosition(), otherPlayer.body.GroundPosition()));
-            const bool nearby = !otherPlayer.despawnedAt && distSq <= SQUARED(SV_PLAYER_NEARBY_THRESHOLD);
-            const auto prevState = client.playerHistory.find(otherPlayer.id);
-            const bool clientAware = prevState != client.playerHistory.end();
-
-            if (nearby) {
-                if (!clientAware) {
-                    // Send full state if client isn't tracking this entity yet
-                    flags = PlayerSnapshot::Flags_Spawn;
-                    #if SV_DEBUG_WORLD_PLAYERS
-                        E_DEBUG("Entered vicinity of player #%u", otherPlayer.id);
-                    #endif
-                } else {
-                    // Send delta updates for puppets that the client already knows about
-                    if (!v3_equal(otherPlayer.body.WorldPosition(), prevState->second.position, POSITION_EPSILON)) {
-                        flags |= PlayerSnapshot::Flags_Position;
-                    }
-                    if (otherPlayer.sprite.direction != prevState->second.direction) {
-                        flags |= PlayerSnapshot::Flags_Direction;
-                    }
-                    if (!otherPlayer.combat.hitPoints || (otherPlayer.combat.hitPoints != prevState->second.hitPoints)) {
-                        flags |= PlayerSnapshot::Flags_Health;
-                    }
-                    if (otherPlayer.combat.hitPointsMax != prevState->second.hitPointsMax) {
-                        flags |= PlayerSnapshot::Flags_HealthMax;
-                    }
-                    if (otherPlayer.combat.level != prevState->second.level) {
-                        flags |= PlayerSnapshot::Flags_Level;
-                    }
-                }
-            } else if (clientAware) {
-                if (!(prevState->second.flags & PlayerSnapshot::Flags_Despawn)) {
-                    // Send despawn notification
-                    flags |= PlayerSnapshot::Flags_Despawn;
-                    #if SV_DEBUG_WORLD_PLAYERS
-                        E_DEBUG("Left vicinity of player #%u", otherPlayer.id);
-                    #endif
-                } else {
-                    // "Despawn" notification already sent, fogetaboutit
-                    client.playerHistory.erase(otherPlayer.id);
-                }
+    // Npcs and items that are nearby can only be in the chunks around the player
+    const Vector3 origin = player.body.WorldPosition();
+    Chunk *nearbyChunks[SV_NEARBY_CHUNKS_MAX]{};
+    const size_t nearbyChunkCount = world.map.FindNearbyChunks(player.body.GroundPosition(),
+        MAX(SV_NPC_NEARBY_THRESHOLD, SV_ITEM_NEARBY_THRESHOLD), nearbyChunks, ARRAY_SIZE(nearbyChunks));
+    for (size_t chunkIdx = 0; chunkIdx < nearbyChunkCount; chunkIdx++) {
+        for (const NPC *npc = nearbyChunks[chunkIdx]->npcs.head; npc; npc = npc->chunkNode.next) {
+            if (npc->id) {
+                Queue(*npc, v3_length_sq(v3_sub(origin, npc->body.WorldPosition())));
             }
         }
-
-        if (flags) {
-             #if SV_DEBUG_WORLD_PLAYERS
-                E_DEBUG("Client aware of player #%u, flags sent: %s", otherPlayer.id, PlayerSnapshot::FlagStr(flags));
-            #endif
-
-            // TODO: Let Player class serialize itself by storing a reference in the Snapshot, then
-            // having NetMessage::Process call a serialize method and forwarding the BitStream
-            // and state flags to it.
-            PlayerSnapshot &state = client.playerHistory[otherPlayer.id];
-            state.flags = flags;
-            state.id = otherPlayer.id;
-            state.position = otherPlayer.body.WorldPosition();
-            state.direction = otherPlayer.sprite.direction;
-            state.speed = otherPlayer.body.speed;
-            state.hitPoints = otherPlayer.combat.hitPoints;
-            state.hitPointsMax = otherPlayer.combat.hitPointsMax;
-            state.level = otherPlayer.combat.level;
-            state.xp = otherPlayer.xp;
-            state.inventory = otherPlayer.inventory;
-
-            worldSnapshot.players[worldSnapshot.playerCount] = state;
-            worldSnapshot.playerCount++;
+        for (const WorldItem *item = nearbyChunks[chunkIdx]->items.head; item; item = item->chunkNode.next) {
+            if (item->euid) {
+                Queue(*item, v3_length_sq(v3_sub(origin, item->body.WorldPosition())));
+            }
         }
     }
 
-    worldSnapshot.npcCount = 0;
-    uint32_t skippedNpcCount = 0;
-    for (int type = NPC::Type_None + 1; type < NPC::Type_Count; type++) {
-        NpcList npcList = serverWorld->npcs.byType[type];
-        for (size_t i = 0; i < npcList.length; i++) {
-            NPC &npc = npcList.data[i];
-            if (!npc.id) {
+    // Anything else the client has history for has left the vicinity, or the world. FindNpc is a linear search, but
+    // there are only ever a few of these, waiting on a despawn ack.
+    for (auto history = client.npcHistory.begin(); history != client.npcHistory.end();) {
+        if (history->second.queuedTick != tick) {
+            const NPC *npc = world.FindNpc(history->first);
+            if (!npc) {
+                history = client.npcHistory.erase(history);
                 continue;
             }
-            DLB_ASSERT(npc.type);
-            if (worldSnapshot.npcCount == ARRAY_SIZE(worldSnapshot.npcs)) {
-                skippedNpcCount++;
+            Queue(*npc, v3_length_sq(v3_sub(origin, npc->body.WorldPosition())));
+        }
+        history++;
+    }
+    for (auto history = client.itemHistory.begin(); history != client.itemHistory.end();) {
+        if (history->second.queuedTick != tick) {
+            const WorldItem *item = world.itemSystem.Find(history->first);
+            if (!item) {
+                history = client.itemHistory.erase(history);
                 continue;
             }
+            Queue(*item, v3_length_sq(v3_sub(origin, item->body.WorldPosition())));
+        }
+        history++;
+    }
 
-            uint32_t flags = NpcSnapshot::Flags_None;
-            const float distSq = v3_length_sq(v3_sub(player.body.WorldPosition(), npc.body.WorldPosition()));
-            const bool nearby = !npc.despawnedAt && distSq <= SQUARED(SV_NPC_NEARBY_THRESHOLD);
-            const auto prevState = client.npcHistory.find(npc.id);
-            const bool clientAware = prevState != client.npcHistory.end();
-
-            if (nearby) {
-                if (!clientAware) {
-                    // Send full state if client isn't tracking this entity yet
-                    flags = NpcSnapshot::Flags_Spawn;
-                    #if SV_DEBUG_WORLD_NPCS
-                        E_DEBUG("Entered vicinity of npc #%u", npc.id);
-                    #endif
-                } else {
-                    // Send delta updates for puppets that the client already knows about
-                    if (strncmp(prevState->second.name, npc.name, npc.nameLength)) {
-                        // TODO: Make NameChangeEvent if it ever actually needs to be updated.. or shared string table
-                        flags |= NpcSnapshot::Flags_Name;
-                    }
-                    if (!v3_equal(npc.body.WorldPosition(), prevState->second.position, POSITION_EPSILON)) {
-                        flags |= NpcSnapshot::Flags_Position;
-                    }
-                    if (npc.sprite.direction != prevState->second.direction) {
-                        flags |= NpcSnapshot::Flags_Direction;
-                    }
-                    if (npc.sprite.scale != prevState->second.scale) {
-                        flags |= NpcSnapshot::Flags_Scale;
-                    }
-                    if (npc.combat.hitPoints != prevState->second.hitPoints) {
-                        flags |= NpcSnapshot::Flags_Health;
-                    }
-                    if (npc.combat.hitPointsMax != prevState->second.hitPointsMax) {
-                        flags |= NpcSnapshot::Flags_HealthMax;
-                    }
-                }
-            } else if (clientAware) {
-                if (!(prevState->second.flags & NpcSnapshot::Flags_Despawn)) {
-                    // Send despawn notification
-                    flags = NpcSnapshot::Flags_Despawn;
-                    #if SV_DEBUG_WORLD_NPCS
-                        E_DEBUG("Left vicinity of npc #%u", npc.id);
-                    #endif
-                } else {
-                    // "Despawn" notification already sent, fogetaboutit
-                    client.npcHistory.erase(npc.id);
-                }
-            }
+    // Only the top of the queue goes out when the budget is tight, so don't bother sorting all of it
+    std::make_heap(queue.candidates.begin(), queue.candidates.end());
+}
 
-            if (flags) {
-                #if SV_DEBUG_WORLD_NPCS
-                    E_DEBUG("Client aware of npc #%u, flags sent: %s", npc.id, NpcSnapshot::FlagStr(flags));
-                #endif
+size_t SV_SnapshotEncoder::Deferred(void) const
+{
+    return queue.candidates.size() + skipped;
+}
 
-                // TODO: Let Enemy serialize itself by storing a reference in the Snapshot, then
-                // having NetMessage::Process call a serialize method and forwarding the BitStream
-                // and state flags to it.
-                NpcSnapshot &state = client.npcHistory[npc.id];
-                state.flags = flags;
-                state.id = npc.id;
-                state.type = npc.type;
-                state.nameLength = npc.nameLength;
-                strncpy(state.name, npc.name, MIN(npc.nameLength, ENTITY_NAME_LENGTH_MAX));
-                state.position = npc.body.WorldPosition();
-                state.direction = npc.sprite.direction;
-                state.scale = npc.sprite.scale;
-                state.hitPoints = npc.combat.hitPoints;
-                state.hitPointsMax = npc.combat.hitPointsMax;
-                state.level = npc.combat.level;
-
-                worldSnapshot.npcs[worldSnapshot.npcCount] = state;
-                worldSnapshot.npcCount++;
-                //E_DEBUG("SS NPC #%u %s", npc.id, NpcSnapshot::FlagStr(flags));
-            }
-        }
+// Client is up to date on this entity now, whether it had anything to send or not
+template <typename K, typename T>
+void SV_SnapshotEncoder::Updated(std::unordered_map<K, SV_EntityHistory<T>> &histories, K id)
+{
+    const auto history = histories.find(id);
+    if (history == histories.end()) {
+        return;
     }
-    if (skippedNpcCount) {
-        E_WARN("Snapshot full, skipped %u enemies", skippedNpcCount);
+    SV_EntityHistory<T> &entity = history->second;
+    if (entity.updatedTick) {
+        SV_SnapshotStats &stats = client.snapshotStats;
+        const uint32_t staleTicks = tick - entity.updatedTick;
+        stats.updates++;
+        stats.staleTicks += staleTicks;
+        stats.staleTicksMax = MAX(stats.staleTicksMax, staleTicks);
     }
+    entity.priority = 0;
+    entity.updatedTick = tick;
+}
 
-    worldSnapshot.itemCount = 0;
-    uint32_t skippedItemCount = 0;
-    //for (size_t i = 0; i < serverWorld->itemSystem.itemsCount && worldSnapshot.itemCount < ARRAY_SIZE(worldSnapshot.items); i++) {
-    for (const WorldItem &item : serverWorld->itemSystem.worldItems) {
-        if (!item.euid) {
+WorldSnapshotRecord SV_SnapshotEncoder::Next(size_t room)
+{
+    WorldSnapshotRecord record{};
+    // Nothing smaller than an item, don't pop the rest of the queue just to skip it
+    while (room >= SNAPSHOT_ITEM_SIZE_MAX && queue.candidates.size()) {
+        std::pop_heap(queue.candidates.begin(), queue.candidates.end());
+        const SV_SnapshotCandidate candidate = queue.candidates.back();
+        queue.candidates.pop_back();
+
+        // Too big for what's left, wait for the next snapshot, but smaller ones might still fit
+        if (WorldSnapshotRecord::SizeMax(candidate.type) > room) {
+            skipped++;
             continue;
         }
-        if (worldSnapshot.itemCount == ARRAY_SIZE(worldSnapshot.items)) {
-            skippedItemCount++;
-            continue;
+
+        record.type = candidate.type;
+        switch (candidate.type) {
+            case SnapshotRecordType::Player: {
+                record.player = Encode(*candidate.player);
+                Updated(client.playerHistory, candidate.player->id);
+                if (record.player) {
+                    return record;
+                }
+                break;
+            } case SnapshotRecordType::Npc: {
+                record.npc = Encode(*candidate.npc);
+                Updated(client.npcHistory, candidate.npc->id);
+                if (record.npc) {
+                    return record;
+                }
+                break;
+            } case SnapshotRecordType::Item: {
+                record.item = Encode(*candidate.item);
+                Updated(client.itemHistory, candidate.item->euid);
+                if (record.item) {
+                    return record;
+                }
+                break;
+            } default: {
+                DLB_ASSERT(!"Unexpected snapshot candidate type");
+            }
         }
+    }
+    return {};
+}
 
-        uint32_t flags = ItemSnapshot::Flags_None;
-        const float distSq = v3_length_sq(v3_sub(player.body.WorldPosition(), item.body.WorldPosition()));
-        const bool nearby = item.stack.count && distSq <= SQUARED(SV_ITEM_NEARBY_THRESHOLD);
-        const auto prevState = client.itemHistory.find(item.euid);
-        const bool clientAware = prevState != client.itemHistory.end();
+PlayerSnapshot *SV_SnapshotEncoder::Encode(const Player &otherPlayer)
+{
+    uint32_t flags = PlayerSnapshot::Flags_None;
+    if (otherPlayer.id == player.id) {
+        // Always send player's entire state to to themselves
+        // This could be smarter, but if we don't do it, then ReconcilePlayer() can get
+        // desync'd from snapshot frequency and "miss" things like teleport events.
+        uint32_t changed = PlayerSnapshot::Flags_Owner;
+        if (player.inventory.dirty) {
+            changed |= PlayerSnapshot::Flags_Inventory;
+            player.inventory.dirty = false;
+        }
+        flags = client.playerHistory[otherPlayer.id].Resolve(changed, client.lastSnapshotAck, tick);
+    } else {
+        // TODO: Make despawn threshold > spawn threshold to prevent spam on event horizon
+        const float distSq = v2_length_sq(v2_sub(player.body.GroundPosition(), otherPlayer.body.GroundPosition()));
+        const bool nearby = !otherPlayer.despawnedAt && distSq <= SQUARED(SV_PLAYER_NEARBY_THRESHOLD);
+        const auto prevState = client.playerHistory.find(otherPlayer.id);
+        const bool hasHistory = prevState != client.playerHistory.end();
+        const bool clientAware = hasHistory && !(prevState->second.state.flags & PlayerSnapshot::Flags_Despawn);
 
         if (nearby) {
             if (!clientAware) {
                 // Send full state if client isn't tracking this entity yet
-                flags = ItemSnapshot::Flags_Spawn;
-                #if SV_DEBUG_WORLD_ITEMS
-                    E_DEBUG("Entered vicinity of item #%u", item.uid);
+                SV_EntityHistory<PlayerSnapshot> &history = client.playerHistory[otherPlayer.id];
+                history = {};
+                flags = history.Resolve(PlayerSnapshot::Flags_Spawn, client.lastSnapshotAck, tick);
+                #if SV_DEBUG_WORLD_PLAYERS
+                    E_DEBUG("Entered vicinity of player #%u", otherPlayer.id);
                 #endif
             } else {
                 // Send delta updates for puppets that the client already knows about
-                if (!v3_equal(item.body.WorldPosition(), prevState->second.position, POSITION_EPSILON)) {
-                    flags |= ItemSnapshot::Flags_Position;
+                const PlayerSnapshot &prev = prevState->second.state;
+                uint32_t changed = PlayerSnapshot::Flags_None;
+                if (!v3_equal(otherPlayer.body.WorldPosition(), prev.position, POSITION_EPSILON)) {
+                    changed |= PlayerSnapshot::Flags_Position;
+                }
+                if (otherPlayer.sprite.direction != prev.direction) {
+                    changed |= PlayerSnapshot::Flags_Direction;
+                }
+                if (!otherPlayer.combat.hitPoints || (otherPlayer.combat.hitPoints != prev.hitPoints)) {
+                    changed |= PlayerSnapshot::Flags_Health;
                 }
-                if (item.stack.uid != prevState->second.itemUid) {
-                    flags |= ItemSnapshot::Flags_ItemUid;
+                if (otherPlayer.combat.hitPointsMax != prev.hitPointsMax) {
+                    changed |= PlayerSnapshot::Flags_HealthMax;
                 }
-                if (item.stack.count != prevState->second.stackCount) {
-                    flags |= ItemSnapshot::Flags_StackCount;
+                if (otherPlayer.combat.level != prev.level) {
+                    changed |= PlayerSnapshot::Flags_Level;
                 }
+                flags = prevState->second.Resolve(changed, client.lastSnapshotAck, tick);
             }
-        } else if (clientAware) {
-            if (!(prevState->second.flags & ItemSnapshot::Flags_Despawn)) {
-                // Send despawn notification
-                flags |= ItemSnapshot::Flags_Despawn;
-                #if SV_DEBUG_WORLD_ITEMS
-                    E_DEBUG("Left vicinity of item #%u", item.uid);
-                #endif
+        } else if (hasHistory) {
+            SV_EntityHistory<PlayerSnapshot> &history = prevState->second;
+            if (!clientAware && history.Acked(client.lastSnapshotAck)) {
+                // "Despawn" notification received by client, fogetaboutit
+                client.playerHistory.erase(prevState);
             } else {
-                // "Despawn" notification already sent, fogetaboutit
-                client.itemHistory.erase(item.euid);
+                // Send despawn notification, until the client acks it
+                #if SV_DEBUG_WORLD_PLAYERS
+                    if (clientAware) E_DEBUG("Left vicinity of player #%u", otherPlayer.id);
+                #endif
+                history.pendingFlags &= PlayerSnapshot::Flags_Despawn;
+                flags = history.Resolve(PlayerSnapshot::Flags_Despawn, client.lastSnapshotAck, tick);
+            }
+        }
+    }
+
+    if (flags) {
+         #if SV_DEBUG_WORLD_PLAYERS
+            E_DEBUG("Client aware of player #%u, flags sent: %s", otherPlayer.id, PlayerSnapshot::FlagStr(flags));
+        #endif
+
+        PlayerSnapshot &state = client.playerHistory[otherPlayer.id].state;
+        state.flags = flags;
+        state.id = otherPlayer.id;
+        state.position = otherPlayer.body.WorldPosition();
+        state.direction = otherPlayer.sprite.direction;
+        state.speed = otherPlayer.body.speed;
+        state.hitPoints = otherPlayer.combat.hitPoints;
+        state.hitPointsMax = otherPlayer.combat.hitPointsMax;
+        state.level = otherPlayer.combat.level;
+        state.xp = otherPlayer.xp;
+        state.inventory = otherPlayer.inventory;
+        return &state;
+    }
+    return 0;
+}
+
+NpcSnapshot *SV_SnapshotEncoder::Encode(const NPC &npc)
+{
+    DLB_ASSERT(npc.type);
+
+    uint32_t flags = NpcSnapshot::Flags_None;
+    const float distSq = v3_length_sq(v3_sub(player.body.WorldPosition(), npc.body.WorldPosition()));
+    const bool nearby = !npc.despawnedAt && distSq <= SQUARED(SV_NPC_NEARBY_THRESHOLD);
+    const auto prevState = client.npcHistory.find(npc.id);
+    const bool hasHistory = prevState != client.npcHistory.end();
+    const bool clientAware = hasHistory && !(prevState->second.state.flags & NpcSnapshot::Flags_Despawn);
+
+    if (nearby) {
+        if (!clientAware) {
+            // Send full state if client isn't tracking this entity yet
+            SV_EntityHistory<NpcSnapshot> &history = client.npcHistory[npc.id];
+            history = {};
+            flags = history.Resolve(NpcSnapshot::Flags_Spawn, client.lastSnapshotAck, tick);
+            #if SV_DEBUG_WORLD_NPCS
+                E_DEBUG("Entered vicinity of npc #%u", npc.id);
+            #endif
+        } else {
+            // Send delta updates for puppets that the client already knows about
+            const NpcSnapshot &prev = prevState->second.state;
+            uint32_t changed = NpcSnapshot::Flags_None;
+            if (strncmp(prev.name, npc.name, npc.nameLength)) {
+                // TODO: Make NameChangeEvent if it ever actually needs to be updated.. or shared string table
+                changed |= NpcSnapshot::Flags_Name;
+            }
+            if (!v3_equal(npc.body.WorldPosition(), prev.position, POSITION_EPSILON)) {
+                changed |= NpcSnapshot::Flags_Position;
+            }
+            if (npc.sprite.direction != prev.direction) {
+                changed |= NpcSnapshot::Flags_Direction;
+            }
+            if (npc.sprite.scale != prev.scale) {
+                changed |= NpcSnapshot::Flags_Scale;
             }
+            if (npc.combat.hitPoints != prev.hitPoints) {
+                changed |= NpcSnapshot::Flags_Health;
+            }
+            if (npc.combat.hitPointsMax != prev.hitPointsMax) {
+                changed |= NpcSnapshot::Flags_HealthMax;
+            }
+            flags = prevState->second.Resolve(changed, client.lastSnapshotAck, tick);
         }
+    } else if (hasHistory) {
+        SV_EntityHistory<NpcSnapshot> &history = prevState->second;
+        if (!clientAware && history.Acked(client.lastSnapshotAck)) {
+            // "Despawn" notification received by client, fogetaboutit
+            client.npcHistory.erase(prevState);
+        } else {
+            // Send despawn notification, until the client acks it
+            #if SV_DEBUG_WORLD_NPCS
+                if (clientAware) E_DEBUG("Left vicinity of npc #%u", npc.id);
+            #endif
+            history.pendingFlags &= NpcSnapshot::Flags_Despawn;
+            flags = history.Resolve(NpcSnapshot::Flags_Despawn, client.lastSnapshotAck, tick);
+        }
+    }
+
+    if (flags) {
+        #if SV_DEBUG_WORLD_NPCS
+            E_DEBUG("Client aware of npc #%u, flags sent: %s", npc.id, NpcSnapshot::FlagStr(flags));
+        #endif
+
+        NpcSnapshot &state = client.npcHistory[npc.id].state;
+        state.flags = flags;
+        state.id = npc.id;
+        state.type = npc.type;
+        state.nameLength = npc.nameLength;
+        strncpy(state.name, npc.name, MIN(npc.nameLength, ENTITY_NAME_LENGTH_MAX));
+        state.position = npc.body.WorldPosition();
+        state.direction = npc.sprite.direction;
+        state.scale = npc.sprite.scale;
+        state.hitPoints = npc.combat.hitPoints;
+        state.hitPointsMax = npc.combat.hitPointsMax;
+        state.level = npc.combat.level;
+        //E_DEBUG("SS NPC #%u %s", npc.id, NpcSnapshot::FlagStr(flags));
+        return &state;
+    }
+    return 0;
+}
 
-        if (flags) {
-            // TODO: Let Item serialize itself by storing a reference in the Snapshot, then
-            // having NetMessage::Process call a serialize method and forwarding the BitStream
-            // and state flags to it.
-            ItemSnapshot &state = client.itemHistory[item.euid];
-            state.flags = flags;
-            state.id = item.euid;
-            state.position = item.body.WorldPosition();
-            state.itemUid = item.stack.uid;
-            state.stackCount = item.stack.count;
-
-            worldSnapshot.items[worldSnapshot.itemCount] = state;
-            worldSnapshot.itemCount++;
+ItemSnapshot *SV_SnapshotEncoder::Encode(const WorldItem &item)
+{
+    uint32_t flags = ItemSnapshot::Flags_None;
+    const float distSq = v3_length_sq(v3_sub(player.body.WorldPosition(), item.body.WorldPosition()));
+    const bool nearby = item.stack.count && distSq <= SQUARED(SV_ITEM_NEARBY_THRESHOLD);
+    const auto prevState = client.itemHistory.find(item.euid);
+    const bool hasHistory = prevState != client.itemHistory.end();
+    const bool clientAware = hasHistory && !(prevState->second.state.flags & ItemSnapshot::Flags_Despawn);
+
+    if (nearby) {
+        if (!clientAware) {
+            // Send full state if client isn't tracking this entity yet
+            SV_EntityHistory<ItemSnapshot> &history = client.itemHistory[item.euid];
+            history = {};
+            flags = history.Resolve(ItemSnapshot::Flags_Spawn, client.lastSnapshotAck, tick);
+            #if SV_DEBUG_WORLD_ITEMS
+                E_DEBUG("Entered vicinity of item #%u", item.uid);
+            #endif
+        } else {
+            // Send delta updates for puppets that the client already knows about
+            const ItemSnapshot &prev = prevState->second.state;
+            uint32_t changed = ItemSnapshot::Flags_None;
+            if (!v3_equal(item.body.WorldPosition(), prev.position, POSITION_EPSILON)) {
+                changed |= ItemSnapshot::Flags_Position;
+            }
+            if (item.stack.uid != prev.itemUid) {
+                changed |= ItemSnapshot::Flags_ItemUid;
+            }
+            if (item.stack.count != prev.stackCount) {
+                changed |= ItemSnapshot::Flags_StackCount;
+            }
+            flags = prevState->second.Resolve(changed, client.lastSnapshotAck, tick);
         }
+    } else if (hasHistory) {
+        SV_EntityHistory<ItemSnapshot> &history = prevState->second;
+        if (!clientAware && history.Acked(client.lastSnapshotAck)) {
+            // "Despawn" notification received by client, fogetaboutit
+            client.itemHistory.erase(prevState);
+        } else {
+            // Send despawn notification, until the client acks it
+            #if SV_DEBUG_WORLD_ITEMS
+                if (clientAware) E_DEBUG("Left vicinity of item #%u", item.uid);
+            #endif
+            history.pendingFlags &= ItemSnapshot::Flags_Despawn;
+            flags = history.Resolve(ItemSnapshot::Flags_Despawn, client.lastSnapshotAck, tick);
+        }
+    }
+
+    if (flags) {
+        ItemSnapshot &state = client.itemHistory[item.euid].state;
+        state.flags = flags;
+        state.id = item.euid;
+        state.position = item.body.WorldPosition();
+        state.itemUid = item.stack.uid;
+        state.stackCount = item.stack.count;
+        return &state;
     }
-    if (skippedItemCount) {
-        E_WARN("Snapshot full, skipped %u world items", skippedItemCount);
+    return 0;
+}
+
+ErrorType NetServer::SendWorldSnapshot(SV_Client &client)
+{
+    assert(client.playerId);
+
+    Player *playerPtr = serverWorld->FindPlayer(client.playerId);
+    if (!playerPtr) {
+        TraceLog(LOG_ERROR, "Failed to find player to send world snapshot to");
+        return ErrorType::PlayerNotFound;
+    }
+    Player &player = *playerPtr;
+
+    // Only the header lives in the message, entity records are encoded straight from the world as it's serialized,
+    // so don't bother clearing the whole union.
+    netMsg.type = NetMessage::Type::WorldSnapshot;
+    WorldSnapshot &worldSnapshot = netMsg.data.worldSnapshot;
+    worldSnapshot = {};
+    worldSnapshot.tick = serverWorld->tick;
+    worldSnapshot.clock = g_clock.now;
+    worldSnapshot.lastInputAck = client.lastInputAck;
+    worldSnapshot.inputOverflow = client.inputOverflow;
+
+    SV_SnapshotEncoder encoder{ *serverWorld, client, player, snapshotQueue, worldSnapshot.tick };
+    encoder.Prioritize();
+    encoder.budget = client.congestion.snapshotBudget;
+    netMsg.snapshotRecords = &encoder;
+    const ErrorType err = SendMsg(client, netMsg);
+    netMsg.snapshotRecords = 0;
+    E_ERROR_RETURN(err, "Failed to send world snapshot", 0);
+
+    SV_SnapshotStats &stats = client.snapshotStats;
+    stats.snapshots++;
+    stats.deferred += encoder.Deferred();
+#if SV_DEBUG_SNAPSHOT_STATS
+    if (stats.snapshots % SV_TICK_RATE == 0) {
+        E_DEBUG("Player #%u snapshots: %u, deferred: %.1f/snapshot, stale ticks: %.1f avg, %u max", client.playerId,
+            stats.snapshots, (float)stats.deferred / stats.snapshots, stats.StaleTicksAvg(), stats.staleTicksMax);
     }
+#endif
 
-    E_ERROR_RETURN(SendMsg(client, netMsg), "Failed to send world snapshot", 0);
     client.lastSnapshotSentAt = g_clock.now;
     return ErrorType::Success;
 }
@@ -1055,11 +1305,28 @@ bool NetServer::ParseCommand(SV_Client &client, NetMessage_ChatMessage &chatMsg)
 }
 
 void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
+{
+    NetBundleReader reader(packet.data, packet.dataLength);
+    const uint8_t *data = 0;
+    size_t length = 0;
+    // Stop early if one of the messages got the client removed (e.g. failed login)
+    const ENetPeer *peer = client.peer;
+    while (client.peer == peer && reader.Next(&data, &length)) {
+        ProcessMsg(client, data, length);
+    }
+}
+
+void NetServer::ProcessMsg(SV_Client &client, const uint8_t *data, size_t length)
 {
     assert(serverWorld);
 
     memset(&netMsg, 0, sizeof(netMsg));
-    netMsg.Deserialize(packet.data, packet.dataLength);
+    if (!netMsg.Deserialize(data, length)) {
+        // Legit clients never send these, so don't bother trying to make sense of anything else they send
+        E_WARN("Malformed message from %s, disconnecting", SafeTextFormatIP(client.peer->address));
+        RemoveClient(client.peer);
+        return;
+    }
 
     if (netMsg.type != NetMessage::Type::Identify &&
         netMsg.connectionToken != client.connectionToken)
@@ -1142,6 +1409,7 @@ void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
             player->inventory.slots[14].stack = { silverCoin, 50 };
             player->inventory.slots[15].stack = { silverCoin, 60 };
             player->inventory.slots[16].stack = { silverCoin, 70 };
+            player->inventory.RetainItems();
 
             SendWelcomeBasket(client);
             break;
@@ -1163,6 +1431,9 @@ void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
             break;
         } case NetMessage::Type::Input: {
             NetMessage_Input &input = netMsg.data.input;
+            if (input.lastSnapshotTick <= serverWorld->tick) {
+                client.lastSnapshotAck = MAX(client.lastSnapshotAck, input.lastSnapshotTick);
+            }
             if (input.sampleCount <= CL_INPUT_SAMPLES_MAX) {
                 for (size_t i = 0; i < input.sampleCount; i++) {
                     InputSample &sample = input.samples[i];
@@ -1213,6 +1484,18 @@ void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
                 }
             }
             break;
+         } case NetMessage::Type::ChunkRequest: {
+            // NOTE: Copy, SendWorldChunk clobbers netMsg
+            const NetMessage_ChunkRequest chunkRequest = netMsg.data.chunkRequest;
+
+            // Only send chunks that already exist, clients don't get to make us generate the whole world
+            Chunk *chunk = serverWorld->map.FindChunk(Chunk::Hash(chunkRequest.chunkX, chunkRequest.chunkY));
+            if (chunk) {
+                E_WARN("Player #%u requested full chunk [%hd, %hd]", client.playerId, chunk->x, chunk->y);
+                SendWorldChunk(client, *chunk);
+                client.chunkHistory[chunk->Hash()] = chunk->version;
+            }
+            break;
          } case NetMessage::Type::TileInteract: {
             NetMessage_TileInteract &tileInteract = netMsg.data.tileInteract;
 
@@ -1234,8 +1517,9 @@ void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
                                         { tileInteract.tileX, tileInteract.tileY, 0 }, dropStack.uid, dropStack.count
                                     );
                                 });
-                                tile->object.SetFlag(ObjectFlag_Stone_Overturned);
-                                BroadcastTileUpdate(tileInteract.tileX, tileInteract.tileY, *tile);
+                                Tile overturned = *tile;
+                                overturned.object.SetFlag(ObjectFlag_Stone_Overturned);
+                                serverWorld->map.SetTileAtWorld(tileInteract.tileX, tileInteract.tileY, overturned);
                             } else {
                                 E_DEBUG("[SRV] TileInteract: Rock already overturned.", 0);
                             }
@@ -1252,6 +1536,13 @@ void NetServer::ProcessMsg(SV_Client &client, ENetPacket &packet)
     }
 }
 
+NetBundle &NetServer::Bundle(const SV_Client &client)
+{
+    const size_t clientIdx = &client - clients;
+    DLB_ASSERT(clientIdx < SV_MAX_PLAYERS);
+    return bundles[clientIdx];
+}
+
 SV_Client *NetServer::AddClient(ENetPeer *peer)
 {
     for (int i = 0; i < SV_MAX_PLAYERS; i++) {
@@ -1259,6 +1550,7 @@ SV_Client *NetServer::AddClient(ENetPeer *peer)
         if (!client.playerId) {
             assert(!client.peer);
             client.peer = peer;
+            bundles[i].Clear();
             peer->data = &client;
 
             assert(serverWorld->tick);
@@ -1302,6 +1594,7 @@ ErrorType NetServer::RemoveClient(ENetPeer *peer)
 
             serverWorld->RemovePlayerInfo(client->playerId);
         }
+        Bundle(*client).Clear();
         *client = {};
     }
 
@@ -1369,9 +1662,22 @@ ErrorType NetServer::Listen(void)
     return ErrorType::Success;
 }
 
+void NetServer::Flush(void)
+{
+    for (int i = 0; i < SV_MAX_PLAYERS; i++) {
+        SV_Client &client = clients[i];
+        if (!client.peer || client.peer->state != ENET_PEER_STATE_CONNECTED) {
+            bundles[i].Clear();
+            continue;
+        }
+        E_ERROR(bundles[i].Flush(client.peer), "Failed to flush bundle for player %u", client.playerId);
+    }
+}
+
 void NetServer::CloseSocket(void)
 {
     if (!server) return;
+    Flush();
     // Notify all clients that the server is stopping
     for (int i = 0; i < (int)server->peerCount; i++) {
         enet_peer_disconnect(&server->peers[i], 0);
@@ -2,12 +2,71 @@
 #include "chat.h"
 #include "error.h"
 #include "fbs.h"
+#include "net_bundle.h"
 #include "tilemap.h"
 #include "world_item.h"
 #include "dlb_murmur3.h"
 #include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+
+struct World;
+
+// Last state sent to a client for one entity. Snapshots are unreliable, so any fields that were sent but not yet
+// acked get resent in every snapshot until the client acks one that contained them.
+template <typename T>
+struct SV_EntityHistory {
+    T        state        {};  // last state sent, state.flags are the flags that were sent with it
+    uint32_t pendingFlags {};  // fields sent since the last acked snapshot
+    uint32_t pendingTick  {};  // tick of the last snapshot that included pendingFlags
+    float    priority     {};  // grows every snapshot the entity has to wait, see SV_SnapshotEncoder::Prioritize
+    uint32_t updatedTick  {};  // tick of the last snapshot that brought the client up to date on this entity
+    uint32_t queuedTick   {};  // tick of the last snapshot that considered this entity, see SV_SnapshotEncoder::Prioritize
+
+    bool Acked(uint32_t snapshotAck) const {
+        return !pendingFlags || snapshotAck >= pendingTick;
+    }
+
+    // Combine fields that changed with fields the client may not have received yet, returns flags to send
+    uint32_t Resolve(uint32_t changedFlags, uint32_t snapshotAck, uint32_t tick) {
+        if (Acked(snapshotAck)) {
+            pendingFlags = 0;
+        }
+        const uint32_t flags = changedFlags | pendingFlags;
+        if (flags) {
+            pendingFlags = flags;
+            pendingTick = tick;
+        }
+        return flags;
+    }
+};
+
+// Decides how often, and how big, a client's snapshots should be from ENet's RTT and packet loss stats for their
+// connection. Backs off hard as soon as the link looks congested and creeps back up while it looks healthy, so slow
+// links get smaller, less frequent snapshots instead of a growing backlog.
+struct SV_Congestion {
+    float  quality          { 1.0f };                 // 0 = most congested, 1 = healthy
+    float  rttLow           {};                       // lowest recent RTT, in msec, slowly drifts up
+    double lastBackoffAt    {};
+    size_t snapshotBudget   { SNAPSHOT_BUDGET_MAX };  // bytes
+    double snapshotInterval { SNAPSHOT_SEND_DT };     // seconds between snapshots
+
+    bool Congested (const ENetPeer &peer) const;
+    // Call once per tick
+    void Update    (const ENetPeer &peer, double now, double dt);
+};
+
+// How well snapshots are keeping up with the world for one client, for tuning snapshot budgets and priorities
+struct SV_SnapshotStats {
+    uint32_t snapshots     {};
+    uint64_t deferred      {};  // entities left for a later snapshot because the budget ran out
+    uint64_t updates       {};  // entities brought up to date, whether they had anything to send or not
+    uint64_t staleTicks    {};  // sum of how many ticks each update waited since the entity's previous update
+    uint32_t staleTicksMax {};  // longest any entity has waited
+
+    float StaleTicksAvg(void) const { return updates ? (float)staleTicks / updates : 0.0f; }
+};
 
 struct SV_Client {
     ENetPeer    *peer              {};
@@ -15,50 +74,128 @@ struct SV_Client {
     uint32_t    playerId           {};
     uint32_t    lastInputAck       {};  // sequence # of last input processed for this client
     uint32_t    lastInputRecv      {};  // sequence # of last input received from client
+    uint32_t    lastSnapshotAck    {};  // tick of newest snapshot the client has received
     double      lastSnapshotSentAt {};
     float       inputOverflow      {};  // how msec of input we've received over/under expected by frameDt
+    SV_Congestion congestion       {};
+    SV_SnapshotStats snapshotStats {};
 
     //InputSample inputBuffer        {};  // last input received (TODO: all input received since last tick, consolidated)
     RingBuffer<InputSample, SV_INPUT_HISTORY> inputHistory {};
 
     //RingBuffer<WorldSnapshot, SV_WORLD_HISTORY> worldHistory {};
-    std::unordered_map<uint32_t, PlayerSnapshot> playerHistory {};
-    std::unordered_map<uint32_t, NpcSnapshot>    npcHistory    {};
-    std::unordered_map<EntityUID, ItemSnapshot>  itemHistory   {};
-    std::unordered_set<ChunkHash>                chunkHistory  {};  // TODO: RingBuffer, this set will grow indefinitely
+    std::unordered_map<uint32_t, SV_EntityHistory<PlayerSnapshot>> playerHistory {};
+    std::unordered_map<uint32_t, SV_EntityHistory<NpcSnapshot>>    npcHistory    {};
+    std::unordered_map<EntityUID, SV_EntityHistory<ItemSnapshot>>  itemHistory   {};
+    std::unordered_map<ChunkHash, uint32_t>      chunkHistory  {};  // chunk -> version client has, TODO: RingBuffer, this map will grow indefinitely
 };
 
+// Entity that might go out in a snapshot, see SV_SnapshotEncoder::Prioritize
+struct SV_SnapshotCandidate {
+    float              priority {};
+    SnapshotRecordType type     {};
+    union {
+        const Player    *player;
+        const NPC       *npc;
+        const WorldItem *item;
+    };
+
+    SV_SnapshotCandidate(const Player    &player, float priority) : priority(priority), type(SnapshotRecordType::Player), player(&player) {}
+    SV_SnapshotCandidate(const NPC       &npc,    float priority) : priority(priority), type(SnapshotRecordType::Npc),    npc(&npc) {}
+    SV_SnapshotCandidate(const WorldItem &item,   float priority) : priority(priority), type(SnapshotRecordType::Item),   item(&item) {}
+
+    bool operator<(const SV_SnapshotCandidate &other) const {
+        return priority < other.priority;  // max heap, highest priority on top
+    }
+};
+
+// Reused for every snapshot, so that building one doesn't allocate once the vector has grown
+struct SV_SnapshotQueue {
+    std::vector<SV_SnapshotCandidate> candidates {};  // heap, players, npcs, and items all compete for the same budget
+};
+
+// Picks out the entities that changed for one client, one record at a time as NetMessage::Process asks for them, so
+// records are written straight from the client's entity history into the packet. Entities are handed out in priority
+// order, whatever their type. When the snapshot runs out of budget, the ones that didn't make it gain priority and go
+// out in a later one.
+struct SV_SnapshotEncoder : WorldSnapshotRecords {
+    SV_SnapshotEncoder(World &world, SV_Client &client, Player &player, SV_SnapshotQueue &queue, uint32_t tick)
+        : world(world), client(client), player(player), queue(queue), tick(tick) {}
+
+    // Gather entities the client should hear about, from the chunks around the player and the client's history, and
+    // heapify them, those that have waited longest (weighted by how close and how fast they are) on top
+    void   Prioritize (void);
+    // Number of entities that didn't fit in the snapshot, call after it has been serialized
+    size_t Deferred   (void) const;
+
+    WorldSnapshotRecord Next(size_t room) override;
+
+private:
+    const char *LOG_SRC = "SV_SnapshotEncoder";
+    World            &world;
+    SV_Client        &client;
+    Player           &player;
+    SV_SnapshotQueue &queue;
+    uint32_t          tick    {};
+    size_t            skipped {};  // candidates popped because they were too big for the room that was left
+
+    // Add the entity to the queue if it's nearby or the client has history for it
+    void Queue (const NPC &npc, float distSq);
+    void Queue (const WorldItem &item, float distSq);
+
+    // Return client's history for the entity with this snapshot's flags filled in, or null if nothing to send
+    PlayerSnapshot *Encode (const Player &otherPlayer);
+    NpcSnapshot    *Encode (const NPC &npc);
+    ItemSnapshot   *Encode (const WorldItem &item);
+
+    template <typename K, typename T>
+    void Updated (std::unordered_map<K, SV_EntityHistory<T>> &histories, K id);
+};
+
+// Bit i is clients[i], picks which clients a broadcast goes to
+typedef uint32_t SV_ClientMask;
+static_assert(SV_MAX_PLAYERS <= sizeof(SV_ClientMask) * 8, "SV_ClientMask needs a bit for every client slot");
+#define SV_CLIENT_MASK_ALL ((SV_ClientMask)((1ull << SV_MAX_PLAYERS) - 1))
+
 struct NetServer {
     ENetHost  *server      {};
     World     *serverWorld {};
     SV_Client clients[SV_MAX_PLAYERS]{};
+    PacketPool packetPool {};             // buffers for outgoing packets, must outlive the ENet host
+    NetBundle  bundles[SV_MAX_PLAYERS]{};  // outgoing messages for clients[i], sent by Flush
+    SV_SnapshotQueue snapshotQueue {};
     //RingBuffer<InputSample, SV_INPUT_HISTORY> inputHistory {};
 
-    NetServer                   (void);
-    ~NetServer                  (void);
-    ErrorType OpenSocket        (unsigned short socketPort);
-    ErrorType SendChatMessage   (const SV_Client &client, const char *message, size_t messageLength);
-    ErrorType SendWorldChunk    (const SV_Client &client, const Chunk &chunk);
-    void      SendNearbyChunks  (SV_Client &client);
-    ErrorType SendWorldSnapshot (SV_Client &client);
-    //ErrorType SendNearbyEvents  (const SV_Client &client);
-    SV_Client *FindClient       (uint32_t playerId);
-    ErrorType Listen            (void);
-    void      CloseSocket       (void);
+    NetServer                      (void);
+    ~NetServer                     (void);
+    ErrorType OpenSocket           (unsigned short socketPort);
+    ErrorType SendChatMessage      (const SV_Client &client, const char *message, size_t messageLength);
+    ErrorType SendWorldChunk       (const SV_Client &client, const Chunk &chunk);
+    ErrorType SendChunkDiff        (const SV_Client &client, const Chunk &chunk);
+    void      SendNearbyChunks     (SV_Client &client);
+    void      BroadcastTileDeltas  (void);
+    ErrorType SendWorldSnapshot    (SV_Client &client);
+    //ErrorType SendNearbyEvents     (const SV_Client &client);
+    SV_Client *FindClient          (uint32_t playerId);
+    ErrorType Listen               (void);
+    // Send all bundled messages, call once per tick after everything has been queued
+    void      Flush                (void);
+    void      CloseSocket          (void);
 
 private:
     const char *LOG_SRC = "NetServer";
-    static uint8_t rawPacket[PACKET_SIZE_MAX];
     NetMessage netMsg {};
     FBS_Buffer fbs_users {};
+    uint8_t    broadcastBuf[PACKET_SIZE_MAX]{};  // BroadcastMsg serializes here once, then copies to each bundle
 
     ErrorType SaveUserDB(const char *filename);
     ErrorType LoadUserDB(const char *filename);
 
-    ErrorType SendRaw              (const SV_Client &client, const void *data, size_t size);
+    ErrorType SendRaw              (const SV_Client &client, const void *data, size_t size, NetDelivery delivery);
     ErrorType SendMsg              (const SV_Client &client, NetMessage &message);
-    ErrorType BroadcastRaw         (const void *data, size_t size);
-    ErrorType BroadcastMsg         (NetMessage &message, std::function<bool(SV_Client &client)> clientFilter = nullptr);
+    ErrorType BroadcastRaw         (const void *data, size_t size, NetDelivery delivery);
+    // Serializes message once for all recipients, so it must not have any per-client content (other than the token)
+    ErrorType BroadcastMsg         (NetMessage &message, SV_ClientMask recipients = SV_CLIENT_MASK_ALL);
     ErrorType SendWelcomeBasket    (SV_Client &client);
     ErrorType BroadcastChatMessage (NetMessage_ChatMessage &chatMsg);
     ErrorType BroadcastPlayerJoin  (const PlayerInfo &playerInfo);
@@ -66,12 +203,13 @@ private:
     ErrorType SendPlayerState      (const SV_Client &client, const Player &otherPlayer, bool nearby, bool spawned);
     ErrorType SendNPCState         (const SV_Client &client, const NPC &npc, bool nearby, bool spawned);
     ErrorType SendItemState        (const SV_Client &client, const WorldItem &item, bool nearby, bool spawned);
-    ErrorType BroadcastTileUpdate  (float worldX, float worldY, const Tile &tile);
 
     bool IsValidInput (const SV_Client &client, const InputSample &sample);
     bool ParseCommand (SV_Client &client, NetMessage_ChatMessage &chatMsg);
     void ProcessMsg   (SV_Client &client, ENetPacket &packet);
+    void ProcessMsg   (SV_Client &client, const uint8_t *data, size_t length);
 
+    NetBundle &Bundle      (const SV_Client &client);
     SV_Client *AddClient   (ENetPeer *peer);
     SV_Client *FindClient  (ENetPeer *peer);
     ErrorType RemoveClient (ENetPeer *peer);
@@ -0,0 +1,140 @@
+#include "packet_pool.h"
+
+PacketPool::~PacketPool(void)
+{
+    DLB_ASSERT(!inUse);
+    while (freeList) {
+        Buffer *next = freeList->next;
+        delete freeList;
+        freeList = next;
+    }
+}
+
+PacketPool::Buffer *PacketPool::Alloc(void)
+{
+    Buffer *buffer = freeList;
+    if (buffer) {
+        freeList = buffer->next;
+    } else {
+        buffer = new Buffer;
+        buffer->pool = this;
+        heapAllocs++;
+    }
+    buffer->next = 0;
+    inUse++;
+    return buffer;
+}
+
+void PacketPool::Free(Buffer *buffer)
+{
+    DLB_ASSERT(buffer);
+    DLB_ASSERT(buffer->pool == this);
+    DLB_ASSERT(inUse);
+    buffer->next = freeList;
+    freeList = buffer;
+    inUse--;
+}
+
+ENetPacket *PacketPool::CreatePacket(Buffer *buffer, size_t length, uint32_t flags)
+{
+    DLB_ASSERT(buffer);
+    DLB_ASSERT(length <= sizeof(buffer->data));
+
+    ENetPacket *packet = enet_packet_create(buffer->data, length, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+    if (!packet) {
+        Free(buffer);
+        return 0;
+    }
+    packet->userData = buffer;
+    packet->freeCallback = OnPacketFree;
+    return packet;
+}
+
+void ENET_CALLBACK PacketPool::OnPacketFree(void *packet)
+{
+    Buffer *buffer = (Buffer *)((ENetPacket *)packet)->userData;
+    buffer->pool->Free(buffer);
+}
+
+NetAllocator g_net_allocator{};
+
+NetAllocator::~NetAllocator(void)
+{
+    for (Block *&freeList : freeLists) {
+        while (freeList) {
+            Block *next = freeList->next;
+            free(freeList);
+            freeList = next;
+        }
+    }
+}
+
+void *NetAllocator::Alloc(size_t size)
+{
+    uint32_t sizeClass = 0;
+    while (sizeClass < NET_ALLOC_CLASS_COUNT && ((size_t)NET_ALLOC_MIN_SIZE << sizeClass) < size) {
+        sizeClass++;
+    }
+
+    Block *block = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sizeClass < NET_ALLOC_CLASS_COUNT && freeLists[sizeClass]) {
+            block = freeLists[sizeClass];
+            freeLists[sizeClass] = block->next;
+        } else {
+            heapAllocs++;
+        }
+        inUse++;
+    }
+
+    if (!block) {
+        const size_t blockSize = sizeClass < NET_ALLOC_CLASS_COUNT ? (size_t)NET_ALLOC_MIN_SIZE << sizeClass : size;
+        block = (Block *)malloc(sizeof(Block) + blockSize);
+        if (!block) {
+            std::lock_guard<std::mutex> lock(mutex);
+            inUse--;
+            return 0;
+        }
+        block->sizeClass = sizeClass;
+    }
+    block->next = 0;
+    return block + 1;
+}
+
+void NetAllocator::Free(void *memory)
+{
+    if (!memory) {
+        return;
+    }
+    Block *block = (Block *)memory - 1;
+    DLB_ASSERT(block->sizeClass <= NET_ALLOC_CLASS_COUNT);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    DLB_ASSERT(inUse);
+    inUse--;
+    if (block->sizeClass == NET_ALLOC_CLASS_COUNT) {
+        free(block);
+        return;
+    }
+    block->next = freeLists[block->sizeClass];
+    freeLists[block->sizeClass] = block;
+}
+
+static void *ENET_CALLBACK net_allocator_malloc(size_t size)
+{
+    return g_net_allocator.Alloc(size);
+}
+
+static void ENET_CALLBACK net_allocator_free(void *memory)
+{
+    g_net_allocator.Free(memory);
+}
+
+int net_enet_initialize(void)
+{
+    ENetCallbacks callbacks{};
+    callbacks.malloc = net_allocator_malloc;
+    callbacks.free = net_allocator_free;
+    return enet_initialize_with_callbacks(ENET_VERSION, &callbacks);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "helpers.h"
+#include "enet_zpl.h"
+#include <mutex>
+
+// Recycled buffers for outgoing packets. Messages are serialized straight into a buffer, which is then handed to ENet
+// with ENET_PACKET_FLAG_NO_ALLOCATE. ENet calls the packet's free callback once it's done with it (sent, or acked if
+// reliable) and the buffer goes back on the free list. Only allocates from the heap when every buffer is in flight.
+// The pool must outlive any ENet host its packets were sent on.
+struct PacketPool {
+    struct Buffer {
+        PacketPool *pool {};
+        Buffer     *next {};  // free list link
+        uint8_t     data [NET_PACKET_BUFFER_SIZE];
+    };
+
+    size_t heapAllocs {};  // buffers ever allocated, stops growing once the pool is warmed up (ENet's own allocations
+                           // are counted by g_net_allocator)
+    size_t inUse      {};  // buffers currently held by a bundle or ENet
+
+    ~PacketPool(void);
+
+    Buffer *Alloc (void);
+    void    Free  (Buffer *buffer);
+    // Wrap the first `length` bytes of buffer in a packet that returns the buffer to its pool when ENet destroys it
+    ENetPacket *CreatePacket(Buffer *buffer, size_t length, uint32_t flags);
+
+private:
+    Buffer *freeList {};
+
+    static void ENET_CALLBACK OnPacketFree(void *packet);
+};
+
+// Everything ENet allocates for itself (packet structs, outgoing/incoming commands, acks, received packet data) once
+// ENet is initialized with net_enet_initialize(). Blocks are recycled on per-size free lists and only come from the heap
+// when a list is empty, so a warmed up connection doesn't allocate at all. Blocks bigger than the largest size class
+// go straight to the heap every time. The client and server threads share it.
+#define NET_ALLOC_MIN_SIZE    64
+#define NET_ALLOC_CLASS_COUNT 10  // 64 B up to 32 KiB, room for a PACKET_SIZE_MAX message received in one piece
+
+struct NetAllocator {
+    size_t heapAllocs {};  // blocks ever allocated from the heap
+    size_t inUse      {};  // blocks currently held by ENet
+
+    ~NetAllocator(void);
+
+    void *Alloc(size_t size);
+    void  Free (void *memory);
+
+private:
+    struct Block {
+        uint32_t sizeClass;  // NET_ALLOC_CLASS_COUNT = too big for any class, not recycled
+        uint32_t unused;
+        Block   *next;       // free list link
+    };
+
+    std::mutex mutex                               {};
+    Block     *freeLists [NET_ALLOC_CLASS_COUNT]   {};
+};
+
+extern NetAllocator g_net_allocator;
+
+// enet_initialize(), with ENet's allocations going through g_net_allocator
+int net_enet_initialize(void);
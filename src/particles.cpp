@@ -6,261 +6,449 @@
 #include "draw_command.h"
 #include "dlb_rand.h"
 #include "chat.h"
+#include "maths.h"
+#include "player.h"
+#include "ui/ui.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
-ParticleSystem::ParticleSystem(void)
-{
-    // Initialze intrusive free lists
-    for (size_t i = 0; i < MAX_PARTICLES; i++) {
-        if (i < MAX_PARTICLES - 1) {
-            particles[i].next = &particles[i + 1];
-        }
-    }
-    particlesFree = particles;
-
-    for (size_t i = 0; i < MAX_EFFECTS; i++) {
-        if (i < MAX_EFFECTS - 1) {
-            effects[i].next = &effects[i + 1];
-        }
-    }
-    effectsFree = effects;
-}
-
-ParticleSystem::~ParticleSystem(void)
-{
-    //memset(particles, 0, sizeof(particles));
-    //memset(effects, 0, sizeof(effects));
-    //particlesFree = 0;
-    //effectsFree = 0;
-}
-
-Particle *ParticleSystem::Alloc(void)
-{
-    // Allocate effect
-    Particle *particle = particlesFree;
-    if (!particle) {
-        // TODO: Delete oldest particles instead of dropping newest ones?
-        //DLB_ASSERT(!"Particle pool is full");
-        //TraceLog(LOG_ERROR, "Particle pool is full; discarding particle.\n");
-        return 0;
-    }
-    particlesFree = particle->next;
-    particlesActiveCount++;
-
-    return particle;
-}
-
 ParticleEffect *ParticleSystem::GenerateEffect(Catalog::ParticleEffectID type, Vector3 origin, const ParticleEffectParams &par)
 {
     DLB_ASSERT((size_t)type > 0);
     DLB_ASSERT((size_t)type < (size_t)Catalog::ParticleEffectID::Count);
     DLB_ASSERT(par.particleCountMin > 0);
-    DLB_ASSERT(par.particleCountMax >= par.particleCountMax);
+    DLB_ASSERT(par.particleCountMax >= par.particleCountMin);
     DLB_ASSERT(par.durationMin > 0.0f);
     DLB_ASSERT(par.durationMax >= par.durationMin);
 
-    const Catalog::ParticleEffectDef &pfx = Catalog::g_particleFx.FindById(type);
-    DLB_ASSERT(pfx.init);
-    if (!pfx.init) {
+    const Catalog::ParticleEffectDef &def = Catalog::g_particleFx.FindById(type);
+    DLB_ASSERT(def.paletteCount);
+    if (!def.paletteCount) {
         return 0;
     }
 
-    // Allocate effect
-    ParticleEffect *effect = effectsFree;
-    if (!effect) {
-        //DLB_ASSERT(!"Particle effect pool is full");
-        //TraceLog(LOG_ERROR, "Particle effect pool is full; discarding particle effect.\n");
-        return 0;
+    ParticleEffect &effect = effects.emplace_back();
+    effect.id = type;
+    effect.origin = origin;
+    effect.duration = dlb_rand32f_range(par.durationMin, par.durationMax);
+    effect.startedAt = g_clock.now;
+    effect.params = par;
+    if (def.sprite) {
+        const Spritesheet &spritesheet = Catalog::g_spritesheets.FindById(def.spritesheet);
+        effect.sprite.spriteDef = spritesheet.FindSprite(def.sprite);
+        // TODO: Don't play particle effects on the server so that we can assert this on client side
+        //DLB_ASSERT(effect.sprite.spriteDef);
     }
-    effectsFree = effect->next;
-    effectsActiveCount++;
 
-    // Sanity checks to ensure previous effect was freed properly and/or free list is returning valid pointers
-    DLB_ASSERT(effect->id == Catalog::ParticleEffectID::Empty);
-    DLB_ASSERT(effect->particlesLeft == 0);
-
-    effect->id = type;
-    effect->origin = origin;
-    effect->duration = dlb_rand32f_range(par.durationMin, par.durationMax);
-    effect->startedAt = g_clock.now;
-    effect->params = par;
+    effect.first = state.size();
+    effect.count = (size_t)dlb_rand32i_range(par.particleCountMin, par.particleCountMax);
+    effect.particlesLeft = effect.count;
+    Emit(effect, def);
+    return &effect;
+}
 
-    const int particleCount = dlb_rand32i_range(par.particleCountMin, par.particleCountMax);
+void ParticleSystem::Emit(const ParticleEffect &effect, const Catalog::ParticleEffectDef &def)
+{
+    const ParticleEffectParams &par = effect.params;
+    const float duration = (float)effect.duration;
+    const size_t end = effect.first + effect.count;
+    ForEachLane([end](auto &lane) { lane.resize(end); });
+
+    for (size_t i = effect.first; i < end; i++) {
+        const int paletteIdx = def.paletteCount > 1 ? dlb_rand32i_range(0, def.paletteCount - 1) : 0;
+
+        Vector3 offset{
+            METERS_TO_PIXELS(dlb_rand32f_range(def.offsetMin.x, def.offsetMax.x)),
+            METERS_TO_PIXELS(dlb_rand32f_range(def.offsetMin.y, def.offsetMax.y)),
+            METERS_TO_PIXELS(dlb_rand32f_range(def.offsetMin.z, def.offsetMax.z))
+        };
+        Vector3 velocity{};
+        float sweep = 0.0f;
+        switch (def.launch) {
+            case Catalog::ParticleLaunch::Params: {
+                velocity.x = METERS_TO_PIXELS(dlb_rand32f_range(par.velocityXMin, par.velocityXMax));
+                velocity.y = METERS_TO_PIXELS(dlb_rand32f_range(par.velocityYMin, par.velocityYMax));
+                velocity.z = METERS_TO_PIXELS(dlb_rand32f_range(par.velocityZMin, par.velocityZMax));
+                break;
+            }
+            case Catalog::ParticleLaunch::Box: {
+                velocity.x = METERS_TO_PIXELS(dlb_rand32f_range(def.velocityMin.x, def.velocityMax.x));
+                velocity.y = METERS_TO_PIXELS(dlb_rand32f_range(def.velocityMin.y, def.velocityMax.y));
+                velocity.z = METERS_TO_PIXELS(dlb_rand32f_range(def.velocityMin.z, def.velocityMax.z));
+                break;
+            }
+            case Catalog::ParticleLaunch::Ring: {
+                const Vector2 dir = v2_normalize({ dlb_rand32f_variance(1.0f), dlb_rand32f_variance(1.0f) });
+                const Vector2 vxy = v2_scale(dir, dlb_rand32f_range(par.velocityXMin, par.velocityXMax));
+                velocity.x = METERS_TO_PIXELS(vxy.x);
+                velocity.y = METERS_TO_PIXELS(vxy.y);
+                velocity.z = METERS_TO_PIXELS(dlb_rand32f_range(par.velocityZMin, par.velocityZMax));
+                break;
+            }
+            case Catalog::ParticleLaunch::Arc: {
+                const float angleRad = dlb_rand32f_range(0.0f, PI);
+                const float radius = METERS_TO_PIXELS(def.arcRadius + (float)paletteIdx * def.arcBandWidth);
+                offset.x += -cosf(angleRad) * radius;
+                offset.z += sinf(angleRad) * radius;
+                velocity.z = METERS_TO_PIXELS(dlb_rand32f_range(def.velocityMin.z, def.velocityMax.z));
+                sweep = angleRad / PI;
+                break;
+            }
+        }
 
-    Particle *prev = 0;
-    for (int i = 0; i < particleCount; i++) {
-        Particle *particle = Alloc();
-        if (!particle) {
-            break;
+        float spawnDelay = 0.0f;
+        float lifespan = 0.0f;
+        switch (def.timing) {
+            case Catalog::ParticleTiming::Params: {
+                DLB_ASSERT(par.spawnDelayMin >= 0);
+                DLB_ASSERT(par.spawnDelayMax >= par.spawnDelayMin);
+                DLB_ASSERT(par.lifespanMin >= 0);
+                DLB_ASSERT(par.lifespanMax >= par.lifespanMin);
+                spawnDelay = dlb_rand32f_range(par.spawnDelayMin, par.spawnDelayMax);
+                lifespan = dlb_rand32f_range(par.lifespanMin, par.lifespanMax);
+                break;
+            }
+            case Catalog::ParticleTiming::Duration: {
+                spawnDelay = def.spawnDelay + duration * dlb_rand32f_variance(def.spawnVariance);
+                const float dieAt = duration - duration * dlb_rand32f_variance(def.dieVariance);
+                lifespan = dieAt - spawnDelay;
+                break;
+            }
+            case Catalog::ParticleTiming::Sweep: {
+                spawnDelay = sweep * duration * 0.5f;
+                lifespan = duration * 0.4f;
+                break;
+            }
         }
-        if (prev) {
-            prev->next = particle;
+        DLB_ASSERT(lifespan > 0.0f);
+
+        float spawnScale = def.scaleA;
+        switch (def.scale) {
+            case Catalog::ParticleScale::SpawnOrder: {
+                DLB_ASSERT(par.spawnScaleFirst > 0);
+                DLB_ASSERT(par.spawnScaleLast > 0);
+                const float spawnDelayRange = par.spawnDelayMax - par.spawnDelayMin;
+                const float spawnOrder = spawnDelayRange > 0.0f ? (spawnDelay - par.spawnDelayMin) / spawnDelayRange : 0.0f;
+                spawnScale = LERP(par.spawnScaleFirst, par.spawnScaleLast, spawnOrder);
+                break;
+            }
+            case Catalog::ParticleScale::ParamsLerp: {
+                spawnScale = par.scaleA;
+                break;
+            }
+            default: break;
         }
 
-        particle->effect = effect;
-        DLB_ASSERT(pfx.init);
-        pfx.init(*particle);
-        effect->particlesLeft++;
-
-        prev = particle;
+        state     [i] = ParticleState_Pending;
+        spawnAt   [i] = spawnDelay;
+        invLife   [i] = 1.0f / MAX(lifespan, 0.001f);
+        alpha     [i] = 0.0f;
+        posX      [i] = offset.x;
+        posY      [i] = offset.y;
+        posZ      [i] = offset.z;
+        velX      [i] = velocity.x;
+        velY      [i] = velocity.y;
+        velZ      [i] = velocity.z;
+        bounced   [i] = 0;
+        scale     [i] = spawnScale;
+        spawnColor[i] = def.palette[paletteIdx];
+        color     [i] = def.palette[paletteIdx];
     }
-
-    return effect;
 }
 
-size_t ParticleSystem::ParticlesActive(void)
+size_t ParticleSystem::ParticlesActive(void) const
 {
-    return particlesActiveCount;
-}
-
-size_t ParticleSystem::EffectsActive(void)
-{
-    return effectsActiveCount;
+    size_t particlesActive = 0;
+    for (const ParticleEffect &effect : effects) {
+        particlesActive += effect.particlesLeft;
+    }
+    return particlesActive;
 }
 
-Particle *ParticleSystem::ParticlePool(void)
+size_t ParticleSystem::EffectsActive(void) const
 {
-    return particles;
+    return effects.size();
 }
 
 void ParticleSystem::Update(double dt)
 {
-    DLB_ASSERT(particlesActiveCount <= MAX_PARTICLES);
-    DLB_ASSERT(effectsActiveCount <= MAX_EFFECTS);
-
-    size_t effectsCounted = 0;
-    for (size_t i = 0; effectsCounted < effectsActiveCount; i++) {
-        ParticleEffect &effect = effects[i];
-        if (effect.id == Catalog::ParticleEffectID::Empty)
-            continue;
-
+    for (ParticleEffect &effect : effects) {
         const ParticleEffect_Callback &beforeUpdate = effect.effectCallbacks[(size_t)ParticleEffect_Event::BeforeUpdate];
         if (beforeUpdate.callback) {
             beforeUpdate.callback(effect, beforeUpdate.userData);
         }
-        effectsCounted++;
     }
 
-    size_t particlesCounted = 0;
-    for (size_t i = 0; particlesCounted < particlesActiveCount; i++) {
-        Particle &particle = particles[i];
-        if (!particle.effect)
-            continue;  // particle is dead
-
-        ParticleEffect &effect = *particle.effect;
-        const float alpha = (float)((g_clock.now - particle.spawnAt) / (particle.dieAt - particle.spawnAt));
-        if (alpha >= 0.0f && alpha < 1.0f) {
-            if (!particle.alive) {
-                Vector3 pos = particle.body.WorldPosition();
-                particle.body.Teleport(effect.origin);
-                particle.body.Move3D(pos);
-                particle.alive = true;
+    // One effect at a time, so that every particle in a batch shares the same def and params
+    for (ParticleEffect &effect : effects) {
+        const Catalog::ParticleEffectDef &def = Catalog::g_particleFx.FindById(effect.id);
+        UpdateLife(effect);
+        UpdatePhysics(effect, def, (float)dt);
+        UpdateLook(effect, def);
+
+        if (def.bounceSound != Catalog::SoundID::Empty) {
+            const size_t end = effect.first + effect.count;
+            for (size_t i = effect.first; i < end; i++) {
+                if (bounced[i]) {
+                    Catalog::g_sounds.Play(def.bounceSound, def.bouncePitch + dlb_rand32f_variance(0.1f), true);
+                }
             }
-            particle.body.drag = effect.params.drag;
-            particle.body.gravityScale = LERP(effect.params.gravityScaleA, effect.params.gravityScaleB, alpha);
-            particle.body.Update(dt);
-            sprite_update(particle.sprite, dt);
-            DLB_ASSERT(Catalog::g_particleFx.FindById(effect.id).update);
-            Catalog::g_particleFx.FindById(effect.id).update(particle, alpha);
-
-            const ParticleEffect_ParticleCallback &afterUpdate = effect.particleCallbacks[(size_t)ParticleEffect_ParticleEvent::AfterUpdate];
-            if (afterUpdate.callback) {
-                afterUpdate.callback(particle, afterUpdate.userData);
-            }
-        } else if (alpha >= 1.0f) {
-            effect.particlesLeft--;
+        }
+    }
 
-            const ParticleEffect_ParticleCallback &died = effect.particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Died];
-            if (died.callback) {
-                died.callback(particle, died.userData);
-            }
+    Compact();
+}
 
-            // Return particle to free list
-            particle = {};
-            particle.next = particlesFree;
-            particlesFree = &particle;
-            particlesActiveCount--;
+void ParticleSystem::UpdateLife(ParticleEffect &effect)
+{
+    const float t = (float)(g_clock.now - effect.startedAt);
+    const size_t end = effect.first + effect.count;
+    for (size_t i = effect.first; i < end; i++) {
+        if (state[i] == ParticleState_Dead) {
+            continue;
+        }
+        const float a = (t - spawnAt[i]) * invLife[i];
+        alpha[i] = a;
+        if (a >= 1.0f) {
+            state[i] = ParticleState_Dead;
+            effect.particlesLeft--;
+        } else if (a >= 0.0f && state[i] == ParticleState_Pending) {
+            // Spawn relative to wherever the effect is now, it might be following something
+            posX[i] += effect.origin.x;
+            posY[i] += effect.origin.y;
+            posZ[i] += effect.origin.z;
+            state[i] = ParticleState_Alive;
         }
-        particlesCounted++;
     }
+}
 
-    effectsCounted = 0;
-    for (size_t i = 0; effectsCounted < effectsActiveCount; i++) {
-        ParticleEffect &effect = effects[i];
-        if (effect.id == Catalog::ParticleEffectID::Empty)
-            continue;
+// Same integration as Body3D::Update, minus the bookkeeping particles never look at. Resting particles don't need to be
+// skipped: gravity pulls them below the ground, and the ground puts them right back where they were. Selects instead of
+// branches so the compiler can vectorize the loop.
+void ParticleSystem::UpdatePhysics(const ParticleEffect &effect, const Catalog::ParticleEffectDef &def, float dt)
+{
+    const ParticleEffectParams &par = effect.params;
+    const bool frictionFromParams = def.launch == Catalog::ParticleLaunch::Params || def.launch == Catalog::ParticleLaunch::Ring;
+    const float friction = frictionFromParams ? par.friction : def.friction;
+    const float frictionCoef = 1.0f - CLAMP(friction, 0.0f, 1.0f);
+    const float dampingCoef = 1.0f - CLAMP(par.drag, 0.0f, 1.0f);
+    const float restitution = def.restitution;
+    const float gravity = -METERS_TO_PIXELS(10.0f);
+    const float gravityScaleA = par.gravityScaleA;
+    const float gravityScaleB = par.gravityScaleB;
+
+    const size_t end = effect.first + effect.count;
+    for (size_t i = effect.first; i < end; i++) {
+        const bool alive = state[i] == ParticleState_Alive;
+        const float accel = gravity * LERP(gravityScaleA, gravityScaleB, alpha[i]) * dt;
+
+        float vx = velX[i];
+        float vy = velY[i];
+        float vz = velZ[i] * dampingCoef + accel;
+        float px = posX[i] + vx * dt;
+        float py = posY[i] + vy * dt;
+        float pz = posZ[i] + vz * dt;
+
+        // Hitting ground, either come to rest or bounce
+        const bool hit = pz <= 0.0f;
+        const bool rest = hit && fabsf(vz - accel) < VELOCITY_EPSILON;
+        const float hitCoef = hit ? frictionCoef : 1.0f;
+        vx = rest ? 0.0f : vx * hitCoef;
+        vy = rest ? 0.0f : vy * hitCoef;
+        vz = rest ? 0.0f : (hit ? -vz * restitution : vz) * hitCoef;
+        pz = hit ? 0.0f : pz;
+
+        px *= fabsf(px) >= POSITION_EPSILON;
+        py *= fabsf(py) >= POSITION_EPSILON;
+        pz *= fabsf(pz) >= POSITION_EPSILON;
+        vx *= fabsf(vx) >= VELOCITY_EPSILON;
+        vy *= fabsf(vy) >= VELOCITY_EPSILON;
+        vz *= fabsf(vz) >= VELOCITY_EPSILON;
+        const bool moving = vx != 0.0f || vy != 0.0f || vz != 0.0f;
+
+        posX[i] = alive ? px : posX[i];
+        posY[i] = alive ? py : posY[i];
+        posZ[i] = alive ? pz : posZ[i];
+        velX[i] = alive ? vx : velX[i];
+        velY[i] = alive ? vy : velY[i];
+        velZ[i] = alive ? vz : velZ[i];
+        bounced[i] = alive && hit && !rest && moving;
+    }
+}
 
-        // note: ParticleEffectEvent_AfterUpdate would go here if I ever care about that..
+void ParticleSystem::UpdateLook(const ParticleEffect &effect, const Catalog::ParticleEffectDef &def)
+{
+    const size_t end = effect.first + effect.count;
+
+    float scaleA = def.scaleA;
+    float scaleB = def.scaleB;
+    switch (def.scale) {
+        case Catalog::ParticleScale::ParamsLerp: {
+            scaleA = effect.params.scaleA;
+            scaleB = effect.params.scaleB;
+        } // fall through
+        case Catalog::ParticleScale::Lerp: {
+            for (size_t i = effect.first; i < end; i++) {
+                scale[i] = LERP(scaleA, scaleB, CLAMP(alpha[i], 0.0f, 1.0f));
+            }
+            break;
+        }
+        default: break;  // set once when emitted
+    }
+
+    if (!def.colorLerp && def.fade == Catalog::ParticleFade::None) {
+        return;
+    }
+    const Color fadeColor = def.fadeColor;
+    for (size_t i = effect.first; i < end; i++) {
+        const float a = CLAMP(alpha[i], 0.0f, 1.0f);
+        const Color from = spawnColor[i];
+        Color to = from;
+        if (def.colorLerp) {
+            to.r = (unsigned char)LERP((float)from.r, (float)fadeColor.r, a);
+            to.g = (unsigned char)LERP((float)from.g, (float)fadeColor.g, a);
+            to.b = (unsigned char)LERP((float)from.b, (float)fadeColor.b, a);
+        }
+        switch (def.fade) {
+            case Catalog::ParticleFade::Lerp: {
+                to.a = (unsigned char)LERP((float)from.a, (float)fadeColor.a, a);
+                break;
+            }
+            case Catalog::ParticleFade::Pulse: {
+                const float ha = a - 0.5f;
+                const float pulse = CLAMP(ha*ha*ha*ha*ha*ha - 5*ha*ha + 1.0f, 0.0f, 1.0f);
+                to.a = (unsigned char)(pulse * (float)from.a);
+                break;
+            }
+            default: break;
+        }
+        color[i] = to;
+    }
+}
 
+// Drop finished effects, sliding the particles of the ones after them down over the gap
+void ParticleSystem::Compact(void)
+{
+    size_t effectsKept = 0;
+    size_t particlesKept = 0;
+    for (size_t e = 0; e < effects.size(); e++) {
+        ParticleEffect &effect = effects[e];
         if (!effect.particlesLeft) {
             const ParticleEffect_Callback &dying = effect.effectCallbacks[(size_t)ParticleEffect_Event::Dying];
             if (dying.callback) {
                 dying.callback(effect, dying.userData);
             }
+            continue;
+        }
 
-            // Return effect to free list
-            effect = {};
-            effect.next = effectsFree;
-            effectsFree = &effect;
-            effectsActiveCount--;
+        if (effect.first != particlesKept) {
+            const size_t from = effect.first;
+            const size_t count = effect.count;
+            ForEachLane([from, count, particlesKept](auto &lane) {
+                std::copy(lane.begin() + from, lane.begin() + from + count, lane.begin() + particlesKept);
+            });
+            effect.first = particlesKept;
         }
-        effectsCounted++;
+        particlesKept += effect.count;
+
+        if (effectsKept != e) {
+            effects[effectsKept] = effect;
+        }
+        effectsKept++;
     }
+
+    effects.resize(effectsKept);
+    ForEachLane([particlesKept](auto &lane) { lane.resize(particlesKept); });
 }
 
 void ParticleSystem::PushAll(DrawList &drawList)
 {
-    DLB_ASSERT(particlesActiveCount <= MAX_PARTICLES);
+    // Reserve up front, the draw list holds on to pointers into this until it's flushed
+    drawables.clear();
+    drawables.reserve(state.size());
+
+    for (size_t e = 0; e < effects.size(); e++) {
+        const ParticleEffect &effect = effects[e];
+        const size_t end = effect.first + effect.count;
+        for (size_t i = effect.first; i < end; i++) {
+            if (state[i] != ParticleState_Alive) {
+                continue;
+            }
+
+            const ParticleView view = View(i);
+            bool cull = false;
+            if (!drawList.cullEnabled) {
+                // Nothing to check against
+            } else if (effect.sprite.spriteDef) {
+                const Rectangle rect = sprite_world_rect(ParticleSprite(effect, i), view.position);
+                cull = !CheckCollisionRecs(rect, drawList.cullRect);
+            } else {
+                cull = !CheckCollisionCircleRec(view.VisualPosition(), view.scale, drawList.cullRect);
+            }
 
-    for (size_t i = 0; i < MAX_PARTICLES; i++) {
-        Particle &particle = particles[i];
-        if (!particle.alive)
-            continue;  // particle is dead
+            ParticleDrawable &drawable = drawables.emplace_back();
+            drawable.system = this;
+            drawable.effect = (uint32_t)e;
+            drawable.particle = (uint32_t)i;
+            drawList.Push(drawable, DrawableType::Particle, floorf(view.position.y), cull);
+        }
+    }
+}
 
-        //const float animTime = (float)(g_clock.now - particle.effect->startedAt);
-        //const float alpha = (float)((animTime - particle.spawnAt) / (particle.dieAt - particle.spawnAt));
-        //if (alpha >= 0.0f && alpha < 1.0f) {
-        drawList.Push(particle, particle.Depth(), particle.Cull(drawList.cullRect));
+Sprite ParticleSystem::ParticleSprite(const ParticleEffect &effect, size_t i) const
+{
+    Sprite sprite = effect.sprite;
+    sprite.scale = scale[i];
+
+    // Same 24 fps as sprite_update, counted from when the particle spawned
+    const SpriteAnim &anim = sprite_anim(sprite);
+    if (anim.frameCount > 1) {
+        const double age = g_clock.now - effect.startedAt - spawnAt[i];
+        sprite.animFrameIdx = (size_t)(MAX(0.0, age) * 24.0) % anim.frameCount;
     }
+    return sprite;
 }
 
-float Particle::Depth(void) const
+ParticleView ParticleSystem::View(size_t i) const
 {
-    const float depth = body.GroundPosition().y;
-    return depth;
+    ParticleView view{};
+    view.position = { posX[i], posY[i], posZ[i] };
+    view.scale = scale[i];
+    view.color = color[i];
+    return view;
 }
 
-bool Particle::Cull(const Rectangle &cullRect) const
+void ParticleSystem::DrawParticle(size_t effectIdx, size_t i) const
 {
-    bool cull = false;
-    if (sprite.spriteDef) {
-        cull = sprite_cull_body(sprite, body, cullRect);
+    const ParticleEffect &effect = effects[effectIdx];
+    const ParticleView view = View(i);
+    const ParticleEffect_ParticleCallback &draw = effect.particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Draw];
+    if (draw.callback) {
+        draw.callback(view, draw.userData);
+    } else if (effect.sprite.spriteDef) {
+        sprite_draw_at(ParticleSprite(effect, i), view.position, view.color);
     } else {
-        const Vector2 bodyBC = body.VisualPosition();
-        cull = !CheckCollisionCircleRec(bodyBC, sprite.scale, cullRect);
+        const Vector3 pos = view.position;
+        const float halfW = view.scale / 2.0f;
+        DrawRectangleRec({ pos.x - halfW, pos.y - pos.z - halfW, view.scale, view.scale }, view.color);
+        //DrawCircleSector({ pos.x, pos.y - pos.z }, view.scale, 0.0f, 360.0f, 12, view.color);
+        //DrawCircleSectorLines({ pos.x, pos.y - pos.z }, view.scale, 0.0f, 360.0f, 12, Fade(BLACK, view.color.a / 255.0f));
     }
-    return cull;
 }
 
-void Particle::Draw(World &world, Vector2 at) const
+void ParticleDrawable::Draw(World &world, Vector2 at) const
 {
     UNUSED(world);
     UNUSED(at);
-    const ParticleEffect_ParticleCallback &draw = effect->particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Draw];
-    if (draw.callback) {
-        draw.callback(const_cast<Particle &>(*this), draw.userData);
-    } else {
-        if (sprite.spriteDef) {
-            sprite_draw_body(sprite, body, color);
-        } else {
-            const Vector3 pos = body.WorldPosition();
-            const float halfW = sprite.scale / 2.0f;
-            DrawRectangleRec({ pos.x - halfW, pos.y - pos.z - halfW, sprite.scale, sprite.scale }, color);
-            //DrawCircleSector({ pos.x, pos.y - pos.z }, sprite.scale, 0.0f, 360.0f, 12, color);
-            //DrawCircleSectorLines({ pos.x, pos.y - pos.z }, sprite.scale, 0.0f, 360.0f, 12, Fade(BLACK, color.a / 255.0f));
-        }
-    }
+    system->DrawParticle(effect, particle);
+}
+
+Vector2 ParticleView::VisualPosition(void) const
+{
+    Vector2 visualPosition = { floorf(position.x), floorf(position.y) };
+    visualPosition.y = floorf(visualPosition.y - position.z);
+    return visualPosition;
 }
 
 void ParticlesFollowPlayerGut(ParticleEffect &effect, void *userData)
@@ -270,11 +458,11 @@ void ParticlesFollowPlayerGut(ParticleEffect &effect, void *userData)
     effect.origin = player->GetAttachPoint(Player::AttachPoint::Gut);
 }
 
-void ParticleDrawText(Particle &particle, void *userData)
+void ParticleDrawText(const ParticleView &particle, void *userData)
 {
     DLB_ASSERT(userData);
     const char *text = (const char *)userData;
-    UI::ParticleText(particle.body.VisualPosition(), text);
+    UI::ParticleText(particle.VisualPosition(), text);
 }
 
 void ParticleFreeText(ParticleEffect &effect, void *userData)
@@ -283,4 +471,4 @@ void ParticleFreeText(ParticleEffect &effect, void *userData)
     DLB_ASSERT(userData);
     char *text = (char *)userData;
     free(text);
-}
\ No newline at end of file
+}
@@ -1,26 +1,20 @@
 #pragma once
-#include "body.h"
 #include "draw_command.h"
 #include "catalog/particle_fx.h"
 #include "sprite.h"
 #include "raylib/raylib.h"
+#include <cstdint>
+#include <vector>
 
-struct ParticleEffect;
-
-struct Particle : Drawable {
-    ParticleEffect *effect  {};  // parent effect, 0 = dead
-    Particle       *next    {};  // when alive, next particle in effect. when dead, intrusive free list.
-    Body3D          body    {};  // physics body
-    Sprite          sprite  {};
-    const char      *text   {};  // text to render (instead of sprite)
-    Color           color   {};  // particle color (tint if particle also has sprite)
-    double          spawnAt {};  // time to spawn
-    bool            alive   {};  // currently alive
-    double          dieAt   {};  // time to die
-
-    float Depth(void) const;
-    bool  Cull(const Rectangle& cullRect) const;
-    void  Draw(World &world, Vector2 at) const override;
+struct ParticleSystem;
+
+// What particle callbacks get to see of a single particle
+struct ParticleView {
+    Vector3 position {};
+    float   scale    {};
+    Color   color    {};
+
+    Vector2 VisualPosition(void) const;
 };
 
 //-----------------------------------------------------------------------------
@@ -32,9 +26,7 @@ enum class ParticleEffect_Event {
 };
 
 enum class ParticleEffect_ParticleEvent {
-    AfterUpdate,
     Draw,
-    Died,
     Count
 };
 
@@ -44,7 +36,7 @@ struct ParticleEffect_Callback {
 };
 
 struct ParticleEffect_ParticleCallback {
-    void (*callback)(struct Particle &particle, void *userData);
+    void (*callback)(const ParticleView &particle, void *userData);
     void *userData{};
 };
 
@@ -75,50 +67,90 @@ struct ParticleEffectParams {
 
 struct ParticleEffect {
     Catalog::ParticleEffectID id            {};  // itemClass of particle effect
+    size_t                    first         {};  // index of the effect's first particle in ParticleSystem's lanes
+    size_t                    count         {};  // number of particles the effect owns, dead or not
     size_t                    particlesLeft {};  // number of particles that are pending or alive (i.e. not dead)
     Vector3                   origin        {};  // origin of particle effect
     double                    duration      {};  // time to play effect for
     double                    startedAt     {};  // time started
     Sprite                    sprite        {};  // sprite to be used for all particles.. for now
     ParticleEffectParams      params        {};  // parameters
-    ParticleEffect            *next         {};  // when dead, intrusive free list
 
     ParticleEffect_Callback effectCallbacks[(size_t)ParticleEffect_Event::Count]{};
     ParticleEffect_ParticleCallback particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Count]{};
 };
 
-//-----------------------------------------------------------------------------
+// Particles only exist as a slot in each of the particle system's lanes, this stands in for one in the draw list
+struct ParticleDrawable : Drawable {
+    const ParticleSystem *system   {};
+    uint32_t              effect   {};
+    uint32_t              particle {};
 
-#define MAX_EFFECTS   32
-#define MAX_PARTICLES 1024
+    void Draw(World &world, Vector2 at) const override;
+};
 
-struct ParticleSystem {
-    ParticleSystem  (void);
-    ~ParticleSystem (void);
+//-----------------------------------------------------------------------------
 
-    size_t ParticlesActive (void);
-    size_t EffectsActive   (void);
+enum ParticleState : uint8_t {
+    ParticleState_Pending,  // waiting for spawnAt
+    ParticleState_Alive,
+    ParticleState_Dead,     // waiting for the rest of its effect to die
+};
 
-    Particle *ParticlePool(void);
+struct ParticleSystem {
+    size_t ParticlesActive (void) const;
+    size_t EffectsActive   (void) const;
 
+    // Returned effect is only valid until the next GenerateEffect or Update, set its callbacks right away
     ParticleEffect *GenerateEffect(Catalog::ParticleEffectID type, Vector3 origin, const ParticleEffectParams &par);
     void Update  (double dt);
     void PushAll (DrawList &drawList);
 
 private:
-    Particle *Alloc (void);
-
-    ParticleEffect  effects[MAX_EFFECTS] {};
-    ParticleEffect *effectsFree          {};
-    size_t          effectsActiveCount   {};
-
-    Particle  particles[MAX_PARTICLES] {};
-    Particle *particlesFree            {};
-    size_t    particlesActiveCount     {};
+    friend struct ParticleDrawable;
+
+    // In the same order as their particles are in the lanes
+    std::vector<ParticleEffect> effects {};
+
+    // Particle state, one lane per attribute so that each batch loop only streams through what it uses. An effect's
+    // particles are contiguous, and are compacted away once all of them have died.
+    std::vector<uint8_t> state      {};  // ParticleState
+    std::vector<float>   spawnAt    {};  // secs after the effect started
+    std::vector<float>   invLife    {};  // 1 / lifespan in secs
+    std::vector<float>   alpha      {};  // 0 at spawn -> 1 at death, as of the last Update
+    std::vector<float>   posX       {};  // offset from the effect's origin until spawned, world position after
+    std::vector<float>   posY       {};
+    std::vector<float>   posZ       {};
+    std::vector<float>   velX       {};
+    std::vector<float>   velY       {};
+    std::vector<float>   velZ       {};
+    std::vector<uint8_t> bounced    {};  // hit the ground and bounced during the last Update
+    std::vector<float>   scale      {};
+    std::vector<Color>   spawnColor {};
+    std::vector<Color>   color      {};
+
+    std::vector<ParticleDrawable> drawables {};  // rebuilt by PushAll, must outlive the draw list's Flush
+
+    template <typename F>
+    void ForEachLane(F &&fn)
+    {
+        fn(state); fn(spawnAt); fn(invLife); fn(alpha);
+        fn(posX); fn(posY); fn(posZ); fn(velX); fn(velY); fn(velZ); fn(bounced);
+        fn(scale); fn(spawnColor); fn(color);
+    }
+
+    void   Emit           (const ParticleEffect &effect, const Catalog::ParticleEffectDef &def);
+    void   UpdateLife     (ParticleEffect &effect);
+    void   UpdatePhysics  (const ParticleEffect &effect, const Catalog::ParticleEffectDef &def, float dt);
+    void   UpdateLook     (const ParticleEffect &effect, const Catalog::ParticleEffectDef &def);
+    void   Compact        (void);
+    Sprite ParticleSprite (const ParticleEffect &effect, size_t i) const;
+    ParticleView View     (size_t i) const;
+    void   DrawParticle   (size_t effectIdx, size_t i) const;
 };
 
 //-----------------------------------------------------------------------------
 
 void ParticlesFollowPlayerGut(ParticleEffect &effect, void *userData);
-void ParticleDrawText(Particle &particle, void *userData);
+void ParticleDrawText(const ParticleView &particle, void *userData);
 void ParticleFreeText(ParticleEffect &effect, void *userData);
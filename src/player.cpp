@@ -219,8 +219,7 @@ void Player::Update(InputSample &input, Tilemap &map)
         }
 
         const Vector2 pos = body.GroundPosition();
-        const Tile *tile = map.TileAtWorld(pos.x, pos.y);
-        if (tile && tile->type == TileType_Water) {
+        if (map.IsSwimmable(pos.x, pos.y)) {
             speed *= 0.5f;
             // TODO: moveState = Player::MoveState::Swimming;
         }
@@ -233,50 +232,14 @@ void Player::Update(InputSample &input, Tilemap &map)
         }
 
         if (!v2_is_zero(moveBuffer)) {
-            const bool walkable = tile && tile->IsWalkable();
-
-            Vector2 newPos = v2_add(pos, moveBuffer);
-            const Tile *newTile = map.TileAtWorld(newPos.x, newPos.y);
-            bool newWalkable = newTile && newTile->IsWalkable();
-
-            // NOTE: This extra logic allows the player to slide when attempting to move diagonally against a wall
-            // NOTE: If current tile isn't walkable, allow player to walk off it. This may not be the best solution
-            // if the player can accidentally end up on unwalkable tiles through gameplay, but currently the only
-            // way to end up on an unwalkable tile is to spawn there.
+            // NOTE: Slides along unwalkable tiles. If the current tile isn't walkable, the player is allowed to
+            // walk off of it. This may not be the best solution if the player can accidentally end up on unwalkable
+            // tiles through gameplay, but currently the only way to end up on an unwalkable tile is to spawn there.
             // TODO: We should fix spawning to ensure player spawns on walkable tile (can probably just manually
             // generate something interesting in the center of the world that overwrites procgen, like Don't
             // Starve's fancy arrival portal).
-            if (walkable) {
-                if (!newWalkable) {
-                    // XY unwalkable, try only X offset
-                    newPos = pos;
-                    newPos.x += moveBuffer.x;
-                    newTile = map.TileAtWorld(newPos.x, newPos.y);
-                    newWalkable = newTile && newTile->IsWalkable();
-                    if (!newWalkable) {
-                        // X unwalkable, try only Y offset
-                        newPos = pos;
-                        newPos.y += moveBuffer.y;
-                        newTile = map.TileAtWorld(newPos.x, newPos.y);
-                        newWalkable = newTile && newTile->IsWalkable();
-                        if (!newWalkable) {
-                            // XY, and both slide directions are all unwalkable
-                            moveBuffer.x = 0.0f;
-                            moveBuffer.y = 0.0f;
-
-                            // TODO: Play wall bonk sound (or splash for water? heh)
-                            // TODO: Maybe bounce the player against the wall? This code doesn't do that nicely..
-                            //player_move(&charlie, v2_scale(v2_negate(moveBuffer), 10.0f));
-                        } else {
-                            // Y offset is walkable
-                            moveBuffer.x = 0.0f;
-                        }
-                    } else {
-                        // X offset is walkable
-                        moveBuffer.y = 0.0f;
-                    }
-                }
-            }
+            // TODO: Play wall bonk sound (or splash for water? heh) when the sweep gets blocked
+            moveBuffer = map.SweepMove(pos, moveBuffer, TileBlock_Solid);
 
             const bool moved = Move(moveBuffer);
             if (moved) {
@@ -289,11 +252,9 @@ void Player::Update(InputSample &input, Tilemap &map)
                 }
             }
 #if 0
-            printf("[%s] %s %s -> %s, + %.02f, %.02f %.02f, %.02f -> %.02f, %.02f\n",
+            printf("[%s] %s, + %.02f, %.02f %.02f, %.02f -> %.02f, %.02f\n",
                 g_clock.server ? "                                                                            SRV" : "CLI",
                 moved ? "M" : "-",
-                walkable ? "-" : "C",
-                newWalkable ? "-" : "C",
                 moveOffset.x,
                 moveOffset.y,
                 pos.x,
@@ -63,6 +63,8 @@ struct PlayerInventory {
         ItemStack stack{};
     };
 
+    // Every slot with a count holds a reference to its item in g_item_db (see ItemDatabase). Copies of an inventory
+    // (e.g. snapshots) don't, call RetainItems() on a copy that's going to be kept around as a player's inventory.
     SlotId selectedSlot {};  // NOTE: for hotbar, needs rework
     Slot   slots        [SlotId_Count]{};
     bool   dirty        {true};  // Used server-side to determine whether client needs a new inv snapshot
@@ -79,6 +81,24 @@ struct PlayerInventory {
         max = Vector2{ (u0 + ITEM_W) / invItems.width, (v0 + ITEM_H) / invItems.height };
     }
 
+    void RetainItems(void)
+    {
+        for (Slot &slot : slots) {
+            if (slot.stack.count) {
+                g_item_db.AddRef(slot.stack.uid);
+            }
+        }
+    }
+
+    void ReleaseItems(void)
+    {
+        for (Slot &slot : slots) {
+            if (slot.stack.count) {
+                g_item_db.Release(slot.stack.uid);
+            }
+        }
+    }
+
     // Returns true if something was picked up by player
     bool PickUp(ItemStack &srcStack)
     {
@@ -86,8 +106,10 @@ struct PlayerInventory {
             return false;
         }
 
+        // Temp slot holds its own reference like any other, srcStack's holder keeps its reference either way
         Slot srcSlot{};
         srcSlot.stack = srcStack;
+        g_item_db.AddRef(srcSlot.stack.uid);
 
         for (SlotId slotId = 0; slotId < SlotId_Count; slotId++) {
             Slot &dstSlot = GetInvSlot(slotId);
@@ -99,6 +121,9 @@ struct PlayerInventory {
 
         bool pickup = srcSlot.stack.count != srcStack.count;
         srcStack.count = srcSlot.stack.count;
+        if (srcSlot.stack.count) {
+            g_item_db.Release(srcSlot.stack.uid);
+        }
         return pickup;
     }
 
@@ -160,14 +185,16 @@ struct PlayerInventory {
         uint32_t maxCanTransfer = MIN(src.stack.count, dstFreeSpace);
         uint32_t transfer = transferLimit ? MIN(maxCanTransfer, transferLimit) : maxCanTransfer;
         if (!skipUpdate) {
+            if (!dst.stack.count) {
+                g_item_db.AddRef(item.uid);
+            }
             src.stack.count -= transfer;
             if (!src.stack.count) {
                 src.stack.uid = 0;
+                g_item_db.Release(item.uid);
             }
             dst.stack.count += transfer;
-            if (dst.stack.count) {
-                dst.stack.uid = item.uid;
-            }
+            dst.stack.uid = item.uid;
             dirty = true;
         }
         if (dstFull) *dstFull = (dst.stack.count == stackLimit);
@@ -226,10 +253,14 @@ struct PlayerInventory {
         return success;
     }
 
+    // The dropped stack's item stays valid until the end of the tick (see ItemDatabase::Reclaim), spawn it or lose it
     ItemStack SlotDrop(SlotId slotId, uint32_t count)
     {
         Slot dropSlot{};
         TransferSlot(GetInvSlot(slotId), dropSlot, count, false);
+        if (dropSlot.stack.count) {
+            g_item_db.Release(dropSlot.stack.uid);
+        }
         return dropSlot.stack;
     }
 
@@ -164,7 +164,11 @@ void sprite_draw_body(const Sprite &sprite, const Body3D &body, const Color &col
         #endif
     }
 
-    Vector3 worldPos = body.WorldPosition();
+    sprite_draw_at(sprite, body.WorldPosition(), color);
+}
+
+void sprite_draw_at(const Sprite &sprite, Vector3 worldPos, const Color &color)
+{
     worldPos.x = floorf(worldPos.x);
     worldPos.y = floorf(worldPos.y);
     worldPos.z = floorf(worldPos.z);
@@ -21,3 +21,4 @@ Vector3            sprite_center     (const Sprite &sprite);
 void               sprite_update     (      Sprite &sprite, double dt);
 bool               sprite_cull_body  (const Sprite &sprite, const struct Body3D &body, Rectangle cullRect);
 void               sprite_draw_body  (const Sprite &sprite, const struct Body3D &body, const Color &color);
+void               sprite_draw_at    (const Sprite &sprite, Vector3 worldPos, const Color &color);
@@ -2,6 +2,7 @@
 #include "body.h"
 #include "helpers.h"
 #include "raylib/raylib.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -50,6 +51,8 @@
     PATH_SEPARATOR \
     FILENAME
 
+const char *Spritesheet::LOG_SRC = "Spritesheet";
+
 struct Token {
     enum class Type {
         Unknown,
@@ -362,9 +365,12 @@ ErrorType Scanner::ParseHeader(Spritesheet &spritesheet)
     // texture path
     DiscardWhitespaceNewlinesComments();
     char texturePath[256] = {};
+    const size_t texturePathStart = cursor;
     if (ConsumeString_Path(texturePath, sizeof(texturePath) - 1) != ErrorType::Success) {
         E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Expected texture_path. " USAGE "\n", fileName);
     }
+    spritesheet.texturePath.text = text + texturePathStart;
+    spritesheet.texturePath.length = cursor - texturePathStart;
 
     //--------------------------------------------------------------------------------
     // Initialization, not parsing.. but it seems appropriate for it to live here?
@@ -380,12 +386,6 @@ ErrorType Scanner::ParseHeader(Spritesheet &spritesheet)
     // Allocate memory for sprites
     // TODO: Handle bad_alloc?
     spritesheet.sprites.reserve(spriteCount);
-
-    // Load spritesheet texture
-    spritesheet.texture = LoadTexture(texturePath);
-    if (!spritesheet.texture.width) {
-        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Failed to load spritesheet texture [path: %s].\n", fileName, texturePath);
-    }
     //--------------------------------------------------------------------------------
 
     return ErrorType::Success;
@@ -483,6 +483,7 @@ ErrorType Scanner::ParseSprite(SpriteDef &sprite)
     if (!sprite.name.length) {
         E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Expected name.\n" USAGE, fileName);
     }
+    sprite.id = sprite_id(sprite.name.text, sprite.name.length);
 
     // directional animations
     for (int i = 0; i < (int)Direction::Count; i++) {
@@ -554,28 +555,249 @@ ErrorType Scanner::ParseSpritesheet(Spritesheet &spritesheet)
     return ErrorType::Success;
 }
 
+static uint32_t spritesheet_bin_string(std::vector<char> &strings, StringView str)
+{
+    const uint32_t offset = (uint32_t)strings.size();
+    strings.insert(strings.end(), str.text, str.text + str.length);
+    strings.push_back(0);
+    return offset;
+}
+
+ErrorType Spritesheet::Compile(const char *filename, const char *text, size_t length, std::vector<char> &bin)
+{
+    Spritesheet &source = *(new Spritesheet{});
+    Scanner scanner = {};
+    scanner.fileName = filename;
+    scanner.text = text;
+    scanner.length = length;
+    ErrorType err = scanner.ParseSpritesheet(source);
+    if (err == ErrorType::Success && !source.texturePath.length) {
+        E_WARN("'%s': Missing spritesheet header.", filename);
+        err = ErrorType::FileReadFailed;
+    }
+    if (err != ErrorType::Success) {
+        delete &source;
+        return err;
+    }
+
+    std::vector<char> strings{};
+    SpritesheetBinHeader header{};
+    header.magic = SPRITESHEET_BIN_MAGIC;
+    header.version = SPRITESHEET_BIN_VERSION;
+    header.frameCount = (uint32_t)source.frames.size();
+    header.animationCount = (uint32_t)source.animations.size();
+    header.spriteCount = (uint32_t)source.sprites.size();
+    header.texturePath.offset = spritesheet_bin_string(strings, source.texturePath);
+    header.texturePath.length = (uint32_t)source.texturePath.length;
+
+    std::vector<SpritesheetBinFrame> frames{};
+    for (const SpriteFrame &frame : source.frames) {
+        SpritesheetBinFrame &binFrame = frames.emplace_back();
+        binFrame.name.offset = spritesheet_bin_string(strings, frame.name);
+        binFrame.name.length = (uint32_t)frame.name.length;
+        binFrame.x = frame.x;
+        binFrame.y = frame.y;
+        binFrame.width = frame.width;
+        binFrame.height = frame.height;
+    }
+
+    std::vector<SpritesheetBinAnim> animations{};
+    for (const SpriteAnim &animation : source.animations) {
+        SpritesheetBinAnim &binAnim = animations.emplace_back();
+        binAnim.name.offset = spritesheet_bin_string(strings, animation.name);
+        binAnim.name.length = (uint32_t)animation.name.length;
+        binAnim.frameCount = (uint32_t)animation.frameCount;
+        memcpy(binAnim.frames, animation.frames, sizeof(binAnim.frames));
+    }
+
+    std::vector<SpritesheetBinSprite> sprites{};
+    std::vector<SpriteLookup> lookup{};
+    for (const SpriteDef &sprite : source.sprites) {
+        SpritesheetBinSprite &binSprite = sprites.emplace_back();
+        binSprite.id = sprite.id;
+        binSprite.name.offset = spritesheet_bin_string(strings, sprite.name);
+        binSprite.name.length = (uint32_t)sprite.name.length;
+        memcpy(binSprite.animations, sprite.animations, sizeof(binSprite.animations));
+        lookup.push_back({ sprite.id, (uint32_t)lookup.size() });
+    }
+    std::sort(lookup.begin(), lookup.end(),
+        [](const SpriteLookup &a, const SpriteLookup &b) { return a.id < b.id; }
+    );
+    for (size_t i = 1; i < lookup.size(); i++) {
+        if (lookup[i].id == lookup[i - 1].id) {
+            const SpriteDef &a = source.sprites[lookup[i - 1].index];
+            const SpriteDef &b = source.sprites[lookup[i].index];
+            E_WARN("'%s': Sprites '%.*s' and '%.*s' have the same id (%08x), rename one of them.", filename,
+                (int)a.name.length, a.name.text, (int)b.name.length, b.name.text, a.id);
+            delete &source;
+            return ErrorType::AllocFailed_Duplicate;
+        }
+    }
+    header.stringsSize = (uint32_t)strings.size();
+    delete &source;
+
+    bin.clear();
+    bin.insert(bin.end(), (const char *)&header, (const char *)(&header + 1));
+    bin.insert(bin.end(), (const char *)frames.data(), (const char *)(frames.data() + frames.size()));
+    bin.insert(bin.end(), (const char *)animations.data(), (const char *)(animations.data() + animations.size()));
+    bin.insert(bin.end(), (const char *)sprites.data(), (const char *)(sprites.data() + sprites.size()));
+    bin.insert(bin.end(), (const char *)lookup.data(), (const char *)(lookup.data() + lookup.size()));
+    bin.insert(bin.end(), strings.begin(), strings.end());
+    return ErrorType::Success;
+}
+
+ErrorType Spritesheet::LoadBinary(const char *filename, char *data, unsigned int size)
+{
+    Unload();
+    buf = data;
+    bufLength = size;
+
+    SpritesheetBinHeader header{};
+    if (!buf || bufLength < sizeof(header)) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Too small to be a compiled spritesheet.", filename);
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (header.magic != SPRITESHEET_BIN_MAGIC || header.version != SPRITESHEET_BIN_VERSION) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Not a compiled spritesheet, or wrong version (%u).", filename, header.version);
+    }
+
+    const size_t framesOffset = sizeof(header);
+    const size_t animationsOffset = framesOffset + (size_t)header.frameCount * sizeof(SpritesheetBinFrame);
+    const size_t spritesOffset = animationsOffset + (size_t)header.animationCount * sizeof(SpritesheetBinAnim);
+    const size_t lookupOffset = spritesOffset + (size_t)header.spriteCount * sizeof(SpritesheetBinSprite);
+    const size_t stringsOffset = lookupOffset + (size_t)header.spriteCount * sizeof(SpriteLookup);
+    if (stringsOffset + header.stringsSize != bufLength) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Size doesn't match header (%u bytes).", filename, bufLength);
+    }
+
+    const char *strings = buf + stringsOffset;
+    auto toView = [&](const SpritesheetBinString &str, StringView &view) {
+        if (str.offset > header.stringsSize || str.length >= header.stringsSize - str.offset || strings[str.offset + str.length]) {
+            return false;
+        }
+        view.text = strings + str.offset;
+        view.length = str.length;
+        return true;
+    };
+    if (!toView(header.texturePath, texturePath) || !texturePath.length) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Bad texture path.", filename);
+    }
+
+    const SpritesheetBinFrame *binFrames = (const SpritesheetBinFrame *)(buf + framesOffset);
+    frames.reserve(header.frameCount);
+    for (size_t i = 0; i < header.frameCount; i++) {
+        const SpritesheetBinFrame &binFrame = binFrames[i];
+        SpriteFrame &frame = frames.emplace_back(this);
+        if (!toView(binFrame.name, frame.name) || binFrame.x < 0 || binFrame.y < 0 || binFrame.width <= 0 || binFrame.height <= 0) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Bad frame %zu.", filename, i);
+        }
+        frame.x = binFrame.x;
+        frame.y = binFrame.y;
+        frame.width = binFrame.width;
+        frame.height = binFrame.height;
+    }
+
+    const SpritesheetBinAnim *binAnims = (const SpritesheetBinAnim *)(buf + animationsOffset);
+    animations.reserve(header.animationCount);
+    for (size_t i = 0; i < header.animationCount; i++) {
+        const SpritesheetBinAnim &binAnim = binAnims[i];
+        SpriteAnim &animation = animations.emplace_back(this);
+        bool valid = toView(binAnim.name, animation.name) && binAnim.frameCount && binAnim.frameCount <= SPRITEANIM_MAX_FRAMES;
+        for (size_t j = 0; valid && j < binAnim.frameCount; j++) {
+            valid = binAnim.frames[j] >= 0 && (uint32_t)binAnim.frames[j] < header.frameCount;
+        }
+        if (!valid) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Bad animation %zu.", filename, i);
+        }
+        animation.frameCount = binAnim.frameCount;
+        memcpy(animation.frames, binAnim.frames, sizeof(animation.frames));
+    }
+
+    const SpritesheetBinSprite *binSprites = (const SpritesheetBinSprite *)(buf + spritesOffset);
+    sprites.reserve(header.spriteCount);
+    for (size_t i = 0; i < header.spriteCount; i++) {
+        const SpritesheetBinSprite &binSprite = binSprites[i];
+        SpriteDef &sprite = sprites.emplace_back(this);
+        bool valid = toView(binSprite.name, sprite.name);
+        for (int j = 0; valid && j < (int)Direction::Count; j++) {
+            valid = binSprite.animations[j] >= -1 && binSprite.animations[j] < (int32_t)header.animationCount;
+        }
+        if (!valid) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Bad sprite %zu.", filename, i);
+        }
+        sprite.id = binSprite.id;
+        memcpy(sprite.animations, binSprite.animations, sizeof(sprite.animations));
+    }
+
+    const SpriteLookup *lookup = (const SpriteLookup *)(buf + lookupOffset);
+    for (size_t i = 0; i < header.spriteCount; i++) {
+        if (lookup[i].index >= header.spriteCount || sprites[lookup[i].index].id != lookup[i].id || (i && lookup[i].id <= lookup[i - 1].id)) {
+            E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Bad sprite lookup table.", filename);
+        }
+    }
+    spriteLookup = lookup;
+    return ErrorType::Success;
+}
+
 ErrorType Spritesheet::LoadFromFile(const char *filename)
 {
-    buf = (char *)LoadFileData(filename, &bufLength);
-    if (!buf) {
+    unsigned int length = 0;
+    char *data = (char *)LoadFileData(filename, &length);
+    if (!data) {
         E_ERROR_RETURN(ErrorType::FileReadFailed, "Failed to read file %s", filename);
     }
 
-    Scanner scanner = {};
-    scanner.fileName = filename;
-    scanner.text = buf;
-    scanner.length = bufLength;
+    uint32_t magic = 0;
+    if (length >= sizeof(magic)) {
+        memcpy(&magic, data, sizeof(magic));
+    }
+    if (magic != SPRITESHEET_BIN_MAGIC) {
+        std::vector<char> bin{};
+        ErrorType err = Compile(filename, data, length, bin);
+        UnloadFileData((unsigned char *)data);
+        E_ERROR_RETURN(err, "Failed to compile %s", filename);
+
+        length = (unsigned int)bin.size();
+        data = (char *)MemAlloc(length);
+        memcpy(data, bin.data(), length);
+    }
+    E_ERROR_RETURN(LoadBinary(filename, data, length), "Failed to load %s", filename);
+
+    // Decode spritesheet texture, uploaded later by UploadTexture() on the render thread
+    image = LoadImage(texturePath.text);
+    if (!image.width) {
+        E_ERROR_RETURN(ErrorType::FileReadFailed, "'%s': Failed to load spritesheet texture [path: %s].\n", filename, texturePath.text);
+    }
+    return ErrorType::Success;
+}
 
-    return scanner.ParseSpritesheet(*this);
+void Spritesheet::UploadTexture(void)
+{
+    if (!image.data) {
+        return;
+    }
+    texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    image = {};
 }
 
-Spritesheet::~Spritesheet()
+void Spritesheet::Unload(void)
 {
     frames.clear();
     animations.clear();
     sprites.clear();
-    UnloadTexture(texture);
+    spriteLookup = 0;
+    texturePath = {};
     UnloadFileData((unsigned char *)buf);
+    buf = 0;
+    bufLength = 0;
+}
+
+Spritesheet::~Spritesheet()
+{
+    Unload();
+    UnloadImage(image);
+    UnloadTexture(texture);
 }
 
 void SpriteFrame::Draw(World &world, Vector2 at) const
@@ -599,15 +821,15 @@ void SpriteFrame::Draw(World &world, Vector2 at) const
     DrawTextureRec(spritesheet->texture, frameRect, topLeft, WHITE);
 }
 
-const SpriteDef *Spritesheet::FindSprite(const char *name) const
+const SpriteDef *Spritesheet::FindSprite(SpriteID id) const
 {
-    // TODO: Hash table if the # of sprites per sheet grows to > 16.. or make SpriteID / sprite catalog?
-    for (const SpriteDef &sprite : sprites) {
-        if (!strncmp(sprite.name.text, name, sprite.name.length)) {
-            return &sprite;
-        }
-    }
-
-    // TODO: Return reference to some ugly placeholder sprite instead
-    return 0;
-}
\ No newline at end of file
+    const SpriteLookup *end = spriteLookup + sprites.size();
+    const SpriteLookup *lookup = std::lower_bound(spriteLookup, end, id,
+        [](const SpriteLookup &lookup, SpriteID id) { return lookup.id < id; }
+    );
+    if (lookup == end || lookup->id != id) {
+        // TODO: Return reference to some ugly placeholder sprite instead
+        return 0;
+    }
+    return &sprites[lookup->index];
+}
@@ -2,10 +2,32 @@
 #include "direction.h"
 #include "string_view.h"
 #include "raylib/raylib.h"
+#include <cstdint>
 #include <vector>
 
 struct Spritesheet;
 
+typedef uint32_t SpriteID;  // hash of a sprite's name, see sprite_id()
+
+// FNV-1a rather than murmur3 so that it's constexpr, call sites with a fixed sprite name look it up by a constant
+constexpr SpriteID sprite_id(const char *name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr SpriteID sprite_id(const char *name)
+{
+    size_t length = 0;
+    while (name[length]) {
+        length++;
+    }
+    return sprite_id(name, length);
+}
+
 struct SpriteFrame : Drawable {
     StringView          name        {};  // name of frame
     const Spritesheet * spritesheet {};  // parent spritesheet
@@ -31,6 +53,7 @@ struct SpriteAnim {
 };
 
 struct SpriteDef {
+    SpriteID            id          {};  // sprite_id(name), precomputed by the spritesheet compiler
     StringView          name        {};  // name of sprite
     const Spritesheet * spritesheet {};  // parent spritesheet
     int animations[(int)Direction::Count]{};  // animation index (spritesheet->animations)
@@ -41,18 +64,79 @@ private:
     SpriteDef() = default;
 };
 
+#define SPRITESHEET_BIN_MAGIC   0x53534C53  // "SLSS"
+#define SPRITESHEET_BIN_VERSION 1
+#define SPRITESHEET_BIN_EXT     ".sheet"    // compiled spritesheets sit next to their .txt source
+
+// Compiled spritesheet, built from the .txt format by tools/spritesheet_compiler.cpp. Layout: header, frames,
+// animations, sprites, sprite lookup table sorted by id, then the string table every name points into. Strings are nul
+// terminated so that the texture path can be handed straight to raylib.
+struct SpritesheetBinString {
+    uint32_t offset {};  // into the string table
+    uint32_t length {};  // without the nul terminator
+};
+
+struct SpritesheetBinHeader {
+    uint32_t             magic          {};
+    uint32_t             version        {};
+    uint32_t             frameCount     {};
+    uint32_t             animationCount {};
+    uint32_t             spriteCount    {};
+    uint32_t             stringsSize    {};
+    SpritesheetBinString texturePath    {};
+};
+
+struct SpritesheetBinFrame {
+    SpritesheetBinString name   {};
+    int32_t              x      {};
+    int32_t              y      {};
+    int32_t              width  {};
+    int32_t              height {};
+};
+
+struct SpritesheetBinAnim {
+    SpritesheetBinString name       {};
+    uint32_t             frameCount {};
+    int32_t              frames     [SPRITEANIM_MAX_FRAMES]{};
+};
+
+struct SpritesheetBinSprite {
+    SpriteID             id         {};
+    SpritesheetBinString name       {};
+    int32_t              animations [(int)Direction::Count]{};
+};
+
+struct SpriteLookup {
+    SpriteID id    {};
+    uint32_t index {};  // into Spritesheet::sprites
+};
+
 struct Spritesheet {
-    Texture                  texture    {};  // spritesheet texture
-    std::vector<SpriteFrame> frames     {};  // array of frames
-    std::vector<SpriteAnim>  animations {};  // array of animations
-    std::vector<SpriteDef>   sprites    {};  // array of sprites definitions
-    unsigned int             bufLength  {};  // length of file buffer in memory
-    char *                   buf        {};  // file buffer (needs to be freed with UnloadFileData())
+    Texture                  texture      {};  // spritesheet texture
+    Image                    image        {};  // decoded texture, only until UploadTexture()
+    StringView               texturePath  {};  // nul terminated
+    std::vector<SpriteFrame> frames       {};  // array of frames
+    std::vector<SpriteAnim>  animations   {};  // array of animations
+    std::vector<SpriteDef>   sprites      {};  // array of sprites definitions
+    const SpriteLookup *     spriteLookup {};  // sprites.size() entries sorted by id, points into buf
+    unsigned int             bufLength    {};  // length of file buffer in memory
+    char *                   buf          {};  // compiled spritesheet (needs to be freed with UnloadFileData())
 
     ~Spritesheet();
+    // Loads a compiled spritesheet, or compiles a .txt one in memory first, then decodes the texture. Doesn't touch the
+    // GPU (safe on a worker).
     ErrorType LoadFromFile(const char *filename);
-    const SpriteDef *FindSprite(const char *name) const;
+    // Takes ownership of data (allocated with MemAlloc or LoadFileData), names are left pointing into it
+    ErrorType LoadBinary(const char *filename, char *data, unsigned int size);
+    void UploadTexture(void);  // render thread only
+    const SpriteDef *FindSprite(SpriteID id) const;
+    const SpriteDef *FindSprite(const char *name) const { return FindSprite(sprite_id(name)); }
+
+    // Parse the .txt format into the compiled format
+    static ErrorType Compile(const char *filename, const char *text, size_t length, std::vector<char> &bin);
 
 private:
-    const char *LOG_SRC = "Spritesheet";
+    static const char *LOG_SRC;
+
+    void Unload(void);
 };
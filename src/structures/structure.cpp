@@ -4,19 +4,138 @@
 
 #include "vault.cpp"
 
-void Structure::Spawn(Tilemap &map, float x, float y)
+thread_local static Prefab g_prefabs[Structure_Count]{};
+
+// Floor division, so that negative tile coords map to the correct chunk
+static inline int32_t structure_floor_div(int32_t a, int32_t b)
+{
+    return (a >= 0) ? (a / b) : ((a - b + 1) / b);
+}
+
+void Prefab::Load(const char *grid, uint32_t gridW, uint32_t gridH)
+{
+    DLB_ASSERT(gridW <= UINT8_MAX);
+    DLB_ASSERT(gridH <= UINT8_MAX);
+    w = (uint8_t)gridW;
+    h = (uint8_t)gridH;
+    runs.clear();
+
+    for (uint32_t y = 0; y < gridH; y++) {
+        PrefabRun run{};
+        for (uint32_t x = 0; x < gridW; x++) {
+            Tile tile{};
+            bool empty = false;
+            switch (grid[y * gridW + x]) {
+                case 'g': tile.type = TileType_Grass; break;
+                case 'w': tile.type = TileType_Water; break;
+                case 'x': tile.type = TileType_Wood;  break;
+                default: empty = true; break;
+            }
+
+            const bool extendsRun = run.length && !empty && tile.type == run.tile.type && tile.object.type == run.tile.object.type &&
+                tile.object.flags == run.tile.object.flags;
+            if (extendsRun) {
+                run.length++;
+                continue;
+            }
+            if (run.length) {
+                runs.push_back(run);
+                run = {};
+            }
+            if (!empty) {
+                run.x = (uint8_t)x;
+                run.y = (uint8_t)y;
+                run.length = 1;
+                run.tile = tile;
+            }
+        }
+        if (run.length) {
+            runs.push_back(run);
+        }
+    }
+}
+
+void Structure::LoadPrefabs(void)
+{
+    g_prefabs[Structure_Vault].Load(g_structure_vault, g_structure_vault_w, g_structure_vault_h);
+}
+
+const Prefab &Structure::FindPrefab(StructureType type)
+{
+    DLB_ASSERT(type < Structure_Count);
+    return g_prefabs[type];
+}
+
+void Structure::Spawn(Tilemap &map, StructureType type, float x, float y)
 {
-    for (uint32_t j = 0; j < g_structure_vault_h; j += TILE_W) {
-        for (uint32_t i = 0; i < g_structure_vault_w; i += TILE_W) {
-            Tile *tile = (Tile *)map.TileAtWorld(x + (float)i, y + (float)j);
-            if (tile) {
-                switch (g_structure_vault[j * g_structure_vault_w + i]) {
-                    case '.': continue;
-                    case 'g': tile->type = TileType_Grass; break;
-                    case 'w': tile->type = TileType_Water; break;
-                    case 'x': tile->type = TileType_Wood;  break;
+    DLB_ASSERT(type < Structure_Count);
+    const Prefab &prefab = g_prefabs[type];
+    DLB_ASSERT(prefab.w);  // LoadPrefabs() not called?
+
+    PrefabStamp stamp{};
+    stamp.type = type;
+    stamp.tileX = (int32_t)floorf(x / TILE_W);
+    stamp.tileY = (int32_t)floorf(y / TILE_W);
+
+    const int32_t chunkMinX = structure_floor_div(stamp.tileX, CHUNK_W);
+    const int32_t chunkMinY = structure_floor_div(stamp.tileY, CHUNK_H);
+    const int32_t chunkMaxX = structure_floor_div(stamp.tileX + prefab.w - 1, CHUNK_W);
+    const int32_t chunkMaxY = structure_floor_div(stamp.tileY + prefab.h - 1, CHUNK_H);
+
+    for (int32_t chunkY = chunkMinY; chunkY <= chunkMaxY; chunkY++) {
+        for (int32_t chunkX = chunkMinX; chunkX <= chunkMaxX; chunkX++) {
+            const ChunkHash chunkHash = Chunk::Hash((int16_t)chunkX, (int16_t)chunkY);
+            Chunk *chunk = map.FindChunk(chunkHash);
+            if (chunk) {
+                if (StampChunk(*chunk, stamp)) {
+                    map.dirtyChunks.insert(chunkHash);
                 }
+            } else {
+                map.pendingStamps[chunkHash].push_back(stamp);
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void Structure::ApplyPending(Tilemap &map, Chunk &chunk)
+{
+    auto pendingIter = map.pendingStamps.find(chunk.Hash());
+    if (pendingIter == map.pendingStamps.end()) {
+        return;
+    }
+
+    for (const PrefabStamp &stamp : pendingIter->second) {
+        StampChunk(chunk, stamp);
+    }
+    map.pendingStamps.erase(pendingIter);
+
+    // Chunk was just generated, nobody has seen the tiles before the stamp yet
+    memset(chunk.dirty, 0, sizeof(chunk.dirty));
+}
+
+bool Structure::StampChunk(Chunk &chunk, const PrefabStamp &stamp)
+{
+    const Prefab &prefab = g_prefabs[stamp.type];
+    const int32_t chunkTileX = (int32_t)chunk.x * CHUNK_W;
+    const int32_t chunkTileY = (int32_t)chunk.y * CHUNK_H;
+
+    bool modified = false;
+    for (const PrefabRun &run : prefab.runs) {
+        const int32_t tileY = stamp.tileY + run.y - chunkTileY;
+        if (tileY < 0 || tileY >= CHUNK_H) {
+            continue;
+        }
+
+        const int32_t runStartX = stamp.tileX + run.x - chunkTileX;
+        const int32_t startX = MAX(0, runStartX);
+        const int32_t endX = MIN(CHUNK_W, runStartX + run.length);
+        for (int32_t tileX = startX; tileX < endX; tileX++) {
+            const size_t tileIdx = (size_t)tileY * CHUNK_W + tileX;
+            chunk.tiles[tileIdx] = run.tile;
+            chunk.UpdateMask(tileIdx);
+            chunk.MarkDirty(tileIdx);
+            modified = true;
+        }
+    }
+    return modified;
+}
@@ -1,12 +1,49 @@
 #pragma once
+#include "../tile.h"
 #include <cstdint>
+#include <vector>
 
+struct Chunk;
 struct Tilemap;
 
 enum StructureType {
     Structure_Vault,
+    Structure_Count
+};
+
+// Horizontal run of identical tiles, relative to the prefab's top-left tile
+struct PrefabRun {
+    uint8_t x      {};
+    uint8_t y      {};
+    uint8_t length {};
+    Tile    tile   {};
+};
+
+// Compact tile data for a structure, empty cells ('.') are not stored and leave the world untouched
+struct Prefab {
+    uint8_t                w    {};
+    uint8_t                h    {};
+    std::vector<PrefabRun> runs {};
+
+    void Load(const char *grid, uint32_t gridW, uint32_t gridH);
+};
+
+// Prefab placed at an absolute tile position, used to defer stamping into chunks that aren't generated yet
+struct PrefabStamp {
+    StructureType type  {};
+    int32_t       tileX {};  // world tile x of prefab's top-left tile
+    int32_t       tileY {};  // world tile y of prefab's top-left tile
 };
 
 struct Structure {
-    static void Spawn(Tilemap &map, float x, float y);
-};
\ No newline at end of file
+    static void          LoadPrefabs  (void);
+    static const Prefab &FindPrefab   (StructureType type);
+    // Stamp prefab with its top-left tile at world position x, y. Writes directly into loaded chunks and marks
+    // the tiles dirty (see Tilemap::dirtyChunks), chunks that aren't generated yet get the stamp once they are.
+    static void          Spawn        (Tilemap &map, StructureType type, float x, float y);
+    // Apply any stamps that were queued for this chunk before it was generated
+    static void          ApplyPending (Tilemap &map, Chunk &chunk);
+
+private:
+    static bool          StampChunk   (Chunk &chunk, const PrefabStamp &stamp);
+};
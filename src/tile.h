@@ -76,6 +76,6 @@ struct Tile {
     }
 
     inline bool IsSpawnable() const {
-        return IsLand();
+        return IsLand() && IsWalkable();
     }
 };
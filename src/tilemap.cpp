@@ -1,4 +1,6 @@
 #include "tilemap.h"
+#include "world_item.h"
+#include "entities/npc.h"
 #include "dlb_rand.h"
 #include "dlb_types.h"
 #include "maths.h"
@@ -144,6 +146,101 @@ Tile *Tilemap::TileAtWorld(float x, float y)
     return tile;
 }
 
+bool Tilemap::SetTileAtWorld(float x, float y, const Tile &tile)
+{
+    TileRef ref = FindTile(x, y, {});
+    if (!ref.chunk) {
+        return false;
+    }
+
+    ref.chunk->tiles[ref.tileIdx] = tile;
+    ref.chunk->UpdateMask(ref.tileIdx);
+    ref.chunk->MarkDirty(ref.tileIdx);
+    dirtyChunks.insert(ref.chunk->Hash());
+    return true;
+}
+
+Tilemap::TileRef Tilemap::FindTile(float x, float y, TileRef hint)
+{
+    const int16_t chunkX = CalcChunk(x);
+    const int16_t chunkY = CalcChunk(y);
+
+    TileRef ref{};
+    if (hint.chunk && hint.chunk->x == chunkX && hint.chunk->y == chunkY) {
+        ref.chunk = hint.chunk;
+    } else {
+        auto iter = chunksIndex.find(Chunk::Hash(chunkX, chunkY));
+        if (iter == chunksIndex.end()) {
+            return ref;
+        }
+        DLB_ASSERT(iter->second < chunks.size());
+        ref.chunk = &chunks[iter->second];
+    }
+
+    const int16_t tileX = CalcChunkTile(x);
+    const int16_t tileY = CalcChunkTile(y);
+    ref.tileIdx = (size_t)tileY * CHUNK_W + tileX;
+    DLB_ASSERT(ref.tileIdx < ARRAY_SIZE(ref.chunk->tiles));
+    return ref;
+}
+
+bool Tilemap::IsBlocked(float x, float y, TileBlockMask blockMask)
+{
+    TileRef ref = FindTile(x, y, {});
+    return !ref.chunk || ref.chunk->IsBlocked(ref.tileIdx, blockMask);
+}
+
+bool Tilemap::IsSwimmable(float x, float y)
+{
+    TileRef ref = FindTile(x, y, {});
+    return ref.chunk && ref.chunk->IsSwimmable(ref.tileIdx);
+}
+
+Vector2 Tilemap::SweepMove(Vector2 pos, Vector2 offset, TileBlockMask blockMask)
+{
+    if (v2_is_zero(offset)) {
+        return offset;
+    }
+
+    TileRef ref = FindTile(pos.x, pos.y, {});
+
+    // NOTE: If starting tile is blocked, allow body to move off of it. The only way to end up on a blocked tile
+    // currently is to spawn there (or have the tile change underneath you).
+    if (!ref.chunk || ref.chunk->IsBlocked(ref.tileIdx, blockMask)) {
+        return offset;
+    }
+
+    // Step at most half a tile at a time so that fast movers can't tunnel through single-tile walls
+    const float length = v2_length(offset);
+    const int steps = MAX(1, (int)ceilf(length / (TILE_W * 0.5f)));
+    const Vector2 step = v2_scale(offset, 1.0f / steps);
+
+    Vector2 cur = pos;
+    for (int i = 0; i < steps; i++) {
+        // NOTE: This extra logic allows sliding when attempting to move diagonally against a wall
+        Vector2 next = v2_add(cur, step);
+        TileRef nextRef = FindTile(next.x, next.y, ref);
+        if (!nextRef.chunk || nextRef.chunk->IsBlocked(nextRef.tileIdx, blockMask)) {
+            // XY blocked, try only X offset
+            next = { cur.x + step.x, cur.y };
+            nextRef = FindTile(next.x, next.y, ref);
+            if (!step.x || !nextRef.chunk || nextRef.chunk->IsBlocked(nextRef.tileIdx, blockMask)) {
+                // X blocked, try only Y offset
+                next = { cur.x, cur.y + step.y };
+                nextRef = FindTile(next.x, next.y, ref);
+                if (!step.y || !nextRef.chunk || nextRef.chunk->IsBlocked(nextRef.tileIdx, blockMask)) {
+                    // XY, and both slide directions are blocked
+                    break;
+                }
+            }
+        }
+        cur = next;
+        ref = nextRef;
+    }
+
+    return v2_sub(cur, pos);
+}
+
 Vector2 Tilemap::TileCenter(Vector2 world) const
 {
     Vector2 tileCenter{};
@@ -170,6 +267,18 @@ Chunk &Tilemap::FindOrGenChunk(World &world, int16_t chunkX, int16_t chunkY)
     chunk.y = chunkY;
     chunksIndex[chunkHash] = chunks.size() - 1;
 
+    GenerateChunk(chunk, &world);
+    chunk.UpdateMasks();
+    Structure::ApplyPending(*this, chunk);
+
+    // TODO: Update minimap when player moves or chunk changes, without re-generating
+    // whole thing; and only the chunk is within the cull rect of the minimap.
+    //GenerateMinimap();
+    return chunk;
+}
+
+void Tilemap::GenerateChunk(Chunk &chunk, World *world)
+{
     constexpr double FREQ_ELEVATION                             = 1.0 / 16000;
     constexpr double FREQ_ROADS                                 = 1.0 / 4000;
     constexpr double FREQ_ROADS_NOISE                           = 1.0 / 400;
@@ -287,9 +396,9 @@ Chunk &Tilemap::FindOrGenChunk(World &world, int16_t chunkX, int16_t chunkY)
                 }
 
                 // Mountaintop Lake treasure
-                if (elev > 0.99) {
+                if (elev > 0.99 && world) {
                     // TODO: Generate a semi-hidden treasure structure instead? These items will despawn.
-                    world.itemSystem.SpawnItem({ x, y, 0 }, ItemType_Orig_Gem_GoldenChest, 1);
+                    world->itemSystem.SpawnItem({ x, y, 0 }, ItemType_Orig_Gem_GoldenChest, 1);
                 }
             }
 
@@ -329,11 +438,214 @@ Chunk &Tilemap::FindOrGenChunk(World &world, int16_t chunkX, int16_t chunkY)
 #undef NOISE_BETWEEN
 
     DLB_ASSERT(tileCount == ARRAY_SIZE(chunk.tiles));
+}
 
-    // TODO: Update minimap when player moves or chunk changes, without re-generating
-    // whole thing; and only the chunk is within the cull rect of the minimap.
-    //GenerateMinimap();
-    return chunk;
+Chunk &Tilemap::AddChunk(const Chunk &chunk)
+{
+    Chunk *result = 0;
+    auto chunkIter = chunksIndex.find(chunk.Hash());
+    if (chunkIter != chunksIndex.end()) {
+        size_t chunkIdx = chunkIter->second;
+        DLB_ASSERT(chunkIdx < chunks.size());
+        result = &chunks[chunkIdx];
+        // Entity lists are local bookkeeping, keep them when the tile data gets replaced
+        ChunkList<NPC> npcs = result->npcs;
+        ChunkList<WorldItem> items = result->items;
+        *result = chunk;
+        result->npcs = npcs;
+        result->items = items;
+    } else {
+        result = &chunks.emplace_back(chunk);
+        result->npcs = {};
+        result->items = {};
+        result->nearPlayerTick = 0;
+        chunksIndex[chunk.Hash()] = chunks.size() - 1;
+    }
+    memset(result->dirty, 0, sizeof(result->dirty));
+    result->UpdateMasks();
+    return *result;
+}
+
+Chunk *Tilemap::FindChunk(ChunkHash hash)
+{
+    auto chunkIter = chunksIndex.find(hash);
+    if (chunkIter == chunksIndex.end()) {
+        return 0;
+    }
+    size_t chunkIdx = chunkIter->second;
+    DLB_ASSERT(chunkIdx < chunks.size());
+    return &chunks[chunkIdx];
+}
+
+Chunk *Tilemap::ChunkAtWorld(float x, float y)
+{
+    return FindChunk(Chunk::Hash(CalcChunk(x), CalcChunk(y)));
+}
+
+template <typename T>
+static void chunk_link_update(Tilemap &map, T &entity, ChunkList<T> Chunk::*list)
+{
+    const Vector2 pos = entity.body.GroundPosition();
+    const ChunkHash chunkHash = Chunk::Hash(map.CalcChunk(pos.x), map.CalcChunk(pos.y));
+    ChunkListNode<T> &node = entity.chunkNode;
+    if (node.linked && node.chunk == chunkHash) {
+        return;
+    }
+
+    if (node.linked) {
+        Chunk *prevChunk = map.FindChunk(node.chunk);
+        DLB_ASSERT(prevChunk);
+        (prevChunk->*list).Remove(entity);
+    }
+
+    Chunk *chunk = map.FindChunk(chunkHash);
+    if (chunk) {
+        (chunk->*list).Insert(entity, chunkHash);
+    }
+}
+
+template <typename T>
+static void chunk_link_remove(Tilemap &map, T &entity, ChunkList<T> Chunk::*list)
+{
+    ChunkListNode<T> &node = entity.chunkNode;
+    if (node.linked) {
+        Chunk *chunk = map.FindChunk(node.chunk);
+        DLB_ASSERT(chunk);
+        (chunk->*list).Remove(entity);
+    }
+}
+
+void Tilemap::UpdateChunkLink(NPC &npc)
+{
+    chunk_link_update(*this, npc, &Chunk::npcs);
+}
+
+void Tilemap::UpdateChunkLink(WorldItem &item)
+{
+    chunk_link_update(*this, item, &Chunk::items);
+}
+
+void Tilemap::UnlinkChunk(NPC &npc)
+{
+    chunk_link_remove(*this, npc, &Chunk::npcs);
+}
+
+void Tilemap::UnlinkChunk(WorldItem &item)
+{
+    chunk_link_remove(*this, item, &Chunk::items);
+}
+
+void Tilemap::RelocateChunkLink(WorldItem &from, WorldItem &to)
+{
+    if (to.chunkNode.linked) {
+        Chunk *chunk = FindChunk(to.chunkNode.chunk);
+        DLB_ASSERT(chunk);
+        chunk->items.Relocate(from, to);
+    }
+}
+
+size_t Tilemap::FindNearbyChunks(Vector2 worldPos, float radius, Chunk **result, size_t resultLen)
+{
+    const int16_t minX = CalcChunk(worldPos.x - radius);
+    const int16_t minY = CalcChunk(worldPos.y - radius);
+    const int16_t maxX = CalcChunk(worldPos.x + radius);
+    const int16_t maxY = CalcChunk(worldPos.y + radius);
+
+    size_t count = 0;
+    for (int chunkY = minY; chunkY <= maxY; chunkY++) {
+        for (int chunkX = minX; chunkX <= maxX; chunkX++) {
+            Chunk *chunk = FindChunk(Chunk::Hash((int16_t)chunkX, (int16_t)chunkY));
+            if (chunk) {
+                if (count == resultLen) {
+                    E_WARN("Nearby chunk buffer full, increase resultLen", 0);
+                    return count;
+                }
+                result[count++] = chunk;
+            }
+        }
+    }
+    return count;
+}
+
+void Chunk::BuildDiff(ChunkDiff &diff) const
+{
+    diff.chunkX = x;
+    diff.chunkY = y;
+    diff.version = version;
+    diff.hash = CalcHash();
+    diff.tileCount = 0;
+    for (size_t tileIdx = 0; tileIdx < ARRAY_SIZE(tiles); tileIdx++) {
+        if (IsModified(tileIdx)) {
+            TileDelta &delta = diff.tiles[diff.tileCount];
+            delta.index = (uint8_t)tileIdx;
+            delta.tile = tiles[tileIdx];
+            diff.tileCount++;
+        }
+    }
+}
+
+void Chunk::ApplyDiff(const ChunkDiff &diff)
+{
+    DLB_ASSERT(diff.chunkX == x);
+    DLB_ASSERT(diff.chunkY == y);
+    DLB_ASSERT(diff.tileCount <= ARRAY_SIZE(tiles));
+    for (size_t i = 0; i < diff.tileCount; i++) {
+        const TileDelta &delta = diff.tiles[i];
+        tiles[delta.index] = delta.tile;
+    }
+    version = diff.version;
+    UpdateMasks();
+}
+
+uint32_t Chunk::CalcHash(void) const
+{
+    // FNV-1a over the networked tile fields, struct padding is not guaranteed to match
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 16777619u;
+    };
+    for (size_t tileIdx = 0; tileIdx < ARRAY_SIZE(tiles); tileIdx++) {
+        const Tile &tile = tiles[tileIdx];
+        mix(tile.type);
+        mix(tile.object.type);
+        mix((uint8_t)(tile.object.flags & 0xff));
+        mix((uint8_t)(tile.object.flags >> 8));
+    }
+    return hash;
+}
+
+void Chunk::UpdateMasks(void)
+{
+    memset(walkable, 0, sizeof(walkable));
+    memset(swimmable, 0, sizeof(swimmable));
+    for (size_t tileIdx = 0; tileIdx < ARRAY_SIZE(tiles); tileIdx++) {
+        const Tile &tile = tiles[tileIdx];
+        const uint64_t bit = 1ull << (tileIdx & 63);
+        if (tile.IsWalkable()) {
+            walkable[tileIdx >> 6] |= bit;
+        }
+        if (tile.IsSwimmable()) {
+            swimmable[tileIdx >> 6] |= bit;
+        }
+    }
+}
+
+void Chunk::UpdateMask(size_t tileIdx)
+{
+    DLB_ASSERT(tileIdx < ARRAY_SIZE(tiles));
+    const Tile &tile = tiles[tileIdx];
+    const uint64_t bit = 1ull << (tileIdx & 63);
+    if (tile.IsWalkable()) {
+        walkable[tileIdx >> 6] |= bit;
+    } else {
+        walkable[tileIdx >> 6] &= ~bit;
+    }
+    if (tile.IsSwimmable()) {
+        swimmable[tileIdx >> 6] |= bit;
+    } else {
+        swimmable[tileIdx >> 6] &= ~bit;
+    }
 }
 
 MapSystem::~MapSystem(void)
@@ -1,14 +1,19 @@
 #pragma once
 #include "helpers.h"
+#include "chunk_list.h"
 #include "tileset.h"
 #include "math.h"
 #include "object.h"
 #include "dlb_rand.h"
 #include "OpenSimplex2F.h"
+#include "structures/structure.h"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 struct World;
+class NPC;
+struct WorldItem;
 
 struct Noise {
     void Seed(int64_t seed) {
@@ -88,10 +93,79 @@ private:
     OpenSimplexGradients * osg {};
 };
 
+#define CHUNK_MASK_WORDS (CHUNK_W * CHUNK_H / 64)
+
+// Which tile properties block movement in a Tilemap collision query
+typedef uint8_t TileBlockMask;
+
+enum : TileBlockMask {
+    TileBlock_None  = 0,
+    TileBlock_Solid = 0x01,  // tile is not walkable (e.g. colliding object)
+    TileBlock_Water = 0x02,  // tile is swimmable (i.e. water, for things that can't swim)
+};
+
+// A single tile change within a chunk
+struct TileDelta {
+    uint8_t index {};  // index into Chunk::tiles
+    Tile    tile  {};
+};
+
+// Tiles that differ from what Tilemap::GenerateChunk produces for this chunk, i.e. everything the client can't
+// generate on its own from the world seed.
+struct ChunkDiff {
+    int16_t   chunkX    {};
+    int16_t   chunkY    {};
+    uint32_t  version   {};  // Chunk::version on the server
+    uint32_t  hash      {};  // Chunk::CalcHash() after applying the diff, to catch generator mismatches
+    uint16_t  tileCount {};
+    TileDelta tiles     [WORLD_CHUNK_TILES]{};
+};
+
 struct Chunk {
-    int16_t x     {};                     // chunk x offset
-    int16_t y     {};                     // chunk y offset
-    Tile    tiles [CHUNK_W * CHUNK_W]{};  // 32x32 tiles per chunk
+    int16_t  x         {};                             // chunk x offset
+    int16_t  y         {};                             // chunk y offset
+    Tile     tiles     [CHUNK_W * CHUNK_W]{};          // 32x32 tiles per chunk
+    uint64_t walkable  [CHUNK_MASK_WORDS]{};           // 1 bit per tile, cache of Tile::IsWalkable()
+    uint64_t swimmable [CHUNK_MASK_WORDS]{};           // 1 bit per tile, cache of Tile::IsSwimmable()
+    uint32_t version   {};                             // incremented by server each tick the chunk is modified
+
+    // Server-side bookkeeping, not networked
+    uint64_t             dirty          [CHUNK_MASK_WORDS]{};  // 1 bit per tile modified since last TileDelta
+    uint64_t             modified       [CHUNK_MASK_WORDS]{};  // 1 bit per tile modified since generation
+    ChunkList<NPC>       npcs           {};  // npcs currently inside of this chunk
+    ChunkList<WorldItem> items          {};  // world items currently inside of this chunk
+    uint32_t             nearPlayerTick {};  // last world tick a living player was near this chunk
+
+    // NOTE: Must be called whenever tiles[] is modified, otherwise collision queries will be stale
+    void UpdateMasks (void);
+    void UpdateMask  (size_t tileIdx);
+
+    // Build/apply the diff between this chunk and its generated baseline, and hash the tiles for verification
+    void     BuildDiff (ChunkDiff &diff) const;
+    void     ApplyDiff (const ChunkDiff &diff);
+    uint32_t CalcHash  (void) const;
+
+    inline void MarkDirty(size_t tileIdx) {
+        dirty[tileIdx >> 6] |= 1ull << (tileIdx & 63);
+        modified[tileIdx >> 6] |= 1ull << (tileIdx & 63);
+    }
+    inline bool IsModified(size_t tileIdx) const {
+        return modified[tileIdx >> 6] & (1ull << (tileIdx & 63));
+    }
+    inline bool IsDirty(size_t tileIdx) const {
+        return dirty[tileIdx >> 6] & (1ull << (tileIdx & 63));
+    }
+
+    inline bool IsWalkable(size_t tileIdx) const {
+        return walkable[tileIdx >> 6] & (1ull << (tileIdx & 63));
+    }
+    inline bool IsSwimmable(size_t tileIdx) const {
+        return swimmable[tileIdx >> 6] & (1ull << (tileIdx & 63));
+    }
+    inline bool IsBlocked(size_t tileIdx, TileBlockMask blockMask) const {
+        return ((blockMask & TileBlock_Solid) && !IsWalkable(tileIdx)) ||
+               ((blockMask & TileBlock_Water) && IsSwimmable(tileIdx));
+    }
 
     inline ChunkHash Hash(void) const {
         return (ChunkHash)(((uint16_t)x << 16) | (uint16_t)y);
@@ -106,13 +180,52 @@ struct Tilemap {
     TilesetID          tilesetId {};
     std::vector<Chunk> chunks    {};  // TODO: RingBuffer, this set will grow indefinitely
     std::unordered_map<ChunkHash, size_t> chunksIndex{};  // [x << 16 | y] -> idx into chunks array
+    std::unordered_map<ChunkHash, std::vector<PrefabStamp>> pendingStamps{};  // stamps waiting for chunk to generate
+    std::unordered_set<ChunkHash> dirtyChunks{};  // chunks with tiles modified since last network update
 
     void GenerateMinimap    (Vector2 worldPos);
     int16_t CalcChunk       (float world) const;
     int16_t CalcChunkTile   (float world) const;
     Tile *TileAtWorld       (float x, float y);  // Return tile at pixel position in world space, or null
+    bool SetTileAtWorld     (float x, float y, const Tile &tile);  // Overwrite tile, update masks, mark dirty
     Vector2 TileCenter      (Vector2 world) const;  // Return tile center in world position
     Chunk &FindOrGenChunk   (World &world, int16_t x, int16_t y);
+    // Generate terrain for chunk.x, chunk.y using this thread's g_noise. Pure function of the seed and chunk
+    // coords, so client and server generate identical chunks as long as WORLD_GEN_VERSION matches. Spawns
+    // world entities (e.g. treasure) into world, if provided.
+    static void GenerateChunk (Chunk &chunk, World *world);
+    Chunk &AddChunk         (const Chunk &chunk);  // Add or replace chunk, e.g. when received from server
+    Chunk *FindChunk        (ChunkHash hash);
+    Chunk *ChunkAtWorld     (float x, float y);
+
+    // Keep the chunk entity lists up-to-date. UpdateChunkLink (re)links the entity into whichever chunk it's
+    // currently in, and must be called after the entity moves. Entities in chunks that aren't loaded are not
+    // linked until the chunk gets generated.
+    void UpdateChunkLink    (NPC &npc);
+    void UpdateChunkLink    (WorldItem &item);
+    void UnlinkChunk        (NPC &npc);
+    void UnlinkChunk        (WorldItem &item);
+    void RelocateChunkLink  (WorldItem &from, WorldItem &to);
+    // Find all loaded chunks that overlap the square around worldPos, returns number of chunks written
+    size_t FindNearbyChunks (Vector2 worldPos, float radius, Chunk **result, size_t resultLen);
+
+    // Collision queries, these only look at the chunk masks and never touch Tile/Object data. Missing chunks
+    // are considered blocked.
+    bool IsBlocked          (float x, float y, TileBlockMask blockMask);
+    bool IsWalkable         (float x, float y) { return !IsBlocked(x, y, TileBlock_Solid); }
+    bool IsSwimmable        (float x, float y);
+    bool IsSpawnable        (float x, float y) { return !IsBlocked(x, y, TileBlock_Solid | TileBlock_Water); }
+    // Move from pos by offset, sliding along blocked tiles. Returns the offset that can actually be applied.
+    Vector2 SweepMove       (Vector2 pos, Vector2 offset, TileBlockMask blockMask);
+
+private:
+    const char *LOG_SRC = "Tilemap";
+
+    struct TileRef {
+        Chunk  *chunk   {};
+        size_t  tileIdx {};
+    };
+    TileRef FindTile(float x, float y, TileRef hint);
 };
 
 struct MapSystem {
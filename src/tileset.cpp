@@ -1,21 +1,39 @@
 #include "tileset.h"
+#include "asset_loader.h"
 #include "raylib/raylib.h"
 #include <cassert>
 #include <stdlib.h>
 
-static void tileset_load(TilesetID tilesetId, const char *texturePath);
+static void tileset_load(AssetLoader &loader, TilesetID tilesetId, const char *texturePath);
+static void tileset_upload(Tileset &tileset, Image &image);
 
-void tileset_init(void)
+void tileset_init(AssetLoader &loader)
 {
-    tileset_load(TilesetID::TS_Overworld, "data/texture/tile/tiles32.png");
-    tileset_load(TilesetID::TS_Objects, "data/texture/tile/objects32.png");
+    tileset_load(loader, TilesetID::TS_Overworld, "data/texture/tile/tiles32.png");
+    tileset_load(loader, TilesetID::TS_Objects, "data/texture/tile/objects32.png");
 }
 
-static void tileset_load(TilesetID tilesetId, const char *texturePath)
+// Decode on a worker, upload on this thread
+static void tileset_load(AssetLoader &loader, TilesetID tilesetId, const char *texturePath)
 {
-    Tileset &tileset = g_tilesets[(size_t)tilesetId];
+    Tileset *tileset = &g_tilesets[(size_t)tilesetId];
+    Image *image = new Image{};
+    loader.Queue(texturePath,
+        [image, texturePath] {
+            *image = LoadImage(texturePath);
+            return image->data ? ErrorType::Success : ErrorType::FileReadFailed;
+        },
+        [tileset, image] {
+            tileset_upload(*tileset, *image);
+            delete image;
+        }
+    );
+}
 
-    tileset.texture = LoadTexture(texturePath);
+static void tileset_upload(Tileset &tileset, Image &image)
+{
+    tileset.texture = LoadTextureFromImage(image);
+    UnloadImage(image);
     assert(tileset.texture.width);
     assert((tileset.texture.width % TILE_W) == 0);
 
@@ -2,6 +2,8 @@
 #include "raylib/raylib.h"
 #include "tile.h"
 
+struct AssetLoader;
+
 enum class TilesetID {
     TS_Overworld,
     TS_Objects,
@@ -17,6 +19,6 @@ struct Tileset {
 
 thread_local static Tileset g_tilesets[(size_t)TilesetID::Count]{};
 
-void tileset_init(void);
+void tileset_init(AssetLoader &loader);
 const Rectangle &tileset_tile_rect(TilesetID tilesetId, TileType tileType);
 void tileset_draw_tile(TilesetID tilesetId, TileType tileType, Vector2 at, Color tint);
@@ -387,6 +387,11 @@ void UI::Netstat(NetClient &netClient, double renderAt)
         }
     }
 
+    const CL_ReconcileStats &reconcileStats = netClient.reconcileStats;
+    ImGui::Text("Reconcile replays  %u / %u snapshots", reconcileStats.replays, reconcileStats.snapshots);
+    ImGui::Text("Samples replayed   %llu / %llu predicted", (unsigned long long)reconcileStats.samplesReplayed,
+        (unsigned long long)reconcileStats.samplesPredicted);
+
     ImGui::NewLine();
 
     const size_t snapshotCount = netClient.worldHistory.Count();
@@ -883,7 +888,8 @@ void UI::QuickHUD(const Font &font, const Player &player, const Tilemap &tilemap
     hudCursorY += pad;
 
     const Spritesheet &coinSpritesheet = Catalog::g_spritesheets.FindById(Catalog::SpritesheetID::Item_Coins);
-    const SpriteDef *coinGildedSpriteDef = coinSpritesheet.FindSprite("coin_gilded");
+    constexpr SpriteID coinGildedId = sprite_id("coin_gilded");
+    const SpriteDef *coinGildedSpriteDef = coinSpritesheet.FindSprite(coinGildedId);
     Rectangle frameRect{};
     frameRect.x      = (float)coinGildedSpriteDef->spritesheet->frames[3].x;
     frameRect.y      = (float)coinGildedSpriteDef->spritesheet->frames[3].y;
@@ -20,10 +20,16 @@ World::World(void)
     //rtt_seed = time(NULL);
     dlb_rand32_seed_r(&rtt_rand, rtt_seed, rtt_seed);
     g_noise.Seed(rtt_seed);
+    itemSystem.map = &map;
 }
 
 World::~World(void)
 {
+    for (Player &player : players) {
+        if (player.id) {
+            player.inventory.ReleaseItems();
+        }
+    }
 }
 
 const Vector3 World::GetWorldSpawn(void)
@@ -174,6 +180,7 @@ void World::RemovePlayer(uint32_t id)
     }
 
     E_DEBUG("Remove player %u", id);
+    player->inventory.ReleaseItems();
     *player = {};
 }
 
@@ -256,12 +263,14 @@ ErrorType World::SpawnNpc(uint32_t id, NPC::Type type, Vector3 worldPos, NPC **r
     if (!newNpc && oldestDeadNpc) {
         //E_WARN("Replacing oldest dead npc with new npc", 0);
         newNpc = oldestDeadNpc;
+        map.UnlinkChunk(*newNpc);
         *newNpc = {};
     }
 
     // Client only - reclaim stale slot
     if (!newNpc && !g_clock.server) {
         newNpc = oldestStaleNpc;
+        map.UnlinkChunk(*newNpc);
         *newNpc = {};
     }
 
@@ -306,6 +315,9 @@ ErrorType World::SpawnNpc(uint32_t id, NPC::Type type, Vector3 worldPos, NPC **r
     }
 
     npc.body.Teleport({ worldPos.x, worldPos.y, 0 });
+    if (g_clock.server) {
+        map.UpdateChunkLink(npc);
+    }
     E_DEBUG("Spawning npc [%u] @ %.f, %.f", npc.id, worldPos.x, worldPos.y);
 
     if (result) *result = &npc;
@@ -340,14 +352,56 @@ void World::RemoveNpc(uint32_t id)
     }
 
     E_DEBUG("RemoveNPC [%u]", enemy->id);
+    map.UnlinkChunk(*enemy);
     *enemy = {};
 }
 
 void World::SV_Simulate(double dt)
 {
+    SV_MarkChunksNearPlayers();
     SV_SimPlayers(dt);
     SV_SimNpcs(dt);
     SV_SimItems(dt);
+    SV_UpdateChunkLinks();
+}
+
+void World::SV_MarkChunksNearPlayers(void)
+{
+    for (Player &player : players) {
+        if (!player.id || player.combat.diedAt) {
+            continue;
+        }
+
+        Chunk *nearbyChunks[SV_NEARBY_CHUNKS_MAX]{};
+        size_t nearbyChunkCount = map.FindNearbyChunks(player.body.GroundPosition(), SV_ENEMY_DESPAWN_RADIUS,
+            nearbyChunks, ARRAY_SIZE(nearbyChunks));
+        for (size_t i = 0; i < nearbyChunkCount; i++) {
+            nearbyChunks[i]->nearPlayerTick = tick;
+        }
+    }
+}
+
+void World::SV_UpdateChunkLinks(void)
+{
+    // NOTE: This only touches the lists when an entity actually crossed a chunk border
+    for (int type = NPC::Type_None + 1; type < NPC::Type_Count; type++) {
+        NpcList npcList = npcs.byType[type];
+        for (size_t i = 0; i < npcList.length; i++) {
+            NPC &npc = npcList.data[i];
+            if (npc.id) {
+                map.UpdateChunkLink(npc);
+            }
+        }
+    }
+    for (WorldItem &item : itemSystem.worldItems) {
+        map.UpdateChunkLink(item);
+    }
+}
+
+bool World::SV_IsNearPlayer(Vector2 worldPos)
+{
+    const Chunk *chunk = map.ChunkAtWorld(worldPos.x, worldPos.y);
+    return chunk && chunk->nearPlayerTick == tick;
 }
 
 void World::SV_SimPlayers(double dt)
@@ -470,8 +524,9 @@ void World::SV_SimPlayers(double dt)
             spawnPos.x += playerPos.x;
             spawnPos.y += playerPos.y;
 
-            const Tile *spawnTile = map.TileAtWorld(spawnPos.x, spawnPos.y);
-            if (spawnTile && spawnTile->IsSpawnable()) {
+            // Don't pile enemies up in the same chunk
+            const Chunk *spawnChunk = map.ChunkAtWorld(spawnPos.x, spawnPos.y);
+            if (spawnChunk && spawnChunk->npcs.count < SV_ENEMY_MAX_PER_CHUNK && map.IsSpawnable(spawnPos.x, spawnPos.y)) {
                 Player *anyPlayerTooClose = FindNearestPlayer(spawnPos, SV_ENEMY_MIN_SPAWN_DIST);
                 if (!anyPlayerTooClose) {
                     SpawnNpc(0, NPC::Type_Slime, { spawnPos.x, spawnPos.y, 0 }, 0);
@@ -500,42 +555,57 @@ void World::SV_SimNpcs(double dt)
 
 void World::SV_SimItems(double dt)
 {
-    for (WorldItem &item : itemSystem.worldItems) {
-        if (!item.euid || item.despawnedAt || g_clock.now < item.spawnedAt + SV_ITEM_PICKUP_DELAY) {
+    // Only items in chunks near a player can possibly be attracted to them
+    for (Player &player : players) {
+        if (!player.id) {
             continue;
         }
 
-        assert(item.stack.uid);
-        assert(item.stack.count);
+        Chunk *nearbyChunks[SV_NEARBY_CHUNKS_MAX]{};
+        size_t nearbyChunkCount = map.FindNearbyChunks(player.body.GroundPosition(), SV_ITEM_ATTRACT_DIST,
+            nearbyChunks, ARRAY_SIZE(nearbyChunks));
 
-        Player *closestPlayer = FindNearestPlayer(item.body.GroundPosition(), SV_ITEM_ATTRACT_DIST);
-        if (!closestPlayer || !closestPlayer->id ||
-            (item.droppedByPlayerId == closestPlayer->id && g_clock.now < item.spawnedAt + SV_ITEM_REPICKUP_DELAY)
-        ) {
-            continue;
-        }
+        for (size_t chunkIdx = 0; chunkIdx < nearbyChunkCount; chunkIdx++) {
+            for (WorldItem *itemPtr = nearbyChunks[chunkIdx]->items.head; itemPtr; itemPtr = itemPtr->chunkNode.next) {
+                WorldItem &item = *itemPtr;
+                if (!item.euid || item.despawnedAt || g_clock.now < item.spawnedAt + SV_ITEM_PICKUP_DELAY) {
+                    continue;
+                }
 
-        Vector2 itemToPlayer = v2_sub(closestPlayer->body.GroundPosition(), item.body.GroundPosition());
-        const float itemToPlayerDistSq = v2_length_sq(itemToPlayer);
-        if (itemToPlayerDistSq < SQUARED(SV_ITEM_PICKUP_DIST)) {
-            if (closestPlayer->inventory.PickUp(item.stack)) {
-                if (!item.stack.count) {
-                    item.despawnedAt = g_clock.now;
+                assert(item.stack.uid);
+                assert(item.stack.count);
+
+                // NOTE: Items near multiple players go to whichever player comes first, same as FindNearestPlayer
+                Player *closestPlayer = FindNearestPlayer(item.body.GroundPosition(), SV_ITEM_ATTRACT_DIST);
+                if (closestPlayer != &player ||
+                    (item.droppedByPlayerId == closestPlayer->id && g_clock.now < item.spawnedAt + SV_ITEM_REPICKUP_DELAY)
+                ) {
+                    continue;
+                }
+
+                Vector2 itemToPlayer = v2_sub(closestPlayer->body.GroundPosition(), item.body.GroundPosition());
+                const float itemToPlayerDistSq = v2_length_sq(itemToPlayer);
+                if (itemToPlayerDistSq < SQUARED(SV_ITEM_PICKUP_DIST)) {
+                    if (closestPlayer->inventory.PickUp(item.stack)) {
+                        if (!item.stack.count) {
+                            item.despawnedAt = g_clock.now;
 #if SV_DEBUG_WORLD_ITEMS
-                    E_DEBUG("Sim: Item picked up %u", item.type);
+                            E_DEBUG("Sim: Item picked up %u", item.type);
 #endif
+                        } else {
+                            // TODO: Send item update message so other players know stack was partially picked up
+                            // to update their label.
+                        }
+                    }
                 } else {
-                    // TODO: Send item update message so other players know stack was partially picked up
-                    // to update their label.
+                    const Vector2 itemToPlayerDir = v2_normalize(itemToPlayer);
+                    const float speed = MAX(0, 5.0f / PIXELS_TO_METERS(sqrtf(itemToPlayerDistSq)));
+                    const Vector2 itemVel = v2_scale(itemToPlayerDir, METERS_TO_PIXELS(speed));
+                    item.body.velocity.x = itemVel.x;
+                    item.body.velocity.y = itemVel.y;
+                    //item.body.velocity.z = MAX(item.body.velocity.z, itemVel.z);
                 }
             }
-        } else {
-            const Vector2 itemToPlayerDir = v2_normalize(itemToPlayer);
-            const float speed = MAX(0, 5.0f / PIXELS_TO_METERS(sqrtf(itemToPlayerDistSq)));
-            const Vector2 itemVel = v2_scale(itemToPlayerDir, METERS_TO_PIXELS(speed));
-            item.body.velocity.x = itemVel.x;
-            item.body.velocity.y = itemVel.y;
-            //item.body.velocity.z = MAX(item.body.velocity.z, itemVel.z);
         }
     }
 
@@ -592,14 +662,14 @@ void World::SV_DespawnDeadEntities(void)
     itemSystem.DespawnDeadEntities(1.0 / SNAPSHOT_SEND_RATE);
 }
 
-void World::CL_Interpolate(double renderAt)
+void World::CL_Interpolate(const InterpolationCursor &cursor)
 {
     // TODO: Probably would help to unify entities in some way so there's less duplication here
     for (Player &player : players) {
         if (!player.id || player.id == playerId) {
             continue;
         }
-        player.body.CL_Interpolate(renderAt, player.sprite.direction);
+        player.body.CL_Interpolate(cursor, player.sprite.direction);
     }
     for (int type = NPC::Type_None + 1; type < NPC::Type_Count; type++) {
         NpcList npcList = npcs.byType[type];
@@ -608,7 +678,7 @@ void World::CL_Interpolate(double renderAt)
             if (!npc.type) {
                 continue;
             }
-            npc.body.CL_Interpolate(renderAt, npc.sprite.direction);
+            npc.body.CL_Interpolate(cursor, npc.sprite.direction);
 
             if (npc.type == NPC::Type_Slime && npc.body.Jumped()) {
                 //Catalog::SoundID squish = dlb_rand32i_range(0, 1) ? Catalog::SoundID::Squish1 : Catalog::SoundID::Squish2;
@@ -621,7 +691,7 @@ void World::CL_Interpolate(double renderAt)
         if (!item.euid) {
             continue;
         }
-        item.body.CL_Interpolate(renderAt, item.sprite.direction);
+        item.body.CL_Interpolate(cursor, item.sprite.direction);
     }
 }
 
@@ -732,6 +802,13 @@ bool World::CullTile(Vector2 tilePos, int zoomMipLevel)
     return false;
 }
 
+// First tile >= tile that's on the mip grid. World aligned, so zoomed out maps don't shimmer as the camera moves.
+static int world_mip_align(int tile, int zoomMipLevel)
+{
+    const int rem = ((tile % zoomMipLevel) + zoomMipLevel) % zoomMipLevel;
+    return rem ? tile + zoomMipLevel - rem : tile;
+}
+
 size_t World::DrawMap(const Spycam &spycam)
 {
     const int zoomMipLevel = spycam.GetZoomMipLevel();
@@ -740,124 +817,106 @@ size_t World::DrawMap(const Spycam &spycam)
         return 0;
     }
 
-    //ImDrawList *bgDrawList = ImGui::GetBackgroundDrawList();
-
-    size_t tilesDrawn = 0;
+    // Visible tiles plus one tile of padding. When zoomed out, only every zoomMipLevel'th tile is drawn.
     const Rectangle &camRect = spycam.GetRect();
-    const float cx = camRect.x;
-    const float cy = camRect.y;
-    const float tilesW = camRect.width / TILE_W;
-    const float tilesH = camRect.height / TILE_W;
-    for (float y = -1; y < tilesH + 2; y += zoomMipLevel) {
-        for (float x = -1; x < tilesW + 2; x += zoomMipLevel) {
-            float xx = cx + x * TILE_W;
-            float yy = cy + y * TILE_W;
-            xx = floorf(xx / TILE_W) * TILE_W;
-            yy = floorf(yy / TILE_W) * TILE_W;
-
-            const Tile *tile = map.TileAtWorld(xx, yy);
-            if (tile) {
-                tileset_draw_tile(map.tilesetId, tile->type, { xx, yy }, WHITE);
-
-                //uint8_t r = tile->base;
-                //uint8_t g = tile->baseNoise;
-                //const int xxi = (int)xx;
-                //const int yyi = (int)yy;
-                //DrawRectangle(xxi    , yyi     , SUBTILE_W, SUBTILE_H, { r, 0, 0, 255 });  // Top left
-                //DrawRectangle(xxi + 8, yyi     , SUBTILE_W, SUBTILE_H, { 0, g, 0, 255 });  // Top right
-
-                //DrawRectangle(xxi    , yyi + 16, SUBTILE_W, SUBTILE_H, { 0, 0, 0, 255 });  // Bottom left
-                //DrawRectangle(xxi + 8, yyi + 16, SUBTILE_W, SUBTILE_H, { 0, 0, 0, 255 });  // Bottom right
-            } else {
-                tileset_draw_tile(map.tilesetId, TileType_Void, { xx, yy }, WHITE);
-            }
-#if 0
-            const Tile *tile = map.TileAtWorld(xx, yy);
-            Tileset &tileset = g_tilesets[(size_t)map.tilesetId];
-            Rectangle tileRect = tileset_tile_rect(map.tilesetId, tile ? tile->type : TileType_Void);
-
-            ImVec2 uv0 = {
-                tileRect.x / tileset.texture.width,
-                tileRect.y / tileset.texture.height,
-            };
-            ImVec2 uv1 = {
-                (tileRect.x + tileRect.width ) / tileset.texture.width,
-                (tileRect.y + tileRect.height) / tileset.texture.height,
-            };
-
-            xx -= cx;
-            yy -= cy;
-
-            bgDrawList->AddImage(
-                (ImTextureID)(size_t)tileset.texture.type,
-                ImVec2(xx, yy),
-                ImVec2(xx + tileRect.width, yy + tileRect.height),
-                ImVec2{ uv0.x, uv0.y },
-                ImVec2{ uv1.x, uv1.y }
-            );
-#endif
-#if 0
-            if (xx > 20 && yy > 20) {
-                char buf[16]{};
-                char *bufPtr = buf + sizeof(buf) - 1;
-                int xxp = xx;
-                int rem;
-                while (xxp) {
-                    rem = xxp % 10;
-                    *(--bufPtr) = '0' + rem;
-                    xxp /= 10;
+    const int tileMinX = (int)floorf(camRect.x / TILE_W) - 1;
+    const int tileMinY = (int)floorf(camRect.y / TILE_W) - 1;
+    const int tileMaxX = (int)floorf((camRect.x + camRect.width) / TILE_W) + 1;
+    const int tileMaxY = (int)floorf((camRect.y + camRect.height) / TILE_W) + 1;
+    const int chunkMinX = map.CalcChunk((float)tileMinX * TILE_W);
+    const int chunkMinY = map.CalcChunk((float)tileMinY * TILE_W);
+    const int chunkMaxX = map.CalcChunk((float)tileMaxX * TILE_W);
+    const int chunkMaxY = map.CalcChunk((float)tileMaxY * TILE_W);
+
+    const Tileset &groundTileset = g_tilesets[(size_t)map.tilesetId];
+    const Tileset &objectTileset = g_tilesets[(size_t)TilesetID::TS_Objects];
+    const SpriteFrame *treeFrame = 0;
+
+    // Ground for every visible chunk first, then objects, so objects never end up under a neighboring chunk's ground
+    size_t tilesDrawn = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int chunkY = chunkMinY; chunkY <= chunkMaxY; chunkY++) {
+            for (int chunkX = chunkMinX; chunkX <= chunkMaxX; chunkX++) {
+                // Visible part of this chunk, in chunk-local tile coords (inclusive)
+                const int chunkTileX = chunkX * CHUNK_W;
+                const int chunkTileY = chunkY * CHUNK_H;
+                const int x0 = world_mip_align(MAX(tileMinX, chunkTileX), zoomMipLevel) - chunkTileX;
+                const int y0 = world_mip_align(MAX(tileMinY, chunkTileY), zoomMipLevel) - chunkTileY;
+                const int x1 = MIN(tileMaxX, chunkTileX + CHUNK_W - 1) - chunkTileX;
+                const int y1 = MIN(tileMaxY, chunkTileY + CHUNK_H - 1) - chunkTileY;
+                if (x0 > x1 || y0 > y1) {
+                    continue;
                 }
-                //snprintf(buf, sizeof(buf), "%d,\n%d", (int)xx, (int)yy);
-                bgDrawList->AddText({ xx - cx, yy - cy }, IM_COL32_WHITE, bufPtr);
-            }
-#endif
-            tilesDrawn++;
-        }
-    }
 
-    for (float y = -1; y < tilesH + 2; y += zoomMipLevel) {
-        for (float x = -1; x < tilesW + 2; x += zoomMipLevel) {
-            float xx = cx + x * TILE_W;
-            float yy = cy + y * TILE_W;
-            xx = floorf(xx / TILE_W) * TILE_W;
-            yy = floorf(yy / TILE_W) * TILE_W;
+                const Chunk *chunk = map.FindChunk(Chunk::Hash((int16_t)chunkX, (int16_t)chunkY));
+                if (!chunk) {
+                    // Not received yet
+                    if (pass == 0) {
+                        for (int y = y0; y <= y1; y += zoomMipLevel) {
+                            for (int x = x0; x <= x1; x += zoomMipLevel) {
+                                const Vector2 at = { (float)(chunkTileX + x) * TILE_W, (float)(chunkTileY + y) * TILE_W };
+                                tileset_draw_tile(map.tilesetId, TileType_Void, at, WHITE);
+                                tilesDrawn++;
+                            }
+                        }
+                    }
+                    continue;
+                }
 
-            const Vector2 at = { xx, yy };
+                const ChunkMesh &mesh = chunkMeshes.Fetch(*chunk, groundTileset, objectTileset);
+                if (pass == 0) {
+                    for (int y = y0; y <= y1; y += zoomMipLevel) {
+                        if (zoomMipLevel == 1) {
+                            ChunkMesh::Draw(groundTileset.texture, mesh.ground, (size_t)(y * CHUNK_W + x0), (size_t)(x1 - x0 + 1));
+                            tilesDrawn += (size_t)(x1 - x0 + 1);
+                        } else {
+                            for (int x = x0; x <= x1; x += zoomMipLevel) {
+                                ChunkMesh::Draw(groundTileset.texture, mesh.ground, (size_t)(y * CHUNK_W + x), 1);
+                                tilesDrawn++;
+                            }
+                        }
+                    }
+                    continue;
+                }
 
-            const Tile *tile = map.TileAtWorld(xx, yy);
-            if (tile && tile->object.type) {
-                ObjectType effectiveType = tile->object.EffectiveType();
-                if (effectiveType < ObjectType_SpritesheetCount) {
-                    tileset_draw_tile(TilesetID::TS_Objects, effectiveType, at, WHITE);
-                } else {
+                auto visible = [&](uint16_t tileIdx) {
+                    const int x = tileIdx % CHUNK_W;
+                    const int y = tileIdx / CHUNK_W;
+                    return x >= x0 && x <= x1 && y >= y0 && y <= y1 &&
+                        (x - x0) % zoomMipLevel == 0 && (y - y0) % zoomMipLevel == 0;
+                };
+                for (size_t i = 0; i < mesh.objectTiles.size(); i++) {
+                    if (visible(mesh.objectTiles[i])) {
+                        ChunkMesh::Draw(objectTileset.texture, mesh.objects, i, 1);
+                    }
+                }
+                for (uint16_t tileIdx : mesh.sprites) {
+                    if (!visible(tileIdx)) {
+                        continue;
+                    }
                     // TODO: Make this lookup more general somehow
-                    switch (effectiveType) {
+                    const Tile &tile = chunk->tiles[tileIdx];
+                    switch (tile.object.EffectiveType()) {
                         case ObjectType_Tree01: {
-                            const Spritesheet &spritesheet = Catalog::g_spritesheets.FindById(Catalog::SpritesheetID::Environment_Forest);
-                            DLB_ASSERT(spritesheet.texture.id);
-                            const SpriteDef *spriteDef = spritesheet.FindSprite("tree_01");
-                            const SpriteAnim &spriteAnim = spritesheet.animations[spriteDef->animations[0]];
-                            DLB_ASSERT(spriteAnim.frameCount == 1);
-                            const SpriteFrame &spriteFrame = spritesheet.frames[spriteAnim.frames[0]];
-                            DLB_ASSERT(spriteFrame.width);
-                            DLB_ASSERT(spriteFrame.height);
-
-                            drawList.Push(spriteFrame, at.y + TILE_H, false, at);
-
-                            //const Rectangle frameRect = {
-                            //    (float)spriteFrame.x,
-                            //    (float)spriteFrame.y,
-                            //    (float)spriteFrame.width,
-                            //    (float)spriteFrame.height
-                            //};
-                            //// Render bottom center of sprite in center of tile
-                            //const Vector2 topLeft = {
-                            //    at.x + TILE_W / 2 - frameRect.width / 2,
-                            //    at.y + TILE_H - frameRect.height
-                            //};
-                            //DrawTextureRec(spritesheet.texture, frameRect, topLeft, WHITE);
+                            if (!treeFrame) {
+                                const Spritesheet &spritesheet = Catalog::g_spritesheets.FindById(Catalog::SpritesheetID::Environment_Forest);
+                                DLB_ASSERT(spritesheet.texture.id);
+                                constexpr SpriteID treeId = sprite_id("tree_01");
+                                const SpriteDef *spriteDef = spritesheet.FindSprite(treeId);
+                                const SpriteAnim &spriteAnim = spritesheet.animations[spriteDef->animations[0]];
+                                DLB_ASSERT(spriteAnim.frameCount == 1);
+                                treeFrame = &spritesheet.frames[spriteAnim.frames[0]];
+                                DLB_ASSERT(treeFrame->width);
+                                DLB_ASSERT(treeFrame->height);
+                            }
+                            const Vector2 at = {
+                                (float)(chunkTileX + tileIdx % CHUNK_W) * TILE_W,
+                                (float)(chunkTileY + tileIdx / CHUNK_W) * TILE_W
+                            };
+                            drawList.Push(*treeFrame, DrawableType::SpriteFrame, at.y + TILE_H, false, at);
                             break;
                         }
+                        default: break;
                     }
                 }
             }
@@ -876,7 +935,7 @@ void World::DrawEntities(void)
 {
     for (Player &player : players) {
         if (player.id) {
-            drawList.Push(player, player.Depth(), player.Cull(drawList.cullRect));
+            drawList.Push(player, DrawableType::Player, player.Depth(), player.Cull(drawList.cullRect));
         }
     }
 
@@ -885,7 +944,7 @@ void World::DrawEntities(void)
         for (size_t i = 0; i < npcList.length; i++) {
             NPC &npc = npcList.data[i];
             if (npc.id) {
-                drawList.Push(npc, npc.Depth(), npc.Cull(drawList.cullRect));
+                drawList.Push(npc, DrawableType::NPC, npc.Depth(), npc.Cull(drawList.cullRect));
             }
         }
     }
@@ -1,5 +1,6 @@
 #pragma once
 #include "chat.h"
+#include "chunk_mesh.h"
 #include "controller.h"
 #include "catalog/items.h"
 #include "direction.h"
@@ -42,6 +43,7 @@ struct World {
     LootSystem     lootSystem     {};
     MapSystem      mapSystem      {};
     Tilemap      & map            { mapSystem.Alloc() };
+    ChunkMeshCache chunkMeshes    {};  // client-side, must be invalidated whenever a chunk's tiles change
     ParticleSystem particleSystem {};
     ChatHistory    chatHistory    {};
     bool           peaceful       { false };
@@ -74,8 +76,10 @@ struct World {
 
     void   SV_Simulate              (double dt);
     void   SV_DespawnDeadEntities   (void);
+    // True if worldPos is in a chunk within SV_ENEMY_DESPAWN_RADIUS of a living player, as of this tick
+    bool   SV_IsNearPlayer          (Vector2 worldPos);
 
-    void   CL_Interpolate          (double renderAt);
+    void   CL_Interpolate          (const InterpolationCursor &cursor);
     void   CL_Extrapolate          (double dt);
     void   CL_Animate              (double dt);
     void   CL_DespawnStaleEntities (void);
@@ -89,9 +93,11 @@ struct World {
 
 private:
     const char *LOG_SRC = "World";
-    void SV_SimPlayers (double dt);
-    void SV_SimNpcs    (double dt);
-    void SV_SimItems   (double dt);
+    void SV_SimPlayers            (double dt);
+    void SV_SimNpcs               (double dt);
+    void SV_SimItems              (double dt);
+    void SV_MarkChunksNearPlayers (void);
+    void SV_UpdateChunkLinks      (void);
 
     bool CL_InterpolateBody(Body3D &body, double renderAt, Direction &direction);
 
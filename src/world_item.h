@@ -1,5 +1,6 @@
 #pragma once
 #include "body.h"
+#include "chunk_list.h"
 #include "draw_command.h"
 
 #define ITEM_WORLD_RADIUS 10.0f
@@ -15,6 +16,7 @@ struct WorldItem : Drawable {
     //double    pickedUpAt        {};
     double    despawnedAt       {};
     uint32_t  droppedByPlayerId {};
+    ChunkListNode<WorldItem> chunkNode {};  // server-side, links item into Chunk::items
 
     Vector3 WorldCenter    (void) const;
     Vector3 WorldTopCenter (void) const;
@@ -1,8 +1,15 @@
 #pragma once
 #include "entities/entities.h"
+#include "helpers.h"
 #include "player.h"
 #include "dlb_types.h"
 
+// Item db entry for an item a record refers to. The client copies it into g_item_db when the record is applied.
+struct ItemDbSnapshot {
+    ItemType type {};
+    uint64_t seed {};  // only sent for inventory items
+};
+
 struct PlayerSnapshot {
     enum Flags : uint32_t {
         Flags_None      = 0,
@@ -46,6 +53,7 @@ struct PlayerSnapshot {
     uint8_t         level        {};  // join, level up
     uint32_t        xp           {};  // join, kill enemy
     PlayerInventory inventory    {};  // join, inventory update
+    ItemDbSnapshot  inventoryDb  [PlayerInventory::SlotId_Count]{};  // item db entry of each inventory slot's item
 };
 
 struct NpcSnapshot {
@@ -118,19 +126,82 @@ struct ItemSnapshot {
     uint32_t flags      {};
     uint32_t id         {};  // worldItem id
     ItemUID  itemUid    {};  // item DB uid
+    ItemType itemType   {};  // item DB type of itemUid, sent with it
     uint32_t stackCount {};  // spawn, partial pickup, combine nearby stacks (future)
     Vector3  position   {};  // world position
 };
 
 struct WorldSnapshot {
-    uint32_t       tick          {};  // server tick this snapshot was generated on
-    double         clock         {};  // server's clock time when this snapshot was taken
-    uint32_t       lastInputAck  {};  // sequence # of last processed input
-    float          inputOverflow {};  // amount of next sample after lastInputAck not yet processed
-    uint32_t       playerCount   {};  // players in this snapshot
-    PlayerSnapshot players       [SNAPSHOT_MAX_PLAYERS]{};
-    uint32_t       npcCount      {};  // enemies in this snapshot
-    NpcSnapshot    npcs          [SNAPSHOT_MAX_NPCS]{};
-    uint32_t       itemCount     {};  // items in this snapshot
-    ItemSnapshot   items         [SNAPSHOT_MAX_ITEMS]{};
+    uint32_t tick          {};  // server tick this snapshot was generated on
+    double   clock         {};  // server's clock time when this snapshot was taken
+    uint32_t lastInputAck  {};  // sequence # of last processed input
+    float    inputOverflow {};  // amount of next sample after lastInputAck not yet processed
+
+    // Filled in by the client as records are applied, not sent
+    uint32_t playerCount   {};  // players in this snapshot
+    uint32_t npcCount      {};  // enemies in this snapshot
+    uint32_t itemCount     {};  // items in this snapshot
+    uint32_t ownerFlags    {};  // flags of the client's own player record, Flags_None if it wasn't in this snapshot
+    Vector3  ownerPosition {};  // position of the client's own player, for reconciliation
+};
+
+enum class SnapshotRecordType : uint8_t {
+    None,  // no more records
+    Player,
+    Npc,
+    Item,
+    Count
+};
+
+// One entity record, only the pointer matching type is set
+struct WorldSnapshotRecord {
+    SnapshotRecordType type   {};
+    PlayerSnapshot     *player {};
+    NpcSnapshot        *npc    {};
+    ItemSnapshot       *item   {};
+
+    // Most bytes a record of this type can take in a snapshot, including its type
+    static size_t SizeMax(SnapshotRecordType type) {
+        switch (type) {
+            case SnapshotRecordType::Player: return SNAPSHOT_PLAYER_SIZE_MAX;
+            case SnapshotRecordType::Npc:    return SNAPSHOT_NPC_SIZE_MAX;
+            case SnapshotRecordType::Item:   return SNAPSHOT_ITEM_SIZE_MAX;
+            default:                         return 1;
+        }
+    }
+};
+
+// Entity records aren't stored in the snapshot. NetMessage::Process pulls them from the writer's world state one at a
+// time as it serializes, and hands them to the reader's world one at a time as it deserializes, so a snapshot can
+// hold as many records as fit in a packet.
+struct WorldSnapshotRecords {
+    virtual ~WorldSnapshotRecords(void) {}
+
+    // Writer: the snapshot never grows past this many bytes, 0 = as many as fit
+    size_t budget {};
+
+    // Writer: return the next record to send, which must fit in room bytes, or a record with type None when there
+    // are no more. Records of any type can come in any order. By default, hands out every player, then every npc,
+    // then every item, as long as there's room for them.
+    virtual WorldSnapshotRecord Next(size_t room) {
+        WorldSnapshotRecord record{};
+        if (room >= SNAPSHOT_PLAYER_SIZE_MAX && (record.player = NextPlayer())) {
+            record.type = SnapshotRecordType::Player;
+        } else if (room >= SNAPSHOT_NPC_SIZE_MAX && (record.npc = NextNpc())) {
+            record.type = SnapshotRecordType::Npc;
+        } else if (room >= SNAPSHOT_ITEM_SIZE_MAX && (record.item = NextItem())) {
+            record.type = SnapshotRecordType::Item;
+        }
+        return record;
+    }
+    // Writer: return the next record of this type, or null when there are no more, see Next
+    virtual PlayerSnapshot *NextPlayer (void) { return 0; }
+    virtual NpcSnapshot    *NextNpc    (void) { return 0; }
+    virtual ItemSnapshot   *NextItem   (void) { return 0; }
+
+    // Reader: called once the header has been read, then for each record as soon as it has been read
+    virtual void OnHeader (const WorldSnapshot &) {}
+    virtual void OnPlayer (const PlayerSnapshot &) {}
+    virtual void OnNpc    (const NpcSnapshot &) {}
+    virtual void OnItem   (const ItemSnapshot &) {}
 };
@@ -0,0 +1,98 @@
+#include "tests.h"
+#include "../src/asset_loader.h"
+#include <cassert>
+#include <thread>
+
+// Stands in for one asset: the decoded data written by Load, and who ran each half of it
+struct asset_loader_test_asset {
+    uint64_t        decoded    {};
+    std::thread::id loadedOn   {};
+    std::thread::id finishedOn {};
+    bool            uploaded   {};
+};
+
+// Every job loads on a worker and finishes on the thread that polls (i.e. where the GPU/audio uploads would happen),
+// failed jobs still get to finish so they can fall back to placeholders, and the timings are there for every job
+// without needing a window.
+static void asset_loader_test_jobs()
+{
+    const size_t JOBS = 64;
+    const std::thread::id mainThread = std::this_thread::get_id();
+    asset_loader_test_asset *assets = new asset_loader_test_asset[JOBS]{};
+
+    StartupLog startupLog{};
+    startupLog.Start();
+
+    AssetLoader &loader = *(new AssetLoader{});
+    loader.Start(4);
+    for (size_t i = 0; i < JOBS; i++) {
+        asset_loader_test_asset *asset = &assets[i];
+        loader.Queue(i % 16 == 15 ? "missing.png" : "asset.png",
+            [asset, i] {
+                // Something to decode
+                uint64_t hash = 14695981039346656037ull;
+                for (size_t j = 0; j < 200000 + i * 1000; j++) {
+                    hash = (hash ^ (j & 0xff)) * 1099511628211ull;
+                }
+                asset->decoded = hash;
+                asset->loadedOn = std::this_thread::get_id();
+                return i % 16 == 15 ? ErrorType::FileReadFailed : ErrorType::Success;
+            },
+            [asset] {
+                asset->finishedOn = std::this_thread::get_id();
+                asset->uploaded = asset->decoded != 0;
+            }
+        );
+    }
+    assert(loader.JobsQueued() == JOBS);
+    assert(!loader.Done());
+
+    size_t progressCalls = 0;
+    float lastProgress = 0.0f;
+    loader.Wait([&] {
+        assert(loader.Progress() >= lastProgress);
+        lastProgress = loader.Progress();
+        progressCalls++;
+        std::this_thread::yield();
+    });
+    startupLog.Mark("Assets");
+
+    assert(loader.Done());
+    assert(loader.Progress() == 1.0f);
+    assert(progressCalls);
+    assert(loader.JobsFinished() == JOBS);
+    assert(loader.JobsFailed() == JOBS / 16);
+    for (size_t i = 0; i < JOBS; i++) {
+        assert(assets[i].uploaded);
+        assert(assets[i].loadedOn != mainThread);
+        assert(assets[i].finishedOn == mainThread);
+    }
+
+    double prevDoneAt = 0;
+    for (const AssetLoader::Timing &timing : loader.timings) {
+        assert(timing.name);
+        assert(timing.loadSecs > 0);
+        assert(timing.doneAt >= prevDoneAt);
+        prevDoneAt = timing.doneAt;
+    }
+    assert(startupLog.stages.size() == 1);
+    assert(startupLog.stages[0].at >= prevDoneAt);
+
+    // Stopping twice (and again in the destructor) is fine, and the loader can be restarted for another batch
+    loader.Stop();
+    loader.Stop();
+    loader.Start(1);
+    bool finished = false;
+    loader.Queue("again.png", [] { return ErrorType::Success; }, [&finished] { finished = true; });
+    loader.Wait();
+    assert(finished);
+    assert(loader.JobsFinished() == 1);
+
+    delete &loader;
+    delete[] assets;
+}
+
+void asset_loader_test()
+{
+    asset_loader_test_jobs();
+}
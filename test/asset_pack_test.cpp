@@ -0,0 +1,100 @@
+#include "tests.h"
+#include "../src/asset_pack.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+// Every asset reads back byte for byte by the path it was added with, user data defers to a loose file when there is
+// one, and damage anywhere in the pack is caught instead of handed to a decoder.
+static void asset_pack_test_roundtrip()
+{
+    // Saved over in the temp dir, not the working dir (which is the game's data dir)
+    const std::string userPathStr = (std::filesystem::temp_directory_path() / "asset_pack_test_user.dat").string();
+    const char *userPath = userPathStr.c_str();
+    remove(userPath);
+
+    AssetPackWriter &writer = *(new AssetPackWriter{});
+    std::vector<std::vector<unsigned char>> assets{};
+    char path[64]{};
+    for (int i = 0; i < 50; i++) {
+        std::vector<unsigned char> &asset = assets.emplace_back(1 + i * 37);
+        for (size_t j = 0; j < asset.size(); j++) {
+            asset[j] = (unsigned char)(i * 31 + j);
+        }
+        snprintf(path, sizeof(path), "data/test/asset%d.bin", i);
+        assert(writer.Add(path, asset.data(), asset.size()) == ErrorType::Success);
+    }
+    assert(writer.Add("data/test/empty.bin", 0, 0) == ErrorType::Success);
+    assert(writer.Add(userPath, "packed", 6, AssetPackFlag_Default) == ErrorType::Success);
+    assert(writer.Add("data/test/asset0.bin", "dupe", 4) == ErrorType::AllocFailed_Duplicate);
+
+    std::vector<unsigned char> packData{};
+    writer.Build(packData);
+    AssetPack &pack = *(new AssetPack{});
+    assert(pack.OpenMemory(packData.data(), packData.size()) == ErrorType::Success);
+    assert(pack.EntryCount() == assets.size() + 2);
+    assert(pack.Verify() == ErrorType::Success);
+
+    for (int i = 0; i < (int)assets.size(); i++) {
+        snprintf(path, sizeof(path), "data/test/asset%d.bin", i);
+        const AssetPackEntry *entry = pack.Find(AssetPack::PathID(path));
+        assert(entry);
+        assert(entry->offset % ASSET_PACK_ALIGN == 0);
+        assert(entry->size == assets[i].size());
+        const unsigned char *data = pack.Read(*entry);
+        assert(data && !memcmp(data, assets[i].data(), assets[i].size()));
+
+        unsigned int bytesRead = 0;
+        unsigned char *copy = pack.LoadFile(path, &bytesRead, false);
+        assert(copy && bytesRead == assets[i].size() && !memcmp(copy, assets[i].data(), bytesRead));
+        free(copy);
+    }
+    const AssetPackEntry *empty = pack.Find(AssetPack::PathID("data/test/empty.bin"));
+    assert(empty && !empty->size && pack.Read(*empty));
+    assert(!pack.Find(AssetPack::PathID("data/test/missing.bin")));
+    unsigned int bytesRead = 1;
+    assert(!pack.LoadFile("data/test/missing.bin", &bytesRead, false) && !bytesRead);
+
+    // Packed user data is only used until something's been saved over it
+    char *text = (char *)pack.LoadFile(userPath, 0, true);
+    assert(text && !strcmp(text, "packed"));
+    free(text);
+    FILE *file = fopen(userPath, "wb");
+    assert(file);
+    fputs("saved", file);
+    fclose(file);
+    text = (char *)pack.LoadFile(userPath, &bytesRead, true);
+    assert(text && !strcmp(text, "saved") && bytesRead == 5);
+    free(text);
+    remove(userPath);
+
+    // Damage to an asset fails just that asset, damage to the header or table of contents fails the whole pack
+    const AssetPackEntry *first = pack.Find(AssetPack::PathID("data/test/asset1.bin"));
+    packData[first->offset + 1] ^= 0x40;
+    assert(!pack.Read(*first));
+    assert(pack.Verify() != ErrorType::Success);
+    packData[first->offset + 1] ^= 0x40;
+    assert(pack.Verify() == ErrorType::Success);
+
+    AssetPackHeader header{};
+    memcpy(&header, packData.data(), sizeof(header));
+    std::vector<unsigned char> bad = packData;
+    bad[header.tocOffset + 3] ^= 0x01;
+    assert(pack.OpenMemory(bad.data(), bad.size()) != ErrorType::Success);
+    bad = packData;
+    bad[0] = 'X';
+    assert(pack.OpenMemory(bad.data(), bad.size()) != ErrorType::Success);
+    assert(pack.OpenMemory(packData.data(), packData.size() - 1) != ErrorType::Success);
+    assert(pack.OpenMemory(packData.data(), sizeof(header) - 1) != ErrorType::Success);
+    assert(!pack.IsOpen());
+
+    delete &pack;
+    delete &writer;
+}
+
+void asset_pack_test()
+{
+    asset_pack_test_roundtrip();
+}
@@ -0,0 +1,72 @@
+#include "tests.h"
+#include "../src/chunk_mesh.h"
+#include <cassert>
+
+// Same layout as tileset_load, without needing a GL context to load the texture
+static void chunk_mesh_test_tileset(Tileset &tileset)
+{
+    tileset.texture.width = 8 * TILE_W;
+    tileset.texture.height = 8 * TILE_W;
+    const int tilesPerRow = tileset.texture.width / TILE_W;
+    for (size_t i = 0; i < ARRAY_SIZE(tileset.textureRects); i++) {
+        tileset.textureRects[i] = { (float)(i % tilesPerRow * TILE_W), (float)(i / tilesPerRow * TILE_W), TILE_W, TILE_W };
+    }
+}
+
+void chunk_mesh_test()
+{
+    Tileset &groundTileset = *(new Tileset{});
+    Tileset &objectTileset = *(new Tileset{});
+    chunk_mesh_test_tileset(groundTileset);
+    chunk_mesh_test_tileset(objectTileset);
+
+    Chunk &chunk = *(new Chunk{});
+    chunk.x = -1;
+    chunk.y = 2;
+    for (size_t i = 0; i < ARRAY_SIZE(chunk.tiles); i++) {
+        chunk.tiles[i].type = TileType_Grass;
+    }
+    const size_t rockIdx = 1 * CHUNK_W + 1;
+    const size_t treeIdx = 3 * CHUNK_W + 7;
+    chunk.tiles[rockIdx].object.type = ObjectType_Rock01;
+    chunk.tiles[treeIdx].object.type = ObjectType_Tree01;
+
+    ChunkMeshCache &cache = *(new ChunkMeshCache{});
+    const ChunkMesh &mesh = cache.Fetch(chunk, groundTileset, objectTileset);
+    assert(cache.builds == 1);
+
+    // One ground quad per tile, in world space, in tile order
+    assert(mesh.ground.size() == ARRAY_SIZE(chunk.tiles) * 4);
+    const ChunkMeshVertex *rockGround = &mesh.ground[rockIdx * 4];
+    assert(rockGround[0].x == -1 * CHUNK_W * TILE_W + TILE_W);
+    assert(rockGround[0].y == 2 * CHUNK_H * TILE_W + TILE_W);
+    assert(rockGround[2].x == rockGround[0].x + TILE_W);
+    assert(rockGround[2].y == rockGround[0].y + TILE_W);
+    const Rectangle &grassRect = groundTileset.textureRects[TileType_Grass];
+    assert(rockGround[0].u == grassRect.x / groundTileset.texture.width);
+    assert(rockGround[2].v == (grassRect.y + grassRect.height) / groundTileset.texture.height);
+
+    // Flat objects get a quad, spritesheet objects are left for the draw list
+    assert(mesh.objects.size() == 4);
+    assert(mesh.objectTiles.size() == 1 && mesh.objectTiles[0] == rockIdx);
+    assert(mesh.objects[0].x == rockGround[0].x && mesh.objects[0].y == rockGround[0].y);
+    assert(mesh.sprites.size() == 1 && mesh.sprites[0] == treeIdx);
+
+    // Cached until the chunk is invalidated, then rebuilt with the new tiles
+    cache.Fetch(chunk, groundTileset, objectTileset);
+    assert(cache.builds == 1);
+    chunk.tiles[rockIdx].type = TileType_Water;
+    chunk.tiles[rockIdx].object.type = ObjectType_None;
+    cache.Invalidate(Chunk::Hash(0, 0));
+    cache.Invalidate(chunk.Hash());
+    const ChunkMesh &rebuilt = cache.Fetch(chunk, groundTileset, objectTileset);
+    assert(cache.builds == 2);
+    assert(rebuilt.objects.empty());
+    const Rectangle &waterRect = groundTileset.textureRects[TileType_Water];
+    assert(rebuilt.ground[rockIdx * 4].u == waterRect.x / groundTileset.texture.width);
+
+    delete &cache;
+    delete &chunk;
+    delete &objectTileset;
+    delete &groundTileset;
+}
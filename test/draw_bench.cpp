@@ -0,0 +1,160 @@
+// Headless DrawList benchmark: pushes a frame's worth of drawables at random depths and flushes them, and compares
+// against the insertion sort DrawList used to do on every Push. Draw calls only record what would have been drawn, so
+// no window is ever opened. Build the SlimeDrawBench target and run it from a console, optionally with the number of
+// frames as the first argument.
+#include "../src/draw_command.h"
+#include "../src/error.h"
+#include "../src/helpers.h"
+#include "dlb_rand.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+DLB_ASSERT_HANDLER(draw_bench_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = draw_bench_assert;
+
+// Stands in for a sprite, counts how often the type changes from one draw to the next (i.e. how often a real frame
+// would have to switch textures and break the batch)
+struct DrawBenchDrawable : Drawable {
+    static const DrawBenchDrawable *lastDrawn;
+    static size_t draws;
+    static size_t batches;
+    static bool   outOfOrder;
+    static bool   tiesInPushOrder;  // two drawables with the same sort key came out in the order they were pushed
+
+    DrawableType type  {};
+    float        depth {};
+
+    void Draw(World &world, Vector2 at) const override
+    {
+        UNUSED(world);
+        UNUSED(at);
+        if (!lastDrawn || lastDrawn->type != type) {
+            batches++;
+        }
+        if (lastDrawn && floorf(lastDrawn->depth * CL_DRAW_DEPTH_SCALE) > floorf(depth * CL_DRAW_DEPTH_SCALE)) {
+            outOfOrder = true;
+        }
+        if (lastDrawn && lastDrawn < this && lastDrawn->type == type &&
+            floorf(lastDrawn->depth * CL_DRAW_DEPTH_SCALE) == floorf(depth * CL_DRAW_DEPTH_SCALE)) {
+            tiesInPushOrder = true;  // drawables are pushed in address order
+        }
+        lastDrawn = this;
+        draws++;
+    }
+
+    static void Reset(void) { lastDrawn = 0; draws = 0; batches = 0; outOfOrder = false; tiesInPushOrder = false; }
+};
+const DrawBenchDrawable *DrawBenchDrawable::lastDrawn;
+size_t DrawBenchDrawable::draws;
+size_t DrawBenchDrawable::batches;
+bool   DrawBenchDrawable::outOfOrder;
+bool   DrawBenchDrawable::tiesInPushOrder;
+
+// What DrawList::Push used to do: keep the list sorted by inserting every command in place
+struct DrawBenchInsertionList {
+    struct Command {
+        const Drawable *drawable {};
+        float           depth    {};
+    };
+    std::vector<Command> sortedCommands {};
+
+    void Push(const Drawable &drawable, float depth)
+    {
+        size_t size = sortedCommands.size();
+        sortedCommands.resize(size + 1);
+        int j;
+        for (j = (int)size - 1; j >= 0; j--) {
+            if (depth > sortedCommands[j].depth) {
+                break;
+            }
+            sortedCommands[(size_t)j + 1] = sortedCommands[j];
+        }
+        sortedCommands[(size_t)j + 1] = { &drawable, depth };
+    }
+
+    void Flush(World &world)
+    {
+        for (const Command &cmd : sortedCommands) {
+            cmd.drawable->Draw(world, {});
+        }
+        sortedCommands.clear();
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const size_t COMMANDS = 10000;
+    const int frames = argc > 1 ? atoi(argv[1]) : 100;
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // A 1080p screen's worth of depths, with about a third of things (trees, dropped items) sitting exactly on a tile
+    // row, the way tile objects are pushed
+    dlb_rand32_t rng{};
+    dlb_rand32_seed_r(&rng, 0xd4a3, 0xd4a3);
+    std::vector<DrawBenchDrawable> drawables(COMMANDS);
+    for (DrawBenchDrawable &drawable : drawables) {
+        drawable.type = (DrawableType)(dlb_rand32u_r(&rng) % (uint32_t)DrawableType::Count);
+        if (dlb_rand32u_r(&rng) % 3 == 0) {
+            drawable.depth = (float)(TILE_H * (dlb_rand32u_r(&rng) % (1080 / TILE_H)));
+        } else {
+            drawable.depth = dlb_rand32f_range_r(&rng, -64.0f, 1080.0f + 64.0f);
+        }
+    }
+
+    // Draw never touches the world, it's only passed through
+    World &world = *(World *)&drawables;
+
+    printf("%d frames of %zu draw commands\n\n", frames, COMMANDS);
+    printf("%-24s %14s %10s\n", "list", "push+flush us", "batches");
+
+    DrawBenchInsertionList &insertionList = *(new DrawBenchInsertionList{});
+    const auto insertionStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        DrawBenchDrawable::Reset();
+        for (const DrawBenchDrawable &drawable : drawables) {
+            insertionList.Push(drawable, drawable.depth);
+        }
+        insertionList.Flush(world);
+        DLB_ASSERT(DrawBenchDrawable::draws == COMMANDS);
+        DLB_ASSERT(!DrawBenchDrawable::outOfOrder);
+    }
+    const auto insertionEnd = std::chrono::steady_clock::now();
+    printf("%-24s %14.1f %10zu\n", "insertion (old)",
+        std::chrono::duration<double, std::micro>(insertionEnd - insertionStart).count() / frames, DrawBenchDrawable::batches);
+
+    DrawList &drawList = *(new DrawList{});
+    const auto radixStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        DrawBenchDrawable::Reset();
+        for (const DrawBenchDrawable &drawable : drawables) {
+            drawList.Push(drawable, drawable.type, drawable.depth);
+        }
+        drawList.Flush(world);
+        DLB_ASSERT(DrawBenchDrawable::draws == COMMANDS);
+        DLB_ASSERT(!DrawBenchDrawable::outOfOrder);
+        // Same as the insertion sort, which put each new command in front of the ones already at its depth
+        DLB_ASSERT(!DrawBenchDrawable::tiesInPushOrder);
+    }
+    const auto radixEnd = std::chrono::steady_clock::now();
+    printf("%-24s %14.1f %10zu\n", "radix",
+        std::chrono::duration<double, std::micro>(radixEnd - radixStart).count() / frames, DrawBenchDrawable::batches);
+
+    delete &drawList;
+    delete &insertionList;
+    return 0;
+}
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/draw_command.cpp"
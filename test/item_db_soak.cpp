@@ -0,0 +1,193 @@
+// Item database soak test: hours of slimes dropping loot that gets picked up, dropped, thrown away, or left to despawn,
+// with a client database mirroring whatever the server sends it. Neither database may grow past what's being held at
+// once. Runs for a long time and rewires the Long Sword proto, so it isn't part of run_tests(). Build the
+// SlimeItemDbSoak target and run it from a console, optionally with the number of hours as the first argument. It
+// exits non-zero on failure.
+#include "../src/error.h"
+#include "../src/helpers.h"
+#include "../src/world.h"
+#include "dlb_rand.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+DLB_ASSERT_HANDLER(item_db_soak_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = item_db_soak_assert;
+
+// The item system never has a map here, and nothing is drawn or simulated
+void Tilemap::UnlinkChunk(WorldItem &item) { UNUSED(item); abort(); }
+void Tilemap::UpdateChunkLink(WorldItem &item) { UNUSED(item); abort(); }
+void Tilemap::RelocateChunkLink(WorldItem &from, WorldItem &to) { UNUSED(from); UNUSED(to); abort(); }
+void sprite_update(Sprite &sprite, double dt) { UNUSED(sprite); UNUSED(dt); abort(); }
+void WorldItem::Update(double dt) { UNUSED(dt); abort(); }
+float WorldItem::Depth(void) const { abort(); }
+bool WorldItem::Cull(const Rectangle &cullRect) const { UNUSED(cullRect); abort(); }
+void WorldItem::Draw(World &world, Vector2 at) const { UNUSED(world); UNUSED(at); abort(); }
+
+int main(int argc, char *argv[])
+{
+    const int hours = argc > 1 ? atoi(argv[1]) : 4;
+    if (hours <= 0) {
+        fprintf(stderr, "usage: %s [hours]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Only the server spawns new items, and only items with affixes get their own uid
+    g_clock.server = true;
+    ItemProto &proto = g_item_catalog.FindProto(ItemType_Weapon_Long_Sword);
+    proto.stackLimit = 1;
+    proto.SetAffixProto(ItemAffix_DamageFlat, { 1.0f, 2.0f }, { 3.0f, 4.0f });
+    DLB_ASSERT(!proto.IsScalar());
+
+    ItemSystem &items = *(new ItemSystem{});
+    PlayerInventory &inventory = *(new PlayerInventory{});
+    ItemDatabase &clientDb = *(new ItemDatabase{});
+    std::unordered_map<EntityUID, ItemUID> clientItems{};  // client's world items
+    PlayerInventory &clientInventory = *(new PlayerInventory{});
+    const size_t reserved = g_item_db.Count();
+
+    dlb_rand32_t rng{};
+    dlb_rand32_seed_r(&rng, 4321, 8765);
+    const double dt = 0.25;
+    const int ticksPerHour = (int)(3600 / dt);
+    size_t highWater = 0;
+    size_t clientHighWater = 0;
+    for (int tick = 0; tick < hours * ticksPerHour; tick++) {
+        g_clock.now += dt;
+
+        // A slime dies every few seconds and drops a couple of swords
+        if (dlb_rand32u_r(&rng) % 12 == 0) {
+            const int drops = 1 + dlb_rand32u_r(&rng) % 3;
+            for (int i = 0; i < drops; i++) {
+                const ItemUID uid = g_item_db.SV_Spawn(ItemType_Weapon_Long_Sword);
+                DLB_ASSERT(uid);
+                if (dlb_rand32u_r(&rng) % 20) {  // spawn fails now and then when the pool is full
+                    items.SpawnItem({}, uid, 1);
+                }
+            }
+        }
+
+        // The player picks up some of it, and drops or uses up some of what they're carrying
+        if (items.worldItems.size() && dlb_rand32u_r(&rng) % 6 == 0) {
+            WorldItem &item = items.worldItems[dlb_rand32u_r(&rng) % items.worldItems.size()];
+            if (!item.despawnedAt && inventory.PickUp(item.stack)) {
+                item.stack.count = 0;
+                item.despawnedAt = g_clock.now;
+            }
+        }
+        if (dlb_rand32u_r(&rng) % 15 == 0) {
+            const PlayerInventory::SlotId slotId = dlb_rand32u_r(&rng) % PLAYER_INV_REG_COUNT;
+            const ItemStack dropped = inventory.SlotDrop(slotId, 1);
+            if (dropped.count && dlb_rand32u_r(&rng) % 2) {
+                items.SpawnItem({}, dropped.uid, dropped.count);
+            }
+        }
+        if (dlb_rand32u_r(&rng) % 40 == 0) {
+            inventory.SortAndCombine();
+        }
+
+        // Reconnect every hour with nothing
+        if (tick % ticksPerHour == ticksPerHour - 1) {
+            inventory.ReleaseItems();
+            inventory = {};
+        }
+
+        // Despawns an item as soon as it's been picked up, or after SV_WORLD_ITEM_LIFETIME on the ground
+        items.DespawnDeadEntities(0);
+
+        // Client gets a snapshot of every world item and the inventory
+        for (const WorldItem &item : items.worldItems) {
+            Item &clientItem = clientDb.FindOrCreate(item.stack.uid);
+            clientItem.type = g_item_db.Find(item.stack.uid).type;
+            if (!clientItems.count(item.euid)) {
+                clientItems[item.euid] = item.stack.uid;
+                clientDb.AddRef(item.stack.uid);
+            }
+        }
+        for (auto iter = clientItems.begin(); iter != clientItems.end();) {
+            if (!items.Find(iter->first)) {
+                clientDb.Release(iter->second);
+                iter = clientItems.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+        for (const PlayerInventory::Slot &slot : inventory.slots) {
+            if (slot.stack.count) {
+                clientDb.FindOrCreate(slot.stack.uid).type = g_item_db.Find(slot.stack.uid).type;
+            }
+        }
+        for (PlayerInventory::Slot &slot : clientInventory.slots) {
+            if (slot.stack.count) {
+                clientDb.Release(slot.stack.uid);
+            }
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(inventory.slots); i++) {
+            clientInventory.slots[i].stack = inventory.slots[i].stack;
+            if (clientInventory.slots[i].stack.count) {
+                clientDb.AddRef(clientInventory.slots[i].stack.uid);
+            }
+        }
+
+        g_item_db.Reclaim();
+        clientDb.Reclaim();
+
+        // Everything that's held can still be found, and nothing else is left
+        size_t held = 0;
+        for (const WorldItem &item : items.worldItems) {
+            DLB_ASSERT(g_item_db.Find(item.stack.uid).uid == item.stack.uid);
+            DLB_ASSERT(g_item_db.RefCount(item.stack.uid));
+            held++;
+        }
+        for (const PlayerInventory::Slot &slot : inventory.slots) {
+            if (slot.stack.count) {
+                DLB_ASSERT(g_item_db.Find(slot.stack.uid).type == ItemType_Weapon_Long_Sword);
+                held++;
+            }
+        }
+        DLB_ASSERT(g_item_db.Count() <= reserved + held);
+        DLB_ASSERT(clientDb.Count() <= reserved + held);
+
+        if (tick == ticksPerHour - 1) {
+            highWater = g_item_db.Capacity();
+            clientHighWater = clientDb.Capacity();
+        }
+    }
+
+    // Bounded by what can be held at once (each inventory slot, then each world item), and flat after the first hour
+    DLB_ASSERT(g_item_db.Capacity() <= reserved + SV_MAX_ITEMS + PlayerInventory::SlotId_Count + 3);
+    DLB_ASSERT(clientDb.Capacity() <= reserved + SV_MAX_ITEMS + PlayerInventory::SlotId_Count + 3);
+    DLB_ASSERT(g_item_db.Capacity() <= highWater + 16);
+    DLB_ASSERT(clientDb.Capacity() <= clientHighWater + 16);
+
+    printf("%d hours, server db capacity %zu (%zu after the first hour), client db capacity %zu (%zu)\n", hours,
+        g_item_db.Capacity(), highWater, clientDb.Capacity(), clientHighWater);
+
+    inventory.ReleaseItems();
+    delete &items;
+    g_item_db.Reclaim();
+    DLB_ASSERT(g_item_db.Count() == reserved);
+
+    delete &clientInventory;
+    delete &clientDb;
+    delete &inventory;
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/body.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/draw_command.cpp"
+#include "../src/item_system.cpp"
+#include "../src/spritesheet.cpp"
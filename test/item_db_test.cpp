@@ -0,0 +1,58 @@
+#include "tests.h"
+#include "../src/item_system.h"
+#include <cassert>
+
+// Reclaimed slots are reused, but never under a uid that still finds anything
+static void item_db_test_generations()
+{
+    ItemDatabase &db = *(new ItemDatabase{});
+    const size_t reserved = db.Count();
+
+    const ItemUID a = db.SV_Spawn(ItemType_Weapon_Long_Sword);
+    assert(a >= ItemType_Count);
+    assert(db.Find(a).uid == a && db.Find(a).type == ItemType_Weapon_Long_Sword);
+
+    // Still valid until Reclaim, even with nothing holding it
+    db.AddRef(a);
+    db.Release(a);
+    assert(db.Find(a).uid == a);
+    assert(db.Reclaim() == 1);
+    assert(!db.Find(a).uid);
+    assert(db.Count() == reserved);
+
+    const ItemUID b = db.SV_Spawn(ItemType_Weapon_Long_Sword);
+    assert(b != a);
+    assert((b & (ITEM_DB_MAX_ITEMS - 1)) == (a & (ITEM_DB_MAX_ITEMS - 1)));
+    assert(!db.Find(a).uid);
+    assert(db.Find(b).uid == b);
+
+    // Held items survive, reserved ones aren't counted at all
+    db.AddRef(b);
+    db.AddRef(ItemType_Currency_Silver);
+    assert(db.Reclaim() == 0);
+    assert(db.RefCount(b) == 1 && db.Find(b).uid == b);
+    assert(db.Find(ItemType_Currency_Silver).uid == ItemType_Currency_Silver);
+    db.Release(b);
+    db.Release(ItemType_Currency_Silver);
+    assert(db.Reclaim() == 1);
+    assert(db.Count() == reserved);
+
+    delete &db;
+}
+
+void item_db_test()
+{
+    // Only the server spawns new items, and only items with affixes get their own uid
+    const bool server = g_clock.server;
+    g_clock.server = true;
+    ItemProto &proto = g_item_catalog.FindProto(ItemType_Weapon_Long_Sword);
+    const ItemProto protoPrev = proto;
+    proto.stackLimit = 1;
+    proto.SetAffixProto(ItemAffix_DamageFlat, { 1.0f, 2.0f }, { 3.0f, 4.0f });
+    assert(!proto.IsScalar());
+
+    item_db_test_generations();
+
+    proto = protoPrev;
+    g_clock.server = server;
+}
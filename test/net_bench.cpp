@@ -0,0 +1,315 @@
+// Headless serialization benchmark: encodes and decodes a representative mix of NetMessages and reports the cost
+// of each, then the cost of broadcasting a message to a growing number of peers. Only links raylib for logging/file
+// utils, never opens a window or a socket. Build the SlimeNetBench target and run it from a console, optionally with
+// the number of iterations per message as the first argument.
+#include "../src/error.h"
+#include "../src/net_bundle.h"
+#include "../src/net_message.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+DLB_ASSERT_HANDLER(net_bench_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = net_bench_assert;
+
+// Hands out the same records every time the snapshot is serialized, and throws away the ones it reads
+struct NetBenchRecords : WorldSnapshotRecords {
+    std::vector<PlayerSnapshot> players     {};
+    std::vector<NpcSnapshot>    npcs        {};
+    std::vector<ItemSnapshot>   items       {};
+    size_t                      nextPlayer  {};
+    size_t                      nextNpc     {};
+    size_t                      nextItem    {};
+    size_t                      recordsRead {};
+
+    void Rewind(void) { nextPlayer = nextNpc = nextItem = 0; }
+
+    PlayerSnapshot *NextPlayer(void) override { return nextPlayer < players.size() ? &players[nextPlayer++] : 0; }
+    NpcSnapshot    *NextNpc   (void) override { return nextNpc    < npcs.size()    ? &npcs   [nextNpc++   ] : 0; }
+    ItemSnapshot   *NextItem  (void) override { return nextItem   < items.size()   ? &items  [nextItem++  ] : 0; }
+
+    void OnPlayer(const PlayerSnapshot &) override { recordsRead++; }
+    void OnNpc   (const NpcSnapshot &) override { recordsRead++; }
+    void OnItem  (const ItemSnapshot &) override { recordsRead++; }
+};
+
+struct NetBenchCase {
+    const char *name    {};
+    NetMessage *msg     {};
+    size_t      records {};  // snapshot records written per message, 0 for other messages
+};
+
+static void net_bench_snapshot(NetBenchRecords &records, NetMessage &msg, bool spawn)
+{
+    msg.type = NetMessage::Type::WorldSnapshot;
+    msg.snapshotRecords = &records;
+    msg.data.worldSnapshot.tick = 1234;
+    msg.data.worldSnapshot.clock = 41.1;
+    msg.data.worldSnapshot.lastInputAck = 4321;
+    msg.data.worldSnapshot.inputOverflow = 0.003f;
+
+    // Every player the server allows, the owner with its whole inventory
+    for (uint32_t i = 0; i < SV_MAX_PLAYERS; i++) {
+        PlayerSnapshot player{};
+        player.id = 1 + i;
+        player.flags = spawn ? PlayerSnapshot::Flags_Spawn : PlayerSnapshot::Flags_Position;
+        player.position = { 100.0f * i, 200.0f, 0.0f };
+        player.direction = Direction::South;
+        player.hitPoints = 80.0f;
+        player.hitPointsMax = 100.0f;
+        player.level = 3;
+        if (!i) {
+            player.flags |= PlayerSnapshot::Flags_Owner;
+            player.speed = 1.0f;
+            player.xp = 1234;
+            if (spawn) {
+                player.flags |= PlayerSnapshot::Flags_Inventory;
+                for (size_t slot = 0; slot < ARRAY_SIZE(player.inventory.slots); slot++) {
+                    ItemStack &stack = player.inventory.slots[slot].stack;
+                    stack.uid = (ItemUID)(1 + slot % (ItemType_Count - 1));
+                    stack.count = 1 + (uint32_t)slot;
+                }
+            }
+        }
+        records.players.push_back(player);
+    }
+
+    // Every npc and item the server can hold, all in range
+    for (uint32_t i = 0; i < SV_MAX_NPCS; i++) {
+        NpcSnapshot npc{};
+        npc.id = 1 + i;
+        npc.type = NPC::Type_Slime;
+        npc.flags = spawn ? NpcSnapshot::Flags_Spawn : (NpcSnapshot::Flags_Position | NpcSnapshot::Flags_Direction);
+        npc.nameLength = (uint8_t)snprintf(npc.name, sizeof(npc.name), "Slime");
+        npc.position = { 10.0f * i, 20.0f * i, 0.0f };
+        npc.direction = Direction::East;
+        npc.scale = 1.0f;
+        npc.hitPoints = 10.0f;
+        npc.hitPointsMax = 10.0f;
+        npc.level = 1;
+        records.npcs.push_back(npc);
+    }
+    for (uint32_t i = 0; i < SV_MAX_ITEMS; i++) {
+        ItemSnapshot item{};
+        item.id = 1 + i;
+        item.flags = spawn ? ItemSnapshot::Flags_Spawn : ItemSnapshot::Flags_Position;
+        item.itemUid = 1 + i % (ItemType_Count - 1);
+        item.stackCount = 1;
+        item.position = { 5.0f * i, 5.0f * i, 0.0f };
+        records.items.push_back(item);
+    }
+}
+
+static void net_bench_chunk(NetMessage &msg)
+{
+    msg.type = NetMessage::Type::WorldChunk;
+    Chunk &chunk = msg.data.worldChunk.chunk;
+    chunk.x = 3;
+    chunk.y = -7;
+    chunk.version = 12;
+    for (size_t i = 0; i < ARRAY_SIZE(chunk.tiles); i++) {
+        chunk.tiles[i].type = (TileType)(i % TileType_Count);
+        chunk.tiles[i].object.type = (ObjectType)(i % 7 ? 0 : (i % ObjectType_Count));
+    }
+}
+
+static void net_bench_input(NetMessage &msg)
+{
+    // Worst case, client resending a full window of unacked samples
+    msg.type = NetMessage::Type::Input;
+    NetMessage_Input &input = msg.data.input;
+    input.lastSnapshotTick = 1234;
+    input.sampleCount = CL_INPUT_SAMPLES_MAX;
+    for (uint32_t i = 0; i < CL_INPUT_SAMPLES_MAX; i++) {
+        InputSample &sample = input.samples[i];
+        sample.seq = 5000 + i;
+        sample.ownerId = 1;
+        sample.dt = (16 + i % 3) * CL_INPUT_DT_QUANTUM * 2;
+        sample.walkEast = i % 8 < 4;
+        sample.walkNorth = i % 16 < 3;
+        sample.primary = i == 20;
+    }
+}
+
+static void net_bench_chat(NetMessage &msg)
+{
+    msg.type = NetMessage::Type::ChatMessage;
+    NetMessage_ChatMessage &chatMsg = msg.data.chatMsg;
+    chatMsg.source = NetMessage_ChatMessage::Source::Client;
+    chatMsg.id = 1;
+    chatMsg.messageLength = (uint32_t)snprintf(chatMsg.message, sizeof(chatMsg.message), "anyone want to go kill some slimes?");
+}
+
+static void net_bench_tile_delta(NetMessage &msg)
+{
+    // A small structure being placed
+    msg.type = NetMessage::Type::TileDelta;
+    NetMessage_TileDelta &tileDelta = msg.data.tileDelta;
+    tileDelta.chunkX = 3;
+    tileDelta.chunkY = -7;
+    tileDelta.version = 13;
+    for (uint32_t i = 0; i < 64; i++) {
+        TileDelta &delta = tileDelta.tiles[tileDelta.tileCount++];
+        delta.index = (uint8_t)(i * 3);
+        delta.tile.type = (TileType)(i % TileType_Count);
+        delta.tile.object.type = (ObjectType)(i % ObjectType_Count);
+    }
+}
+
+// Cost of queueing one message for a number of peers: serializing it into every peer's bundle, vs serializing it once
+// and copying it into every bundle with the peer's connection token patched in, which is what NetServer::BroadcastMsg
+// does. Bundles are cleared after each broadcast, so nothing is actually sent and the peers are never connected.
+static void net_bench_broadcast(int iterations)
+{
+    const size_t PEERS_MAX = 64;
+    PacketPool &pool = *(new PacketPool{});
+    ENetPeer *peers = (ENetPeer *)calloc(PEERS_MAX, sizeof(*peers));
+    NetBundle *bundles = new NetBundle[PEERS_MAX];
+    for (size_t i = 0; i < PEERS_MAX; i++) {
+        bundles[i].pool = &pool;
+    }
+    NetMessage &msg = *(new NetMessage{});
+    net_bench_tile_delta(msg);
+    const NetDelivery delivery = msg.Delivery();
+    uint8_t *buf = (uint8_t *)calloc(PACKET_SIZE_MAX, sizeof(*buf));
+
+    printf("\nTileDelta broadcast, %zu bytes, %d iterations per peer count\n\n", msg.Serialize(buf, PACKET_SIZE_MAX), iterations);
+    printf("%-8s %16s %16s %16s\n", "peers", "per-peer ns", "encode-once ns", "encode-once/peer");
+
+    for (size_t peerCount = 8; peerCount <= PEERS_MAX; peerCount *= 2) {
+        const auto perPeerStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (size_t p = 0; p < peerCount; p++) {
+                msg.connectionToken = 1 + (uint32_t)p;
+                ErrorType err = bundles[p].Append(&peers[p], msg);
+                DLB_ASSERT(err == ErrorType::Success);
+            }
+            for (size_t p = 0; p < peerCount; p++) {
+                bundles[p].Clear();
+            }
+        }
+        const auto perPeerEnd = std::chrono::steady_clock::now();
+
+        const auto onceStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            msg.connectionToken = 0;
+            const size_t size = msg.Serialize(buf, PACKET_SIZE_MAX);
+            for (size_t p = 0; p < peerCount; p++) {
+                NetMessage::PatchConnectionToken(buf, size, 1 + (uint32_t)p);
+                ErrorType err = bundles[p].Append(&peers[p], buf, size, delivery);
+                DLB_ASSERT(err == ErrorType::Success);
+            }
+            for (size_t p = 0; p < peerCount; p++) {
+                bundles[p].Clear();
+            }
+        }
+        const auto onceEnd = std::chrono::steady_clock::now();
+
+        const double perPeerNs = std::chrono::duration<double, std::nano>(perPeerEnd - perPeerStart).count() / iterations;
+        const double onceNs = std::chrono::duration<double, std::nano>(onceEnd - onceStart).count() / iterations;
+        printf("%-8zu %16.0f %16.0f %16.0f\n", peerCount, perPeerNs, onceNs, onceNs / peerCount);
+    }
+
+    free(buf);
+    delete &msg;
+    delete[] bundles;
+    free(peers);
+    DLB_ASSERT(!pool.inUse);
+    delete &pool;
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    NetBenchRecords &spawnRecords = *(new NetBenchRecords{});
+    NetBenchRecords &deltaRecords = *(new NetBenchRecords{});
+    NetBenchRecords &readRecords = *(new NetBenchRecords{});
+    NetBenchCase cases[] = {
+        { "WorldSnapshot (spawn)", new NetMessage{} },
+        { "WorldSnapshot (delta)", new NetMessage{} },
+        { "WorldChunk",            new NetMessage{} },
+        { "Input",                 new NetMessage{} },
+        { "ChatMessage",           new NetMessage{} },
+    };
+    net_bench_snapshot(spawnRecords, *cases[0].msg, true);
+    net_bench_snapshot(deltaRecords, *cases[1].msg, false);
+    net_bench_chunk(*cases[2].msg);
+    net_bench_input(*cases[3].msg);
+    net_bench_chat(*cases[4].msg);
+
+    NetMessage &msgRead = *(new NetMessage{});
+    uint8_t *buf = (uint8_t *)calloc(PACKET_SIZE_MAX, sizeof(*buf));
+
+    printf("%d iterations per message\n\n", iterations);
+    printf("%-24s %8s %8s %12s %12s %10s %10s\n", "message", "bytes", "records", "encode ns", "decode ns", "enc MB/s", "dec MB/s");
+
+    for (NetBenchCase &benchCase : cases) {
+        NetMessage &msg = *benchCase.msg;
+        NetBenchRecords *records = (NetBenchRecords *)msg.snapshotRecords;
+        size_t bytes = 0;
+
+        const auto encodeStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            if (records) {
+                records->Rewind();
+            }
+            bytes = msg.Serialize(buf, PACKET_SIZE_MAX);
+        }
+        const auto encodeEnd = std::chrono::steady_clock::now();
+        if (records) {
+            benchCase.records = records->nextPlayer + records->nextNpc + records->nextItem;
+        }
+
+        readRecords.recordsRead = 0;
+        const auto decodeStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            msgRead.type = NetMessage::Type::Unknown;
+            msgRead.snapshotRecords = &readRecords;
+            msgRead.Deserialize(buf, bytes);
+        }
+        const auto decodeEnd = std::chrono::steady_clock::now();
+        DLB_ASSERT(msgRead.type == msg.type);
+        DLB_ASSERT(readRecords.recordsRead == benchCase.records * iterations);
+
+        const double encodeNs = std::chrono::duration<double, std::nano>(encodeEnd - encodeStart).count() / iterations;
+        const double decodeNs = std::chrono::duration<double, std::nano>(decodeEnd - decodeStart).count() / iterations;
+        printf("%-24s %8zu %8zu %12.0f %12.0f %10.1f %10.1f\n", benchCase.name, bytes, benchCase.records,
+            encodeNs, decodeNs, bytes / encodeNs * 1000.0, bytes / decodeNs * 1000.0);
+    }
+
+    net_bench_broadcast(iterations);
+
+    free(buf);
+    delete &msgRead;
+    for (NetBenchCase &benchCase : cases) {
+        delete benchCase.msg;
+    }
+    delete &readRecords;
+    delete &deltaRecords;
+    delete &spawnRecords;
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/bit_stream.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/net_bundle.cpp"
+#include "../src/net_message.cpp"
+#include "../src/packet_pool.cpp"
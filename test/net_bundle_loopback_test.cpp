@@ -0,0 +1,234 @@
+// Loopback bundle tests over a real ENet connection: queues small messages around an oversized one and checks they
+// arrive in order in as few packets as the bundle size allows, then streams chat and input for a few hundred ticks and
+// checks that neither our packet pool nor ENet keeps allocating once warmed up. Opens sockets and polls on wall-clock
+// time, so it isn't part of run_tests(). Build the SlimeNetBundleTest target and run it from a console, it exits
+// non-zero on failure.
+#include "../src/error.h"
+#include "../src/net_bundle.h"
+#include "../src/net_message.h"
+#include "../src/packet_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+DLB_ASSERT_HANDLER(net_bundle_loopback_test_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = net_bundle_loopback_test_assert;
+
+// Queue a bunch of small messages with one oversized message in the middle, flush once, and check that they arrive
+// in order in as few packets as the bundle size allows.
+static void net_bundle_test_loopback()
+{
+    const int SMALL_BEFORE = 40;
+    const int SMALL_AFTER = 60;
+    const int MSG_COUNT = SMALL_BEFORE + 1 + SMALL_AFTER;
+    const size_t SMALL_SIZE = 20;
+    const size_t BIG_SIZE = NET_BUNDLE_SIZE_MAX * 4;
+    const enet_uint32 TIMEOUT_MS = 3000;
+    const NetDelivery delivery = NetMessage::Delivery(NetMessage::Type::ChatMessage);
+
+    int enet_code = net_enet_initialize();
+    DLB_ASSERT(!enet_code);
+
+    ENetAddress address{};
+    address.host = enet_v4_localhost;
+    address.port = 0;
+    ENetHost *server = enet_host_create(&address, 1, NetChannel_Count, 0, 0);
+    ENetHost *client = enet_host_create(nullptr, 1, NetChannel_Count, 0, 0);
+    DLB_ASSERT(server && client);
+
+    address.port = server->address.port;
+    ENetPeer *serverPeer = enet_host_connect(client, &address, NetChannel_Count, 0);
+    DLB_ASSERT(serverPeer);
+
+    PacketPool &pool = *(new PacketPool{});
+    NetBundle &bundle = *(new NetBundle{ &pool });
+    uint8_t *msgData = (uint8_t *)calloc(BIG_SIZE, sizeof(*msgData));
+    size_t msgSizes[MSG_COUNT]{};
+    int packetCount = 0;
+    int recvCount = 0;
+    bool sent = false;
+
+    const enet_uint32 start = enet_time_get();
+    while (recvCount < MSG_COUNT && enet_time_get() - start < TIMEOUT_MS) {
+        ENetEvent event{};
+        while (enet_host_service(server, &event, 0) > 0) {
+            if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+                DLB_ASSERT(event.channelID == delivery.channel);
+                packetCount++;
+                NetBundleReader reader(event.packet->data, event.packet->dataLength);
+                const uint8_t *msg = 0;
+                size_t msgLength = 0;
+                while (reader.Next(&msg, &msgLength)) {
+                    DLB_ASSERT(recvCount < MSG_COUNT);
+                    DLB_ASSERT(msgLength == msgSizes[recvCount]);
+                    DLB_ASSERT(msg[0] == (uint8_t)recvCount);
+                    DLB_ASSERT(msg[msgLength - 1] == (uint8_t)recvCount);
+                    recvCount++;
+                }
+                enet_packet_destroy(event.packet);
+            }
+        }
+        while (enet_host_service(client, &event, 0) > 0) {}
+
+        if (!sent && serverPeer->state == ENET_PEER_STATE_CONNECTED) {
+            for (int i = 0; i < MSG_COUNT; i++) {
+                msgSizes[i] = i == SMALL_BEFORE ? BIG_SIZE : SMALL_SIZE;
+                memset(msgData, i, msgSizes[i]);
+                ErrorType err = bundle.Append(serverPeer, msgData, msgSizes[i], delivery);
+                DLB_ASSERT(err == ErrorType::Success);
+            }
+            ErrorType err = bundle.Flush(serverPeer);
+            DLB_ASSERT(err == ErrorType::Success);
+            enet_host_flush(client);
+            sent = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    DLB_ASSERT(recvCount == MSG_COUNT);
+    // Small messages before the big one fit in 1 bundle, the big one goes alone, the ones after need 2 bundles
+    DLB_ASSERT(packetCount == 4);
+
+    delete &bundle;
+    free(msgData);
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    // Host is gone, so ENet has handed every buffer back
+    DLB_ASSERT(!pool.inUse);
+    delete &pool;
+    enet_deinitialize();
+}
+
+// Stream chat and input messages for a few hundred ticks. Once the pools have enough buffers to cover what's in
+// flight, sending more messages shouldn't allocate any more, neither for our buffers nor inside ENet.
+static void net_bundle_test_soak()
+{
+    const int TICKS = 300;
+    const int CHATS_PER_TICK = 8;
+    const int WARMUP_TICKS = 60;
+    const enet_uint32 TIMEOUT_MS = 5000;
+
+    int enet_code = net_enet_initialize();
+    DLB_ASSERT(!enet_code);
+    const size_t enetInUse = g_net_allocator.inUse;
+
+    ENetAddress address{};
+    address.host = enet_v4_localhost;
+    address.port = 0;
+    ENetHost *server = enet_host_create(&address, 1, NetChannel_Count, 0, 0);
+    ENetHost *client = enet_host_create(nullptr, 1, NetChannel_Count, 0, 0);
+    DLB_ASSERT(server && client);
+
+    address.port = server->address.port;
+    ENetPeer *serverPeer = enet_host_connect(client, &address, NetChannel_Count, 0);
+    DLB_ASSERT(serverPeer);
+
+    PacketPool &pool = *(new PacketPool{});
+    NetBundle &bundle = *(new NetBundle{ &pool });
+    NetMessage &msg = *(new NetMessage{});
+    NetMessage &msgRead = *(new NetMessage{});
+    int tick = 0;
+    int chatsRecv = 0;
+    size_t warmAllocs = 0;
+    size_t warmEnetAllocs = 0;
+
+    const enet_uint32 start = enet_time_get();
+    while (chatsRecv < TICKS * CHATS_PER_TICK && enet_time_get() - start < TIMEOUT_MS) {
+        ENetEvent event{};
+        while (enet_host_service(server, &event, 0) > 0) {
+            if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+                NetBundleReader reader(event.packet->data, event.packet->dataLength);
+                const uint8_t *data = 0;
+                size_t length = 0;
+                while (reader.Next(&data, &length)) {
+                    memset(&msgRead, 0, sizeof(msgRead));
+                    msgRead.Deserialize(data, length);
+                    if (msgRead.type == NetMessage::Type::ChatMessage) {
+                        DLB_ASSERT(msgRead.data.chatMsg.id == (uint32_t)chatsRecv);
+                        chatsRecv++;
+                    } else {
+                        DLB_ASSERT(msgRead.type == NetMessage::Type::Input);
+                    }
+                }
+                enet_packet_destroy(event.packet);
+            }
+        }
+        while (enet_host_service(client, &event, 0) > 0) {}
+
+        if (serverPeer->state == ENET_PEER_STATE_CONNECTED && tick < TICKS) {
+            for (int i = 0; i < CHATS_PER_TICK; i++) {
+                memset(&msg, 0, sizeof(msg));
+                msg.type = NetMessage::Type::ChatMessage;
+                msg.data.chatMsg.source = NetMessage_ChatMessage::Source::Client;
+                msg.data.chatMsg.id = tick * CHATS_PER_TICK + i;
+                msg.data.chatMsg.messageLength = (uint32_t)sprintf(msg.data.chatMsg.message, "soak test message #%u", msg.data.chatMsg.id);
+                ErrorType err = bundle.Append(serverPeer, msg);
+                DLB_ASSERT(err == ErrorType::Success);
+            }
+            memset(&msg, 0, sizeof(msg));
+            msg.type = NetMessage::Type::Input;
+            msg.data.input.lastSnapshotTick = tick;
+            ErrorType err = bundle.Append(serverPeer, msg);
+            DLB_ASSERT(err == ErrorType::Success);
+            err = bundle.Flush(serverPeer);
+            DLB_ASSERT(err == ErrorType::Success);
+            enet_host_flush(client);
+
+            tick++;
+            if (tick == WARMUP_TICKS) {
+                warmAllocs = pool.heapAllocs;
+                warmEnetAllocs = g_net_allocator.heapAllocs;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    DLB_ASSERT(tick == TICKS);
+    DLB_ASSERT(chatsRecv == TICKS * CHATS_PER_TICK);
+    // A handful of buffers covers everything in flight, no matter how many messages go through them
+    DLB_ASSERT(pool.heapAllocs < 16);
+    DLB_ASSERT(pool.heapAllocs <= warmAllocs + 2);
+    // Same for ENet's packet structs, commands and acks, even though every message it sends is a new ENetPacket
+    DLB_ASSERT(g_net_allocator.heapAllocs <= warmEnetAllocs + 2);
+
+    delete &msgRead;
+    delete &msg;
+    delete &bundle;
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    DLB_ASSERT(!pool.inUse);
+    DLB_ASSERT(g_net_allocator.inUse == enetInUse);
+    delete &pool;
+    enet_deinitialize();
+}
+
+int main(int argc, char *argv[])
+{
+    UNUSED(argc);
+    UNUSED(argv);
+
+    net_bundle_test_loopback();
+    net_bundle_test_soak();
+
+    printf("net bundle loopback tests passed\n");
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/bit_stream.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/net_bundle.cpp"
+#include "../src/net_message.cpp"
+#include "../src/packet_pool.cpp"
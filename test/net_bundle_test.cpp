@@ -0,0 +1,24 @@
+#include "tests.h"
+#include "../src/net_bundle.h"
+#include <cassert>
+
+static void net_bundle_test_reader()
+{
+    // Two messages, then a length prefix that runs past the end of the buffer
+    const uint8_t bundle[] = { 2, 0, 'h', 'i', 1, 0, '!', 9, 0, 'x' };
+    NetBundleReader reader(bundle, sizeof(bundle));
+    const uint8_t *msg = 0;
+    size_t msgLength = 0;
+
+    assert(reader.Next(&msg, &msgLength));
+    assert(msgLength == 2 && !memcmp(msg, "hi", 2));
+    assert(reader.Next(&msg, &msgLength));
+    assert(msgLength == 1 && msg[0] == '!');
+    assert(!reader.Next(&msg, &msgLength));
+    assert(!reader.Next(&msg, &msgLength));
+}
+
+void net_bundle_test()
+{
+    net_bundle_test_reader();
+}
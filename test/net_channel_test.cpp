@@ -0,0 +1,159 @@
+// Loopback channel test: sends a snapshot and a chat message every tick over a real ENet connection that drops every
+// 4th datagram the client receives, using the delivery policy for each. Lost snapshots should just be skipped, while
+// the reliable channel stalls until the retransmit. Opens sockets and waits on ENet's retransmit timer, so it isn't
+// part of run_tests(). Build the SlimeNetChannelTest target and run it from a console, it exits non-zero on failure.
+#include "../src/error.h"
+#include "../src/net_message.h"
+#include "../src/packet_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+DLB_ASSERT_HANDLER(net_channel_test_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = net_channel_test_assert;
+
+// Simulated packet loss: drop every Nth datagram the client receives
+static int g_net_channel_test_drop_every;
+static int g_net_channel_test_recv_count;
+
+static int ENET_CALLBACK net_channel_test_intercept(ENetHost *host, void *event)
+{
+    UNUSED(host);
+    UNUSED(event);
+    if (!g_net_channel_test_drop_every) {
+        return 0;
+    }
+    g_net_channel_test_recv_count++;
+    return (g_net_channel_test_recv_count % g_net_channel_test_drop_every) == 0;  // 1 = swallow datagram
+}
+
+// Nothing here asserts on wall-clock time, only on the order things arrived in. The timeout is just a way out if the
+// connection never comes up.
+int main(int argc, char *argv[])
+{
+    UNUSED(argc);
+    UNUSED(argv);
+
+    const int TICKS = 40;
+    const enet_uint32 TICK_MS = 5;
+    const enet_uint32 TIMEOUT_MS = 10000;
+    const NetDelivery deliveries[] = {
+        NetMessage::Delivery(NetMessage::Type::WorldSnapshot),
+        NetMessage::Delivery(NetMessage::Type::ChatMessage),
+    };
+    DLB_ASSERT(deliveries[0].channel == NetChannel_Realtime);
+    DLB_ASSERT(!(deliveries[0].flags & ENET_PACKET_FLAG_RELIABLE));
+    DLB_ASSERT(deliveries[1].channel == NetChannel_Reliable);
+    DLB_ASSERT(deliveries[1].flags & ENET_PACKET_FLAG_RELIABLE);
+
+    int enet_code = net_enet_initialize();
+    DLB_ASSERT(!enet_code);
+
+    ENetAddress address{};
+    address.host = enet_v4_localhost;
+    address.port = 0;
+    ENetHost *server = enet_host_create(&address, 1, NetChannel_Count, 0, 0);
+    ENetHost *client = enet_host_create(nullptr, 1, NetChannel_Count, 0, 0);
+    DLB_ASSERT(server && client);
+    enet_host_set_intercept(client, net_channel_test_intercept);
+
+    address.port = server->address.port;
+    ENetPeer *serverPeer = enet_host_connect(client, &address, NetChannel_Count, 0);
+    ENetPeer *clientPeer = 0;
+    DLB_ASSERT(serverPeer);
+
+    // Order each tick's message was received in, across both channels. 0 = never arrived.
+    int recvOrder[ARRAY_SIZE(deliveries)][TICKS]{};
+    int recvCount[ARRAY_SIZE(deliveries)]{};
+    int recvLast[ARRAY_SIZE(deliveries)]{ -1, -1 };
+    int recvTotal = 0;
+
+    const enet_uint32 start = enet_time_get();
+    enet_uint32 nextSend = 0;
+    int tick = 0;
+    while (enet_time_get() - start < TIMEOUT_MS) {
+        ENetEvent event{};
+        while (enet_host_service(server, &event, 0) > 0) {
+            if (event.type == ENET_EVENT_TYPE_CONNECT) {
+                clientPeer = event.peer;
+            }
+        }
+        while (enet_host_service(client, &event, 0) > 0) {
+            if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+                int payload = 0;
+                memcpy(&payload, event.packet->data, sizeof(payload));
+                for (size_t i = 0; i < ARRAY_SIZE(deliveries); i++) {
+                    if (event.channelID == deliveries[i].channel) {
+                        DLB_ASSERT(payload >= 0 && payload < TICKS);
+                        // Both channels are sequenced, nothing arrives after something newer
+                        DLB_ASSERT(payload > recvLast[i]);
+                        recvLast[i] = payload;
+                        recvOrder[i][payload] = ++recvTotal;
+                        recvCount[i]++;
+                    }
+                }
+                enet_packet_destroy(event.packet);
+            }
+        }
+
+        const enet_uint32 now = enet_time_get();
+        if (clientPeer && serverPeer->state == ENET_PEER_STATE_CONNECTED && tick < TICKS && now >= nextSend) {
+            g_net_channel_test_drop_every = 4;
+            for (size_t i = 0; i < ARRAY_SIZE(deliveries); i++) {
+                ENetPacket *packet = enet_packet_create(&tick, sizeof(tick), deliveries[i].flags);
+                DLB_ASSERT(packet);
+                enet_peer_send(clientPeer, deliveries[i].channel, packet);
+            }
+            enet_host_flush(server);
+            tick++;
+            nextSend = now + TICK_MS;
+        }
+        if (tick == TICKS && recvCount[1] == TICKS) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    DLB_ASSERT(tick == TICKS);
+    // Some snapshots were lost, the rest arrived without waiting on them
+    DLB_ASSERT(recvCount[0] < TICKS);
+    DLB_ASSERT(recvCount[0] > TICKS / 2);
+    // Chat all arrived, and at least one message had to wait for its retransmit while newer snapshots went past it
+    DLB_ASSERT(recvCount[1] == TICKS);
+    int chatStalls = 0;
+    for (int t = 0; t < TICKS - 1; t++) {
+        if (recvOrder[0][t + 1] && recvOrder[0][t + 1] < recvOrder[1][t]) {
+            chatStalls++;
+        }
+    }
+    DLB_ASSERT(chatStalls);
+
+    printf("%d/%d snapshots, %d/%d chat messages, %d chat messages overtaken by a newer snapshot\n", recvCount[0],
+        TICKS, recvCount[1], TICKS, chatStalls);
+
+    g_net_channel_test_drop_every = 0;
+    g_net_channel_test_recv_count = 0;
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    enet_deinitialize();
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/bit_stream.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/net_bundle.cpp"
+#include "../src/net_message.cpp"
+#include "../src/packet_pool.cpp"
@@ -0,0 +1,50 @@
+#include "tests.h"
+#include "../src/net_server.h"
+#include <cassert>
+
+// Run the estimator for some number of seconds against a link with fixed stats
+static void net_congestion_test_run(SV_Congestion &congestion, ENetPeer &peer, double &now, double seconds)
+{
+    for (double end = now + seconds; now < end; now += SV_TICK_DT) {
+        congestion.Update(peer, now, SV_TICK_DT);
+    }
+}
+
+// A healthy link gets full snapshots every tick, a congested one backs off to small, infrequent snapshots, and it
+// recovers once the link does.
+void net_congestion_test()
+{
+    SV_Congestion &congestion = *(new SV_Congestion{});
+    ENetPeer &peer = *(new ENetPeer{});
+    double now = 0;
+
+    peer.roundTripTime = 40;
+    net_congestion_test_run(congestion, peer, now, 5.0);
+    assert(congestion.snapshotBudget == SNAPSHOT_BUDGET_MAX);
+    assert(fabs(congestion.snapshotInterval - SNAPSHOT_SEND_DT) < 1e-9);
+
+    // Heavy loss, backs off a bit more every second
+    peer.packetLoss = ENET_PEER_PACKET_LOSS_SCALE / 5;
+    net_congestion_test_run(congestion, peer, now, 1.0);
+    const size_t firstBudget = congestion.snapshotBudget;
+    assert(firstBudget < SNAPSHOT_BUDGET_MAX);
+    assert(congestion.snapshotInterval > SNAPSHOT_SEND_DT);
+    net_congestion_test_run(congestion, peer, now, 5.0);
+    assert(congestion.snapshotBudget < firstBudget);
+    assert(congestion.snapshotBudget < SNAPSHOT_BUDGET_MIN + 1024);
+    assert(congestion.snapshotInterval > SNAPSHOT_SEND_DT_MAX * 0.9);
+
+    // Loss clears up, but packets start queueing up somewhere
+    peer.packetLoss = 0;
+    peer.roundTripTime = 40 + SV_CONGESTION_RTT_SLACK * 2;
+    net_congestion_test_run(congestion, peer, now, 1.0);
+    assert(congestion.snapshotBudget < firstBudget);
+
+    // Link is healthy again, after a while the RTT is the new normal and snapshots go back to full size and rate
+    net_congestion_test_run(congestion, peer, now, 30.0);
+    assert(congestion.snapshotBudget == SNAPSHOT_BUDGET_MAX);
+    assert(fabs(congestion.snapshotInterval - SNAPSHOT_SEND_DT) < 1e-9);
+
+    delete &peer;
+    delete &congestion;
+}
@@ -0,0 +1,210 @@
+// Fuzz harness for NetMessage::Deserialize. Every byte the server reads off the wire goes through it, so no input may
+// crash it, hang it, or trip an assert; malformed input must just make it return 0.
+//
+// Build with -DNET_FUZZ_LIBFUZZER and -fsanitize=fuzzer to hand the entry point to libFuzzer. Otherwise the SlimeNetFuzz
+// target runs offline: it serializes a few valid messages, then deserializes random mutations of them (bit flips,
+// byte stomps, truncations) and pure noise. First argument is the number of inputs to try, second is the rng seed.
+#include "../src/error.h"
+#include "../src/net_message.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+DLB_ASSERT_HANDLER(net_fuzz_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    abort();
+}
+dlb_assert_handler_def *dlb_assert_handler = net_fuzz_assert;
+
+// Reads and drops every record, only checking that the reader never hands out garbage it claims is valid
+struct NetFuzzRecords : WorldSnapshotRecords {
+    size_t recordsRead {};
+
+    void OnPlayer(const PlayerSnapshot &) override { recordsRead++; }
+    void OnNpc   (const NpcSnapshot &npc) override { recordsRead++; DLB_ASSERT(npc.nameLength <= ENTITY_NAME_LENGTH_MAX); }
+    void OnItem  (const ItemSnapshot &) override { recordsRead++; }
+};
+
+static NetMessage     *g_net_fuzz_msg;
+static NetFuzzRecords *g_net_fuzz_records;
+static size_t          g_net_fuzz_accepted;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!g_net_fuzz_msg) {
+        g_net_fuzz_msg = new NetMessage{};
+        g_net_fuzz_records = new NetFuzzRecords{};
+    }
+    if (!size) {
+        return 0;
+    }
+
+    NetMessage &msg = *g_net_fuzz_msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.snapshotRecords = g_net_fuzz_records;
+    if (msg.Deserialize(data, size)) {
+        g_net_fuzz_accepted++;
+        // Anything the reader accepts has to be within the limits the rest of the game relies on
+        switch (msg.type) {
+            case NetMessage::Type::Input: {
+                DLB_ASSERT(msg.data.input.sampleCount <= CL_INPUT_SAMPLES_MAX);
+                break;
+            }
+            case NetMessage::Type::ChatMessage: {
+                DLB_ASSERT(msg.data.chatMsg.messageLength <= CHATMSG_LENGTH_MAX);
+                break;
+            }
+            default: break;
+        }
+    }
+    return 0;
+}
+
+#ifndef NET_FUZZ_LIBFUZZER
+
+static size_t net_fuzz_seed(std::vector<std::vector<uint8_t>> &seeds, NetMessage &msg)
+{
+    std::vector<uint8_t> buf(PACKET_SIZE_MAX);
+    size_t bytes = msg.Serialize(buf.data(), buf.size());
+    DLB_ASSERT(bytes);
+    buf.resize(bytes);
+    seeds.push_back(buf);
+    memset(&msg, 0, sizeof(msg));
+    return bytes;
+}
+
+// Valid messages of the types a client can send, plus a snapshot so the record readers get some coverage too
+static void net_fuzz_seeds(std::vector<std::vector<uint8_t>> &seeds)
+{
+    NetMessage &msg = *(new NetMessage{});
+
+    msg.type = NetMessage::Type::Identify;
+    msg.data.identify.usernameLength = (uint32_t)snprintf(msg.data.identify.username, sizeof(msg.data.identify.username), "fuzzer");
+    msg.data.identify.passwordLength = (uint32_t)snprintf(msg.data.identify.password, sizeof(msg.data.identify.password), "hunter2");
+    net_fuzz_seed(seeds, msg);
+
+    msg.type = NetMessage::Type::ChatMessage;
+    msg.data.chatMsg.source = NetMessage_ChatMessage::Source::Client;
+    msg.data.chatMsg.id = 1;
+    msg.data.chatMsg.messageLength = (uint32_t)snprintf(msg.data.chatMsg.message, sizeof(msg.data.chatMsg.message), "hello");
+    net_fuzz_seed(seeds, msg);
+
+    msg.type = NetMessage::Type::Input;
+    msg.data.input.lastSnapshotTick = 99;
+    msg.data.input.sampleCount = 8;
+    for (uint32_t i = 0; i < msg.data.input.sampleCount; i++) {
+        InputSample &sample = msg.data.input.samples[i];
+        sample.seq = 100 + i;
+        sample.ownerId = 1;
+        sample.dt = 16 * CL_INPUT_DT_QUANTUM * 2;
+        sample.walkEast = i % 2;
+    }
+    net_fuzz_seed(seeds, msg);
+
+    struct NetFuzzWriter : WorldSnapshotRecords {
+        PlayerSnapshot player {};
+        NpcSnapshot    npc    {};
+        ItemSnapshot   item   {};
+        int            npcs   {};
+        bool           done[2]{};
+
+        PlayerSnapshot *NextPlayer(void) override { return done[0] ? 0 : (done[0] = true, &player); }
+        NpcSnapshot    *NextNpc   (void) override { return npcs++ < 4 ? &npc : 0; }
+        ItemSnapshot   *NextItem  (void) override { return done[1] ? 0 : (done[1] = true, &item); }
+    } &writer = *(new NetFuzzWriter{});
+    writer.player.id = 1;
+    writer.player.flags = PlayerSnapshot::Flags_Spawn | PlayerSnapshot::Flags_Owner;
+    writer.npc.id = 7;
+    writer.npc.type = NPC::Type_Slime;
+    writer.npc.flags = NpcSnapshot::Flags_Spawn;
+    writer.npc.nameLength = (uint8_t)snprintf(writer.npc.name, sizeof(writer.npc.name), "Slime");
+    writer.item.id = 3;
+    writer.item.flags = ItemSnapshot::Flags_Spawn;
+    writer.item.itemUid = 1;
+    writer.item.stackCount = 2;
+    msg.type = NetMessage::Type::WorldSnapshot;
+    msg.snapshotRecords = &writer;
+    msg.data.worldSnapshot.tick = 1234;
+    net_fuzz_seed(seeds, msg);
+
+    delete &writer;
+    delete &msg;
+}
+
+int main(int argc, char *argv[])
+{
+    const long inputs = argc > 1 ? atol(argv[1]) : 1000000;
+    const uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], 0, 10) : 0x5117e;
+    if (inputs <= 0) {
+        fprintf(stderr, "usage: %s [inputs] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<uint8_t>> seeds{};
+    net_fuzz_seeds(seeds);
+
+    // The seeds themselves must round trip
+    for (const std::vector<uint8_t> &input : seeds) {
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    DLB_ASSERT(g_net_fuzz_accepted == seeds.size());
+    g_net_fuzz_accepted = 0;
+
+    dlb_rand32_t rng{};
+    dlb_rand32_seed_r(&rng, seed, seed);
+
+    std::vector<uint8_t> input{};
+    for (long i = 0; i < inputs; i++) {
+        const std::vector<uint8_t> &base = seeds[dlb_rand32u_r(&rng) % seeds.size()];
+        input = base;
+        switch (dlb_rand32u_r(&rng) % 4) {
+            case 0: {  // flip a few bits
+                for (uint32_t n = 1 + dlb_rand32u_r(&rng) % 8; n; n--) {
+                    uint32_t bit = dlb_rand32u_r(&rng) % (input.size() * 8);
+                    input[bit / 8] ^= 1 << (bit % 8);
+                }
+                break;
+            }
+            case 1: {  // stomp a few bytes, favoring values that make lengths and counts blow up
+                const uint8_t stomps[] = { 0x00, 0x7f, 0x80, 0xff };
+                for (uint32_t n = 1 + dlb_rand32u_r(&rng) % 4; n; n--) {
+                    input[dlb_rand32u_r(&rng) % input.size()] = stomps[dlb_rand32u_r(&rng) % ARRAY_SIZE(stomps)];
+                }
+                break;
+            }
+            case 2: {  // truncate
+                input.resize(1 + dlb_rand32u_r(&rng) % input.size());
+                break;
+            }
+            case 3: {  // noise
+                input.resize(1 + dlb_rand32u_r(&rng) % PACKET_SIZE_MAX);
+                for (uint8_t &byte : input) {
+                    byte = (uint8_t)dlb_rand32u_r(&rng);
+                }
+                break;
+            }
+        }
+
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    printf("%ld inputs, %zu accepted, %zu snapshot records read\n", inputs, g_net_fuzz_accepted, g_net_fuzz_records->recordsRead);
+    delete g_net_fuzz_records;
+    delete g_net_fuzz_msg;
+    return 0;
+}
+
+#endif
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/bit_stream.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/net_message.cpp"
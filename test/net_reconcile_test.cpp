@@ -0,0 +1,121 @@
+#include "tests.h"
+#include "../src/net_client.h"
+#include "../src/world.h"
+#include <cassert>
+
+static void net_reconcile_test_grass(World &world)
+{
+    for (int16_t y = -1; y <= 1; y++) {
+        for (int16_t x = -1; x <= 1; x++) {
+            Chunk chunk{};
+            chunk.x = x;
+            chunk.y = y;
+            for (size_t i = 0; i < ARRAY_SIZE(chunk.tiles); i++) {
+                chunk.tiles[i].type = TileType_Grass;
+            }
+            world.map.AddChunk(chunk);
+        }
+    }
+}
+
+// Walk back and forth with a few frames of latency each way and a snapshot every other frame, the way the server
+// would send them. As long as the server simulates the same thing the client predicted, no snapshot should cause a
+// replay. After the server moves the player on its own, the client should replay once and end up where the server
+// says it is.
+void net_reconcile_test()
+{
+    const int FRAMES = 600;
+    const int LATENCY = 6;         // frames, each way
+    const int SNAPSHOT_EVERY = 2;  // frames
+    const int SHOVE_FRAME = 400;   // server moves the player without any input asking for it
+    const Vector3 START{ CHUNK_W * TILE_W * 0.5f, CHUNK_W * TILE_W * 0.5f, 0 };
+    const bool smoothReconcile = g_cl_smooth_reconcile;
+    g_cl_smooth_reconcile = false;
+
+    NetClient &netClient = *(new NetClient{});
+    netClient.serverWorld = new World{};
+    World &clientWorld = *netClient.serverWorld;
+    World &serverWorld = *(new World{});
+    net_reconcile_test_grass(clientWorld);
+    net_reconcile_test_grass(serverWorld);
+
+    clientWorld.playerId = 1;
+    Player &clientPlayer = *clientWorld.AddPlayer(1);
+    Player &serverPlayer = *serverWorld.AddPlayer(1);
+    clientPlayer.body.Teleport(START);
+    serverPlayer.body.Teleport(START);
+
+    InputSample *inputs = (InputSample *)calloc(FRAMES, sizeof(*inputs));
+    WorldSnapshot *snapshots = (WorldSnapshot *)calloc(FRAMES, sizeof(*snapshots));
+    uint32_t lastInputAck = 0;
+    CL_ReconcileStats shoveStats{};
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        // Server: simulate the inputs that just arrived, then take a snapshot
+        const int inputFrame = frame - LATENCY;
+        if (inputFrame >= 0) {
+            InputSample input = inputs[inputFrame];
+            serverPlayer.Update(input, serverWorld.map);
+            lastInputAck = input.seq;
+        }
+        if (frame == SHOVE_FRAME) {
+            serverPlayer.body.Teleport(v3_add(serverPlayer.body.WorldPosition(), { 0, METERS_TO_PIXELS(1.0f), 0 }));
+        }
+        if (frame % SNAPSHOT_EVERY == 0) {
+            WorldSnapshot &snapshot = snapshots[frame];
+            snapshot.tick = frame + 1;
+            snapshot.lastInputAck = lastInputAck;
+            snapshot.ownerFlags = PlayerSnapshot::Flags_Owner | PlayerSnapshot::Flags_Position;
+            snapshot.ownerPosition = serverPlayer.body.WorldPosition();
+        }
+
+        // Client: receive snapshots, sample input, reconcile
+        const int snapshotFrame = frame - LATENCY;
+        if (snapshotFrame >= 0 && snapshots[snapshotFrame].tick) {
+            netClient.worldHistory.Alloc() = snapshots[snapshotFrame];
+        }
+        if (frame == SHOVE_FRAME) {
+            shoveStats = netClient.reconcileStats;
+        }
+
+        netClient.inputSeq++;
+        InputSample &input = netClient.inputHistory.Alloc();
+        input = {};
+        input.seq = netClient.inputSeq;
+        input.ownerId = clientPlayer.id;
+        input.dt = 33 * CL_INPUT_DT_QUANTUM;
+        input.walkEast = (frame / 60) % 2 == 0;
+        input.walkWest = !input.walkEast;
+        input.walkNorth = (frame / 25) % 3 == 0;
+        input.skipFx = true;
+        inputs[frame] = input;
+
+        netClient.ReconcilePlayer();
+    }
+
+    const CL_ReconcileStats &stats = netClient.reconcileStats;
+
+    // Every snapshot that arrived was reconciled, and every sample was predicted once..
+    assert(stats.snapshots == (FRAMES - LATENCY + SNAPSHOT_EVERY - 1) / SNAPSHOT_EVERY);
+    assert(stats.samplesPredicted == FRAMES);
+    // ..and while the server agreed, only the snapshots from before it had any input to ack replayed
+    assert(shoveStats.snapshots > 100);
+    assert(shoveStats.replays == LATENCY / SNAPSHOT_EVERY);
+    // The shove forced a replay of everything the server hadn't seen yet, and no more than that
+    assert(stats.replays == shoveStats.replays + 1);
+    assert(stats.samplesReplayed - shoveStats.samplesReplayed <= LATENCY * 2);
+    // Each replay only went back as far as the oldest sample still in flight
+    assert(stats.samplesReplayed <= stats.replays * LATENCY * 2);
+
+    // Client caught up with the shove and agrees with the server again
+    const WorldSnapshot &latest = netClient.worldHistory.Last();
+    const CL_PredictedState *acked = &netClient.predictedStates[latest.lastInputAck % CL_INPUT_HISTORY];
+    assert(acked->seq == latest.lastInputAck);
+    assert(v3_distance_sq(acked->position, latest.ownerPosition) <= SQUARED(CL_MAX_PLAYER_POS_DESYNC_DIST));
+
+    free(snapshots);
+    free(inputs);
+    delete &serverWorld;
+    delete &netClient;  // owns clientWorld
+    g_cl_smooth_reconcile = smoothReconcile;
+}
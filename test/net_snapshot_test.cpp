@@ -0,0 +1,242 @@
+#include "tests.h"
+#include "../src/net_server.h"
+#include "../src/world.h"
+#include <cassert>
+#include <unordered_map>
+
+// Count how many times each npc and item made it into a snapshot
+struct net_snapshot_test_records : WorldSnapshotRecords {
+    uint32_t npcUpdates[SV_MAX_NPC_SLIMES + 1]{};
+    uint32_t npcFlags[SV_MAX_NPC_SLIMES + 1]{};  // flags of each npc's latest record
+    std::unordered_map<EntityUID, uint32_t> itemUpdates{};
+
+    void OnNpc(const NpcSnapshot &npcSnap) override {
+        assert(npcSnap.id <= SV_MAX_NPC_SLIMES);
+        npcUpdates[npcSnap.id]++;
+        npcFlags[npcSnap.id] = npcSnap.flags;
+    }
+    void OnItem(const ItemSnapshot &itemSnap) override {
+        itemUpdates[itemSnap.id]++;
+    }
+};
+
+// Chunks around the origin for the server to find nearby npcs and items in
+static void net_snapshot_test_chunks(World &world)
+{
+    for (int16_t y = -1; y <= 1; y++) {
+        for (int16_t x = -1; x <= 2; x++) {
+            Chunk chunk{};
+            chunk.x = x;
+            chunk.y = y;
+            world.map.AddChunk(chunk);
+        }
+    }
+}
+
+// Slimes spread out in a line from the player, slime #1 closest, all shuffling sideways every tick
+static void net_snapshot_test_slimes(World &world)
+{
+    for (uint32_t i = 0; i < SV_MAX_NPC_SLIMES; i++) {
+        NPC &slime = world.npcs.slimes[i];
+        if (!slime.id) {
+            slime.id = 1 + i;
+            slime.type = NPC::Type_Slime;
+            slime.nameLength = (uint8_t)snprintf(slime.name, sizeof(slime.name), "Slime");
+            slime.combat.hitPoints = 10.0f;
+            slime.combat.hitPointsMax = 10.0f;
+        }
+        const float x = METERS_TO_PIXELS(1.0f) * (1 + i);
+        const float y = METERS_TO_PIXELS(0.1f) * (world.tick % 10);
+        slime.body.Teleport({ x, y, 0 });
+        world.map.UpdateChunkLink(slime);
+    }
+}
+
+// Build a snapshot for the client the way SendWorldSnapshot does, and hand it to the client's records
+static void net_snapshot_test_send(World &world, Player &player, SV_Client &client, SV_SnapshotQueue &queue,
+    net_snapshot_test_records &records, size_t budget)
+{
+    NetMessage &msg = *(new NetMessage{});
+    NetMessage &msgRead = *(new NetMessage{});
+    uint8_t *buf = (uint8_t *)calloc(PACKET_SIZE_MAX, sizeof(*buf));
+
+    msg.type = NetMessage::Type::WorldSnapshot;
+    msg.data.worldSnapshot.tick = world.tick;
+    SV_SnapshotEncoder encoder{ world, client, player, queue, world.tick };
+    encoder.Prioritize();
+    encoder.budget = budget;
+    msg.snapshotRecords = &encoder;
+    const size_t bytes = msg.Serialize(buf, PACKET_SIZE_MAX);
+    assert(bytes);
+    assert(bytes <= budget);
+    client.snapshotStats.snapshots++;
+    client.snapshotStats.deferred += encoder.Deferred();
+
+    msgRead.snapshotRecords = &records;
+    assert(msgRead.Deserialize(buf, bytes));
+
+    // Client acks everything right away
+    client.lastSnapshotAck = world.tick;
+
+    free(buf);
+    delete &msgRead;
+    delete &msg;
+}
+
+// A crowd of slimes that all move every tick, with a snapshot budget that only fits a few of them. Every slime should
+// still get updated regularly, the ones closest to the player more often than the ones furthest away.
+void net_snapshot_test_crowd()
+{
+    const int SNAPSHOTS = 300;
+    const int WARMUP = 20;
+    const size_t BUDGET = 320;  // header, the player's own record, and room for a handful of npcs
+
+    World &world = *(new World{});
+    net_snapshot_test_chunks(world);
+    Player &player = *world.AddPlayer(1);
+    player.body.Teleport({ 0, 0, 0 });
+
+    SV_Client &client = *(new SV_Client{});
+    client.playerId = player.id;
+    SV_SnapshotQueue &queue = *(new SV_SnapshotQueue{});
+    net_snapshot_test_records &records = *(new net_snapshot_test_records{});
+
+    for (int i = 0; i < SNAPSHOTS; i++) {
+        world.tick++;
+        net_snapshot_test_slimes(world);
+        if (i == WARMUP) {
+            client.snapshotStats = {};
+            records = {};
+        }
+        net_snapshot_test_send(world, player, client, queue, records, BUDGET);
+    }
+
+    // Budget was too small to send everyone every snapshot
+    const SV_SnapshotStats &stats = client.snapshotStats;
+    assert(stats.deferred > 0);
+
+    // ..but nobody starved, and nobody waited much longer than it takes to cycle through the whole crowd
+    for (uint32_t id = 1; id <= SV_MAX_NPC_SLIMES; id++) {
+        assert(records.npcUpdates[id] > 0);
+    }
+    assert(stats.staleTicksMax < SV_MAX_NPC_SLIMES * 2);
+    assert(stats.StaleTicksAvg() > 1.0f);
+
+    // Closer slimes are worth updating more often
+    assert(records.npcUpdates[1] > records.npcUpdates[SV_MAX_NPC_SLIMES]);
+
+    delete &records;
+    delete &queue;
+    delete &client;
+    delete &world;
+}
+
+// Same crowd, with a few items rolling around on the ground nearby. The slimes alone have more to send than the budget
+// allows, but players, npcs, and items all compete for the same budget, so the items still get their turn.
+void net_snapshot_test_mixed()
+{
+    const int SNAPSHOTS = 300;
+    const size_t BUDGET = 320;
+    const size_t ITEM_COUNT = 4;
+
+    World &world = *(new World{});
+    net_snapshot_test_chunks(world);
+    Player &player = *world.AddPlayer(1);
+    player.body.Teleport({ 0, 0, 0 });
+
+    ItemProto &proto = g_item_catalog.FindProto(ItemType_Currency_Silver);
+    const ItemProto protoPrev = proto;
+    proto.stackLimit = 1;
+    EntityUID itemIds[ITEM_COUNT]{};
+    for (size_t i = 0; i < ITEM_COUNT; i++) {
+        WorldItem *item = world.itemSystem.SpawnItem({}, ItemType_Currency_Silver, 1);
+        assert(item);
+        itemIds[i] = item->euid;
+    }
+
+    SV_Client &client = *(new SV_Client{});
+    client.playerId = player.id;
+    SV_SnapshotQueue &queue = *(new SV_SnapshotQueue{});
+    net_snapshot_test_records &records = *(new net_snapshot_test_records{});
+
+    for (int i = 0; i < SNAPSHOTS; i++) {
+        world.tick++;
+        net_snapshot_test_slimes(world);
+        for (size_t j = 0; j < ITEM_COUNT; j++) {
+            WorldItem &item = *world.itemSystem.Find(itemIds[j]);
+            const float x = -METERS_TO_PIXELS(1.0f) * (1 + j);
+            const float y = METERS_TO_PIXELS(0.1f) * (world.tick % 10);
+            item.body.Teleport({ x, y, 0 });
+            world.map.UpdateChunkLink(item);
+        }
+        net_snapshot_test_send(world, player, client, queue, records, BUDGET);
+    }
+
+    // Slimes didn't all fit
+    assert(client.snapshotStats.deferred > 0);
+
+    // ..and items kept up anyway, about as often as a slime does
+    for (size_t i = 0; i < ITEM_COUNT; i++) {
+        assert(records.itemUpdates[itemIds[i]] > SNAPSHOTS / (SV_MAX_NPC_SLIMES + ITEM_COUNT));
+    }
+    for (uint32_t id = 1; id <= SV_MAX_NPC_SLIMES; id++) {
+        assert(records.npcUpdates[id] > 0);
+    }
+
+    delete &records;
+    delete &queue;
+    delete &client;
+    delete &world;
+    proto = protoPrev;
+}
+
+// Npcs are gathered from the chunks around the player. One that leaves them still hears about its despawn, through the
+// client's history, and is forgotten once the client acks it.
+void net_snapshot_test_vicinity()
+{
+    World &world = *(new World{});
+    net_snapshot_test_chunks(world);
+    Player &player = *world.AddPlayer(1);
+    player.body.Teleport({ 0, 0, 0 });
+    world.tick++;
+    net_snapshot_test_slimes(world);
+
+    SV_Client &client = *(new SV_Client{});
+    client.playerId = player.id;
+    SV_SnapshotQueue &queue = *(new SV_SnapshotQueue{});
+    net_snapshot_test_records &records = *(new net_snapshot_test_records{});
+
+    net_snapshot_test_send(world, player, client, queue, records, SNAPSHOT_BUDGET_MAX);
+    for (uint32_t id = 1; id <= SV_MAX_NPC_SLIMES; id++) {
+        assert(records.npcUpdates[id] == 1);
+        assert(client.npcHistory.count(id));
+    }
+
+    // Slime #1 wanders off, out of every chunk the server has
+    NPC &slime = world.npcs.slimes[0];
+    slime.body.Teleport({ METERS_TO_PIXELS(100.0f), 0, 0 });
+    world.map.UpdateChunkLink(slime);
+    assert(!slime.chunkNode.linked);
+
+    world.tick++;
+    net_snapshot_test_send(world, player, client, queue, records, SNAPSHOT_BUDGET_MAX);
+    assert(records.npcUpdates[1] == 2);
+    assert(records.npcFlags[1] & NpcSnapshot::Flags_Despawn);
+
+    world.tick++;
+    net_snapshot_test_send(world, player, client, queue, records, SNAPSHOT_BUDGET_MAX);
+    assert(records.npcUpdates[1] == 2);
+    assert(!client.npcHistory.count(1));
+
+    delete &records;
+    delete &queue;
+    delete &client;
+    delete &world;
+}
+
+void net_snapshot_test()
+{
+    net_snapshot_test_crowd();
+    net_snapshot_test_mixed();
+    net_snapshot_test_vicinity();
+}
@@ -0,0 +1,104 @@
+// Headless particle benchmark: fills the particle system with 100k particles from a mix of every effect that doesn't
+// need a player to follow, and times ParticleSystem::Update. Nothing is drawn or played; the sound, sprite drawing, and UI
+// hooks the particle system calls into are stubbed out below. Build the SlimeParticleBench target and run it from a
+// console, optionally with the number of frames as the first argument.
+#include "../src/error.h"
+#include "../src/game_client.h"
+#include "../src/helpers.h"
+#include "../src/particles.h"
+#include "../src/ui/ui.h"
+#include "dlb_rand.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+DLB_ASSERT_HANDLER(particle_bench_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = particle_bench_assert;
+
+// No spritesheets or sounds are loaded, so effects fall back to colored squares and bounce silently
+void Catalog::Sounds::Play(SoundID id, float pitch, bool multi) { UNUSED(id); UNUSED(pitch); UNUSED(multi); }
+
+// Only reachable when drawing or following a player, which the bench never does
+const SpriteAnim &sprite_anim(const Sprite &sprite) { UNUSED(sprite); abort(); }
+Rectangle sprite_world_rect(const Sprite &sprite, const Vector3 &pos) { UNUSED(sprite); UNUSED(pos); abort(); }
+void sprite_draw_at(const Sprite &sprite, Vector3 worldPos, const Color &color) { UNUSED(sprite); UNUSED(worldPos); UNUSED(color); abort(); }
+void UI::ParticleText(Vector2 pos, const char *text) { UNUSED(pos); UNUSED(text); abort(); }
+Vector3 Player::GetAttachPoint(AttachPoint attachPoint) const { UNUSED(attachPoint); abort(); }
+
+int main(int argc, char *argv[])
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 600;
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t PARTICLES = 100000;
+    const size_t PARTICLES_PER_EFFECT = 1000;
+    const double dt = 1.0 / 60.0;
+    const Catalog::ParticleEffectID types[] = {
+        Catalog::ParticleEffectID::Blood,
+        Catalog::ParticleEffectID::Copper,
+        Catalog::ParticleEffectID::Gem,
+        Catalog::ParticleEffectID::Goo,
+        Catalog::ParticleEffectID::Number,
+        Catalog::ParticleEffectID::Poison_Nova,
+        Catalog::ParticleEffectID::Rainbow,
+    };
+
+    Catalog::g_particleFx.Load();
+    ParticleSystem &particles = *(new ParticleSystem{});
+
+    // Long enough that nothing dies during the run, short spawn delays so nearly everything is alive and moving
+    ParticleEffectParams params{};
+    params.particleCountMin = (int)PARTICLES_PER_EFFECT;
+    params.particleCountMax = params.particleCountMin;
+    params.spawnDelayMin = 0.0f;
+    params.spawnDelayMax = 0.5f;
+    params.lifespanMin = 1000.0f;
+    params.lifespanMax = 1000.0f;
+    params.durationMin = 1000.0f;
+    params.durationMax = 1000.0f;
+    for (size_t i = 0; i < PARTICLES / PARTICLES_PER_EFFECT; i++) {
+        const Vector3 origin = { dlb_rand32f_variance(METERS_TO_PIXELS(50.0f)), dlb_rand32f_variance(METERS_TO_PIXELS(50.0f)), 0 };
+        ParticleEffect *effect = particles.GenerateEffect(types[i % ARRAY_SIZE(types)], origin, params);
+        DLB_ASSERT(effect);
+    }
+    DLB_ASSERT(particles.ParticlesActive() == PARTICLES);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        g_clock.now += dt;
+        particles.Update(dt);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    DLB_ASSERT(particles.ParticlesActive() == PARTICLES);
+
+    const double usPerFrame = std::chrono::duration<double, std::micro>(end - start).count() / frames;
+    printf("%zu particles in %zu effects, %d frames\n", PARTICLES, particles.EffectsActive(), frames);
+    printf("%-24s %14s %14s\n", "", "us/frame", "ns/particle");
+    printf("%-24s %14.1f %14.2f\n", "ParticleSystem::Update", usPerFrame, usPerFrame * 1000.0 / PARTICLES);
+
+    delete &particles;
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#define DLB_RAND_IMPLEMENTATION
+#include "dlb_rand.h"
+#undef DLB_RAND_IMPLEMENTATION
+
+#include "../src/asset_loader.cpp"
+#include "../src/asset_pack.cpp"
+#include "../src/catalog/csv.cpp"
+#include "../src/catalog/particle_fx.cpp"
+#include "../src/catalog/spritesheets.cpp"
+#include "../src/draw_command.cpp"
+#include "../src/particles.cpp"
+#include "../src/spritesheet.cpp"
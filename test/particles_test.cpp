@@ -0,0 +1,100 @@
+#include "tests.h"
+#include "../src/particles.h"
+#include "../src/world.h"
+#include <cassert>
+
+static int g_particles_test_dying;
+
+static void particles_test_dying(ParticleEffect &effect, void *userData)
+{
+    UNUSED(effect);
+    UNUSED(userData);
+    g_particles_test_dying++;
+}
+
+// Records where each particle would have been drawn
+struct particles_test_drawn {
+    size_t  count  {};
+    Vector3 origin {};
+    float   maxDistSq {};
+    bool    underground {};
+};
+
+static void particles_test_draw(const ParticleView &particle, void *userData)
+{
+    particles_test_drawn &drawn = *(particles_test_drawn *)userData;
+    drawn.count++;
+    const Vector2 offset = { particle.position.x - drawn.origin.x, particle.position.y - drawn.origin.y };
+    drawn.maxDistSq = MAX(drawn.maxDistSq, v2_length_sq(offset));
+    drawn.underground |= particle.position.z < 0.0f;
+}
+
+static void particles_test_step(ParticleSystem &particles, double secs)
+{
+    const double dt = 1.0 / 60.0;
+    for (double t = 0; t < secs; t += dt) {
+        g_clock.now += dt;
+        particles.Update(dt);
+    }
+}
+
+// More particles than the old fixed pool had room for, from effects that end at different times. Every particle should
+// be allocated, each effect cleaned up exactly once when its last particle dies, and the particles of the effects that
+// are left should be untouched by the ones that were compacted away in front of them.
+static void particles_test_lifetime()
+{
+    const double now = g_clock.now;
+    Catalog::g_particleFx.Load();
+    World &world = *(new World{});
+    ParticleSystem &particles = world.particleSystem;
+    DrawList &drawList = *(new DrawList{});
+    particles_test_drawn &drawn = *(new particles_test_drawn{});
+    g_particles_test_dying = 0;
+
+    ParticleEffectParams params{};
+    params.particleCountMin = 1000;
+    params.particleCountMax = params.particleCountMin;
+    for (int i = 0; i < 3; i++) {
+        params.durationMin = 1.0f + i;
+        params.durationMax = params.durationMin;
+        const Vector3 origin = { METERS_TO_PIXELS(10.0f) * i, METERS_TO_PIXELS(20.0f), 0 };
+        ParticleEffect *goo = particles.GenerateEffect(Catalog::ParticleEffectID::Goo, origin, params);
+        assert(goo);
+        goo->effectCallbacks[(size_t)ParticleEffect_Event::Dying] = { particles_test_dying, 0 };
+        goo->particleCallbacks[(size_t)ParticleEffect_ParticleEvent::Draw] = { particles_test_draw, &drawn };
+        drawn.origin = origin;
+    }
+    assert(particles.EffectsActive() == 3);
+    assert(particles.ParticlesActive() == 3000);
+
+    // First effect is gone, everyone else has spawned and is still around
+    particles_test_step(particles, 1.5);
+    assert(particles.EffectsActive() == 2);
+    assert(particles.ParticlesActive() == 2000);
+    assert(g_particles_test_dying == 1);
+
+    // Only the last effect draws, and its particles are still wherever it put them
+    particles_test_step(particles, 1.0);
+    assert(particles.EffectsActive() == 1);
+    assert(particles.ParticlesActive() == 1000);
+    particles.PushAll(drawList);
+    drawList.Flush(world);
+    assert(drawn.count == 1000);
+    assert(drawn.maxDistSq < SQUARED(METERS_TO_PIXELS(3.0f)));
+    assert(!drawn.underground);
+
+    particles_test_step(particles, 1.5);
+    assert(particles.EffectsActive() == 0);
+    assert(particles.ParticlesActive() == 0);
+    assert(g_particles_test_dying == 3);
+
+    delete &drawn;
+    delete &drawList;
+    delete &world;
+    g_clock.now = now;
+}
+
+void particles_test()
+{
+    particles_test_lifetime();
+}
@@ -0,0 +1,116 @@
+#include "tests.h"
+#include "../src/body.h"
+#include <cassert>
+#include <vector>
+
+// Entities show up in a snapshot every other tick at best, and lower priority ones get left out for a while. Looking
+// up any tick in the window has to find the same two entries a scan through every entry would.
+static void position_history_test_find()
+{
+    const uint32_t N = CL_WORLD_HISTORY;
+    PositionHistory &history = *(new PositionHistory{});
+    std::vector<Vector3Snapshot> entries{};
+
+    const Vector3Snapshot *empty = 0;
+    assert(!history.Find(1, &empty, &empty));
+
+    dlb_rand32_t rng{};
+    dlb_rand32_seed_r(&rng, 1234, 5678);
+    uint32_t tick = 100;
+    for (int i = 0; i < 200; i++) {
+        // Mostly every snapshot (2 ticks), sometimes deferred, once in a while for longer than the whole window
+        const uint32_t roll = dlb_rand32u_r(&rng) % 20;
+        tick += roll < 14 ? 2 : roll < 19 ? 2 + 2 * (dlb_rand32u_r(&rng) % 4) : N + 10;
+
+        Vector3Snapshot &entry = history.Push(tick);
+        assert(entry.tick == tick);
+        if (entries.size()) {
+            // Starts out as a copy of the previous entry
+            assert(entry.v.x == entries.back().v.x);
+        }
+        entry.serverTime = tick / (double)SV_TICK_RATE;
+        entry.v = { (float)i, (float)tick, 0 };
+        entries.push_back(entry);
+        assert(history.Last().tick == tick);
+
+        for (uint32_t t = tick >= N + 5 ? tick - N - 5 : 0; t <= tick + 3; t++) {
+            const Vector3Snapshot *found = 0;
+            const Vector3Snapshot *next = 0;
+            const bool inWindow = t >= entries[0].tick && t + N > tick;
+            assert(history.Find(t, &found, &next) == inWindow);
+            if (!inWindow) {
+                continue;
+            }
+
+            size_t right = 0;
+            while (right < entries.size() && entries[right].tick <= t) {
+                right++;
+            }
+            assert(right > 0);
+            const Vector3Snapshot &expected = entries[right - 1];
+            assert(found->tick == expected.tick);
+            assert(found->serverTime == expected.serverTime);
+            assert(found->v.x == expected.v.x);
+            if (right == entries.size()) {
+                assert(!next);
+            } else {
+                assert(next);
+                assert(next->tick == entries[right].tick);
+                assert(next->v.x == entries[right].v.x);
+            }
+        }
+    }
+
+    // Ticks going backwards means the server restarted, start over
+    history.Push(5).v = { 1, 2, 3 };
+    assert(history.Count() == 1);
+    const Vector3Snapshot *found = 0;
+    const Vector3Snapshot *next = 0;
+    assert(!history.Find(4, &found, &next));
+    assert(history.Find(5, &found, &next) && !next && found->v.z == 3);
+
+    delete &history;
+}
+
+// Bodies interpolate between the entries around the cursor, and hold the newest entry once they run out
+static void position_history_test_interpolate()
+{
+    Body3D &body = *(new Body3D{});
+    Direction direction{};
+
+    Vector3Snapshot &a = body.positionHistory.Push(10);
+    a.serverTime = 1.0;
+    a.v = { 0, 0, 0 };
+    Vector3Snapshot &b = body.positionHistory.Push(16);
+    b.serverTime = 1.1;
+    b.v = { 60, 0, 0 };
+    b.direction = Direction::East;
+
+    InterpolationCursor cursor{};
+    cursor.renderAt = 1.05;
+    cursor.tick = 12;
+    cursor.valid = true;
+    body.CL_Interpolate(cursor, direction);
+    assert(body.WorldPosition().x == 30);
+    assert(direction == Direction::East);
+
+    cursor.renderAt = 1.5;
+    cursor.tick = 40;
+    body.CL_Interpolate(cursor, direction);
+    assert(body.WorldPosition().x == 60);
+
+    // Before any snapshot, nothing happens
+    Body3D &fresh = *(new Body3D{});
+    cursor.tick = 9;
+    fresh.CL_Interpolate(cursor, direction);
+    assert(fresh.WorldPosition().x == 0);
+
+    delete &fresh;
+    delete &body;
+}
+
+void position_history_test()
+{
+    position_history_test_find();
+    position_history_test_interpolate();
+}
@@ -0,0 +1,130 @@
+// Headless spritesheet benchmark: generates a large .txt spritesheet, then times compiling it (what every launch used to
+// do), loading the compiled version (what every launch does now), and looking sprites up by name the old way (linear
+// strncmp), by name through the hash, and by a precomputed SpriteID. No textures are loaded. Build the
+// SlimeSpritesheetBench target and run it from a console, optionally with the number of sprites as the first argument.
+#include "../src/helpers.h"
+#include "../src/clock.h"
+#include "../src/draw_command.h"
+#include "../src/error.h"
+#include "../src/spritesheet.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+DLB_ASSERT_HANDLER(spritesheet_bench_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    exit(EXIT_FAILURE);
+}
+dlb_assert_handler_def *dlb_assert_handler = spritesheet_bench_assert;
+
+// How FindSprite worked before sprites had ids
+static const SpriteDef *spritesheet_bench_find_linear(const Spritesheet &sheet, const char *name)
+{
+    const size_t nameLength = strlen(name);
+    for (const SpriteDef &sprite : sheet.sprites) {
+        if (sprite.name.length == nameLength && !strncmp(sprite.name.text, name, nameLength)) {
+            return &sprite;
+        }
+    }
+    return 0;
+}
+
+static double spritesheet_bench_ns(std::chrono::steady_clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char *argv[])
+{
+    const int spriteCount = argc > 1 ? atoi(argv[1]) : 256;
+    if (spriteCount <= 0) {
+        fprintf(stderr, "usage: %s [sprites]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const int ITERATIONS = 200;
+    const int LOOKUPS = 1000000;
+
+    // One sprite per 8 directional animations, 4 frames each, like the character sheets
+    const int animationCount = spriteCount * 8;
+    const int frameCount = animationCount * 4;
+    std::string text{};
+    char line[256]{};
+    snprintf(line, sizeof(line), "spritesheet %d %d %d data/texture/bench.png\n", frameCount, animationCount, spriteCount);
+    text += line;
+    for (int i = 0; i < frameCount; i++) {
+        snprintf(line, sizeof(line), "frame bench_frame_%d %d %d 54 94\n", i, (i % 32) * 54, (i / 32) * 94);
+        text += line;
+    }
+    for (int i = 0; i < animationCount; i++) {
+        snprintf(line, sizeof(line), "animation bench_anim_%d %d %d %d %d\n", i, i * 4, i * 4 + 1, i * 4 + 2, i * 4 + 3);
+        text += line;
+    }
+    std::vector<std::string> names{};
+    for (int i = 0; i < spriteCount; i++) {
+        names.push_back("bench_sprite_" + std::to_string(i));
+        const int a = i * 8;
+        snprintf(line, sizeof(line), "sprite %s %d %d %d %d %d %d %d %d\n", names.back().c_str(),
+            a, a + 1, a + 2, a + 3, a + 4, a + 5, a + 6, a + 7);
+        text += line;
+    }
+
+    std::vector<char> bin{};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        DLB_ASSERT(Spritesheet::Compile("bench.txt", text.data(), text.size(), bin) == ErrorType::Success);
+    }
+    const double compileUs = spritesheet_bench_ns(start, ITERATIONS) / 1000.0;
+
+    Spritesheet &sheet = *(new Spritesheet{});
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        char *data = (char *)MemAlloc((unsigned int)bin.size());
+        memcpy(data, bin.data(), bin.size());
+        DLB_ASSERT(sheet.LoadBinary("bench.sheet", data, (unsigned int)bin.size()) == ErrorType::Success);
+    }
+    const double loadUs = spritesheet_bench_ns(start, ITERATIONS) / 1000.0;
+
+    // Look up every sprite in turn, sum the indices so the lookups can't be skipped
+    std::vector<SpriteID> ids{};
+    for (const std::string &name : names) {
+        ids.push_back(sprite_id(name.c_str()));
+    }
+    size_t check = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        check += spritesheet_bench_find_linear(sheet, names[i % spriteCount].c_str()) - sheet.sprites.data();
+    }
+    const double linearNs = spritesheet_bench_ns(start, LOOKUPS);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        check -= sheet.FindSprite(names[i % spriteCount].c_str()) - sheet.sprites.data();
+    }
+    const double nameNs = spritesheet_bench_ns(start, LOOKUPS);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        check += sheet.FindSprite(ids[i % spriteCount]) - sheet.sprites.data();
+    }
+    const double idNs = spritesheet_bench_ns(start, LOOKUPS);
+    DLB_ASSERT(check == (size_t)LOOKUPS / spriteCount * spriteCount * (spriteCount - 1) / 2 +
+        (size_t)(LOOKUPS % spriteCount) * (LOOKUPS % spriteCount - 1) / 2);
+
+    printf("%d frames, %d animations, %d sprites: %zu byte .txt, %zu byte .sheet\n", frameCount, animationCount,
+        spriteCount, text.size(), bin.size());
+    printf("%-32s %14s\n", "", "us/load");
+    printf("%-32s %14.1f\n", "Spritesheet::Compile (.txt)", compileUs);
+    printf("%-32s %14.1f\n", "Spritesheet::LoadBinary (.sheet)", loadUs);
+    printf("%-32s %14s\n", "", "ns/lookup");
+    printf("%-32s %14.1f\n", "linear strncmp", linearNs);
+    printf("%-32s %14.1f\n", "FindSprite(const char *)", nameNs);
+    printf("%-32s %14.1f\n", "FindSprite(SpriteID)", idNs);
+
+    delete &sheet;
+    return 0;
+}
+
+#include "../src/draw_command.cpp"
+#include "../src/spritesheet.cpp"
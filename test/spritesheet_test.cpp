@@ -0,0 +1,87 @@
+#include "tests.h"
+#include "../src/spritesheet.h"
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+static_assert(sprite_id("tree_01") == sprite_id("tree_01_dead", 7), "sprite_id must only hash the given length");
+
+static char *spritesheet_test_copy(const std::vector<char> &bin)
+{
+    char *data = (char *)MemAlloc((unsigned int)bin.size());
+    memcpy(data, bin.data(), bin.size());
+    return data;
+}
+
+// The compiled spritesheet loads back with the same frames, animations, and sprites as the text it was compiled from,
+// sprites are found by exact name only, and a damaged file is rejected instead of indexing out of bounds.
+static void spritesheet_test_compile()
+{
+    const char *text =
+        "# test sheet\n"
+        "spritesheet 3 2 3 data/texture/test.png\n"
+        "frame idle_0  0 0 10 20\n"
+        "frame walk_0 10 0 10 20\n"
+        "frame walk_1 20 0 10 20\n"
+        "animation idle 0\n"
+        "animation walk 1 2\n"
+        "sprite slime      0 0 0 0 1 1 1 1\n"
+        "sprite slime_king 1 1 1 1 - - - -\n"
+        "sprite slime_x    0 1 0 1 0 1 0 1\n";
+
+    std::vector<char> bin{};
+    assert(Spritesheet::Compile("test.txt", text, strlen(text), bin) == ErrorType::Success);
+
+    Spritesheet &sheet = *(new Spritesheet{});
+    assert(sheet.LoadBinary("test.sheet", spritesheet_test_copy(bin), (unsigned int)bin.size()) == ErrorType::Success);
+    assert(!strcmp(sheet.texturePath.text, "data/texture/test.png"));
+    assert(sheet.frames.size() == 3);
+    assert(sheet.frames[2].x == 20 && sheet.frames[2].width == 10 && sheet.frames[2].height == 20);
+    assert(sheet.frames[2].spritesheet == &sheet);
+    assert(sheet.animations.size() == 2);
+    assert(sheet.animations[1].frameCount == 2 && sheet.animations[1].frames[1] == 2);
+    assert(sheet.sprites.size() == 3);
+
+    const SpriteDef *king = sheet.FindSprite("slime_king");
+    assert(king && king == &sheet.sprites[1]);
+    assert(king->name.length == 10 && !strncmp(king->name.text, "slime_king", king->name.length));
+    assert(king->animations[0] == 1 && king->animations[(int)Direction::South] == -1);
+    assert(sheet.FindSprite("slime") == &sheet.sprites[0]);
+    assert(sheet.FindSprite(sprite_id("slime_x")) == &sheet.sprites[2]);
+    assert(!sheet.FindSprite("slim"));
+    assert(!sheet.FindSprite("slime_kingdom"));
+
+    // Anything pointing outside of the file or at a frame/animation that doesn't exist
+    std::vector<char> bad = bin;
+    bad.pop_back();
+    assert(sheet.LoadBinary("test.sheet", spritesheet_test_copy(bad), (unsigned int)bad.size()) != ErrorType::Success);
+    bad = bin;
+    bad[0] = 'X';
+    assert(sheet.LoadBinary("test.sheet", spritesheet_test_copy(bad), (unsigned int)bad.size()) != ErrorType::Success);
+    bad = bin;
+    SpritesheetBinAnim anim{};
+    const size_t animOffset = sizeof(SpritesheetBinHeader) + 3 * sizeof(SpritesheetBinFrame) + sizeof(anim);
+    memcpy(&anim, bad.data() + animOffset, sizeof(anim));
+    anim.frames[1] = 3;
+    memcpy(bad.data() + animOffset, &anim, sizeof(anim));
+    assert(sheet.LoadBinary("test.sheet", spritesheet_test_copy(bad), (unsigned int)bad.size()) != ErrorType::Success);
+    bad = bin;
+    bad.back() = 'X';  // string table terminator
+    assert(sheet.LoadBinary("test.sheet", spritesheet_test_copy(bad), (unsigned int)bad.size()) != ErrorType::Success);
+
+    // Two sprites with the same name can't both be found by it
+    const char *dupe =
+        "spritesheet 1 1 2 data/texture/test.png\n"
+        "frame idle_0 0 0 10 20\n"
+        "animation idle 0\n"
+        "sprite slime 0 0 0 0 0 0 0 0\n"
+        "sprite slime 0 0 0 0 0 0 0 0\n";
+    assert(Spritesheet::Compile("dupe.txt", dupe, strlen(dupe), bin) == ErrorType::AllocFailed_Duplicate);
+
+    delete &sheet;
+}
+
+void spritesheet_test()
+{
+    spritesheet_test_compile();
+}
@@ -2,17 +2,53 @@
 
 void maths_test();
 void dlb_rand_test();
+void asset_loader_test();
+void asset_pack_test();
 void bit_stream_test();
+void chunk_mesh_test();
+void item_db_test();
 void net_message_test();
+void net_bundle_test();
+void net_congestion_test();
+void net_reconcile_test();
+void net_snapshot_test();
+void particles_test();
+void position_history_test();
+void spritesheet_test();
+void tilemap_test();
 
 void run_tests()
 {
     maths_test();
     dlb_rand_test();
+    asset_loader_test();
+    asset_pack_test();
     bit_stream_test();
+    chunk_mesh_test();
+    item_db_test();
     net_message_test();
+    net_bundle_test();
+    net_congestion_test();
+    net_reconcile_test();
+    net_snapshot_test();
+    particles_test();
+    position_history_test();
+    spritesheet_test();
+    tilemap_test();
 }
 
 #include "maths_test.cpp"
+#include "asset_loader_test.cpp"
+#include "asset_pack_test.cpp"
 #include "bitstream_test.cpp"
-#include "net_message_test.cpp"
\ No newline at end of file
+#include "chunk_mesh_test.cpp"
+#include "item_db_test.cpp"
+#include "net_message_test.cpp"
+#include "net_bundle_test.cpp"
+#include "net_congestion_test.cpp"
+#include "net_reconcile_test.cpp"
+#include "net_snapshot_test.cpp"
+#include "particles_test.cpp"
+#include "position_history_test.cpp"
+#include "spritesheet_test.cpp"
+#include "tilemap_test.cpp"
\ No newline at end of file
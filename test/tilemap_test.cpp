@@ -0,0 +1,262 @@
+#include "tests.h"
+#include "../src/chunk_generator.h"
+#include "../src/tilemap.h"
+#include <cassert>
+
+static Chunk &tilemap_test_chunk(Tilemap &map, int16_t x, int16_t y)
+{
+    Chunk chunk{};
+    chunk.x = x;
+    chunk.y = y;
+    for (size_t i = 0; i < ARRAY_SIZE(chunk.tiles); i++) {
+        chunk.tiles[i].type = TileType_Grass;
+    }
+    return map.AddChunk(chunk);
+}
+
+static void chunk_mask_test()
+{
+    Tilemap map{};
+    Chunk &chunk = tilemap_test_chunk(map, 0, 0);
+    for (size_t i = 0; i < ARRAY_SIZE(chunk.tiles); i++) {
+        assert(chunk.IsWalkable(i));
+        assert(!chunk.IsSwimmable(i));
+    }
+
+    Tile rock{};
+    rock.type = TileType_Grass;
+    rock.object.type = ObjectType_Rock01;
+    rock.object.SetFlag(ObjectFlag_Collide);
+    assert(map.SetTileAtWorld(3 * TILE_W, 2 * TILE_W, rock));
+    assert(!chunk.IsWalkable(2 * CHUNK_W + 3));
+    assert(!map.IsWalkable(3 * TILE_W + 1, 2 * TILE_W + 1));
+    assert(!map.IsSpawnable(3 * TILE_W + 1, 2 * TILE_W + 1));
+
+    Tile water{};
+    water.type = TileType_Water;
+    assert(map.SetTileAtWorld(CHUNK_W * TILE_W - 1, CHUNK_W * TILE_W - 1, water));
+    assert(chunk.IsSwimmable(ARRAY_SIZE(chunk.tiles) - 1));
+    assert(map.IsWalkable(CHUNK_W * TILE_W - 1, CHUNK_W * TILE_W - 1));
+    assert(!map.IsSpawnable(CHUNK_W * TILE_W - 1, CHUNK_W * TILE_W - 1));
+
+    // Overwriting a tile must clear its bits again
+    Tile grass{};
+    grass.type = TileType_Grass;
+    assert(map.SetTileAtWorld(3 * TILE_W, 2 * TILE_W, grass));
+    assert(chunk.IsWalkable(2 * CHUNK_W + 3));
+
+    // Edits are tracked per tile for the next tile delta
+    assert(map.dirtyChunks.contains(chunk.Hash()));
+    assert(chunk.IsDirty(2 * CHUNK_W + 3));
+    assert(chunk.IsDirty(ARRAY_SIZE(chunk.tiles) - 1));
+    assert(!chunk.IsDirty(0));
+
+    // Missing chunks are blocked, and can't be written to
+    assert(!map.IsWalkable(-1, 0));
+    assert(!map.SetTileAtWorld(-1, 0, grass));
+}
+
+static void sweep_move_test()
+{
+    Tilemap map{};
+    tilemap_test_chunk(map, 0, 0);
+    tilemap_test_chunk(map, 1, 0);
+
+    // Wall along x = 5
+    Tile rock{};
+    rock.type = TileType_Grass;
+    rock.object.SetFlag(ObjectFlag_Collide);
+    for (int y = 0; y < CHUNK_H; y++) {
+        map.SetTileAtWorld(5 * TILE_W, (float)(y * TILE_W), rock);
+    }
+
+    const Vector2 start = { 4 * TILE_W + 16, 8 * TILE_W + 16 };
+
+    // Unblocked move is untouched
+    Vector2 offset = map.SweepMove(start, { -10, 10 }, TileBlock_Solid);
+    assert(offset.x == -10 && offset.y == 10);
+
+    // Diagonal into the wall slides along it
+    offset = map.SweepMove(start, { 20, 10 }, TileBlock_Solid);
+    assert(start.x + offset.x < 5 * TILE_W);
+    assert(offset.y == 10);
+
+    // Fast movers don't tunnel through the wall
+    offset = map.SweepMove(start, { 4 * TILE_W, 0 }, TileBlock_Solid);
+    assert(start.x + offset.x < 5 * TILE_W);
+
+    // Water only blocks when asked to
+    Tile water{};
+    water.type = TileType_Water;
+    map.SetTileAtWorld(4 * TILE_W, 9 * TILE_W, water);
+    offset = map.SweepMove(start, { 0, TILE_W }, TileBlock_Solid);
+    assert(offset.y == TILE_W);
+    offset = map.SweepMove(start, { 0, TILE_W }, TileBlock_Solid | TileBlock_Water);
+    assert(offset.y < TILE_W);
+
+    // Bodies stuck on a blocked tile are allowed to walk off
+    const Vector2 inWall = { 5 * TILE_W + 16, 8 * TILE_W + 16 };
+    offset = map.SweepMove(inWall, { 20, 0 }, TileBlock_Solid);
+    assert(offset.x == 20);
+}
+
+static void chunk_list_test()
+{
+    Tilemap map{};
+    tilemap_test_chunk(map, 0, 0);
+    tilemap_test_chunk(map, 1, 0);
+    const float chunkW = CHUNK_W * TILE_W;
+
+    NPC a{};
+    NPC b{};
+    a.body.Teleport({ 10, 10, 0 });
+    b.body.Teleport({ 20, 10, 0 });
+    map.UpdateChunkLink(a);
+    map.UpdateChunkLink(b);
+    assert(map.FindChunk(Chunk::Hash(0, 0))->npcs.count == 2);
+
+    // Crossing a chunk border moves the npc to the other list
+    a.body.Teleport({ chunkW + 10, 10, 0 });
+    map.UpdateChunkLink(a);
+    Chunk *left = map.FindChunk(Chunk::Hash(0, 0));
+    Chunk *right = map.FindChunk(Chunk::Hash(1, 0));
+    assert(left->npcs.count == 1 && left->npcs.head == &b);
+    assert(right->npcs.count == 1 && right->npcs.head == &a);
+    assert(!b.chunkNode.next && !b.chunkNode.prev);
+
+    // Entities outside of loaded chunks aren't linked
+    b.body.Teleport({ -10, 10, 0 });
+    map.UpdateChunkLink(b);
+    assert(!b.chunkNode.linked);
+    assert(!left->npcs.count && !left->npcs.head);
+
+    map.UnlinkChunk(a);
+    assert(!right->npcs.count && !right->npcs.head);
+
+    // Items get moved around in memory by ItemSystem, make sure the neighbors follow
+    WorldItem items[3]{};
+    for (WorldItem &item : items) {
+        item.body.Teleport({ 10, 10, 0 });
+        map.UpdateChunkLink(item);
+    }
+    assert(left->items.count == 3);
+    map.UnlinkChunk(items[1]);
+    items[1] = items[2];
+    map.RelocateChunkLink(items[2], items[1]);
+    items[2] = {};
+    size_t count = 0;
+    for (WorldItem *item = left->items.head; item; item = item->chunkNode.next) {
+        assert(item == &items[0] || item == &items[1]);
+        count++;
+    }
+    assert(count == 2);
+}
+
+static void structure_stamp_test()
+{
+    Structure::LoadPrefabs();
+    const Prefab &vault = Structure::FindPrefab(Structure_Vault);
+    assert(vault.w == 7 && vault.h == 7);
+    assert(vault.runs.size() == 9);  // 7 rows, middle row split in 3 runs by the wood tile
+
+    // Stamp across the border of a loaded chunk and an ungenerated one
+    Tilemap map{};
+    tilemap_test_chunk(map, 0, 0);
+    Structure::Spawn(map, Structure_Vault, (CHUNK_W - 3) * TILE_W, 0);
+    assert(map.dirtyChunks.size() == 1);
+    assert(map.dirtyChunks.contains(Chunk::Hash(0, 0)));
+    assert(map.pendingStamps.size() == 1);
+    assert(map.pendingStamps.contains(Chunk::Hash(1, 0)));
+
+    // Wood tile at (3, 3) relative to the prefab lands in the next chunk, its left neighbor in this one
+    const Tile *tile = map.TileAtWorld((CHUNK_W - 1) * TILE_W, 3 * TILE_W);
+    assert(tile && tile->type == TileType_Grass);
+    tile = map.TileAtWorld((CHUNK_W - 3) * TILE_W, 0);
+    assert(tile && tile->type == TileType_Grass);  // '.' cells are left untouched
+
+    Chunk next{};
+    next.x = 1;
+    next.y = 0;
+    Chunk &added = map.AddChunk(next);
+    Structure::ApplyPending(map, added);
+    assert(map.pendingStamps.empty());
+    tile = map.TileAtWorld(CHUNK_W * TILE_W, 3 * TILE_W);
+    assert(tile && tile->type == TileType_Wood);
+    tile = map.TileAtWorld(CHUNK_W * TILE_W, 0);
+    assert(tile && tile->type == TileType_Grass);
+    tile = map.TileAtWorld((CHUNK_W + 2) * TILE_W, 0);
+    assert(tile && tile->type == TileType_Void);  // '.' cells are left untouched
+
+    // Negative tile coords map to the correct chunk
+    Tilemap negMap{};
+    tilemap_test_chunk(negMap, -1, -1);
+    Structure::Spawn(negMap, Structure_Vault, -7 * TILE_W, -7 * TILE_W);
+    assert(negMap.dirtyChunks.size() == 1 && negMap.pendingStamps.empty());
+    tile = negMap.TileAtWorld(-4 * TILE_W, -4 * TILE_W);
+    assert(tile && tile->type == TileType_Wood);
+}
+
+static void chunk_diff_test()
+{
+    g_noise.Seed(16);
+
+    // Server edits a generated chunk
+    Chunk server{};
+    server.x = 3;
+    server.y = -2;
+    Tilemap::GenerateChunk(server, 0);
+    server.version = 5;
+    server.tiles[17].type = TileType_Wood;
+    server.tiles[17].object = {};
+    server.MarkDirty(17);
+
+    ChunkDiff &diff = *(new ChunkDiff{});
+    server.BuildDiff(diff);
+    assert(diff.chunkX == 3 && diff.chunkY == -2);
+    assert(diff.version == 5);
+    assert(diff.tileCount == 1);
+    assert(diff.tiles[0].index == 17);
+
+    // Client generates the same baseline and gets an identical chunk
+    Chunk client{};
+    client.x = diff.chunkX;
+    client.y = diff.chunkY;
+    Tilemap::GenerateChunk(client, 0);
+    client.ApplyDiff(diff);
+    assert(client.version == 5);
+    assert(client.CalcHash() == diff.hash);
+    assert(client.tiles[17].type == TileType_Wood);
+
+    // Generator mismatch is caught by the hash
+    Chunk bad{};
+    bad.x = diff.chunkX;
+    bad.y = diff.chunkY;
+    Tilemap::GenerateChunk(bad, 0);
+    bad.tiles[200].type = bad.tiles[200].type == TileType_Water ? TileType_Grass : TileType_Water;
+    bad.ApplyDiff(diff);
+    assert(bad.CalcHash() != diff.hash);
+
+    // Same thing on the worker thread, with its own g_noise
+    ChunkGenerator generator{};
+    generator.Start(16);
+    generator.Queue(diff);
+    std::vector<ChunkGenerator::Result> results{};
+    for (int i = 0; i < 1000 && !generator.Poll(results); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(results.size() == 1);
+    assert(results[0].valid);
+    assert(results[0].chunk.CalcHash() == diff.hash);
+    generator.Stop();
+
+    delete &diff;
+    g_noise.Free();
+}
+
+void tilemap_test() {
+    chunk_mask_test();
+    sweep_move_test();
+    chunk_list_test();
+    structure_stamp_test();
+    chunk_diff_test();
+}
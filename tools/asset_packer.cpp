@@ -0,0 +1,113 @@
+// Packs every file under the given directories into one asset pack (see src/asset_pack.h), named by their path
+// relative to the root so the game can keep loading them by the same paths it always has. Directories after --default
+// hold user data: their files are only defaults, and a loose copy on disk overrides the packed one at runtime.
+//
+// Usage: SlimeAssetPacker <output.pak> <root> <dir>... [--default <dir>...]
+// The SlimeAssetPack target runs it on bin/data and bin/db whenever anything in them changes.
+#include "../src/asset_pack.h"
+#include "../src/error.h"
+#include "../src/helpers.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+DLB_ASSERT_HANDLER(asset_packer_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    abort();
+}
+dlb_assert_handler_def *dlb_assert_handler = asset_packer_assert;
+
+static bool asset_packer_read(const std::filesystem::path &path, std::vector<unsigned char> &data)
+{
+    FILE *file = fopen(path.string().c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    const size_t read = data.size() ? fread(data.data(), 1, data.size(), file) : 0;
+    fclose(file);
+    return read == data.size();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s <output.pak> <root> <dir>... [--default <dir>...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *output = argv[1];
+    const std::filesystem::path root = argv[2];
+
+    // Sorted so that the same files always make the same pack
+    struct Input {
+        std::string path  {};  // relative to root, always with forward slashes
+        uint32_t    flags {};
+    };
+    std::vector<Input> inputs{};
+    uint32_t flags = 0;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "--default")) {
+            flags = AssetPackFlag_Default;
+            continue;
+        }
+        const std::filesystem::path dir = root / argv[i];
+        if (!std::filesystem::is_directory(dir)) {
+            fprintf(stderr, "%s is not a directory\n", dir.string().c_str());
+            return EXIT_FAILURE;
+        }
+        for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(dir)) {
+            if (entry.is_regular_file()) {
+                inputs.push_back({ entry.path().lexically_relative(root).generic_string(), flags });
+            }
+        }
+    }
+    std::sort(inputs.begin(), inputs.end(), [](const Input &a, const Input &b) { return a.path < b.path; });
+
+    AssetPackWriter &writer = *(new AssetPackWriter{});
+    std::vector<unsigned char> data{};
+    size_t bytes = 0;
+    for (const Input &input : inputs) {
+        if (!asset_packer_read(root / input.path, data)) {
+            fprintf(stderr, "Failed to read %s\n", input.path.c_str());
+            return EXIT_FAILURE;
+        }
+        if (writer.Add(input.path.c_str(), data.data(), data.size(), input.flags) != ErrorType::Success) {
+            return EXIT_FAILURE;
+        }
+        bytes += data.size();
+        printf("%08x %10zu %s%s\n", AssetPack::PathID(input.path.c_str()), data.size(), input.path.c_str(),
+            input.flags & AssetPackFlag_Default ? " (default)" : "");
+    }
+
+    // Check what we wrote reads back the same before anyone tries to start the game with it
+    std::vector<unsigned char> pack{};
+    writer.Build(pack);
+    AssetPack &check = *(new AssetPack{});
+    if (check.OpenMemory(pack.data(), pack.size()) != ErrorType::Success || check.Verify() != ErrorType::Success ||
+        check.EntryCount() != inputs.size()) {
+        fprintf(stderr, "Asset pack failed to verify\n");
+        return EXIT_FAILURE;
+    }
+    delete &check;
+
+    if (writer.Save(output) != ErrorType::Success) {
+        return EXIT_FAILURE;
+    }
+    printf("%zu assets, %zu bytes of data, %zu byte pack\n", inputs.size(), bytes, pack.size());
+    delete &writer;
+    return 0;
+}
+
+#define DLB_MURMUR3_IMPLEMENTATION
+#include "dlb_murmur3.h"
+#undef DLB_MURMUR3_IMPLEMENTATION
+
+#include "../src/asset_pack.cpp"
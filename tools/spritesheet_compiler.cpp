@@ -0,0 +1,66 @@
+// Compiles a .txt spritesheet definition (see src/spritesheet.cpp for the format) into the flat binary format in
+// src/spritesheet.h, so the game only has to validate it at startup instead of parsing it. Sprite ids are hashed here,
+// once, and written out with a lookup table sorted by id.
+//
+// Usage: SlimeSpritesheetCompiler <input.txt> <output.sheet>
+// The SlimeSpritesheets target runs it on every spritesheet in bin/data/entity whenever one changes.
+#include "../src/helpers.h"
+#include "../src/clock.h"
+#include "../src/draw_command.h"
+#include "../src/error.h"
+#include "../src/spritesheet.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+DLB_ASSERT_HANDLER(spritesheet_compiler_assert)
+{
+    fprintf(stderr, "[DLB_ASSERT failed] %s\n  %s:%u\n", expr, filename, line);
+    abort();
+}
+dlb_assert_handler_def *dlb_assert_handler = spritesheet_compiler_assert;
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <input.txt> <output.sheet>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *input = argv[1];
+    const char *output = argv[2];
+
+    unsigned int textLength = 0;
+    char *text = (char *)LoadFileData(input, &textLength);
+    if (!text) {
+        fprintf(stderr, "Failed to read %s\n", input);
+        return EXIT_FAILURE;
+    }
+    std::vector<char> bin{};
+    const ErrorType err = Spritesheet::Compile(input, text, textLength, bin);
+    UnloadFileData((unsigned char *)text);
+    if (err != ErrorType::Success) {
+        return EXIT_FAILURE;
+    }
+
+    // Check it loads back before anyone tries to start the game with it
+    Spritesheet &check = *(new Spritesheet{});
+    char *checkData = (char *)MemAlloc((unsigned int)bin.size());
+    memcpy(checkData, bin.data(), bin.size());
+    if (check.LoadBinary(output, checkData, (unsigned int)bin.size()) != ErrorType::Success) {
+        fprintf(stderr, "%s failed to load back after compiling\n", output);
+        return EXIT_FAILURE;
+    }
+    printf("%s: %zu frames, %zu animations, %zu sprites, %zu bytes\n", output, check.frames.size(),
+        check.animations.size(), check.sprites.size(), bin.size());
+    delete &check;
+
+    if (!SaveFileData(output, bin.data(), (unsigned int)bin.size())) {
+        fprintf(stderr, "Failed to write %s\n", output);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+#include "../src/draw_command.cpp"
+#include "../src/spritesheet.cpp"